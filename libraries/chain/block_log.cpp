@@ -1,107 +1,275 @@
 #include <chain/block_log.hpp>
-#include <fstream>
+#include <chain/compressed_block_log.hpp>
 #include <fc/io/raw.hpp>
+#include <fc/bitutil.hpp>
 
 #include <boost/thread/mutex.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
-#include <boost/interprocess/sync/lock_options.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 
-#define LOG_READ  (std::ios::in | std::ios::binary)
-#define LOG_WRITE (std::ios::out | std::ios::binary | std::ios::app)
+#include <atomic>
+#include <memory>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace taiyi { namespace chain {
 
     typedef boost::interprocess::scoped_lock< boost::mutex > scoped_lock;
 
-    boost::interprocess::defer_lock_type defer_lock;
-
     namespace detail {
-  
+
+        /**
+         * 文件打开时已有部分的只读映射，区块日志只追加，这部分内容不会再改变
+         */
+        struct mapped_file
+        {
+            std::unique_ptr< boost::interprocess::file_mapping >    mapping;
+            std::unique_ptr< boost::interprocess::mapped_region >   region;
+            const char*                                             data = nullptr;
+            uint64_t                                                size = 0;
+
+            void map( const fc::path& file, uint64_t file_size )
+            {
+                unmap();
+                if( file_size == 0 )
+                    return;
+
+                mapping.reset( new boost::interprocess::file_mapping( file.generic_string().c_str(), boost::interprocess::read_only ) );
+                region.reset( new boost::interprocess::mapped_region( *mapping, boost::interprocess::read_only, 0, file_size ) );
+                region->advise( boost::interprocess::mapped_region::advice_random );
+                data = (const char*)region->get_address();
+                size = file_size;
+            }
+
+            void unmap()
+            {
+                data = nullptr;
+                size = 0;
+                region.reset();
+                mapping.reset();
+            }
+
+            const char* find( uint64_t offset, uint64_t len )const
+            {
+                return offset + len <= size ? data + offset : nullptr;
+            }
+        };
+
         class block_log_impl
         {
         public:
-            optional< signed_block > head;
-            block_id_type            head_id;
-            std::fstream             block_stream;
-            std::fstream             index_stream;
-            fc::path                 block_file;
-            fc::path                 index_file;
-            bool                     block_write = false;
-            bool                     index_write = false;
-
-            bool                     use_locking = true;
-
-            boost::mutex             mtx;
-
-            inline void check_block_read()
-            { try {
-                if( block_write )
-                {
-                    block_stream.close();
-                    block_stream.open( block_file.generic_string().c_str(), LOG_READ );
-                    block_write = false;
-                }
-            } FC_LOG_AND_RETHROW() }
+            ~block_log_impl()
+            {
+                block_map.unmap();
+                index_map.unmap();
+                if( block_fd != -1 )
+                    ::close( block_fd );
+                if( index_fd != -1 )
+                    ::close( index_fd );
+            }
 
-            inline void check_block_write()
-            { try {
-                if( !block_write )
-                {
-                    block_stream.close();
-                    block_stream.open( block_file.generic_string().c_str(), LOG_WRITE );
-                    block_write = true;
-                }
-            } FC_LOG_AND_RETHROW() }
+            std::shared_ptr< const signed_block >   head;           ///< 通过std::atomic_load/std::atomic_store访问
+            std::atomic< uint64_t >                 block_size{ 0 };
+            std::atomic< uint64_t >                 index_size{ 0 };
+
+            int                                     block_fd = -1;
+            int                                     index_fd = -1;
+            fc::path                                block_file;
+            fc::path                                index_file;
 
-            inline void check_index_read()
-            { try {
-                if( index_write )
+            mapped_file                             block_map;
+            mapped_file                             index_map;
+
+            boost::mutex                            write_mtx;      ///< 只用于串行化写入，读取不加锁
+
+            std::unique_ptr< compressed_block_log > compressed;     ///< 压缩格式的日志，这时上面的成员都不使用
+
+            static int open_file( const fc::path& file )
+            {
+                int fd = ::open( file.generic_string().c_str(), O_RDWR | O_APPEND | O_CREAT, 0644 );
+                FC_ASSERT( fd != -1, "Could not open ${f}: ${e}", ("f", file.generic_string())("e", strerror( errno )) );
+                return fd;
+            }
+
+            static uint64_t file_size( int fd )
+            {
+                struct stat st;
+                FC_ASSERT( fstat( fd, &st ) == 0, "Could not stat block log file: ${e}", ("e", strerror( errno )) );
+                return st.st_size;
+            }
+
+            static void write_all( int fd, const char* data, size_t len )
+            {
+                while( len > 0 )
                 {
-                    index_stream.close();
-                    index_stream.open( index_file.generic_string().c_str(), LOG_READ );
-                    index_write = false;
+                    ssize_t n = ::write( fd, data, len );
+                    if( n == -1 && errno == EINTR )
+                        continue;
+                    FC_ASSERT( n > 0, "Could not write to block log file: ${e}", ("e", strerror( errno )) );
+                    data += n;
+                    len -= n;
                 }
-            } FC_LOG_AND_RETHROW() }
+            }
 
-            inline void check_index_write()
-            { try {
-                if( !index_write )
+            static void pread_all( int fd, char* data, size_t len, uint64_t offset )
+            {
+                while( len > 0 )
                 {
-                    index_stream.close();
-                    index_stream.open( index_file.generic_string().c_str(), LOG_WRITE );
-                    index_write = true;
+                    ssize_t n = ::pread( fd, data, len, offset );
+                    if( n == -1 && errno == EINTR )
+                        continue;
+                    FC_ASSERT( n > 0, "Could not read from block log file: ${e}", ("e", n == 0 ? std::string( "unexpected end of file" ) : std::string( strerror( errno ) )) );
+                    data += n;
+                    len -= n;
+                    offset += n;
                 }
-            } FC_LOG_AND_RETHROW() }
+            }
+
+            /** 读取[offset, offset+len)，在映射范围内时直接返回映射地址，否则读入buffer */
+            const char* read( int fd, const mapped_file& map, uint64_t offset, uint64_t len, std::vector<char>& buffer )const
+            {
+                const char* data = map.find( offset, len );
+                if( data )
+                    return data;
+
+                buffer.resize( len );
+                pread_all( fd, buffer.data(), len, offset );
+                return buffer.data();
+            }
+
+            uint64_t read_uint64( int fd, const mapped_file& map, uint64_t offset )const
+            {
+                std::vector<char> buffer;
+                uint64_t value;
+                memcpy( &value, read( fd, map, offset, sizeof( value ), buffer ), sizeof( value ) );
+                return value;
+            }
+
+            uint32_t head_num()const
+            {
+                auto h = std::atomic_load( &head );
+                return h ? h->block_num() : 0;
+            }
+
+            uint64_t get_block_pos( uint32_t block_num )const
+            {
+                if( !( block_num > 0 && block_num <= head_num() ) )
+                    return block_log::npos;
+                return read_uint64( index_fd, index_map, sizeof( uint64_t ) * ( block_num - 1 ) );
+            }
+
+            /** 读取位于pos长度为len的区块，返回区块和下一个区块的位置 */
+            std::pair< signed_block, uint64_t > read_block( uint64_t pos, uint64_t len )const
+            {
+                std::vector<char> buffer;
+                const char* data = read( block_fd, block_map, pos, len, buffer );
+
+                std::pair< signed_block, uint64_t > result;
+                fc::datastream< const char* > ds( data, len );
+                fc::raw::unpack( ds, result.first );
+                result.second = pos + len + sizeof( uint64_t );
+                return result;
+            }
+
+            /** 由区块头中previous的前4个字节得到区块号，再由下一个区块的位置得到区块长度 */
+            uint64_t get_block_size( uint64_t pos )const
+            {
+                //写入时先发布索引大小再发布区块文件大小，这里按相反的顺序读取：
+                //索引里还没有下一个区块时，读到的区块文件大小也一定还不包含下一个区块
+                uint64_t log_size = block_size.load( std::memory_order_acquire );
+                uint64_t idx_size = index_size.load( std::memory_order_acquire );
+
+                std::vector<char> buffer;
+                uint32_t previous_num;
+                memcpy( &previous_num, read( block_fd, block_map, pos, sizeof( previous_num ), buffer ), sizeof( previous_num ) );
+                uint64_t num = fc::endian_reverse_u32( previous_num ) + 1ull;
+                FC_ASSERT( num * sizeof( uint64_t ) <= idx_size, "Invalid block position ${p}.", ("p", pos) );
+
+                uint64_t end = log_size - sizeof( uint64_t );
+                if( ( num + 1 ) * sizeof( uint64_t ) <= idx_size )
+                    end = read_uint64( index_fd, index_map, num * sizeof( uint64_t ) ) - sizeof( uint64_t );
+                FC_ASSERT( end > pos, "Invalid block position ${p}.", ("p", pos) );
+                return end - pos;
+            }
+
+            signed_block read_head()const
+            {
+                uint64_t size = block_size.load( std::memory_order_acquire );
+                FC_ASSERT( size > sizeof( uint64_t ), "Block log is empty." );
+
+                uint64_t pos = read_uint64( block_fd, block_map, size - sizeof( uint64_t ) );
+                return read_block( pos, size - sizeof( uint64_t ) - pos ).first;
+            }
+
+            void construct_index();
         };
-        
+
+        void block_log_impl::construct_index()
+        { try {
+            ilog( "Reconstructing Block Log Index..." );
+            index_map.unmap();
+            FC_ASSERT( ftruncate( index_fd, 0 ) == 0, "Could not truncate block log index: ${e}", ("e", strerror( errno )) );
+
+            uint64_t size = block_size.load();
+            uint64_t end_pos = read_uint64( block_fd, block_map, size - sizeof( uint64_t ) );
+
+            //在映射的区块文件上顺序解析，只是为了得到每个区块的结束位置
+            FC_ASSERT( block_map.size == size );
+            fc::datastream< const char* > ds( block_map.data, size );
+            std::vector<char> index;
+            signed_block tmp;
+            uint64_t pos = 0;
+
+            while( pos < end_pos )
+            {
+                fc::raw::unpack( ds, tmp );
+                ds.read( (char*)&pos, sizeof( pos ) );
+                index.insert( index.end(), (const char*)&pos, (const char*)&pos + sizeof( pos ) );
+            }
+
+            write_all( index_fd, index.data(), index.size() );
+            index_size = index.size();
+            index_map.map( index_file, index.size() );
+        } FC_LOG_AND_RETHROW() }
+
     } //detail
 
     block_log::block_log()
-    :my( new detail::block_log_impl() )
-    {
-        my->block_stream.exceptions( std::fstream::failbit | std::fstream::badbit );
-        my->index_stream.exceptions( std::fstream::failbit | std::fstream::badbit );
-    }
+    :my( std::make_shared< detail::block_log_impl >() )
+    {}
 
     block_log::~block_log()
     {
         flush();
     }
 
-    void block_log::open( const fc::path& file )
+    void block_log::open( const fc::path& file, uint32_t compress_chunk_blocks )
     {
-        if( my->block_stream.is_open() )
-            my->block_stream.close();
-        if( my->index_stream.is_open() )
-            my->index_stream.close();
-        
-        my->block_file = file;
-        my->index_file = fc::path( file.generic_string() + ".index" );
-        
-        my->block_stream.open( my->block_file.generic_string().c_str(), LOG_WRITE );
-        my->index_stream.open( my->index_file.generic_string().c_str(), LOG_WRITE );
-        my->block_write = true;
-        my->index_write = true;
+        //新的实现完全打开之后才替换，读者持有的旧实现在最后一个读者结束时才释放
+        auto impl = std::make_shared< detail::block_log_impl >();
+
+        //文件格式由已有文件决定，新建的日志才按参数选择是否压缩
+        bool is_new = !fc::exists( file ) || fc::file_size( file ) == 0;
+        if( compressed_block_log::is_compressed_log( file ) || ( is_new && compress_chunk_blocks > 0 ) )
+        {
+            impl->compressed.reset( new compressed_block_log() );
+            impl->compressed->open( file, compress_chunk_blocks > 0 ? compress_chunk_blocks : compressed_block_log::default_chunk_blocks );
+            std::atomic_store( &my, impl );
+            return;
+        }
+        if( compress_chunk_blocks > 0 )
+            wlog( "Block log ${f} is not compressed, convert it with test_block_log to use compression", ("f", file.generic_string()) );
+
+        impl->block_file = file;
+        impl->index_file = fc::path( file.generic_string() + ".index" );
+
+        impl->block_fd = detail::block_log_impl::open_file( impl->block_file );
+        impl->index_fd = detail::block_log_impl::open_file( impl->index_file );
 
         /* On startup of the block log, there are several states the log file and the index file can be
          * in relation to eachother.
@@ -121,229 +289,176 @@ namespace taiyi { namespace chain {
          *  - If the index file head is not in the log file, delete the index and replay.
          *  - If the index file head is in the log, but not up to date, replay from index head.
          */
-        auto log_size = fc::file_size( my->block_file );
-        auto index_size = fc::file_size( my->index_file );
+        uint64_t log_size = detail::block_log_impl::file_size( impl->block_fd );
+        uint64_t index_size = detail::block_log_impl::file_size( impl->index_fd );
+        impl->block_size = log_size;
+        impl->index_size = index_size;
+        impl->block_map.map( impl->block_file, log_size );
 
         if( log_size )
         {
             ilog( "Log is nonempty" );
-            my->head = read_head();
-            my->head_id = my->head->id();
-            
+            std::atomic_store( &impl->head, std::shared_ptr< const signed_block >( new signed_block( impl->read_head() ) ) );
+
             if( index_size )
             {
-                my->check_block_read();
-                my->check_index_read();
-                
                 ilog( "Index is nonempty" );
-                uint64_t block_pos;
-                my->block_stream.seekg( -sizeof( uint64_t), std::ios::end );
-                my->block_stream.read( (char*)&block_pos, sizeof( block_pos ) );
-                
-                uint64_t index_pos;
-                my->index_stream.seekg( -sizeof( uint64_t), std::ios::end );
-                my->index_stream.read( (char*)&index_pos, sizeof( index_pos ) );
-                
+                impl->index_map.map( impl->index_file, index_size );
+                uint64_t block_pos = impl->read_uint64( impl->block_fd, impl->block_map, log_size - sizeof( uint64_t ) );
+                uint64_t index_pos = impl->read_uint64( impl->index_fd, impl->index_map, index_size - sizeof( uint64_t ) );
+
                 if( block_pos < index_pos )
                 {
                     ilog( "block_pos < index_pos, close and reopen index_stream" );
-                    construct_index();
+                    impl->construct_index();
                 }
                 else if( block_pos > index_pos )
                 {
                     ilog( "Index is incomplete" );
-                    construct_index();
+                    impl->construct_index();
                 }
             }
             else
             {
                 ilog( "Index is empty" );
-                construct_index();
+                impl->construct_index();
             }
         }
         else if( index_size )
         {
             ilog( "Index is nonempty, remove and recreate it" );
-            my->index_stream.close();
-            fc::remove_all( my->index_file );
-            my->index_stream.open( my->index_file.generic_string().c_str(), LOG_WRITE );
-            my->index_write = true;
+            FC_ASSERT( ftruncate( impl->index_fd, 0 ) == 0, "Could not truncate block log index: ${e}", ("e", strerror( errno )) );
+            impl->index_size = 0;
         }
+
+        std::atomic_store( &my, impl );
     }
 
     void block_log::close()
     {
-        my.reset( new detail::block_log_impl() );
+        std::atomic_store( &my, std::make_shared< detail::block_log_impl >() );
     }
-    
+
     bool block_log::is_open()const
     {
-        return my->block_stream.is_open();
+        auto impl = std::atomic_load( &my );
+        if( impl->compressed )
+            return impl->compressed->is_open();
+        return impl->block_fd != -1;
     }
-    
+
+    bool block_log::is_compressed()const
+    {
+        return std::atomic_load( &my )->compressed != nullptr;
+    }
+
+    void block_log::set_read_ahead( bool read_ahead )
+    {
+        auto impl = std::atomic_load( &my );
+        if( impl->compressed )
+            impl->compressed->set_read_ahead( read_ahead );
+    }
+
     uint64_t block_log::append( const signed_block& b )
     { try {
-        scoped_lock lock( my->mtx, defer_lock );
-        
-        if( my->use_locking )
+        auto impl = std::atomic_load( &my );
+        if( impl->compressed )
         {
-            lock.lock();;
+            impl->compressed->append( b );
+            return b.block_num() - 1;
         }
-        
-        my->check_block_write();
-        my->check_index_write();
-        
-        uint64_t pos = my->block_stream.tellp();
-        FC_ASSERT( static_cast<uint64_t>(my->index_stream.tellp()) == sizeof( uint64_t ) * ( b.block_num() - 1 ),
+
+        scoped_lock lock( impl->write_mtx );
+
+        uint64_t pos = impl->block_size.load( std::memory_order_relaxed );
+        uint64_t index_pos = impl->index_size.load( std::memory_order_relaxed );
+        FC_ASSERT( index_pos == sizeof( uint64_t ) * ( b.block_num() - 1 ),
                   "Append to index file occuring at wrong position.",
-                  ( "position", (uint64_t) my->index_stream.tellp() )( "expected",( b.block_num() - 1 ) * sizeof( uint64_t ) ) );
+                  ( "position", index_pos )( "expected",( b.block_num() - 1 ) * sizeof( uint64_t ) ) );
+
+        //区块和它的位置一次写入
         auto data = fc::raw::pack_to_vector( b );
-        my->block_stream.write( data.data(), data.size() );
-        my->block_stream.write( (char*)&pos, sizeof( pos ) );
-        my->index_stream.write( (char*)&pos, sizeof( pos ) );
-        my->head = b;
-        my->head_id = b.id();
-        
+        data.insert( data.end(), (const char*)&pos, (const char*)&pos + sizeof( pos ) );
+        detail::block_log_impl::write_all( impl->block_fd, data.data(), data.size() );
+        detail::block_log_impl::write_all( impl->index_fd, (const char*)&pos, sizeof( pos ) );
+
+        //依次发布索引大小、区块文件大小和新的head，读到新head的读者一定能读到它之前的全部数据
+        impl->index_size.store( index_pos + sizeof( pos ), std::memory_order_release );
+        impl->block_size.store( pos + data.size(), std::memory_order_release );
+        std::atomic_store( &impl->head, std::shared_ptr< const signed_block >( new signed_block( b ) ) );
+
         return pos;
     } FC_LOG_AND_RETHROW() }
 
     void block_log::flush()
     {
-        scoped_lock lock( my->mtx, defer_lock );
-        
-        if( my->use_locking )
-        {
-            lock.lock();;
-        }
-        
-        my->block_stream.flush();
-        my->index_stream.flush();
+        //写入没有用户态缓冲，数据已经在操作系统中，这里不需要做任何事
     }
 
     std::pair< signed_block, uint64_t > block_log::read_block( uint64_t pos )const
-    {
-        scoped_lock lock( my->mtx, defer_lock );
-        
-        if( my->use_locking )
+    { try {
+        auto impl = std::atomic_load( &my );
+        if( impl->compressed )
         {
-            lock.lock();;
+            //压缩日志中的位置就是区块号减一
+            auto b = impl->compressed->read_block_by_num( pos + 1 );
+            FC_ASSERT( b.valid(), "Block ${n} is not in block log.", ("n", pos + 1) );
+            return std::make_pair( std::move( *b ), pos + 1 );
         }
-        
-        return read_block_helper( pos );
-    }
-
-    std::pair< signed_block, uint64_t > block_log::read_block_helper( uint64_t pos )const
-    { try {
-        my->check_block_read();
-        
-        my->block_stream.seekg( pos );
-        std::pair<signed_block,uint64_t> result;
-        fc::raw::unpack( my->block_stream, result.first );
-        result.second = uint64_t(my->block_stream.tellg()) + 8;
-        return result;
+        return impl->read_block( pos, impl->get_block_size( pos ) );
     } FC_LOG_AND_RETHROW() }
 
     optional< signed_block > block_log::read_block_by_num( uint32_t block_num )const
     { try {
-        scoped_lock lock( my->mtx, defer_lock );
-        
-        if( my->use_locking )
-        {
-            lock.lock();;
-        }
-        
+        auto impl = std::atomic_load( &my );
+        if( impl->compressed )
+            return impl->compressed->read_block_by_num( block_num );
+
         optional< signed_block > b;
-        uint64_t pos = get_block_pos_helper( block_num );
+        uint64_t pos = impl->get_block_pos( block_num );
         if( pos != npos )
         {
-            b = read_block_helper( pos ).first;
+            b = impl->read_block( pos, impl->get_block_size( pos ) ).first;
             FC_ASSERT( b->block_num() == block_num , "Wrong block was read from block log.", ( "returned", b->block_num() )( "expected", block_num ));
         }
         return b;
     } FC_LOG_AND_RETHROW() }
 
     uint64_t block_log::get_block_pos( uint32_t block_num ) const
-    {
-        scoped_lock lock( my->mtx, defer_lock );
-        
-        if( my->use_locking )
-        {
-            lock.lock();;
-        }
-        
-        return get_block_pos_helper( block_num );
-    }
-
-    uint64_t block_log::get_block_pos_helper( uint32_t block_num ) const
     { try {
-        my->check_index_read();
-        
-        if( !( my->head.valid() && block_num <= protocol::block_header::num_from_id( my->head_id ) && block_num > 0 ) )
-            return npos;
-        my->index_stream.seekg( sizeof( uint64_t ) * ( block_num - 1 ) );
-        uint64_t pos;
-        my->index_stream.read( (char*)&pos, sizeof( pos ) );
-        return pos;
+        auto impl = std::atomic_load( &my );
+        if( impl->compressed )
+            return block_num > 0 && block_num <= impl->compressed->head_block_num() ? block_num - 1 : npos;
+        return impl->get_block_pos( block_num );
     } FC_LOG_AND_RETHROW() }
 
     signed_block block_log::read_head()const
     { try {
-        scoped_lock lock( my->mtx, defer_lock );
-        
-        if( my->use_locking )
+        auto impl = std::atomic_load( &my );
+        if( impl->compressed )
         {
-            lock.lock();;
+            auto h = impl->compressed->head();
+            FC_ASSERT( h.valid(), "Block log is empty." );
+            return *h;
         }
-        
-        my->check_block_read();
-        
-        uint64_t pos;
-        my->block_stream.seekg( -sizeof(pos), std::ios::end );
-        my->block_stream.read( (char*)&pos, sizeof(pos) );
-        return read_block_helper( pos ).first;
+        return impl->read_head();
     } FC_LOG_AND_RETHROW() }
 
-    const optional< signed_block >& block_log::head()const
+    optional< signed_block > block_log::head()const
     {
-        scoped_lock lock( my->mtx, defer_lock );
-        
-        if( my->use_locking )
-        {
-            lock.lock();;
-        }
-        
-        return my->head;
-    }
+        auto impl = std::atomic_load( &my );
+        if( impl->compressed )
+            return impl->compressed->head();
 
-    void block_log::construct_index()
-    { try {
-        ilog( "Reconstructing Block Log Index..." );
-        my->index_stream.close();
-        fc::remove_all( my->index_file );
-        my->index_stream.open( my->index_file.generic_string().c_str(), LOG_WRITE );
-        my->index_write = true;
-        
-        uint64_t pos = 0;
-        uint64_t end_pos;
-        my->check_block_read();
-        
-        my->block_stream.seekg( -sizeof( uint64_t), std::ios::end );
-        my->block_stream.read( (char*)&end_pos, sizeof( end_pos ) );
-        signed_block tmp;
-        
-        my->block_stream.seekg( pos );
-        
-        while( pos < end_pos )
-        {
-            fc::raw::unpack( my->block_stream, tmp );
-            my->block_stream.read( (char*)&pos, sizeof( pos ) );
-            my->index_stream.write( (char*)&pos, sizeof( pos ) );
-        }
-    } FC_LOG_AND_RETHROW() }
+        optional< signed_block > result;
+        auto h = std::atomic_load( &impl->head );
+        if( h )
+            result = *h;
+        return result;
+    }
 
     void block_log::set_locking( bool use_locking )
     {
-        my->use_locking = true;
     }
-    
+
 } } // taiyi::chain
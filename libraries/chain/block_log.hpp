@@ -31,6 +31,19 @@ namespace taiyi { namespace chain {
      *
      * The main file is the only file that needs to persist. The index file can be reconstructed during a
      * linear scan of the main file.
+     *
+     * Readers never take a lock. Both files are memory mapped up to their size at open time (the history
+     * never changes), anything appended after that is read with pread. The writer appends each block and
+     * its index entry with a single write per file, then publishes the new sizes and head atomically.
+     * A reader loads the head first, so everything up to that head is already visible.
+     *
+     * open and close build a new implementation (mappings, file descriptors) and swap it in atomically.
+     * Every call works on the shared_ptr it loaded, so an old mapping is released only after the last
+     * reader using it has finished.
+     *
+     * A block log can also be stored in the compressed, chunked format of compressed_block_log. The format
+     * of an existing file is detected on open, a new file is compressed when compress_chunk_blocks is set.
+     * In that format the file positions returned by append, get_block_pos and read_block are block_num - 1.
      */
 
     class block_log
@@ -39,9 +52,13 @@ namespace taiyi { namespace chain {
         block_log();
         ~block_log();
         
-        void open( const fc::path& file );
+        void open( const fc::path& file, uint32_t compress_chunk_blocks = 0 );
         void close();
         bool is_open()const;
+        bool is_compressed()const;
+
+        /** Decompress the next chunk in background while reading a compressed log sequentially */
+        void set_read_ahead( bool read_ahead );
 
         uint64_t append( const signed_block& b );
         void flush();
@@ -53,23 +70,17 @@ namespace taiyi { namespace chain {
          */
         uint64_t get_block_pos( uint32_t block_num ) const;
         signed_block read_head()const;
-        const optional< signed_block >& head()const;
+        optional< signed_block > head()const;
 
         /*
-         * Used by the database to skip locking when reindexing
-         * APIs don't work at this point, so there is no danger.
+         * Readers do not lock any more, kept for compatibility.
          */
         void set_locking( bool );
         
         static const uint64_t npos = std::numeric_limits<uint64_t>::max();
         
     private:
-        void construct_index();
-        
-        std::pair< signed_block, uint64_t > read_block_helper( uint64_t file_pos )const;
-        uint64_t get_block_pos_helper( uint32_t block_num ) const;
-        
-        std::unique_ptr<detail::block_log_impl> my;
+        std::shared_ptr<detail::block_log_impl> my; ///< 通过std::atomic_load/std::atomic_store访问
     };
 
 } } //taiyi::chain
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <chain/util/advanced_benchmark_dumper.hpp>
+
+#include <chainbase/chainbase.hpp>
+
+#include <fc/signals.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace taiyi { namespace chain {
+
+    /**
+     * 一个块对一个索引的所有修改，由块的撤销状态得到。
+     * 指针指向索引中的当前对象和撤销状态中的旧值，没有复制，只在回调期间有效。
+     *
+     * 块被弹出时（pop_block，包括分叉切换）在撤销之前以reverted再发一次同样的列表：
+     * created中的对象将被删除，modified中的对象恢复为first，removed中的对象将被恢复
+     */
+    template< typename ObjectType >
+    struct changed_objects_notification
+    {
+        typedef std::pair< const ObjectType*, const ObjectType* > modified_pair;    ///< 修改前，修改后
+
+        uint32_t                            block_num = 0;
+        size_t                              change_count = 0;   ///< 修改的对象总数，truncated时也有效
+        bool                                truncated = false;  ///< 修改数量超过订阅时给出的上限，没有列出对象，订阅者需要自行重新同步
+        bool                                reverted = false;   ///< 块的修改正在被撤销
+
+        std::vector< const ObjectType* >    created;
+        std::vector< modified_pair >        modified;           ///< 块内第一次修改前的值和当前值
+        std::vector< const ObjectType* >    removed;            ///< 块开始时的值
+    };
+
+    class abstract_changed_objects_feed
+    {
+    public:
+        virtual ~abstract_changed_objects_feed() {}
+
+        virtual const void* get_index_address()const = 0;
+        virtual void notify( uint32_t block_num, bool reverted ) = 0;
+    };
+
+    /**
+     * 一个索引的变更流，每个块结束时把块的撤销状态整理成通知，一次发给所有订阅者。
+     *
+     * 订阅时可以给出一个块最多接收的修改数量，超过时只收到truncated通知。
+     * 所有订阅者都有上限时，超过最大上限的块不再整理对象列表，开销只有一次计数
+     */
+    template< typename MultiIndexType >
+    class changed_objects_feed : public abstract_changed_objects_feed
+    {
+    public:
+        typedef typename MultiIndexType::value_type                     object_type;
+        typedef changed_objects_notification< object_type >             notification_type;
+        typedef std::function< void( const notification_type& ) >      handler_type;
+
+        changed_objects_feed( const chainbase::generic_index< MultiIndexType >& index, util::advanced_benchmark_dumper& dumper )
+            : _index( index ), _benchmark_dumper( dumper ) {}
+
+        virtual const void* get_index_address()const override { return &_index; }
+
+        boost::signals2::connection connect( const handler_type& func, const std::string& plugin_name, uint32_t max_changes, int32_t group )
+        {
+            if( max_changes == 0 )
+                _unbounded = true;
+            else
+                _max_changes = std::max( _max_changes, max_changes );
+
+            std::string name = plugin_name + "<-changed_objects";
+            auto& dumper = _benchmark_dumper;
+            return _signal.connect( group, [func, name, max_changes, &dumper]( const notification_type& note ) {
+                if( dumper.is_enabled() )
+                    dumper.begin();
+
+                if( max_changes && !note.truncated && note.change_count > max_changes )
+                {
+                    notification_type truncated;
+                    truncated.block_num = note.block_num;
+                    truncated.change_count = note.change_count;
+                    truncated.truncated = true;
+                    truncated.reverted = note.reverted;
+                    func( truncated );
+                }
+                else
+                    func( note );
+
+                if( dumper.is_enabled() )
+                    dumper.end( name );
+            } );
+        }
+
+        virtual void notify( uint32_t block_num, bool reverted ) override
+        {
+            if( _signal.empty() )
+                return;
+
+            size_t count = _index.head_change_count();
+            if( count == 0 )
+                return;
+
+            notification_type note;
+            note.block_num = block_num;
+            note.change_count = count;
+            note.reverted = reverted;
+
+            if( !_unbounded && count > _max_changes )
+            {
+                note.truncated = true;
+                _signal( note );
+                return;
+            }
+
+            std::deque< object_type > decoded;
+            _index.visit_head_changes( decoded,
+                [&]( const object_type& o ) { note.created.push_back( &o ); },
+                [&]( const object_type& before, const object_type& after ) { note.modified.emplace_back( &before, &after ); },
+                [&]( const object_type& o ) { note.removed.push_back( &o ); } );
+
+            _signal( note );
+        }
+
+    private:
+        const chainbase::generic_index< MultiIndexType >&   _index;
+        util::advanced_benchmark_dumper&                    _benchmark_dumper;
+        fc::signal< void( const notification_type& ) >      _signal;
+        uint32_t                                            _max_changes = 0;
+        bool                                                _unbounded = false;
+    };
+
+} } // taiyi::chain
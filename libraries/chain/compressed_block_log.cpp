@@ -0,0 +1,467 @@
+#include <chain/compressed_block_log.hpp>
+#include <fc/io/raw.hpp>
+
+#include <zlib.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace taiyi { namespace chain {
+
+    const uint64_t compressed_block_log::magic = 0x3247'4F4C'4B4C'4254ull; // "TBLKLOG2"
+    const uint32_t compressed_block_log::default_chunk_blocks;
+
+    namespace {
+
+        const uint32_t log_version = 2;
+        const size_t   log_header_size = 32;     // magic, version, chunk_blocks, compression, reserved
+        const size_t   chunk_header_size = 16;   // compressed size, raw size, first block, block count
+        const size_t   max_chunk_cache = 4;
+
+        int open_file( const fc::path& file )
+        {
+            int fd = ::open( file.generic_string().c_str(), O_RDWR | O_APPEND | O_CREAT, 0644 );
+            FC_ASSERT( fd != -1, "Could not open ${f}: ${e}", ("f", file.generic_string())("e", strerror( errno )) );
+            return fd;
+        }
+
+        uint64_t file_size( int fd )
+        {
+            struct stat st;
+            FC_ASSERT( fstat( fd, &st ) == 0, "Could not stat block log file: ${e}", ("e", strerror( errno )) );
+            return st.st_size;
+        }
+
+        void truncate_file( int fd, uint64_t size )
+        {
+            FC_ASSERT( ftruncate( fd, size ) == 0, "Could not truncate block log file: ${e}", ("e", strerror( errno )) );
+        }
+
+        void write_all( int fd, const char* data, size_t len )
+        {
+            while( len > 0 )
+            {
+                ssize_t n = ::write( fd, data, len );
+                if( n == -1 && errno == EINTR )
+                    continue;
+                FC_ASSERT( n > 0, "Could not write to block log file: ${e}", ("e", strerror( errno )) );
+                data += n;
+                len -= n;
+            }
+        }
+
+        /** 返回实际读到的字节数，只有到达文件末尾时才会少于len */
+        size_t pread_all( int fd, char* data, size_t len, uint64_t offset )
+        {
+            size_t total = 0;
+            while( total < len )
+            {
+                ssize_t n = ::pread( fd, data + total, len - total, offset + total );
+                if( n == -1 && errno == EINTR )
+                    continue;
+                FC_ASSERT( n >= 0, "Could not read from block log file: ${e}", ("e", strerror( errno )) );
+                if( n == 0 )
+                    break;
+                total += n;
+            }
+            return total;
+        }
+
+        uint32_t get_u32( const char* p )
+        {
+            uint32_t v;
+            memcpy( &v, p, sizeof( v ) );
+            return v;
+        }
+
+        void put_u32( char* p, uint32_t v )
+        {
+            memcpy( p, &v, sizeof( v ) );
+        }
+
+    } // anonymous
+
+    compressed_block_log::compressed_block_log()
+    {}
+
+    compressed_block_log::~compressed_block_log()
+    {
+        close();
+    }
+
+    bool compressed_block_log::is_compressed_log( const fc::path& file )
+    {
+        if( !fc::exists( file ) || fc::file_size( file ) < sizeof( magic ) )
+            return false;
+
+        int fd = ::open( file.generic_string().c_str(), O_RDONLY );
+        if( fd == -1 )
+            return false;
+        uint64_t m = 0;
+        bool result = pread_all( fd, (char*)&m, sizeof( m ), 0 ) == sizeof( m ) && m == magic;
+        ::close( fd );
+        return result;
+    }
+
+    void compressed_block_log::open( const fc::path& file, uint32_t chunk_blocks )
+    { try {
+        close();
+
+        _block_file = file;
+        _index_file = fc::path( file.generic_string() + ".index" );
+        _tail_file = fc::path( file.generic_string() + ".tail" );
+
+        _block_fd = open_file( _block_file );
+        _index_fd = open_file( _index_file );
+        _tail_fd = open_file( _tail_file );
+
+        char header[ log_header_size ];
+        _block_size = file_size( _block_fd );
+        if( _block_size == 0 )
+        {
+            FC_ASSERT( chunk_blocks > 0, "Number of blocks in a chunk must be positive." );
+            memset( header, 0, sizeof( header ) );
+            memcpy( header, &magic, sizeof( magic ) );
+            put_u32( header + 8, log_version );
+            put_u32( header + 12, chunk_blocks );
+            header[ 16 ] = (char)zlib_compression;
+            write_all( _block_fd, header, sizeof( header ) );
+            _block_size = sizeof( header );
+
+            truncate_file( _index_fd, 0 );
+            truncate_file( _tail_fd, 0 );
+        }
+        else
+        {
+            FC_ASSERT( pread_all( _block_fd, header, sizeof( header ), 0 ) == sizeof( header ), "Block log header is incomplete." );
+            uint64_t m;
+            memcpy( &m, header, sizeof( m ) );
+            FC_ASSERT( m == magic, "${f} is not a compressed block log.", ("f", file.generic_string()) );
+            FC_ASSERT( get_u32( header + 8 ) == log_version, "Unsupported block log version ${v}.", ("v", get_u32( header + 8 )) );
+        }
+
+        _chunk_blocks = get_u32( header + 12 );
+        _compression = (uint8_t)header[ 16 ];
+        FC_ASSERT( _chunk_blocks > 0 );
+        FC_ASSERT( _compression == no_compression || _compression == zlib_compression, "Unknown block log compression ${c}.", ("c", _compression) );
+
+        reconstruct_index();
+        load_tail();
+    } FC_CAPTURE_LOG_AND_RETHROW( (file) ) }
+
+    void compressed_block_log::close()
+    {
+        {
+            decltype( _chunk_cache ) chunks;
+            {
+                std::lock_guard< std::mutex > lock( _mutex );
+                chunks.swap( _chunk_cache );
+            }
+            chunks.clear(); //在锁外等待后台解压完成
+        }
+
+        if( _block_fd != -1 )
+            ::close( _block_fd );
+        if( _index_fd != -1 )
+            ::close( _index_fd );
+        if( _tail_fd != -1 )
+            ::close( _tail_fd );
+        _block_fd = _index_fd = _tail_fd = -1;
+
+        _chunk_count = 0;
+        _block_size = 0;
+        _tail.clear();
+        _head.reset();
+    }
+
+    bool compressed_block_log::is_open()const
+    {
+        return _block_fd != -1;
+    }
+
+    void compressed_block_log::reconstruct_index()
+    {
+        //逐个读取区块头重建索引，只有与索引文件不一致时才重写；写了一半的区块在这里截掉
+        std::vector< uint64_t > positions;
+        uint64_t pos = log_header_size;
+        uint64_t size = _block_size;
+        uint32_t expected_first = 1;
+        char header[ chunk_header_size ];
+        while( pos + chunk_header_size <= size )
+        {
+            pread_all( _block_fd, header, sizeof( header ), pos );
+            uint64_t end = pos + chunk_header_size + get_u32( header );
+            if( end > size || get_u32( header + 8 ) != expected_first || get_u32( header + 12 ) != _chunk_blocks )
+                break;
+
+            positions.push_back( pos );
+            expected_first += _chunk_blocks;
+            pos = end;
+        }
+
+        if( pos != size )
+        {
+            wlog( "Block log has an incomplete chunk at ${p}, truncating ${n} bytes", ("p", pos)("n", size - pos) );
+            truncate_file( _block_fd, pos );
+            _block_size = pos;
+        }
+
+        std::vector< uint64_t > index( file_size( _index_fd ) / sizeof( uint64_t ) );
+        if( index.size() )
+            pread_all( _index_fd, (char*)index.data(), index.size() * sizeof( uint64_t ), 0 );
+        if( index != positions )
+        {
+            ilog( "Reconstructing Block Log Index..." );
+            truncate_file( _index_fd, 0 );
+            if( positions.size() )
+                write_all( _index_fd, (const char*)positions.data(), positions.size() * sizeof( uint64_t ) );
+        }
+
+        _chunk_count = positions.size();
+    }
+
+    void compressed_block_log::load_tail()
+    {
+        std::vector<char> data( file_size( _tail_fd ) );
+        if( data.size() )
+            pread_all( _tail_fd, data.data(), data.size(), 0 );
+
+        uint32_t next_num = _chunk_count * _chunk_blocks + 1;
+        size_t pos = 0;
+        bool rewrite = false;
+        while( pos + sizeof( uint32_t ) <= data.size() )
+        {
+            uint32_t len = get_u32( data.data() + pos );
+            if( pos + sizeof( uint32_t ) + len > data.size() )
+                break;
+
+            std::vector<char> packed( data.data() + pos + sizeof( uint32_t ), data.data() + pos + sizeof( uint32_t ) + len );
+            pos += sizeof( uint32_t ) + len;
+
+            uint32_t num = fc::raw::unpack_from_vector< signed_block >( packed ).block_num();
+            if( num < next_num )
+            {
+                rewrite = true; //已经压缩到最后一个块中
+                continue;
+            }
+            FC_ASSERT( num == next_num, "Block log tail is not continuous, expected ${e} got ${n}.", ("e", next_num)("n", num) );
+            _tail.push_back( std::move( packed ) );
+            ++next_num;
+        }
+
+        if( rewrite || pos != data.size() )
+        {
+            wlog( "Rewriting block log tail with ${n} blocks", ("n", _tail.size()) );
+            truncate_file( _tail_fd, 0 );
+            for( const auto& packed : _tail )
+            {
+                std::vector<char> record( sizeof( uint32_t ) );
+                put_u32( record.data(), packed.size() );
+                record.insert( record.end(), packed.begin(), packed.end() );
+                write_all( _tail_fd, record.data(), record.size() );
+            }
+        }
+
+        if( _tail.size() )
+            _head = fc::raw::unpack_from_vector< signed_block >( _tail.back() );
+        else if( _chunk_count )
+            _head = read_chunk_block( _chunk_count * _chunk_blocks );
+
+        if( _tail.size() >= _chunk_blocks )
+            write_chunk();
+    }
+
+    void compressed_block_log::append( const signed_block& b )
+    { try {
+        std::lock_guard< std::mutex > lock( _mutex );
+
+        uint32_t head_num = _head.valid() ? _head->block_num() : 0;
+        FC_ASSERT( b.block_num() == head_num + 1, "Append to block log occuring at wrong block number.", ("num", b.block_num())("expected", head_num + 1) );
+
+        auto packed = fc::raw::pack_to_vector( b );
+        std::vector<char> record( sizeof( uint32_t ) );
+        put_u32( record.data(), packed.size() );
+        record.insert( record.end(), packed.begin(), packed.end() );
+        write_all( _tail_fd, record.data(), record.size() );
+
+        _tail.push_back( std::move( packed ) );
+        _head = b;
+
+        if( _tail.size() >= _chunk_blocks )
+            write_chunk();
+    } FC_LOG_AND_RETHROW() }
+
+    void compressed_block_log::write_chunk()
+    {
+        uint32_t count = _tail.size();
+        std::vector<char> raw( count * sizeof( uint32_t ) );
+        for( uint32_t i = 0; i < count; ++i )
+        {
+            put_u32( raw.data() + i * sizeof( uint32_t ), raw.size() );
+            raw.insert( raw.end(), _tail[ i ].begin(), _tail[ i ].end() );
+        }
+
+        std::vector<char> chunk( chunk_header_size );
+        if( _compression == zlib_compression )
+        {
+            uLongf compressed_size = compressBound( raw.size() );
+            chunk.resize( chunk_header_size + compressed_size );
+            int r = compress2( (Bytef*)chunk.data() + chunk_header_size, &compressed_size, (const Bytef*)raw.data(), raw.size(), Z_DEFAULT_COMPRESSION );
+            FC_ASSERT( r == Z_OK, "Could not compress block log chunk: ${r}", ("r", r) );
+            chunk.resize( chunk_header_size + compressed_size );
+        }
+        else
+        {
+            chunk.insert( chunk.end(), raw.begin(), raw.end() );
+        }
+
+        put_u32( chunk.data(), chunk.size() - chunk_header_size );
+        put_u32( chunk.data() + 4, raw.size() );
+        put_u32( chunk.data() + 8, _chunk_count * _chunk_blocks + 1 );
+        put_u32( chunk.data() + 12, count );
+
+        //先写块和索引，再清空尾部文件；中途崩溃时打开会丢弃尾部已经压缩的区块
+        uint64_t pos = _block_size;
+        write_all( _block_fd, chunk.data(), chunk.size() );
+        write_all( _index_fd, (const char*)&pos, sizeof( pos ) );
+        _block_size += chunk.size();
+        ++_chunk_count;
+
+        truncate_file( _tail_fd, 0 );
+        _tail.clear();
+    }
+
+    compressed_block_log::chunk_ptr compressed_block_log::load_chunk( uint32_t chunk_num )const
+    {
+        uint64_t pos;
+        FC_ASSERT( pread_all( _index_fd, (char*)&pos, sizeof( pos ), chunk_num * sizeof( uint64_t ) ) == sizeof( pos ) );
+
+        char header[ chunk_header_size ];
+        FC_ASSERT( pread_all( _block_fd, header, sizeof( header ), pos ) == sizeof( header ) );
+        uint32_t compressed_size = get_u32( header );
+        uint32_t raw_size = get_u32( header + 4 );
+
+        std::vector<char> compressed( compressed_size );
+        FC_ASSERT( pread_all( _block_fd, compressed.data(), compressed_size, pos + chunk_header_size ) == compressed_size );
+
+        auto chunk = std::make_shared< chunk_data >();
+        chunk->first_block = get_u32( header + 8 );
+        chunk->block_count = get_u32( header + 12 );
+        if( _compression == zlib_compression )
+        {
+            chunk->payload.resize( raw_size );
+            uLongf size = raw_size;
+            int r = uncompress( (Bytef*)chunk->payload.data(), &size, (const Bytef*)compressed.data(), compressed.size() );
+            FC_ASSERT( r == Z_OK && size == raw_size, "Could not decompress block log chunk ${c}: ${r}", ("c", chunk_num)("r", r) );
+        }
+        else
+        {
+            chunk->payload = std::move( compressed );
+        }
+        FC_ASSERT( chunk->payload.size() >= chunk->block_count * sizeof( uint32_t ) );
+        return chunk;
+    }
+
+    compressed_block_log::chunk_ptr compressed_block_log::get_chunk( uint32_t chunk_num )const
+    {
+        std::shared_future< chunk_ptr > result;
+        //被淘汰的条目可能还在后台预读，future析构时会等待解压完成，移到锁外销毁，不阻塞其他读取
+        decltype( _chunk_cache ) evicted;
+        {
+            std::lock_guard< std::mutex > lock( _mutex );
+
+            auto find = [&]( uint32_t n ) {
+                for( auto itr = _chunk_cache.begin(); itr != _chunk_cache.end(); ++itr )
+                {
+                    if( itr->first == n )
+                        return itr;
+                }
+                return _chunk_cache.end();
+            };
+
+            auto itr = find( chunk_num );
+            if( itr != _chunk_cache.end() )
+            {
+                _chunk_cache.splice( _chunk_cache.begin(), _chunk_cache, itr );
+                result = itr->second;
+            }
+            else
+            {
+                //由第一个读取的线程解压
+                result = std::async( std::launch::deferred, [this, chunk_num]() { return load_chunk( chunk_num ); } ).share();
+                _chunk_cache.emplace_front( chunk_num, result );
+            }
+
+            if( _read_ahead && chunk_num + 1 < _chunk_count && find( chunk_num + 1 ) == _chunk_cache.end() )
+            {
+                auto next = std::async( std::launch::async, [this, chunk_num]() { return load_chunk( chunk_num + 1 ); } ).share();
+                _chunk_cache.emplace( std::next( _chunk_cache.begin() ), chunk_num + 1, next );
+            }
+
+            while( _chunk_cache.size() > max_chunk_cache )
+                evicted.splice( evicted.end(), _chunk_cache, std::prev( _chunk_cache.end() ) );
+        }
+        evicted.clear();
+
+        return result.get();
+    }
+
+    signed_block compressed_block_log::read_chunk_block( uint32_t block_num )const
+    {
+        auto chunk = get_chunk( ( block_num - 1 ) / _chunk_blocks );
+        uint32_t i = block_num - chunk->first_block;
+        FC_ASSERT( i < chunk->block_count );
+        uint32_t begin = chunk->offsets()[ i ];
+        uint32_t end = i + 1 < chunk->block_count ? chunk->offsets()[ i + 1 ] : chunk->payload.size();
+        FC_ASSERT( begin <= end && end <= chunk->payload.size() );
+
+        fc::datastream< const char* > ds( chunk->payload.data() + begin, end - begin );
+        signed_block b;
+        fc::raw::unpack( ds, b );
+        FC_ASSERT( b.block_num() == block_num, "Wrong block was read from block log.", ( "returned", b.block_num() )( "expected", block_num ) );
+        return b;
+    }
+
+    optional< signed_block > compressed_block_log::read_block_by_num( uint32_t block_num )const
+    { try {
+        optional< signed_block > b;
+        {
+            std::lock_guard< std::mutex > lock( _mutex );
+            if( block_num == 0 || !_head.valid() || block_num > _head->block_num() )
+                return b;
+
+            //尾部的区块在内存中，已经压缩的块不会再改变，在锁外解压
+            uint32_t chunk_num = ( block_num - 1 ) / _chunk_blocks;
+            if( chunk_num >= _chunk_count )
+            {
+                b = fc::raw::unpack_from_vector< signed_block >( _tail[ block_num - 1 - _chunk_count * _chunk_blocks ] );
+                return b;
+            }
+        }
+
+        b = read_chunk_block( block_num );
+        return b;
+    } FC_LOG_AND_RETHROW() }
+
+    void compressed_block_log::set_read_ahead( bool read_ahead )
+    {
+        std::lock_guard< std::mutex > lock( _mutex );
+        _read_ahead = read_ahead;
+    }
+
+    optional< signed_block > compressed_block_log::head()const
+    {
+        std::lock_guard< std::mutex > lock( _mutex );
+        return _head;
+    }
+
+    uint32_t compressed_block_log::head_block_num()const
+    {
+        std::lock_guard< std::mutex > lock( _mutex );
+        return _head.valid() ? _head->block_num() : 0;
+    }
+
+} } // taiyi::chain
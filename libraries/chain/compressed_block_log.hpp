@@ -0,0 +1,100 @@
+#pragma once
+#include <fc/filesystem.hpp>
+#include <protocol/block.hpp>
+
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+
+namespace taiyi { namespace chain {
+
+    using namespace taiyi::protocol;
+
+    /* Block log v2: blocks are grouped into chunks of a fixed number of blocks, each chunk is compressed
+     * independently. The index file stores the position of every chunk, so a block is found in O(1) by
+     * (block_num - 1) / chunk_blocks.
+     *
+     * +--------+-----------------------------+-----------------------------+-----+
+     * | Header | Chunk 1 (blocks 1..N)       | Chunk 2 (blocks N+1..2N)    | ... |
+     * +--------+-----------------------------+-----------------------------+-----+
+     *
+     * Chunk: | compressed size | raw size | first block | block count | compressed payload |
+     * Payload (uncompressed): | offset of each block in the payload | packed blocks |
+     *
+     * Blocks of the last, incomplete chunk are kept uncompressed in the tail file, one
+     * | size | packed block | record per block. When the tail is full it is compressed into a chunk,
+     * appended to the main file, and the tail is truncated. On open, blocks in the tail that already
+     * are in the last chunk (crash between the two writes) are ignored, and a torn record at the end
+     * of the tail is dropped.
+     */
+    class compressed_block_log
+    {
+    public:
+        enum compression_type : uint8_t
+        {
+            no_compression      = 0,
+            zlib_compression    = 1
+        };
+
+        static const uint64_t magic;
+        static const uint32_t default_chunk_blocks = 1000;
+
+        compressed_block_log();
+        ~compressed_block_log();
+
+        /** chunk_blocks is only used for a new log, an existing log keeps the value in its header */
+        void open( const fc::path& file, uint32_t chunk_blocks = default_chunk_blocks );
+        void close();
+        bool is_open()const;
+
+        /** True if file is an existing block log v2 */
+        static bool is_compressed_log( const fc::path& file );
+
+        void append( const signed_block& b );
+        optional< signed_block > read_block_by_num( uint32_t block_num )const;
+        optional< signed_block > head()const;
+        uint32_t head_block_num()const;
+        uint32_t get_chunk_blocks()const { return _chunk_blocks; }
+
+        /** When enabled, reading a block of chunk N decompresses chunk N+1 on a background thread */
+        void set_read_ahead( bool read_ahead );
+
+    private:
+        struct chunk_data
+        {
+            uint32_t            first_block = 0;
+            uint32_t            block_count = 0;
+            std::vector<char>   payload;
+            const uint32_t*     offsets()const { return (const uint32_t*)payload.data(); }
+        };
+        typedef std::shared_ptr< const chunk_data > chunk_ptr;
+
+        chunk_ptr get_chunk( uint32_t chunk_num )const;
+        chunk_ptr load_chunk( uint32_t chunk_num )const;
+        signed_block read_chunk_block( uint32_t block_num )const;
+        void write_chunk();
+        void reconstruct_index();
+        void load_tail();
+
+        fc::path                                _block_file;
+        fc::path                                _index_file;
+        fc::path                                _tail_file;
+        int                                     _block_fd = -1;
+        int                                     _index_fd = -1;
+        int                                     _tail_fd = -1;
+
+        uint32_t                                _chunk_blocks = 0;
+        uint8_t                                 _compression = zlib_compression;
+        uint32_t                                _chunk_count = 0;
+        uint64_t                                _block_size = 0;
+
+        std::vector< std::vector<char> >        _tail;      ///< 尾部文件中还没有压缩的区块
+        optional< signed_block >                _head;
+        bool                                    _read_ahead = false;
+
+        mutable std::mutex                      _mutex;
+        mutable std::list< std::pair< uint32_t, std::shared_future< chunk_ptr > > > _chunk_cache; ///< 最近使用的在前
+    };
+
+} } //taiyi::chain
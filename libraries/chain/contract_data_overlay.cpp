@@ -0,0 +1,255 @@
+#include <chain/taiyi_fwd.hpp>
+
+#include <chain/contract_data_overlay.hpp>
+
+#include <fc/io/raw.hpp>
+
+#include <algorithm>
+
+namespace taiyi { namespace chain {
+
+    namespace {
+
+        uint64_t entry_size( const lua_key& key, const lua_types& value )
+        {
+            return fc::raw::pack_size( key ) + fc::raw::pack_size( value );
+        }
+
+        uint64_t entries_size( const lua_map& stored, const std::set<lua_key>& keys )
+        {
+            uint64_t size = 0;
+            for( const auto& key : keys )
+            {
+                auto itr = stored.find( key );
+                if( itr != stored.end() )
+                    size += entry_size( key, itr->second );
+            }
+            return size;
+        }
+
+    }
+
+    thread_local std::vector< contract_data_overlay* > contract_data_overlay::_opened;
+
+    contract_data_overlay::contract_data_overlay( const contract_object& contract )
+        : contract_data_overlay( contract_object_type, contract.id._id, contract.contract_data, contract.contract_data_size )
+    {}
+    //=============================================================================
+    contract_data_overlay::contract_data_overlay( const account_contract_data_object& acd )
+        : contract_data_overlay( account_contract_data_object_type, acd.id._id, acd.contract_data, acd.contract_data_size )
+    {}
+    //=============================================================================
+    contract_data_overlay::contract_data_overlay( uint16_t owner_type, int64_t owner_id, const lua_map& stored, uint64_t stored_size )
+        : _owner( owner_type, owner_id ), _base( &stored ), _count( stored.size() )
+    {
+        _entries_size = stored_size - fc::raw::pack_size( fc::unsigned_int( stored.size() ) );
+        _opened.push_back( this );
+    }
+    //=============================================================================
+    contract_data_overlay::~contract_data_overlay()
+    {
+        auto itr = std::find( _opened.begin(), _opened.end(), this );
+        if( itr != _opened.end() )
+            _opened.erase( itr );
+    }
+    //=============================================================================
+    const lua_map& contract_data_overlay::read_view( const lua_map& read_list )
+    {
+        static auto start_key = lua_key( lua_types( lua_string( "start" ) ) );
+        static auto stop_key = lua_key( lua_types( lua_string( "stop" ) ) );
+
+        _view.clear();
+
+        //读取整表或者按范围读取顶层时需要合并后的整表
+        bool full = read_list.size() == 0;
+        auto itr = read_list.find( start_key );
+        if( itr != read_list.end() && itr->second.which() == lua_types::tag<lua_int>::value )
+            full = true;
+        itr = read_list.find( stop_key );
+        if( itr != read_list.end() && itr->second.which() == lua_types::tag<lua_int>::value )
+            full = true;
+
+        if( full )
+        {
+            if( !is_modified() )
+                return base();
+            merge_to( _view );
+            return _view;
+        }
+
+        //读取时只会访问read_list顶层键对应的数据
+        for( const auto& item : read_list )
+        {
+            const lua_types* value = find( item.first );
+            if( value )
+                _view[ item.first ] = *value;
+        }
+        return _view;
+    }
+    //=============================================================================
+    void contract_data_overlay::write( const lua_map& write_list, const std::function< void( lua_map& ) >& writer )
+    {
+        std::set<lua_key> affected;
+        lua_map working;
+
+        if( write_list.size() == 0 )
+        {
+            //整表覆盖
+            merge_to( working );
+            for( const auto& item : working )
+                affected.insert( item.first );
+        }
+        else
+        {
+            //写入只会修改write_list中出现过的键对应的顶层数据
+            collect_contract_data_keys( write_list, affected );
+            for( const auto& key : affected )
+            {
+                const lua_types* value = find( key );
+                if( value )
+                    working[ key ] = *value;
+            }
+        }
+
+        //writer中途出错时已经写入的部分仍然保留（合约可以在lua中捕获这个错误）
+        try
+        {
+            writer( working );
+        }
+        catch( ... )
+        {
+            merge_working( affected, working );
+            throw;
+        }
+
+        merge_working( affected, working );
+    }
+    //=============================================================================
+    void contract_data_overlay::merge_working( std::set<lua_key>& affected, lua_map& working )
+    {
+        for( const auto& item : working )
+            affected.insert( item.first );
+
+        for( const auto& key : affected )
+        {
+            const lua_types* old_value = find( key );
+            if( old_value )
+            {
+                _entries_size -= entry_size( key, *old_value );
+                --_count;
+            }
+
+            auto witr = working.find( key );
+            if( witr != working.end() )
+            {
+                _entries_size += entry_size( key, witr->second );
+                ++_count;
+                _dirty[ key ] = std::move( witr->second );
+                _erased.erase( key );
+            }
+            else
+            {
+                _dirty.erase( key );
+                if( base().find( key ) != base().end() )
+                    _erased.insert( key );
+            }
+        }
+    }
+    //=============================================================================
+    uint64_t contract_data_overlay::get_pack_size()const
+    {
+        return fc::raw::pack_size( fc::unsigned_int( _count ) ) + _entries_size;
+    }
+    //=============================================================================
+    void contract_data_overlay::isolate_others()
+    {
+        for( auto* overlay : _opened )
+        {
+            if( overlay != this && overlay->_owner == _owner )
+                overlay->detach();
+        }
+    }
+    //=============================================================================
+    void contract_data_overlay::apply( lua_map& stored, uint64_t& stored_size )const
+    {
+        if( _detached )
+        {
+            //存储的数据已经被其他视图修改过，以创建时的快照加上增量整体覆盖
+            lua_map merged;
+            merge_to( merged );
+            stored = std::move( merged );
+        }
+        else
+        {
+            for( const auto& key : _erased )
+                stored.erase( key );
+            for( const auto& item : _dirty )
+                stored[ item.first ] = item.second;
+        }
+
+        stored_size = get_pack_size();
+    }
+    //=============================================================================
+    const lua_types* contract_data_overlay::find( const lua_key& key )const
+    {
+        auto ditr = _dirty.find( key );
+        if( ditr != _dirty.end() )
+            return &ditr->second;
+        if( _erased.find( key ) != _erased.end() )
+            return nullptr;
+
+        auto bitr = base().find( key );
+        return bitr != base().end() ? &bitr->second : nullptr;
+    }
+    //=============================================================================
+    void contract_data_overlay::merge_to( lua_map& out )const
+    {
+        out = base();
+        for( const auto& key : _erased )
+            out.erase( key );
+        for( const auto& item : _dirty )
+            out[ item.first ] = item.second;
+    }
+    //=============================================================================
+    void contract_data_overlay::detach()
+    {
+        if( _detached )
+            return;
+
+        _snapshot = *_base;
+        _detached = true;
+        _base = nullptr;
+    }
+    //=============================================================================
+    void collect_contract_data_keys( const lua_map& keys, std::set<lua_key>& out )
+    {
+        for( const auto& item : keys )
+        {
+            out.insert( item.first );
+            if( item.second.which() == lua_types::tag<lua_table>::value )
+                collect_contract_data_keys( item.second.get<lua_table>().v, out );
+        }
+    }
+    //=============================================================================
+    void write_contract_data_keys( lua_map& stored, uint64_t& stored_size, const std::set<lua_key>& keys, const std::function< void( lua_map& ) >& writer )
+    {
+        uint64_t other_size = stored_size - fc::raw::pack_size( fc::unsigned_int( stored.size() ) ) - entries_size( stored, keys );
+        auto update_size = [&]() {
+            stored_size = fc::raw::pack_size( fc::unsigned_int( stored.size() ) ) + other_size + entries_size( stored, keys );
+        };
+
+        //writer中途出错时已经写入的部分仍然保留（合约可以在lua中捕获这个错误）
+        try
+        {
+            writer( stored );
+        }
+        catch( ... )
+        {
+            update_size();
+            throw;
+        }
+
+        update_size();
+    }
+
+} } // taiyi::chain
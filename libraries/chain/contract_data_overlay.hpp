@@ -0,0 +1,101 @@
+#pragma once
+
+#include <chain/contract_objects.hpp>
+
+#include <functional>
+#include <set>
+#include <vector>
+
+namespace taiyi { namespace chain {
+
+    using protocol::lua_key;
+    using protocol::lua_int;
+    using protocol::lua_string;
+    using protocol::lua_table;
+
+    /**
+     * 合约数据（contract_object::contract_data、account_contract_data_object::contract_data）的写时复制视图
+     *
+     * 读取直接落到存储的数据上，只有被写入的顶层键才会复制到增量中，写回时也只修改这些键；
+     * 数据打包后的大小随增量同步维护，与fc::raw::pack_size(合并后的表)完全一致。
+     *
+     * 同一份数据可能同时被多个视图引用（例如合约调用自身时嵌套的contract_handler），每个视图
+     * 看到的都是自己创建时的数据。某个视图写回之前，其他引用同一份数据的视图会先保存一份
+     * 快照，并在写回时以快照加增量整体覆盖，与原先整表复制、整表写回的行为保持一致。
+     */
+    class contract_data_overlay
+    {
+    public:
+        explicit contract_data_overlay( const contract_object& contract );
+        explicit contract_data_overlay( const account_contract_data_object& acd );
+        ~contract_data_overlay();
+
+        contract_data_overlay( const contract_data_overlay& ) = delete;
+        contract_data_overlay& operator=( const contract_data_overlay& ) = delete;
+
+        /**
+         * 读取用的表：只包含read_list涉及的顶层键，读取整表或按范围读取顶层时为合并后的整表
+         */
+        const lua_map& read_view( const lua_map& read_list );
+
+        /**
+         * 在只包含write_list涉及的顶层键的表上执行writer（write_list为空时为整表），然后合并到增量中
+         */
+        void write( const lua_map& write_list, const std::function< void( lua_map& ) >& writer );
+
+        bool is_modified()const { return _dirty.size() > 0 || _erased.size() > 0; }
+
+        /**
+         * 是否需要写回：自己写入过，或者创建之后存储的数据被其他视图修改过。后一种情况写回的是创建时的快照，
+         * 与原先无条件整表写回的结果相同；两者都不成立时存储的数据就是创建时的数据，写回不改变任何内容
+         */
+        bool needs_write_back()const { return is_modified() || _detached; }
+
+        /**
+         * 等于fc::raw::pack_size(合并后的表)
+         */
+        uint64_t get_pack_size()const;
+
+        /**
+         * 写回存储：修改存储的对象之前调用isolate_others，然后在db.modify中调用apply
+         */
+        void isolate_others();
+        void apply( lua_map& stored, uint64_t& stored_size )const;
+
+    private:
+        contract_data_overlay( uint16_t owner_type, int64_t owner_id, const lua_map& stored, uint64_t stored_size );
+
+        const lua_map& base()const { return _detached ? _snapshot : *_base; }
+        const lua_types* find( const lua_key& key )const;
+        void merge_to( lua_map& out )const;
+        void merge_working( std::set<lua_key>& affected, lua_map& working );
+        void detach();
+
+        std::pair< uint16_t, int64_t >  _owner;         ///< 存储数据所在的对象
+        const lua_map*                  _base = nullptr;
+        bool                            _detached = false;
+        lua_map                         _snapshot;      ///< 存储的数据被其他视图修改前保存的快照
+
+        lua_map                         _dirty;         ///< 写入过的顶层键
+        std::set<lua_key>               _erased;        ///< 删除了的存储中的顶层键
+
+        uint64_t                        _count = 0;
+        uint64_t                        _entries_size = 0;
+
+        lua_map                         _view;
+
+        static thread_local std::vector< contract_data_overlay* > _opened;
+    };
+
+    /**
+     * keys中各层出现过的所有键。write_table_data按keys写入时，可能改变的顶层键都在其中
+     */
+    void collect_contract_data_keys( const lua_map& keys, std::set<lua_key>& out );
+
+    /**
+     * 直接修改存储的合约数据（如nfa_object::contract_data），writer只能改变keys中的顶层键。
+     * stored_size（fc::raw::pack_size(stored)）按这些键增量维护，writer中途出错时同样准确
+     */
+    void write_contract_data_keys( lua_map& stored, uint64_t& stored_size, const std::set<lua_key>& keys, const std::function< void( lua_map& ) >& writer );
+
+} } // taiyi::chain
@@ -89,6 +89,7 @@ namespace taiyi { namespace chain {
             cbo.source_code = o.data;
 #endif
         });
+        _db.get_lua_chunk_cache().invalidate(code_bin_object.id);
         
         string previous_version = contract->current_version.str();
         _db.modify(*contract, [&](contract_object &c) {
@@ -104,18 +104,26 @@ namespace taiyi { namespace chain {
     }
     //=============================================================================
     contract_handler::contract_handler(database &db, const account_object& caller, const nfa_object* nfa_caller, const contract_object &contract, contract_result &result, LuaContext &context, bool eval)
-    : db(db), contract(contract), caller(caller), nfa_caller(nfa_caller), result(result), context(context), is_in_eval(eval)
+    : db(db), contract(contract), caller(caller), nfa_caller(nfa_caller), result(result), context(context),
+      account_contract_data_cache(db.prepare_account_contract_data(caller, contract)), contract_data_cache(contract), is_in_eval(eval)
     {
         result.contract_name = contract.name;
-        account_contract_data_cache = db.prepare_account_contract_data(caller, contract);
-        contract_data_cache = contract.contract_data;
     }
     //=============================================================================
     contract_handler::~contract_handler()
     {
-        const auto& acd = db.get<account_contract_data_object, by_account_contract>( boost::make_tuple(caller.id, contract.id) );
-        db.modify(acd, [&](account_contract_data_object &obj) { obj.contract_data = account_contract_data_cache; });
-        db.modify(contract, [&](contract_object& c) { c.contract_data = contract_data_cache; });
+        //数据没有被任何视图修改过时不需要写回
+        if (account_contract_data_cache.needs_write_back())
+        {
+            const auto& acd = db.get<account_contract_data_object, by_account_contract>( boost::make_tuple(caller.id, contract.id) );
+            account_contract_data_cache.isolate_others();
+            db.modify(acd, [&](account_contract_data_object &obj) { account_contract_data_cache.apply(obj.contract_data, obj.contract_data_size); });
+        }
+        if (contract_data_cache.needs_write_back())
+        {
+            contract_data_cache.isolate_others();
+            db.modify(contract, [&](contract_object& c) { contract_data_cache.apply(c.contract_data, c.contract_data_size); });
+        }
         
         for (auto c : _sub_chs)
             delete c;
@@ -126,8 +134,8 @@ namespace taiyi { namespace chain {
         uint64_t contract_private_data_size    = 3L * 1024;
         uint64_t contract_total_data_size      = 10L * 1024 * 1024;
         uint64_t contract_max_data_size        = 2L * 1024 * 1024 * 1024;
-        FC_ASSERT(fc::raw::pack_size(account_contract_data_cache) <= contract_private_data_size, "the contract private data size is too large.");
-        FC_ASSERT(fc::raw::pack_size(contract_data_cache) <= contract_total_data_size, "the contract total data size is too large.");
+        FC_ASSERT(account_contract_data_cache.get_pack_size() <= contract_private_data_size, "the contract private data size is too large.");
+        FC_ASSERT(contract_data_cache.get_pack_size() <= contract_total_data_size, "the contract total data size is too large.");
     }
     //=============================================================================
     bool contract_handler::is_owner()
@@ -479,9 +487,11 @@ namespace taiyi { namespace chain {
             operation vop = nfa_transfer_operation(from_account.name, to_account.name, nfa_id);
             db.pre_push_virtual_operation( vop );
 
+            account_id_type old_owner = nfa->owner_account;
             db.modify(*nfa, [&](nfa_object &obj) {
                 obj.owner_account = to_account.id;
             });
+            db.update_xinsu_proposal_votes(*nfa, old_owner);
             
             //TODO: 转移子节点里面所有子节点的所有权，是否同时也要转移使用权？
             std::set<nfa_id_type> look_checker;
@@ -755,19 +765,25 @@ namespace taiyi { namespace chain {
             db.pre_push_virtual_operation( vop );
 
             const nfa_object& nfa = db.create_nfa(caller_, *nfa_symbol, false, context);
+            std::set<lua_key> data_keys;
+            for(const auto& p : data)
+                data_keys.insert(p.first);
             db.modify(nfa, [&](nfa_object& obj) {
-                for(const auto& p : data) {
-                    if(obj.contract_data.find(p.first) != obj.contract_data.end())
-                        obj.contract_data[p.first] = p.second;
-                    else {
-                        FC_ASSERT(false, "nfa data not support the key \"${k}\"", ("k", p.first));
+                write_contract_data_keys(obj.contract_data, obj.contract_data_size, data_keys, [&](lua_map& target_table) {
+                    for(const auto& p : data) {
+                        if(target_table.find(p.first) != target_table.end())
+                            target_table[p.first] = p.second;
+                        else {
+                            FC_ASSERT(false, "nfa data not support the key \"${k}\"", ("k", p.first));
+                        }
                     }
-                }
+                });
                 
                 obj.owner_account = actor_nfa->owner_account;
                 obj.active_account = actor_nfa->active_account;
                 obj.parent = nfa_id_type(to_actor_nfa_id);
             });
+            db.update_xinsu_proposal_votes(nfa, caller_.id);
 
             db.post_push_virtual_operation( vop );
 
@@ -821,18 +837,24 @@ namespace taiyi { namespace chain {
             db.pre_push_virtual_operation( vop );
 
             const nfa_object& nfa = db.create_nfa(caller_, *nfa_symbol, false, context);
+            std::set<lua_key> data_keys;
+            for(const auto& p : data)
+                data_keys.insert(p.first);
             db.modify(nfa, [&](nfa_object& obj) {
-                for(const auto& p : data) {
-                    if(obj.contract_data.find(p.first) != obj.contract_data.end())
-                        obj.contract_data[p.first] = p.second;
-                    else {
-                        FC_ASSERT(false, "nfa data not support the key \"${k}\"", ("k", p.first));
+                write_contract_data_keys(obj.contract_data, obj.contract_data_size, data_keys, [&](lua_map& target_table) {
+                    for(const auto& p : data) {
+                        if(target_table.find(p.first) != target_table.end())
+                            target_table[p.first] = p.second;
+                        else {
+                            FC_ASSERT(false, "nfa data not support the key \"${k}\"", ("k", p.first));
+                        }
                     }
-                }
+                });
                 
                 obj.owner_account = to_account->id;
                 obj.active_account = to_account->id;
             });
+            db.update_xinsu_proposal_votes(nfa, caller_.id);
 
             db.post_push_virtual_operation( vop );
 
@@ -987,8 +1009,8 @@ namespace taiyi { namespace chain {
             if(name != current_contract_name) {
                 if(!context.get_sandbox(name)) {
                     new_sandbox = true;
-                    context.new_sandbox(name, baseENV.lua_code_b.data(), baseENV.lua_code_b.size());
-                    context.load_script_to_sandbox(name, contract_code.lua_code_b.data(), contract_code.lua_code_b.size());
+                    context.new_sandbox(name, baseENV, db.get_lua_chunk_cache());
+                    context.load_script_to_sandbox(name, contract, contract_code, db.get_lua_chunk_cache());
                     context.writeVariable(name, "_G", "protected");
                     context.writeVariable(name, "contract_helper", &ch);
                     context.writeVariable(name, "contract_base_info", &cbi);
@@ -1033,7 +1055,7 @@ namespace taiyi { namespace chain {
                 if(temp.which() == contract_affected_type::tag<contract_result>::value)
                     ch.result.relevant_datasize += temp.get<contract_result>().relevant_datasize;
             }
-            ch.result.relevant_datasize += fc::raw::pack_size(ch.contract_data_cache) + fc::raw::pack_size(ch.account_contract_data_cache) + fc::raw::pack_size(ch.result.contract_affecteds);
+            ch.result.relevant_datasize += ch.contract_data_cache.get_pack_size() + ch.account_contract_data_cache.get_pack_size() + fc::raw::pack_size(ch.result.contract_affecteds);
 
             return result_table.v;
         }
@@ -1122,8 +1144,8 @@ namespace taiyi { namespace chain {
             if(name != current_contract_name) {
                 if(!context.get_sandbox(name)) {
                     new_sandbox = true;
-                    context.new_sandbox(name, baseENV.lua_code_b.data(), baseENV.lua_code_b.size());
-                    context.load_script_to_sandbox(name, contract_code.lua_code_b.data(), contract_code.lua_code_b.size());
+                    context.new_sandbox(name, baseENV, db.get_lua_chunk_cache());
+                    context.load_script_to_sandbox(name, contract, contract_code, db.get_lua_chunk_cache());
                     context.writeVariable(name, "_G", "protected");
                     context.writeVariable(name, "contract_helper", &ch);
                     context.writeVariable(name, "contract_base_info", &cbi);
@@ -1168,7 +1190,7 @@ namespace taiyi { namespace chain {
                 if(temp.which() == contract_affected_type::tag<contract_result>::value)
                     ch.result.relevant_datasize += temp.get<contract_result>().relevant_datasize;
             }
-            ch.result.relevant_datasize += fc::raw::pack_size(ch.contract_data_cache) + fc::raw::pack_size(ch.account_contract_data_cache) + fc::raw::pack_size(ch.result.contract_affecteds);
+            ch.result.relevant_datasize += ch.contract_data_cache.get_pack_size() + ch.account_contract_data_cache.get_pack_size() + fc::raw::pack_size(ch.result.contract_affecteds);
 
             db.set_contract_run_zone(pre_contract_run_zone);
 
@@ -1240,8 +1262,8 @@ namespace taiyi { namespace chain {
             if(name != current_contract_name) {
                 if(!context.get_sandbox(name)) {
                     new_sandbox = true;
-                    context.new_sandbox(name, baseENV.lua_code_b.data(), baseENV.lua_code_b.size());
-                    context.load_script_to_sandbox(name, contract_code.lua_code_b.data(), contract_code.lua_code_b.size());
+                    context.new_sandbox(name, baseENV, db.get_lua_chunk_cache());
+                    context.load_script_to_sandbox(name, contract, contract_code, db.get_lua_chunk_cache());
                     context.writeVariable(name, "_G", "protected");                    
                     context.writeVariable(name, "contract_helper", &ch);
                     context.writeVariable(name, "contract_base_info", &cbi);
@@ -1286,7 +1308,7 @@ namespace taiyi { namespace chain {
                 if(temp.which() == contract_affected_type::tag<contract_result>::value)
                     ch.result.relevant_datasize += temp.get<contract_result>().relevant_datasize;
             }
-            ch.result.relevant_datasize += fc::raw::pack_size(ch.contract_data_cache) + fc::raw::pack_size(ch.account_contract_data_cache) + fc::raw::pack_size(ch.result.contract_affecteds);
+            ch.result.relevant_datasize += ch.contract_data_cache.get_pack_size() + ch.account_contract_data_cache.get_pack_size() + fc::raw::pack_size(ch.result.contract_affecteds);
 
             return result_table.v;
         }
@@ -1337,14 +1359,19 @@ namespace taiyi { namespace chain {
             
             db.add_contract_handler_exe_point(5 + fc::raw::pack_size(result_table) / 5);
 
+            std::set<lua_key> data_keys;
+            for (const auto& p : result_table.v)
+                data_keys.insert(p.first);
             db.modify(*nfa, [&](nfa_object& obj) {
                 //仅仅改变主合约，不改变nfa的symbol
                 obj.main_contract = contract->id;
                 //仅仅增加数据中没有的字段
-                for (auto& p : result_table.v) {
-                    if (obj.contract_data.find(p.first) == obj.contract_data.end())
-                        obj.contract_data[p.first] = p.second;
-                }
+                write_contract_data_keys(obj.contract_data, obj.contract_data_size, data_keys, [&](lua_map& target_table) {
+                    for (auto& p : result_table.v) {
+                        if (target_table.find(p.first) == target_table.end())
+                            target_table[p.first] = p.second;
+                    }
+                });
             });
             
             protocol::nfa_affected affected;
@@ -1502,7 +1529,7 @@ namespace taiyi { namespace chain {
         {
             vector<lua_types> stacks = {};
             lua_map result;
-            read_table_data(result, read_list, contract_data_cache, stacks);
+            read_table_data(result, read_list, contract_data_cache.read_view(read_list), stacks);
             
             db.add_contract_handler_exe_point(2 + fc::raw::pack_size(read_list) / 5);
 
@@ -1527,7 +1554,7 @@ namespace taiyi { namespace chain {
             db.add_contract_handler_exe_point(2 + fc::raw::pack_size(write_list) / 5);
             
             vector<lua_types> stacks = {};
-            write_table_data(contract_data_cache, write_list, data, stacks);
+            contract_data_cache.write(write_list, [&](lua_map& target_table) { write_table_data(target_table, write_list, data, stacks); });
         }
         catch (const fc::exception& e)
         {
@@ -1547,11 +1574,11 @@ namespace taiyi { namespace chain {
         {
             const auto& account = db.get_account(account_name);
             const auto& contract = db.get<contract_object, by_name>(contract_name);
-            auto account_contract_data = db.prepare_account_contract_data(account, contract);
+            const auto& account_contract_data = db.prepare_account_contract_data(account, contract);
 
             vector<lua_types> stacks = {};
             lua_map result;
-            read_table_data(result, read_list, account_contract_data, stacks);
+            read_table_data(result, read_list, account_contract_data.contract_data, stacks);
 
             db.add_contract_handler_exe_point(2 + fc::raw::pack_size(read_list) / 5);
 
@@ -1575,7 +1602,7 @@ namespace taiyi { namespace chain {
         {
             vector<lua_types> stacks = {};
             lua_map result;
-            read_table_data(result, read_list, account_contract_data_cache, stacks);
+            read_table_data(result, read_list, account_contract_data_cache.read_view(read_list), stacks);
 
             db.add_contract_handler_exe_point(2 + fc::raw::pack_size(read_list) / 5);
 
@@ -1598,7 +1625,7 @@ namespace taiyi { namespace chain {
         try
         {
             vector<lua_types> stacks = {};
-            write_table_data(account_contract_data_cache, write_list, data, stacks);
+            account_contract_data_cache.write(write_list, [&](lua_map& target_table) { write_table_data(target_table, write_list, data, stacks); });
             
             db.add_contract_handler_exe_point(2 + fc::raw::pack_size(write_list) / 5);
         }
@@ -1647,9 +1674,14 @@ namespace taiyi { namespace chain {
             const auto& nfa = db.get<nfa_object, by_id>(nfa_id);
             FC_ASSERT(nfa.owner_account == caller.id || nfa.active_account == caller.id, "无权操作NFA");
 
+            //只有write_list中出现过的键可能被修改，按这些键增量维护contract_data_size
+            std::set<lua_key> affected;
+            collect_contract_data_keys(write_list, affected);
             db.modify(nfa, [&](nfa_object& obj) {
                 vector<lua_types> stacks = {};
-                write_table_data(obj.contract_data, write_list, data, stacks);
+                write_contract_data_keys(obj.contract_data, obj.contract_data_size, affected, [&](lua_map& target_table) {
+                    write_table_data(target_table, write_list, data, stacks);
+                });
             });
             
             db.add_contract_handler_exe_point(2 + fc::raw::pack_size(write_list) / 5);
@@ -2310,6 +2342,33 @@ namespace taiyi { namespace chain {
         }
     }
     //=============================================================================
+    vector<string> contract_handler::find_way_to_zone(const string& from_zone_name, const string& to_zone_name)
+    {
+        try
+        {
+            db.add_contract_handler_exe_point(2);
+
+            const auto* from_zone = db.find< zone_object, by_name >( from_zone_name );
+            FC_ASSERT(from_zone != nullptr, "没有名叫\"${a}\"的地方", ("a", from_zone_name));
+            const auto* to_zone = db.find< zone_object, by_name >( to_zone_name );
+            FC_ASSERT(to_zone != nullptr, "没有名叫\"${a}\"的地方", ("a", to_zone_name));
+
+            //寻路的计算量随路线缓存，命中缓存时消耗与重新寻路相同，保证各节点一致
+            auto route = db.find_way_to_zone(*from_zone, *to_zone);
+            db.add_contract_handler_exe_point(route.search_cost + route.zones.size());
+
+            vector<string> way_points;
+            way_points.reserve(route.zones.size());
+            for(const auto& z : route.zones)
+                way_points.push_back(db.get< zone_object, by_id >(z).name);
+            return way_points;
+        }
+        catch (const fc::exception& e)
+        {
+            LUA_C_ERR_THROW(context.mState, e.to_string());
+        }
+    }
+    //=============================================================================
     int64_t contract_handler::create_actor_talent_rule(const string& contract_name)
     {
         try
@@ -2407,6 +2466,7 @@ namespace taiyi { namespace chain {
                 act.family_name = family_name;
                 act.last_name = last_name;
             });
+            db.count_actor_created(new_actor);
             
             db.initialize_actor_talents(new_actor);
 
@@ -2910,6 +2970,7 @@ namespace taiyi { namespace chain {
 
                 auto found = pvidx.find( boost::make_tuple( voter.id, id ) );
 
+                //投票者一定是心素，票数随投票直接增减
                 if(approve)
                 {
                     if(found == pvidx.end()) {
@@ -2917,6 +2978,9 @@ namespace taiyi { namespace chain {
                             obj.voter = voter.id;
                             obj.proposal_id = id;
                         });
+                        db.modify(*found_id, [&](proposal_object& obj) {
+                            obj.total_votes += 1;
+                        });
                     }
                     narrate(FORMAT_MESSAGE("\"${a}\"支持了第${p}号提案", ("a", caller.name)("p", id)), true);
                 }
@@ -2924,6 +2988,9 @@ namespace taiyi { namespace chain {
                 {
                     if(found != pvidx.end()) {
                         db.remove(*found);
+                        db.modify(*found_id, [&](proposal_object& obj) {
+                            obj.total_votes -= 1;
+                        });
                         narrate(FORMAT_MESSAGE("\"${a}\"不再支持第${p}号提案", ("a", caller.name)("p", id)), true);
                     }
                 }
@@ -3010,6 +3077,7 @@ namespace taiyi { namespace chain {
             db.modify(xinsu_mark, [&](nfa_object &obj) {
                 obj.owner_account = receiver->id;
             });
+            db.update_xinsu_proposal_votes(xinsu_mark, creator.id);
             
             //count xinsu
             db.modify(db.get_dynamic_global_properties(), [&](dynamic_global_property_object& obj) {
@@ -3047,9 +3115,11 @@ namespace taiyi { namespace chain {
         
         const auto& danuo = db.get_account( TAIYI_DANUO_ACCOUNT );
         std::for_each(found_nfas.begin(), found_nfas.end(), [&](auto& id) {
-            db.modify(db.get<nfa_object, by_id>(id), [&](auto& obj) {
+            const auto& nfa = db.get<nfa_object, by_id>(id);
+            db.modify(nfa, [&](auto& obj) {
                 obj.owner_account = danuo.id;
             });
+            db.update_xinsu_proposal_votes(nfa, account->id);
         });
         
         //count xinsu
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <chain/contract_objects.hpp>
+#include <chain/contract_data_overlay.hpp>
 #include <chain/contract_worker.hpp>
 
 namespace taiyi { namespace chain {
@@ -244,8 +245,8 @@ namespace taiyi { namespace chain {
         const nfa_object*                   nfa_caller = 0; //隐含由某个NFA发起的调用
         contract_result&                    result;
         LuaContext&                         context;
-        lua_map                             account_contract_data_cache;
-        lua_map                             contract_data_cache;
+        contract_data_overlay               account_contract_data_cache;
+        contract_data_overlay               contract_data_cache;
         bool                                is_in_eval; //只读模式标记，表示在eval调用中
         
         std::vector<contract_handler*>      _sub_chs;
@@ -325,6 +326,7 @@ namespace taiyi { namespace chain {
         contract_zone_base_info get_zone_info(int64_t nfa_id);
         contract_zone_base_info get_zone_info_by_name(const string& name);
         void connect_zones(int64_t from_zone_nfa_id, int64_t to_zone_nfa_id);
+        vector<string> find_way_to_zone(const string& from_zone_name, const string& to_zone_name);
         vector<contract_actor_base_info> list_actors_on_zone(int64_t nfa_id);
         string exploit_zone(const string& actor_name, const string& zone_name);
         bool is_contract_allowed_by_zone(const string& zone_name, const string& contract_name);
@@ -601,11 +601,13 @@ namespace taiyi { namespace chain {
             auto itn = nfa_by_parent_idx.lower_bound( _caller.id );
             FC_ASSERT(itn == nfa_by_parent_idx.end() || itn->parent != _caller.id, "caller with child can not be destroyed");
                         
+            account_id_type old_owner = _caller.owner_account;
             _db.modify(_caller, [&]( nfa_object& obj ) {
                 obj.owner_account = _db.get_account(TAIYI_NULL_ACCOUNT).id;
                 obj.active_account = obj.owner_account;
                 obj.next_tick_block = std::numeric_limits<uint32_t>::max(); //disable tick
             });
+            _db.update_xinsu_proposal_votes(_caller, old_owner);
         }
         catch (const fc::exception& e)
         {
@@ -827,10 +829,12 @@ namespace taiyi { namespace chain {
                             FC_ASSERT(itr->second.which() == lua_types::tag<lua_int>::value, "attributes value type invalid (must be int)");
                             auto v = itr->second.get<lua_int>().v;
                             if(v != 0) {
+                                int16_t old_health = actor.health;
                                 _db.modify( actor, [&]( actor_object& obj ) {
                                     obj.health = std::min<int16_t>(std::max<int16_t>(0, obj.health + v), obj.health_max);
                                     obj.last_update = now;
                                 });
+                                _db.count_actor_health_changed(old_health, actor.health);
                             }
                         }
                         else if( k == age_key) {
@@ -1274,8 +1278,8 @@ namespace taiyi { namespace chain {
             if(name != current_contract_name) {
                 if(!_context.get_sandbox(name)) {
                     new_sandbox = true;
-                    _context.new_sandbox(name, baseENV.lua_code_b.data(), baseENV.lua_code_b.size());
-                    _context.load_script_to_sandbox(name, contract_code.lua_code_b.data(), contract_code.lua_code_b.size());
+                    _context.new_sandbox(name, baseENV, _db.get_lua_chunk_cache());
+                    _context.load_script_to_sandbox(name, contract, contract_code, _db.get_lua_chunk_cache());
                     _context.writeVariable(name, "_G", "protected");
                     _context.writeVariable(name, "contract_helper", &ch);
                     _context.writeVariable(name, "contract_base_info", &cbi);
@@ -1320,7 +1324,7 @@ namespace taiyi { namespace chain {
                 if(temp.which() == contract_affected_type::tag<contract_result>::value)
                     ch.result.relevant_datasize += temp.get<contract_result>().relevant_datasize;
             }
-            ch.result.relevant_datasize += fc::raw::pack_size(ch.contract_data_cache) + fc::raw::pack_size(ch.account_contract_data_cache) + fc::raw::pack_size(ch.result.contract_affecteds);
+            ch.result.relevant_datasize += ch.contract_data_cache.get_pack_size() + ch.account_contract_data_cache.get_pack_size() + fc::raw::pack_size(ch.result.contract_affecteds);
 
             return result_table.v;
         }
@@ -1406,8 +1410,8 @@ namespace taiyi { namespace chain {
             if(name != current_contract_name) {
                 if(!_context.get_sandbox(name)) {
                     new_sandbox = true;
-                    _context.new_sandbox(name, baseENV.lua_code_b.data(), baseENV.lua_code_b.size());
-                    _context.load_script_to_sandbox(name, contract_code.lua_code_b.data(), contract_code.lua_code_b.size());
+                    _context.new_sandbox(name, baseENV, _db.get_lua_chunk_cache());
+                    _context.load_script_to_sandbox(name, contract, contract_code, _db.get_lua_chunk_cache());
                     _context.writeVariable(name, "_G", "protected");
                     _context.writeVariable(name, "contract_helper", &ch);
                     _context.writeVariable(name, "contract_base_info", &cbi);
@@ -1452,7 +1456,7 @@ namespace taiyi { namespace chain {
                 if(temp.which() == contract_affected_type::tag<contract_result>::value)
                     ch.result.relevant_datasize += temp.get<contract_result>().relevant_datasize;
             }
-            ch.result.relevant_datasize += fc::raw::pack_size(ch.contract_data_cache) + fc::raw::pack_size(ch.account_contract_data_cache) + fc::raw::pack_size(ch.result.contract_affecteds);
+            ch.result.relevant_datasize += ch.contract_data_cache.get_pack_size() + ch.account_contract_data_cache.get_pack_size() + fc::raw::pack_size(ch.result.contract_affecteds);
             
             _db.set_contract_run_zone(pre_contract_run_zone);
 
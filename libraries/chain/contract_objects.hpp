@@ -3,6 +3,7 @@
 #include <protocol/lua_types.hpp>
 
 #include <chain/taiyi_object_types.hpp>
+#include <chain/util/undo_encoding.hpp>
 
 namespace taiyi { namespace chain {
 
@@ -32,6 +33,7 @@ namespace taiyi { namespace chain {
         transaction_id_type current_version;
         bool                is_release = false;
         lua_map             contract_data;
+        uint64_t            contract_data_size = 1; ///< fc::raw::pack_size(contract_data)，随写入增量维护
         lua_map             contract_ABI;
         contract_bin_code_id_type lua_code_b_id;
         
@@ -80,6 +82,7 @@ namespace taiyi { namespace chain {
         account_id_type     owner;
         contract_id_type    contract_id;
         lua_map             contract_data;
+        uint64_t            contract_data_size = 1; ///< fc::raw::pack_size(contract_data)，随写入增量维护
     };
 
     struct by_account_contract;
@@ -133,11 +136,13 @@ namespace taiyi { namespace chain {
 } } // taiyi::chain
 
 
-FC_REFLECT(taiyi::chain::contract_object, (id)(owner)(name)(current_version)(is_release)(contract_data)(contract_ABI)(lua_code_b_id)(creation_date) )
+FC_REFLECT(taiyi::chain::contract_object, (id)(owner)(name)(current_version)(is_release)(contract_data)(contract_data_size)(contract_ABI)(lua_code_b_id)(creation_date) )
 CHAINBASE_SET_INDEX_TYPE(taiyi::chain::contract_object, taiyi::chain::contract_index)
+TAIYI_SET_UNDO_ENCODER(taiyi::chain::contract_object, taiyi::chain::util::contract_data_size_of)
 
-FC_REFLECT(taiyi::chain::account_contract_data_object, (id)(owner)(contract_id)(contract_data) )
+FC_REFLECT(taiyi::chain::account_contract_data_object, (id)(owner)(contract_id)(contract_data)(contract_data_size) )
 CHAINBASE_SET_INDEX_TYPE(taiyi::chain::account_contract_data_object, taiyi::chain::account_contract_data_index)
+TAIYI_SET_UNDO_ENCODER(taiyi::chain::account_contract_data_object, taiyi::chain::util::contract_data_size_of)
 
 #ifndef IS_LOW_MEM
 FC_REFLECT(taiyi::chain::contract_bin_code_object, (id)(contract_id)(lua_code_b)(source_code) )
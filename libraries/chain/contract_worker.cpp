@@ -56,8 +56,8 @@ namespace taiyi { namespace chain {
             if(name != current_contract_name) {
                 if(!context.get_sandbox(name)) {
                     new_sandbox = true;
-                    context.new_sandbox(name, baseENV.lua_code_b.data(), baseENV.lua_code_b.size());
-                    context.load_script_to_sandbox(name, contract_code.lua_code_b.data(), contract_code.lua_code_b.size());
+                    context.new_sandbox(name, baseENV, db.get_lua_chunk_cache());
+                    context.load_script_to_sandbox(name, contract, contract_code, db.get_lua_chunk_cache());
                     context.writeVariable(name, "_G", "protected");
                     context.writeVariable(name, "contract_helper", &ch);
                     context.writeVariable(name, "nfa_helper", (contract_nfa_handler*)0);
@@ -103,7 +103,7 @@ namespace taiyi { namespace chain {
                 if(temp.which() == contract_affected_type::tag<contract_result>::value)
                     result.relevant_datasize += temp.get<contract_result>().relevant_datasize;
             }
-            result.relevant_datasize += fc::raw::pack_size(ch.contract_data_cache) + fc::raw::pack_size(ch.account_contract_data_cache) + fc::raw::pack_size(result.contract_affecteds);
+            result.relevant_datasize += ch.contract_data_cache.get_pack_size() + ch.account_contract_data_cache.get_pack_size() + fc::raw::pack_size(result.contract_affecteds);
         }
         catch (LuaContext::VMcollapseErrorException e)
         {
@@ -411,8 +411,8 @@ namespace taiyi { namespace chain {
             const auto& name = contract.name;
             if(name != current_contract_name) {
                 if(!context.get_sandbox(name)) {
-                    context.new_sandbox(name, baseENV.lua_code_b.data(), baseENV.lua_code_b.size());
-                    context.load_script_to_sandbox(name, contract_code.lua_code_b.data(), contract_code.lua_code_b.size());
+                    context.new_sandbox(name, baseENV, db.get_lua_chunk_cache());
+                    context.load_script_to_sandbox(name, contract, contract_code, db.get_lua_chunk_cache());
                     context.writeVariable(name, "_G", "protected");
                     context.writeVariable(name, "contract_helper", &ch);
                     context.writeVariable(name, "contract_base_info", &cbi);
@@ -470,7 +470,7 @@ namespace taiyi { namespace chain {
                 if(temp.which() == contract_affected_type::tag<contract_result>::value)
                     result.relevant_datasize += temp.get<contract_result>().relevant_datasize;
             }
-            result.relevant_datasize += fc::raw::pack_size(ch.contract_data_cache) + fc::raw::pack_size(ch.account_contract_data_cache) + fc::raw::pack_size(result.contract_affecteds);
+            result.relevant_datasize += ch.contract_data_cache.get_pack_size() + ch.account_contract_data_cache.get_pack_size() + fc::raw::pack_size(result.contract_affecteds);
             
             db.set_contract_run_zone(pre_contract_run_zone);
         }
@@ -49,8 +49,10 @@ namespace taiyi { namespace chain {
                     member< cultivation_object, cultivation_id_type, &cultivation_object::id >
                 >
             >,
+            /// 未开始的修真（start_time为最大值）排在最后，并按截止开始时间排序
             ordered_unique< tag< by_start_deadline >,
                 composite_key< cultivation_object,
+                    member< cultivation_object, uint32_t, &cultivation_object::start_time >,
                     member< cultivation_object, uint32_t, &cultivation_object::start_deadline >,
                     member< cultivation_object, cultivation_id_type, &cultivation_object::id >
                 >
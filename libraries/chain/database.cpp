@@ -17,11 +17,14 @@
 #include <chain/transaction_object.hpp>
 #include <chain/contract_objects.hpp>
 #include <chain/nfa_objects.hpp>
+#include <chain/actor_objects.hpp>
 #include <chain/siming_objects.hpp>
 #include <chain/siming_schedule.hpp>
 #include <chain/proposal_processor.hpp>
 
 #include <chain/util/uint256.hpp>
+#include <chain/util/undo_encoding.hpp>
+#include <chain/util/index_configuration.hpp>
 
 #include <fc/smart_ref_impl.hpp>
 #include <fc/uint128.hpp>
@@ -57,7 +60,7 @@ namespace taiyi { namespace chain {
     {}
     
     database::database()
-        : _my( new database_impl(*this) )
+        : _my( new database_impl(*this) ), _invariant_checker( *this ), _zone_router( *this )
     {}
 
     database::~database()
@@ -67,6 +70,13 @@ namespace taiyi { namespace chain {
 
     void database::open( const open_args& args )
     { try {
+        //每个索引使用base加上database.cfg中同名节的设置
+        set_index_configuration_resolver( []( const std::string& value_type_name, const boost::any& cfg ) -> boost::any {
+            const fc::variant* v = boost::any_cast< fc::variant >( &cfg );
+            if( v == nullptr )
+                return cfg;
+            return util::index_database_configuration( *v, util::index_name_of_object_type( value_type_name ) );
+        } );
         chainbase::database::open( args.state_storage_dir, args.chainbase_flags, args.database_cfg );
         
         initialize_indexes();
@@ -82,10 +92,18 @@ namespace taiyi { namespace chain {
         _dao_account_id = get<account_object, by_name>(TAIYI_DAO_ACCOUNT).id;
         
         _benchmark_dumper.set_enabled( args.benchmark_is_enabled );
+        _lua_chunk_cache.set_capacity( args.lua_chunk_cache_size );
+        _lua_context_pool.set_chunk_cache( &_lua_chunk_cache );
+        _lua_context_pool.start( args.lua_context_pool_size );
+        _signature_key_cache.set_thread_num( args.signature_recovery_threads );
+        _incremental_pending_transactions = args.incremental_pending_transactions;
+        util::undo_encoding_threshold() = args.undo_encoding_threshold;
+        _invariant_checker.set_thread_num( args.invariant_check_threads );
+        _zone_router.set_cache_capacity( args.zone_route_cache_size );
         
         assert( args.data_dir.is_absolute() );
         chainbase::bfs::create_directories( args.data_dir );
-        _block_log.open( args.data_dir / "block_log" );
+        _block_log.open( args.data_dir / "block_log", args.block_log_compression_chunk );
         
         auto log_head = _block_log.head();
         
@@ -102,6 +120,16 @@ namespace taiyi { namespace chain {
                 if (args.do_validate_invariants)
                     validate_invariants();
             }
+            
+            if( args.do_validate_invariants && args.incremental_invariants )
+                _invariant_checker.set_incremental( true );
+            
+            _zone_router.attach();
+            
+            //账号权限的任何变化（包括撤销）都可能改变交易池中交易的权限检查结果
+            _account_authority_observer = get_mutable_index< account_authority_index >().add_delta_observer( [this]( const account_authority_object&, int ) {
+                _pending_tx_pool.reset_verified();
+            } );
         });
         
         if( head_block_num() )
@@ -115,6 +143,7 @@ namespace taiyi { namespace chain {
         
         with_read_lock( [&]() {
             init_hardforks(); // Writes to local state, but reads from db
+            publish_state_snapshot();
         });
         
         if (args.benchmark.first)
@@ -151,7 +180,11 @@ namespace taiyi { namespace chain {
         for ( auto const& delegate : delegates )
         {
             ilog( "Converting index '${name}' to ${type} type.", ("name", delegate.first)("type", type_str) );
-            delegate.second.set_index_type( db, type, p, cfg );
+            const fc::variant* v = boost::any_cast< fc::variant >( &cfg );
+            if( v != nullptr )
+                delegate.second.set_index_type( db, type, p, util::index_database_configuration( *v, delegate.first ) );
+            else
+                delegate.second.set_index_type( db, type, p, cfg );
         }
     }
     
@@ -200,7 +233,7 @@ namespace taiyi { namespace chain {
             
             with_write_lock( [&]() {
                 _block_log.set_locking( false );
-                auto itr = _block_log.read_block( 0 );
+                _block_log.set_read_ahead( true );
                 auto last_block_num = _block_log.head()->block_num();
                 if( args.stop_replay_at > 0 && args.stop_replay_at < last_block_num )
                     last_block_num = args.stop_replay_at;
@@ -209,10 +242,9 @@ namespace taiyi { namespace chain {
                     args.benchmark.second( 0, get_abstract_index_cntr() );
                 }
                 
-                while( itr.first.block_num() != last_block_num )
-                {
-                    auto cur_block_num = itr.first.block_num();
-                    if( cur_block_num % 100000 == 0 )
+                auto apply_replayed_block = [&]( const signed_block& block, const prepared_block* prepared ) {
+                    auto cur_block_num = block.block_num();
+                    if( cur_block_num % 100000 == 0 && cur_block_num != last_block_num )
                     {
                         std::cerr << "   " << double( cur_block_num ) * 100  / last_block_num << "%   " << cur_block_num << " of " << last_block_num << "   (" <<
                         get_cache_size()  << " objects cached using " << (get_cache_usage() >> 20) << "M" << ")\n";
@@ -220,9 +252,9 @@ namespace taiyi { namespace chain {
                         //rocksdb::SetPerfLevel(rocksdb::kEnableCount);
                         //rocksdb::get_perf_context()->Reset();
                     }
-                    apply_block( itr.first, skip_flags );
+                    apply_block( block, skip_flags, prepared );
                     
-                    if( cur_block_num % 100000 == 0 )
+                    if( cur_block_num % 100000 == 0 && cur_block_num != last_block_num )
                     {
                         //std::cout << rocksdb::get_perf_context()->ToString() << std::endl;
                         if( cur_block_num % 1000000 == 0 )
@@ -231,18 +263,42 @@ namespace taiyi { namespace chain {
                         }
                     }
                     
+                    note.last_block_number = cur_block_num;
                     if( (args.benchmark.first > 0) && (cur_block_num % args.benchmark.first == 0) )
                         args.benchmark.second( cur_block_num, get_abstract_index_cntr() );
-                    itr = _block_log.read_block( itr.second );
-                }
+                };
                 
-                apply_block( itr.first, skip_flags );
-                note.last_block_number = itr.first.block_num();
+                if( args.reindex_pipeline_depth > 0 )
+                {
+                    //工作线程提前读取、反序列化区块并计算哈希，这里只按顺序应用
+                    reindex_pipeline pipeline( _block_log, 1, last_block_num, args.reindex_pipeline_depth, args.reindex_pipeline_threads );
+                    _reindex_pipeline = &pipeline;
+                    BOOST_SCOPE_EXIT( this_ ) {
+                        this_->_reindex_pipeline = nullptr;
+                    } BOOST_SCOPE_EXIT_END
+                    
+                    while( auto b = pipeline.next() )
+                        apply_replayed_block( b->block, b.get() );
+                    
+                    auto stats = pipeline.get_stats();
+                    ilog( "Replay pipeline: depth ${d}, ${t} threads, ${p} ms preparing blocks, ${w} ms waiting for blocks.",
+                          ("d", stats.depth)("t", stats.thread_num)("p", stats.prepare_us / 1000)("w", stats.wait_us / 1000) );
+                }
+                else
+                {
+                    auto itr = _block_log.read_block( 0 );
+                    while( true )
+                    {
+                        apply_replayed_block( itr.first, nullptr );
+                        if( itr.first.block_num() == last_block_num )
+                            break;
+                        itr = _block_log.read_block( itr.second );
+                    }
+                }
                 
-                if( (args.benchmark.first > 0) && (note.last_block_number % args.benchmark.first == 0) )
-                    args.benchmark.second( note.last_block_number, get_abstract_index_cntr() );
                 set_revision( head_block_num() );
                 _block_log.set_locking( true );
+                _block_log.set_read_ahead( false );
                 
                 //get_index< account_index >().indices().print_stats();
             });
@@ -266,6 +322,11 @@ namespace taiyi { namespace chain {
         FC_CAPTURE_AND_RETHROW( (args.data_dir)(args.state_storage_dir) )
     }
 
+    reindex_pipeline::stats database::get_reindex_pipeline_stats()const
+    {
+        return _reindex_pipeline ? _reindex_pipeline->get_stats() : reindex_pipeline::stats();
+    }
+
     void database::wipe( const fc::path& data_dir, const fc::path& state_storage_dir, bool include_blocks)
     {
         close();
@@ -274,6 +335,7 @@ namespace taiyi { namespace chain {
         {
             fc::remove_all( data_dir / "block_log" );
             fc::remove_all( data_dir / "block_log.index" );
+            fc::remove_all( data_dir / "block_log.tail" );
         }
     }
 
@@ -286,12 +348,21 @@ namespace taiyi { namespace chain {
         
         undo_all();
         
+        _invariant_checker.set_incremental( false );
+        _zone_router.detach();
+        if( _account_authority_observer && has_index< account_authority_index >() )
+            get_mutable_index< account_authority_index >().remove_delta_observer( _account_authority_observer );
+        _account_authority_observer = 0;
+        
         chainbase::database::flush();
         chainbase::database::close();
         
         _block_log.close();
         
         _fork_db.reset();
+        
+        _lua_context_pool.stop();
+        _lua_chunk_cache.clear();
     } FC_CAPTURE_AND_RETHROW() }
     
     bool database::is_known_block( const block_id_type& id )const
@@ -307,7 +378,7 @@ namespace taiyi { namespace chain {
     bool database::is_known_transaction( const transaction_id_type& id )const
     { try {
         const auto& trx_idx = get_index<transaction_index>().indices().get<by_trx_id>();
-        return trx_idx.find( id ) != trx_idx.end();
+        return trx_idx.find( id ) != trx_idx.end() || _pending_tx_pool.contains( id );
     } FC_CAPTURE_AND_RETHROW() }
     
     block_id_type database::find_block_id_for_num( uint32_t block_num )const
@@ -520,6 +591,12 @@ namespace taiyi { namespace chain {
         return (_checkpoints.size() > 0) && (_checkpoints.rbegin()->first >= head_block_num());
     }
     
+    void database::prefetch_signature_keys( const signed_block& b )
+    { try {
+        //_apply_transaction验证权限时使用bip_0062
+        _signature_key_cache.prefetch( b, get_chain_id(), fc::ecc::bip_0062 );
+    } FC_CAPTURE_AND_RETHROW( (b.block_num()) ) }
+    
     /**
      * Push block "may fail" in which case every partial change is unwound.  After
      * push block is successful the block is appended to the chain database on disk.
@@ -555,7 +632,7 @@ namespace taiyi { namespace chain {
         
         bool result;
         detail::with_skip_flags( *this, skip, [&]() {
-            detail::without_pending_transactions( *this, std::move(_pending_tx), [&]() {
+            detail::without_pending_transactions( *this, [&]() {
                 try
                 {
                     result = _push_block(new_block);
@@ -696,27 +773,156 @@ namespace taiyi { namespace chain {
         if( !_pending_tx_session.valid() )
             _pending_tx_session = start_undo_session();
         
+        transaction_id_type trx_id = trx.id();
+        FC_ASSERT( !_pending_tx_pool.contains( trx_id ), "Duplicate transaction check failed", ("trx_ix", trx_id) );
+        
         // Create a temporary undo session as a child of _pending_tx_session.
         // The temporary session will be discarded by the destructor if
         // _apply_transaction fails.  If we make it to merge(), we
         // apply the changes.
         
         auto temp_session = start_undo_session();
-        _apply_transaction( trx );
-        _pending_tx.push_back( trx );
+        int64_t consumed_qi_before = _consumed_qi;
+        _apply_transaction( trx, trx_id );
+        const auto& ptx = _pending_tx_pool.add( trx, trx_id, true );
+        _pending_tx_pool.set_qi_cost( ptx, _consumed_qi - consumed_qi_before );
         
-        notify_changed_objects();
         // The transaction applied successfully. Merge its changes into the pending block session.
         temp_session.squash();
     }
     
+    void database::_apply_pending_transaction( const pending_transaction& ptx )
+    {
+        if( !_pending_tx_session.valid() )
+            _pending_tx_session = start_undo_session();
+        
+        //签名和权限检查过之后没有任何账号权限变化，检查结果仍然有效，其余检查和操作都重新执行
+        uint32_t skip = get_node_properties().skip_flags;
+        bool verified = _pending_tx_pool.is_verified( ptx );
+        if( verified )
+            skip |= skip_transaction_signatures | skip_authority_check;
+        
+        auto temp_session = start_undo_session();
+        int64_t consumed_qi_before = _consumed_qi;
+        detail::with_skip_flags( *this, skip, [&]() {
+            _apply_transaction( ptx.trx, ptx.id );
+        });
+        _pending_tx_pool.set_applied( ptx );
+        _pending_tx_pool.set_verified( ptx );
+        _pending_tx_pool.set_qi_cost( ptx, _consumed_qi - consumed_qi_before );
+        _pending_tx_pool.count_revalidated( verified );
+        
+        temp_session.squash();
+    }
+    
+    void database::reset_pending_transaction_session()
+    {
+        _pending_tx_session.reset();
+        _pending_tx_pool.reset_applied();
+    }
+    
+    void database::revalidate_pending_transactions()
+    {
+        auto start = fc::time_point::now();
+        bool apply_trxs = true;
+        uint32_t applied_txs = 0;
+        uint32_t postponed_txs = 0;
+        
+        // 只移出真正被打包的交易，区块应用失败时记录的交易ID已经随状态回滚
+        if( _pending_tx_included.size() )
+        {
+            const auto& trx_idx = get_index<transaction_index>().indices().get<by_trx_id>();
+            vector< transaction_id_type > included;
+            for( const auto& id : _pending_tx_included )
+            {
+                if( trx_idx.find( id ) != trx_idx.end() )
+                    included.push_back( id );
+            }
+            _pending_tx_pool.remove_included( included );
+            _pending_tx_included.clear();
+        }
+        _pending_tx_pool.remove_expired( head_block_time() );
+        
+        if( !_incremental_pending_transactions )
+            _pending_tx_pool.reset_verified();
+        
+        for( const auto& tx : _popped_tx )
+        {
+            if( apply_trxs && fc::time_point::now() - start > TAIYI_PENDING_TRANSACTION_EXECUTION_LIMIT ) apply_trxs = false;
+            
+            if( apply_trxs )
+            {
+                try {
+                    if( !is_known_transaction( tx.id() ) ) {
+                        // since push_transaction() takes a signed_transaction,
+                        // the operation_results field will be ignored.
+                        _push_transaction( tx );
+                        applied_txs++;
+                    }
+                } catch ( const fc::exception&  ) {}
+            }
+            else
+            {
+                transaction_id_type id = tx.id();
+                if( !is_known_transaction( id ) )
+                    _pending_tx_pool.add( tx, id, false );
+                postponed_txs++;
+            }
+        }
+        _popped_tx.clear();
+        
+        // 按到达顺序重新应用交易池中的全部交易，pending状态总是包含所有交易
+        const auto& pool_idx = _pending_tx_pool.by_arrival();
+        for( auto itr = pool_idx.begin(); itr != pool_idx.end(); )
+        {
+            const pending_transaction& ptx = *itr++;
+            if( _pending_tx_pool.is_applied( ptx ) )
+                continue;
+            
+            if( apply_trxs && fc::time_point::now() - start > TAIYI_PENDING_TRANSACTION_EXECUTION_LIMIT ) apply_trxs = false;
+            
+            if( !apply_trxs )
+            {
+                postponed_txs++;
+                continue;
+            }
+            
+            try
+            {
+                _apply_pending_transaction( ptx );
+                applied_txs++;
+            }
+            catch( const transaction_exception& e )
+            {
+                dlog( "Pending transaction became invalid after switching to block ${b} ${n} ${t}",
+                     ("b", head_block_id())("n", head_block_num())("t", head_block_time()) );
+                dlog( "The invalid transaction caused exception ${e}", ("e", e.to_detail_string()) );
+                dlog( "${t}", ("t", ptx.trx) );
+                _pending_tx_pool.remove( ptx.id );
+                _pending_tx_pool.count_dropped();
+            }
+            catch( const fc::exception& )
+            {
+                _pending_tx_pool.remove( ptx.id );
+                _pending_tx_pool.count_dropped();
+            }
+        }
+        
+        if( postponed_txs )
+        {
+            wlog( "Postponed ${p} pending transactions. ${a} were applied.", ("p", postponed_txs)("a", applied_txs) );
+        }
+    }
+    
     /**
      * Removes the most recent block from the database and
      * undoes any changes it made.
      */
     void database::pop_block()
     { try {
-        _pending_tx_session.reset();
+        reset_pending_transaction_session();
+        // 分叉切换时保守地重新检查全部交易的签名和权限
+        _pending_tx_pool.reset_verified();
         auto head_id = head_block_id();
         
         /// save the head block so we can recover its transactions
@@ -724,7 +930,9 @@ namespace taiyi { namespace chain {
         TAIYI_ASSERT( head_block.valid(), pop_empty_chain, "there are no blocks to pop" );
         
         _fork_db.pop_block();
+        notify_changed_objects( true );
         undo();
+        publish_state_snapshot();
         
         _popped_tx.insert( _popped_tx.begin(), head_block->transactions.begin(), head_block->transactions.end() );
         
@@ -732,8 +940,8 @@ namespace taiyi { namespace chain {
     
     void database::clear_pending()
     { try {
-        assert( (_pending_tx.size() == 0) || _pending_tx_session.valid() );
-        _pending_tx.clear();
+        _pending_tx_pool.clear();
+        _pending_tx_included.clear();
         _pending_tx_session.reset();
     } FC_CAPTURE_AND_RETHROW() }
     
@@ -1365,6 +1573,17 @@ namespace taiyi { namespace chain {
     {
         initialize_core_indexes( *this );
         _plugin_index_signal();
+        
+        //插件的索引也已经注册，database.cfg中其他的节都没有对应的索引
+        const fc::variant* cfg = boost::any_cast< fc::variant >( &get_database_configuration() );
+        if( cfg != nullptr && cfg->is_object() )
+        {
+            for( const auto& e : cfg->get_object() )
+            {
+                if( e.key() != "global" && e.key() != "base" && !has_index_delegate( e.key() ) )
+                    wlog( "Database configuration for unknown index '${name}' is ignored.", ("name", e.key()) );
+            }
+        }
     }
     
     void g_init_tiandao_property_object( tiandao_property_object& tiandao );
@@ -1516,33 +1735,26 @@ namespace taiyi { namespace chain {
         });
     }
 
-    void database::notify_changed_objects()
-    { try {
-    /*
-        vector< chainbase::generic_id > ids;
-        get_changed_ids( ids );
-        TAIYI_TRY_NOTIFY( changed_objects, ids )
-    */
-
-    /*
-        if( _undo_db.enabled() )
-        {
-            const auto& head_undo = _undo_db.head();
-            vector<object_id_type> changed_ids;  changed_ids.reserve(head_undo.old_values.size());
-            for( const auto& item : head_undo.old_values ) changed_ids.push_back(item.first);
-            for( const auto& item : head_undo.new_ids ) changed_ids.push_back(item);
-            vector<const object*> removed;
-            removed.reserve( head_undo.removed.size() );
-            for( const auto& item : head_undo.removed )
-            {
-                changed_ids.push_back( item.first );
-                removed.emplace_back( item.second.get() );
-            }
-            TAIYI_TRY_NOTIFY( changed_objects, changed_ids )
-        }
-    */
-    } FC_CAPTURE_AND_RETHROW() }
+    void database::notify_changed_objects( bool reverted )
+    {
+        //块应用完成时块内所有交易的撤销会话都已合并到块的会话，弹出块时待处理交易的会话已经撤销，
+        //两种情况下撤销状态都是头部块的全部修改
+        uint32_t block_num = head_block_num();
+        for( auto& feed : _changed_objects_feeds )
+            TAIYI_TRY_NOTIFY( feed->notify, block_num, reverted )
+    }
 
+    void database::publish_state_snapshot()
+    {
+        auto snapshot = std::make_shared< state_snapshot >( get_dynamic_global_properties(), get_siming_schedule_object(), get_hardfork_property_object() );
+        
+        const auto& rf_idx = get_index< reward_fund_index, by_id >();
+        for( auto itr = rf_idx.begin(); itr != rf_idx.end(); ++itr )
+            snapshot->reward_funds.push_back( *itr );
+        
+        std::atomic_store( &_state_snapshot, std::shared_ptr< const state_snapshot >( std::move( snapshot ) ) );
+    }
+    
     void database::set_flush_interval( uint32_t flush_blocks )
     {
         _flush_blocks = flush_blocks;
@@ -1551,12 +1763,12 @@ namespace taiyi { namespace chain {
     
     //////////////////// private methods ////////////////////
     
-    void database::apply_block( const signed_block& next_block, uint32_t skip )
+    void database::apply_block( const signed_block& next_block, uint32_t skip, const prepared_block* prepared )
     { try {
         //fc::time_point begin_time = fc::time_point::now();
         
         detail::with_skip_flags( *this, skip, [&]() {
-            _apply_block( next_block );
+            _apply_block( next_block, prepared );
         } );
         
         try
@@ -1566,6 +1778,21 @@ namespace taiyi { namespace chain {
                 validate_invariants();
         }
         FC_CAPTURE_AND_RETHROW( (next_block) );
+        
+        //不变量检查通过后块才算被接受，检查失败时块被撤销，订阅者和状态快照的读者都不会看到它
+        detail::with_skip_flags( *this, skip, [&]() {
+            notify_changed_objects();
+            
+            publish_state_snapshot();
+            
+            // This moves newly irreversible blocks from the fork db to the block log
+            // and commits irreversible state to the database. This should always be the
+            // last call of applying a block because it is the only thing that is not
+            // reversible.
+            migrate_irreversible_state();
+            
+            trim_cache();
+        } );
 
         auto block_num = next_block.block_num();
 
@@ -1600,9 +1827,9 @@ namespace taiyi { namespace chain {
         
     } FC_CAPTURE_AND_RETHROW( (next_block) ) }
     
-    void database::_apply_block( const signed_block& next_block )
+    void database::_apply_block( const signed_block& next_block, const prepared_block* prepared )
     { try {
-        block_notification note( next_block );
+        block_notification note = prepared ? block_notification( next_block, prepared->block_id ) : block_notification( next_block );
         notify_pre_apply_block( note );
         
         const uint32_t next_block_num = note.block_num;
@@ -1671,7 +1898,7 @@ namespace taiyi { namespace chain {
         const siming_object& signing_siming = validate_block_header(skip, next_block);
         
         const auto& gprops = get_dynamic_global_properties();
-        auto block_size = fc::raw::pack_size( next_block );
+        auto block_size = prepared ? prepared->block_size : fc::raw::pack_size( next_block );
         FC_ASSERT( block_size <= gprops.maximum_block_size, "Block Size is too Big", ("next_block_num",next_block_num)("block_size", block_size)("max",gprops.maximum_block_size) );
         if( block_size < TAIYI_MIN_BLOCK_SIZE )
             elog( "Block size is too small", ("next_block_num",next_block_num)("block_size", block_size)("min",TAIYI_MIN_BLOCK_SIZE));
@@ -1704,7 +1931,10 @@ namespace taiyi { namespace chain {
              * 然而，为了不影响当前节点的状态，对广播来的交易（自己收交易请求api也走的
              * 广播）的验证，以及在出块时候对打包交易的验证，都是需要专门的回滚操作的。
              */
-            apply_transaction( trx, skip );
+            if( prepared )
+                _apply_transaction( trx, prepared->trx_ids[ _current_trx_in_block ] ); //跳过标志已经由apply_block设置
+            else
+                apply_transaction( trx, skip );
             ++_current_trx_in_block;
         }
         
@@ -1718,39 +1948,30 @@ namespace taiyi { namespace chain {
         update_last_irreversible_block();
         
         create_block_summary(next_block);
-        clear_expired_transactions();
-        clear_expired_delegations();
+        run_block_routine("clear_expired_transactions", [&]() { clear_expired_transactions(); });
+        run_block_routine("clear_expired_delegations", [&]() { clear_expired_delegations(); });
         
-        update_siming_schedule(*this);
+        run_block_routine("update_siming_schedule", [&]() { update_siming_schedule(*this); });
                 
-        process_funds();
-        process_qi_withdrawals();
+        run_block_routine("process_funds", [&]() { process_funds(); });
+        run_block_routine("process_qi_withdrawals", [&]() { process_qi_withdrawals(); });
         
-        account_recovery_processing();
-        process_decline_adoring_rights();
+        run_block_routine("account_recovery_processing", [&]() { account_recovery_processing(); });
+        run_block_routine("process_decline_adoring_rights", [&]() { process_decline_adoring_rights(); });
 
-        process_proposals(note);
+        run_block_routine("process_proposals", [&]() { process_proposals(note); });
 
-        process_tiandao();
-        process_nfa_tick();
+        run_block_routine("process_tiandao", [&]() { process_tiandao(); });
+        run_block_routine("process_nfa_tick", [&]() { process_nfa_tick(); });
         
-        clean_cultivations(); // TODO: 放到一个定期维护的过程中，而不是每个块都调用
+        //只访问到期的修真，开销与到期数量成正比
+        run_block_routine("clean_cultivations", [&]() { clean_cultivations(); });
 
         process_hardforks();
         
         // notify observers that the block has been applied
         notify_post_apply_block(note);
         
-        notify_changed_objects();
-        
-        // This moves newly irreversible blocks from the fork db to the block log
-        // and commits irreversible state to the database. This should always be the
-        // last call of applying a block because it is the only thing that is not
-        // reversible.
-        migrate_irreversible_state();
-        
-        trim_cache();
-        
     } FC_CAPTURE_LOG_AND_RETHROW( (next_block.block_num()) ) }
 
     struct process_header_visitor
@@ -1806,8 +2027,13 @@ namespace taiyi { namespace chain {
     }
     
     void database::_apply_transaction(const signed_transaction& trx)
+    {
+        _apply_transaction( trx, trx.id() );
+    }
+    
+    void database::_apply_transaction(const signed_transaction& trx, const transaction_id_type& id)
     { try {
-        transaction_notification note(trx);
+        transaction_notification note(trx, id);
         _current_trx_id = note.transaction_id;
         _current_trx = &trx;
         const transaction_id_type& trx_id = note.transaction_id;
@@ -1815,6 +2041,10 @@ namespace taiyi { namespace chain {
         
         uint32_t skip = get_node_properties().skip_flags;
         
+        //区块中的交易，区块应用成功后要从交易池移出
+        if( _currently_processing_block_id.valid() && !_pending_tx_pool.empty() )
+            _pending_tx_included.push_back( trx_id );
+        
         if( !(skip&skip_validate) )   /* issue #505 explains why this skip_flag is disabled */
             trx.validate();
         
@@ -1833,8 +2063,13 @@ namespace taiyi { namespace chain {
             
             try
             {
-                trx.verify_authority( chain_id, get_active, get_owner, get_posting, TAIYI_MAX_SIG_CHECK_DEPTH,
-                                     TAIYI_MAX_AUTHORITY_MEMBERSHIP, TAIYI_MAX_SIG_CHECK_ACCOUNTS, fc::ecc::bip_0062);
+                flat_set< public_key_type > signature_keys;
+                if( _signature_key_cache.is_enabled() && _signature_key_cache.get( trx_id, trx, fc::ecc::bip_0062, signature_keys ) )
+                    trx.verify_authority( signature_keys, get_active, get_owner, get_posting, TAIYI_MAX_SIG_CHECK_DEPTH,
+                                         TAIYI_MAX_AUTHORITY_MEMBERSHIP, TAIYI_MAX_SIG_CHECK_ACCOUNTS );
+                else
+                    trx.verify_authority( chain_id, get_active, get_owner, get_posting, TAIYI_MAX_SIG_CHECK_DEPTH,
+                                         TAIYI_MAX_AUTHORITY_MEMBERSHIP, TAIYI_MAX_SIG_CHECK_ACCOUNTS, fc::ecc::bip_0062);
             }
             catch( protocol::tx_missing_active_auth& e )
             {
@@ -2069,7 +2304,9 @@ namespace taiyi { namespace chain {
     { try {
         block_summary_id_type sid( next_block.block_num() & 0xffff );
         modify( get< block_summary_object >( sid ), [&](block_summary_object& p) {
-            p.block_id = next_block.id();
+            // _currently_processing_block_id is always set by caller
+            FC_ASSERT( _currently_processing_block_id.valid() );
+            p.block_id = *_currently_processing_block_id;
         });
     } FC_CAPTURE_AND_RETHROW() }
     
@@ -2652,112 +2889,7 @@ namespace taiyi { namespace chain {
      */
     void database::validate_invariants()const
     { try {
-        asset total_supply = asset(0, YANG_SYMBOL);
-        share_type total_vsf_adores = share_type( 0 );
-        
-        asset total_gold = asset(0, GOLD_SYMBOL);
-        asset total_food = asset(0, FOOD_SYMBOL);
-        asset total_wood = asset(0, WOOD_SYMBOL);
-        asset total_fabric = asset(0, FABRIC_SYMBOL);
-        asset total_herb = asset(0, HERB_SYMBOL);
-
-        auto gpo = get_dynamic_global_properties();
-        
-        // verify no siming has too many adores
-        const auto& siming_idx = get_index< siming_index >().indices();
-        for( auto itr = siming_idx.begin(); itr != siming_idx.end(); ++itr )
-            FC_ASSERT(itr->adores <= gpo.total_qi.amount, "核对司命收到信仰总值的合理性失败");
-        
-        asset total_account_qi = asset(0, QI_SYMBOL);
-        asset total_reward_qi = asset(0, QI_SYMBOL);
-        asset total_reward_feigang = asset(0, QI_SYMBOL);
-        const auto& account_idx = get_index< account_index, by_name >();
-        for( auto itr = account_idx.begin(); itr != account_idx.end(); ++itr )
-        {
-            total_supply += itr->balance;
-            total_supply += itr->reward_yang_balance;
-            
-            total_account_qi += itr->qi;
-            total_reward_qi += itr->reward_qi_balance;
-            total_reward_feigang += itr->reward_feigang_balance;
-            
-            total_gold += get_balance(*itr, GOLD_SYMBOL);
-            total_food += get_balance(*itr, FOOD_SYMBOL);
-            total_wood += get_balance(*itr, WOOD_SYMBOL);
-            total_fabric += get_balance(*itr, FABRIC_SYMBOL);
-            total_herb += get_balance(*itr, HERB_SYMBOL);
-            
-            total_vsf_adores += ( itr->proxy == TAIYI_PROXY_TO_SELF_ACCOUNT ?
-                itr->siming_adore_weight() :
-                ( TAIYI_MAX_PROXY_RECURSION_DEPTH > 0 ?
-                    itr->proxied_vsf_adores[TAIYI_MAX_PROXY_RECURSION_DEPTH - 1] :
-                    itr->qi.amount
-                )
-            );
-        }
-
-        FC_ASSERT(total_account_qi.amount == total_vsf_adores, "核对由所有账号产生的信仰总值失败", ("total_account_qi", total_account_qi)("total_vsf_adores", total_vsf_adores));
-        FC_ASSERT(gpo.pending_rewarded_feigang == total_reward_feigang, "核对所有账号的未领取非罡失败", ("gpo.pending_rewarded_feigang", gpo.pending_rewarded_feigang)("total_reward_feigang", total_reward_feigang));
-
-        asset total_nfa_qi = asset(0, QI_SYMBOL);
-        asset total_cultivation_qi = asset(0, QI_SYMBOL);
-        const auto& nfa_idx = get_index< nfa_index, by_id >();
-        for( auto itr = nfa_idx.begin(); itr != nfa_idx.end(); ++itr)
-        {
-            total_supply += get_nfa_balance(*itr, YANG_SYMBOL);
-            total_nfa_qi += itr->qi;
-            
-            total_gold += get_nfa_balance(*itr, GOLD_SYMBOL);
-            total_food += get_nfa_balance(*itr, FOOD_SYMBOL);
-            total_wood += get_nfa_balance(*itr, WOOD_SYMBOL);
-            total_fabric += get_nfa_balance(*itr, FABRIC_SYMBOL);
-            total_herb += get_nfa_balance(*itr, HERB_SYMBOL);
-
-            total_cultivation_qi.amount += itr->cultivation_value;
-        }
-        
-        const auto& nfa_material_idx = get_index< nfa_material_index, by_id >();
-        for( auto itr = nfa_material_idx.begin(); itr != nfa_material_idx.end(); ++itr)
-        {
-            total_gold += itr->gold;
-            total_food += itr->food;
-            total_wood += itr->wood;
-            total_fabric += itr->fabric;
-            total_herb += itr->herb;
-        }
-
-        FC_ASSERT(gpo.pending_cultivation_qi == total_cultivation_qi, "核对参与修真的真气总量失败", ("gpo.pending_cultivation_qi", gpo.pending_cultivation_qi)("total_cultivation_qi", total_cultivation_qi));
-
-        const auto& reward_idx = get_index< reward_fund_index, by_id >();
-        for( auto itr = reward_idx.begin(); itr != reward_idx.end(); ++itr ) {
-            total_supply += itr->reward_balance;
-            total_reward_qi += itr->reward_qi_balance;
-        }
-
-        FC_ASSERT(gpo.pending_rewarded_qi == total_reward_qi, "核对修真奖励池和账号未领取修真奖励真气失败", ("gpo.pending_rewarded_qi", gpo.pending_rewarded_qi)("total_reward_qi", total_reward_qi));
-
-        FC_ASSERT(gpo.total_qi == (total_account_qi + total_nfa_qi), "核对自由真气总量失败", ("gpo.total_qi", gpo.total_qi)("total_account_qi", total_account_qi)("total_nfa_qi", total_nfa_qi));
-        
-        //统计所有非阳寿相关的等价真气，避免最后换算阳寿时候的整型误差
-        asset total_qi = total_account_qi + total_reward_feigang + total_nfa_qi + total_cultivation_qi + total_reward_qi;
-        //换算物质到等价真气
-        total_qi += total_gold * TAIYI_GOLD_QI_PRICE;
-        total_qi += total_food * TAIYI_FOOD_QI_PRICE;
-        total_qi += total_wood * TAIYI_WOOD_QI_PRICE;
-        total_qi += total_fabric * TAIYI_FABRIC_QI_PRICE;
-        total_qi += total_herb * TAIYI_HERB_QI_PRICE;
-
-        //统计以阳寿表示的全局总量
-        total_supply += total_qi * TAIYI_QI_SHARE_PRICE;
-        FC_ASSERT(gpo.current_supply == total_supply, "核对系统总阳寿量失败", ("gpo.current_supply", gpo.current_supply)("total_supply", total_supply));
-        
-        //核对系统总物质量
-        FC_ASSERT(gpo.total_gold == total_gold, "核对系统总金石含量失败", ("gpo.total_gold", gpo.total_gold)("total_gold", total_gold));
-        FC_ASSERT(gpo.total_food == total_food, "核对系统总食物含量失败", ("gpo.total_food", gpo.total_food)("total_food", total_food));
-        FC_ASSERT(gpo.total_wood == total_wood, "核对系统总木材含量失败", ("gpo.total_wood", gpo.total_wood)("total_wood", total_wood));
-        FC_ASSERT(gpo.total_fabric == total_fabric, "核对系统总织物含量失败", ("gpo.total_fabric", gpo.total_fabric)("total_fabric", total_fabric));
-        FC_ASSERT(gpo.total_herb == total_herb, "核对系统总药材含量失败", ("gpo.total_herb", gpo.total_herb)("total_herb", total_herb));
-        
+        _invariant_checker.check();
     } FC_CAPTURE_LOG_AND_RETHROW( (head_block_num()) ); }
 
     optional< chainbase::database::session >& database::pending_transaction_session()
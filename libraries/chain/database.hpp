@@ -1,13 +1,23 @@
 #pragma once
 #include <chain/block_log.hpp>
+#include <chain/changed_objects.hpp>
 #include <chain/fork_database.hpp>
 #include <chain/global_property_object.hpp>
 #include <chain/hardfork_property_object.hpp>
+#include <chain/invariant_checker.hpp>
+#include <chain/zone_router.hpp>
+#include <chain/lua_context_pool.hpp>
+#include <chain/lua_chunk_cache.hpp>
 #include <chain/node_property_object.hpp>
 #include <chain/notifications.hpp>
+#include <chain/pending_transaction_pool.hpp>
+#include <chain/reindex_pipeline.hpp>
+#include <chain/signature_key_cache.hpp>
+#include <chain/state_snapshot.hpp>
 
 #include <chain/util/advanced_benchmark_dumper.hpp>
 #include <chain/util/signal.hpp>
+#include <chain/util/tiandao_calendar.hpp>
 
 #include <protocol/protocol.hpp>
 #include <protocol/hardfork.hpp>
@@ -20,6 +30,7 @@
 
 #include <functional>
 #include <map>
+#include <memory>
 
 namespace taiyi { namespace chain {
 
@@ -113,9 +124,20 @@ namespace taiyi { namespace chain {
             fc::variant database_cfg;
             bool replay_in_memory = false;
             std::vector< std::string > replay_memory_indices{};
+            uint32_t lua_context_pool_size = 0;
+            uint32_t lua_chunk_cache_size = 0;
+            uint32_t block_log_compression_chunk = 0;
+            uint32_t signature_recovery_threads = 0;
+            bool incremental_pending_transactions = true;
+            uint64_t undo_encoding_threshold = 0;
+            uint32_t invariant_check_threads = 0;
+            bool incremental_invariants = false;
+            uint32_t zone_route_cache_size = 0;
 
             // The following fields are only used on reindexing
             uint32_t stop_replay_at = 0;
+            uint32_t reindex_pipeline_depth = 0;
+            uint32_t reindex_pipeline_threads = 0;
             TBenchmark benchmark = TBenchmark(0, []( uint32_t, const abstract_index_cntr_t& ){});
         };
 
@@ -139,6 +161,11 @@ namespace taiyi { namespace chain {
          */
         uint32_t reindex( const open_args& args );
 
+        /**
+         * 重放流水线的统计，不在reindex中时返回空（depth为0），用于args.benchmark的回调
+         */
+        reindex_pipeline::stats get_reindex_pipeline_stats()const;
+
         /**
          * @brief wipe Delete database from disk, and potentially the raw chain as well.
          * @param include_blocks If true, delete the raw chain as well as the database.
@@ -201,11 +228,32 @@ namespace taiyi { namespace chain {
         bool before_last_checkpoint()const;
 
         bool push_block( const signed_block& b, uint32_t skip = skip_nothing );
+
+        /**
+         * 在拿写锁之前并行恢复区块中交易的签名公钥，应用交易时直接使用，不需要数据库锁
+         */
+        void prefetch_signature_keys( const signed_block& b );
+        const signature_key_cache& get_signature_key_cache()const { return _signature_key_cache; }
         void push_transaction( const signed_transaction& trx, uint32_t skip = skip_nothing );
         void _maybe_warn_multiple_production( uint32_t height )const;
         bool _push_block( const signed_block& b );
         void _push_transaction( const signed_transaction& trx );
 
+        /**
+         * 等待打包的交易池，block_producer按到达顺序从中取交易出块
+         */
+        const pending_transaction_pool& get_pending_transaction_pool()const { return _pending_tx_pool; }
+
+        /**
+         * 撤销pending状态，交易池中的交易全部变为未应用
+         */
+        void reset_pending_transaction_session();
+
+        /**
+         * 新区块之后重新整理交易池：移出被打包和过期的交易，先应用弹出区块中的交易，再按到达顺序重新应用交易池中的全部交易
+         */
+        void revalidate_pending_transactions();
+
         void pop_block();
         void clear_pending();
 
@@ -251,6 +299,34 @@ namespace taiyi { namespace chain {
         boost::signals2::connection add_pre_reindex_handler( const reindex_handler_t& func, const abstract_plugin& plugin, int32_t group = -1 );
         boost::signals2::connection add_post_reindex_handler( const reindex_handler_t& func, const abstract_plugin& plugin, int32_t group = -1 );
 
+        /**
+         * 订阅一个索引的变更流，每个块被接受（应用完成并通过不变量检查）后收到这个块创建、修改、删除的对象，
+         * 没有被接受的块不发通知；块被弹出或者分叉切换撤销时再收到一次reverted通知。
+         * max_changes不为0时，一个块的修改超过这个数量只收到truncated通知。
+         *
+         * 回放时不记录撤销状态，没有变更流，订阅者在post_reindex时从当前状态重新同步；关闭数据库时撤销的块也不发通知
+         */
+        template< typename MultiIndexType >
+        boost::signals2::connection add_changed_objects_handler( const typename changed_objects_feed< MultiIndexType >::handler_type& func, const abstract_plugin& plugin, uint32_t max_changes = 0, int32_t group = -1 )
+        {
+            const auto& index = get_index< MultiIndexType >();
+            changed_objects_feed< MultiIndexType >* feed = nullptr;
+            for( auto& f : _changed_objects_feeds )
+            {
+                if( f->get_index_address() == &index )
+                {
+                    feed = static_cast< changed_objects_feed< MultiIndexType >* >( f.get() );
+                    break;
+                }
+            }
+            if( feed == nullptr )
+            {
+                feed = new changed_objects_feed< MultiIndexType >( index, _benchmark_dumper );
+                _changed_objects_feeds.emplace_back( feed );
+            }
+            return feed->connect( func, plugin.get_name(), max_changes, group );
+        }
+
         //**************** database_siming_schedule.cpp **************//
 
         /**
@@ -341,6 +417,8 @@ namespace taiyi { namespace chain {
         void initialize_actor_object( actor_object& act, const std::string& name, const nfa_object& nfa );
         void initialize_actor_talents( const actor_object& act );
         void initialize_actor_attributes( const actor_object& act, const vector<uint16_t>& init_attrs );
+        void count_actor_created( const actor_object& act );
+        void count_actor_health_changed( int16_t old_health, int16_t new_health );
         const actor_object& get_actor( const std::string& name )const;
         const actor_object* find_actor( const std::string& name )const;
         void initialize_actor_talent_rule_object(const account_object& creator, actor_talent_rule_object& rule, LuaContext& context);
@@ -358,6 +436,9 @@ namespace taiyi { namespace chain {
         const zone_object*  find_zone( const std::string& name ) const;
         bool is_contract_allowed_by_zone(const contract_object& contract, const zone_id_type& zone_id) const;
         int calculate_moving_days_to_zone( const zone_object& zone );
+        /** 移动天数最少的路线，路线中的每一步都按calculate_moving_days_to_zone计算天数 */
+        zone_route find_way_to_zone( const zone_object& from, const zone_object& to );
+        zone_router& get_zone_router() { return _zone_router; }
         int64_t calculate_zone_spiritual_energy( const zone_object& zone ) const;
         void process_tiandao();
         
@@ -393,7 +474,6 @@ namespace taiyi { namespace chain {
          * can be reapplied at the proper time
          */
         std::deque< signed_transaction >       _popped_tx;
-        vector< signed_transaction >           _pending_tx;
 
         bool has_hardfork( uint32_t hardfork )const;
 
@@ -403,8 +483,17 @@ namespace taiyi { namespace chain {
             with id N, applies all hardforks with id <= N */
         void set_hardfork( uint32_t hardfork, bool process_now = true );
 
+        /**
+         * 核对供应量等不变量，由invariant_checker按索引分片并行扫描，或者在增量模式下直接使用随修改维护的合计
+         */
         void validate_invariants()const;
 
+        /** 最后发布的全局状态副本（只包含被接受的块的状态），可以在任何线程中调用，不需要持有锁 */
+        std::shared_ptr< const state_snapshot > get_state_snapshot()const { return std::atomic_load( &_state_snapshot ); }
+        /** 用当前状态发布新的全局状态副本，只在写线程中调用 */
+        void publish_state_snapshot();
+        invariant_checker& get_invariant_checker() { return _invariant_checker; }
+
         void set_flush_interval( uint32_t flush_blocks );
 
         void apply_transaction( const signed_transaction& trx, uint32_t skip = skip_nothing );
@@ -419,9 +508,18 @@ namespace taiyi { namespace chain {
         // contracts
         void initialize_VM_baseENV(LuaContext& context);
 
+        /**
+         * 取出一个已经初始化好baseENV的虚拟机，等价于新建LuaContext后执行initialize_VM_baseENV，
+         * 用完后通过release_VM_context归还，由虚拟机池在后台线程销毁
+         */
+        std::unique_ptr<LuaContext> acquire_VM_context();
+        void release_VM_context(std::unique_ptr<LuaContext> context);
+        lua_context_pool& get_lua_context_pool() { return _lua_context_pool; }
+        lua_chunk_cache& get_lua_chunk_cache() { return _lua_chunk_cache; }
+
         void create_basic_contract_objects();
         size_t create_contract_objects(const account_object& owner, const string& contract_name, const string& contract_data, long long& vm_drops, bool released_after_created = false);
-        lua_map prepare_account_contract_data(const account_object& account, const contract_object& contract);
+        const account_contract_data_object& prepare_account_contract_data(const account_object& account, const contract_object& contract);
         
         void add_contract_handler_exe_point(int64_t p) { _contract_handler_exe_point += p; }
         int64_t get_contract_handler_exe_point() const { return _contract_handler_exe_point; }
@@ -443,6 +541,10 @@ namespace taiyi { namespace chain {
         
         // xinsu
         bool is_xinsu(const account_object& account) const;
+        /** 心素标记NFA创建（old_owner为空）或者所有者变更后调用，账号因此成为或者不再是心素时修正其所投提案的票数 */
+        void update_xinsu_proposal_votes(const nfa_object& nfa, const optional<account_id_type>& old_owner);
+        /** 账号所投的每个提案的票数加上delta */
+        void adjust_proposal_votes(const account_id_type& voter, int64_t delta);
         
         // DAO
         bool is_dao_account(const account_object& account) const;
@@ -450,7 +552,7 @@ namespace taiyi { namespace chain {
     protected:
         //Mark pop_undo() as protected -- we do not want outside calling pop_undo(); it should call pop_block() instead
         //void pop_undo() { object_database::pop_undo(); }
-        void notify_changed_objects();
+        void notify_changed_objects( bool reverted = false );
 
         void process_nfa_tick();
 
@@ -459,9 +561,15 @@ namespace taiyi { namespace chain {
         bool _log_hardforks = true;
         optional< chainbase::database::session > _pending_tx_session;
 
-        void apply_block( const signed_block& next_block, uint32_t skip = skip_nothing );
-        void _apply_block( const signed_block& next_block );
+        void apply_block( const signed_block& next_block, uint32_t skip = skip_nothing, const prepared_block* prepared = nullptr );
+        void _apply_block( const signed_block& next_block, const prepared_block* prepared = nullptr );
         void _apply_transaction( const signed_transaction& trx );
+        void _apply_transaction( const signed_transaction& trx, const transaction_id_type& id );
+
+        /**
+         * 在pending状态中重新应用交易池中的交易，签名和权限检查仍然有效时跳过这两项检查
+         */
+        void _apply_pending_transaction( const pending_transaction& ptx );
         operation_result apply_operation( const operation& op );
 
         ///Steps involved in applying a new block
@@ -480,6 +588,21 @@ namespace taiyi { namespace chain {
         void clear_expired_delegations();
         void process_header_extensions( const signed_block& next_block );
 
+        /** 执行每个块的维护过程，开启advanced-benchmark时以“block--->名称”统计各自的耗时 */
+        template< typename Lambda >
+        void run_block_routine( const char* name, Lambda&& routine )
+        {
+            if( !_benchmark_dumper.is_enabled() )
+            {
+                routine();
+                return;
+            }
+
+            auto since = _benchmark_dumper.now();
+            routine();
+            _benchmark_dumper.end_since( since, std::string( "block--->" ) + name );
+        }
+
         void init_hardforks();
         void process_hardforks();
         void apply_hardfork( uint32_t hardfork );
@@ -636,6 +759,55 @@ namespace taiyi { namespace chain {
           * 用于快速访问DAO账号ID的缓存变量
          */
         account_id_type _dao_account_id = account_id_type::max();
+
+        /**
+          * 合约字节码的解码缓存，所有虚拟机共用
+         */
+        lua_chunk_cache _lua_chunk_cache;
+
+        /**
+          * 预热的虚拟机池，用于NFA心跳等需要大量新建虚拟机的场合
+         */
+        lua_context_pool _lua_context_pool;
+
+        /**
+          * 按年缓存的虚拟历法，process_tiandao每个区块查询
+         */
+        tiandao_calendar _tiandao_calendar;
+
+        /**
+          * 重放时的区块读取流水线，只在reindex期间有效
+         */
+        const reindex_pipeline* _reindex_pipeline = nullptr;
+
+        /**
+          * 预先恢复的交易签名公钥，push_block之前由prefetch_signature_keys填充
+         */
+        signature_key_cache _signature_key_cache;
+
+        /**
+          * 等待打包的交易，以及正在应用的区块中出现过的交易ID（区块应用成功后从交易池移出）
+         */
+        pending_transaction_pool _pending_tx_pool;
+        vector< transaction_id_type > _pending_tx_included;
+        bool _incremental_pending_transactions = true;
+        uint32_t _account_authority_observer = 0;  ///< 账号权限变化时使交易池中的权限检查结果失效
+
+        /**
+          * 累计通过非罡奖励消耗的气，不属于链上状态，只用来计算单个交易的消耗
+         */
+        int64_t _consumed_qi = 0;
+
+        invariant_checker _invariant_checker;
+
+        /**
+          * 区域连接图和最近查询的路线，随区域和连接索引的修改增量维护
+         */
+        zone_router _zone_router;
+
+        std::vector< std::unique_ptr< abstract_changed_objects_feed > > _changed_objects_feeds;
+
+        std::shared_ptr< const state_snapshot > _state_snapshot;
     };
 
     struct reindex_notification
@@ -71,6 +71,34 @@ namespace taiyi { namespace chain {
             rule.init_attribute_amount_modifier = it_amodifier->second.get<lua_int>().v;
     }
     //=============================================================================
+    void database::count_actor_created( const actor_object& act )
+    {
+        modify( get_tiandao_properties(), [&]( tiandao_property_object& t ) {
+            if( act.health > 0 )
+                t.live_actor_num++;
+            else
+                t.dead_actor_num++;
+        });
+    }
+    //=============================================================================
+    void database::count_actor_health_changed( int16_t old_health, int16_t new_health )
+    {
+        //只有健康值越过0时生死人数才会变化
+        if( (old_health > 0) == (new_health > 0) )
+            return;
+        
+        modify( get_tiandao_properties(), [&]( tiandao_property_object& t ) {
+            if( new_health > 0 ) {
+                t.live_actor_num++;
+                t.dead_actor_num--;
+            }
+            else {
+                t.live_actor_num--;
+                t.dead_actor_num++;
+            }
+        });
+    }
+    //=============================================================================
     void database::initialize_actor_talents( const actor_object& act )
     {
         auto now = head_block_time();
@@ -125,13 +125,20 @@ namespace taiyi { namespace chain {
     {
         const auto &contract_base = get<contract_object, by_id>(contract_id_type());
         const auto &contract_base_code = get<contract_bin_code_object, by_id>(contract_base.lua_code_b_id);
-        lua_getglobal(context.mState, "baseENV");
-        if (lua_isnil(context.mState, -1))
-        {
-            lua_pop(context.mState, 1);
-            luaL_loadbuffer(context.mState, contract_base_code.lua_code_b.data(), contract_base_code.lua_code_b.size(), contract_base.name.data());
-            lua_setglobal(context.mState, "baseENV");
-        }
+        lua_context_pool::load_base_env(context, contract_base.name, contract_base_code.id, contract_base_code.lua_code_b, &_lua_chunk_cache);
+    }
+    //=============================================================================
+    std::unique_ptr<LuaContext> database::acquire_VM_context()
+    {
+        const auto &contract_base = get<contract_object, by_id>(contract_id_type());
+        const auto &contract_base_code = get<contract_bin_code_object, by_id>(contract_base.lua_code_b_id);
+        _lua_context_pool.set_base_env(contract_base.name, contract_base_code.id, contract_base.current_version, contract_base_code.lua_code_b);
+        return _lua_context_pool.acquire();
+    }
+    //=============================================================================
+    void database::release_VM_context(std::unique_ptr<LuaContext> context)
+    {
+        _lua_context_pool.release(std::move(context));
     }
     //=============================================================================
     size_t database::create_contract_objects(const account_object& owner, const string& contract_name, const string& contract_data, long long& vm_drops, bool released_after_created)
@@ -177,7 +184,7 @@ namespace taiyi { namespace chain {
         create_contract_objects(owner, TAIYI_BLACKLIST_CONTRACT_NAME, CONTRACT_BLACKLIST, vm_drops, false);
     }
     //=========================================================================
-    lua_map database::prepare_account_contract_data(const account_object& account, const contract_object& contract)
+    const account_contract_data_object& database::prepare_account_contract_data(const account_object& account, const contract_object& contract)
     {
         const auto* acd = find<account_contract_data_object, by_account_contract>( boost::make_tuple(account.id, contract.id) );
         if(acd == nullptr) {
@@ -188,7 +195,7 @@ namespace taiyi { namespace chain {
             acd = find<account_contract_data_object, by_account_contract>( boost::make_tuple(account.id, contract.id) );
         }
         
-        return acd->contract_data;
+        return *acd;
     }
     //=========================================================================
     void database::reward_feigang(const account_object& to_account, const account_object& from_account, const asset& feigang )
@@ -211,6 +218,7 @@ namespace taiyi { namespace chain {
             props.pending_rewarded_feigang += feigang;
             props.total_qi -= feigang;
         } );
+        _consumed_qi += feigang.amount.value;
     }
     //=========================================================================
     void database::reward_feigang(const account_object& to_account, const nfa_object& from_nfa, const asset& feigang )
@@ -233,6 +241,7 @@ namespace taiyi { namespace chain {
             props.pending_rewarded_feigang += feigang;
             props.total_qi -= feigang;
         } );
+        _consumed_qi += feigang.amount.value;
     }
 
 } } //taiyi::chain
@@ -189,15 +189,13 @@ namespace taiyi { namespace chain {
         auto now = head_block_num();
         std::set<const cultivation_object*> removed;
 
-        //首先剔除截止开始时间还未开始的修真
+        //首先剔除截止开始时间还未开始的修真，只访问未开始的修真，已经开始的不论多少都不用遍历
         const auto& cidx_by_start_deadline = get_index< cultivation_index >().indices().get< by_start_deadline >();
-        for (auto itr = cidx_by_start_deadline.begin(); itr != cidx_by_start_deadline.end(); ++itr) {
+        for (auto itr = cidx_by_start_deadline.lower_bound(boost::make_tuple(std::numeric_limits<uint32_t>::max())); itr != cidx_by_start_deadline.end(); ++itr) {
             if (itr->start_deadline > now)
                 break;
-            if (itr->start_time == std::numeric_limits<uint32_t>::max()) {
-                dissolve_cultivation(*itr);
-                removed.insert(&(*itr));
-            }
+            dissolve_cultivation(*itr);
+            removed.insert(&(*itr));
         }
         
         //再剔除修真时间超过最大修真时间的
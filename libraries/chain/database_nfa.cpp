@@ -10,6 +10,7 @@
 #include <chain/account_object.hpp>
 #include <chain/contract_objects.hpp>
 #include <chain/nfa_objects.hpp>
+#include <chain/proposal_objects.hpp>
 #include <chain/asset_objects/nfa_balance_object.hpp>
 
 #include <chain/lua_context.hpp>
@@ -184,6 +185,7 @@ namespace taiyi { namespace chain {
         modify(xinsu_mark, [&](nfa_object &obj) {
             obj.owner_account = first_one.id;
         });
+        update_xinsu_proposal_votes(xinsu_mark, creator.id);
     }
     //=========================================================================
     void database::create_basic_nfa_symbol_objects()
@@ -241,6 +243,7 @@ namespace taiyi { namespace chain {
             
             obj.created_time = head_block_time();
         });
+        update_xinsu_proposal_votes(nfa, optional<account_id_type>());
         
         //运行主合约初始化nfa数据
         const auto& contract = get<contract_object, by_id>(nfa.main_contract);
@@ -253,6 +256,7 @@ namespace taiyi { namespace chain {
         //init nfa from result table
         modify(nfa, [&](nfa_object& obj) {
             obj.contract_data = result_table.v;
+            obj.contract_data_size = fc::raw::pack_size(obj.contract_data);
         });
         
         //create material
@@ -328,8 +332,8 @@ namespace taiyi { namespace chain {
             vector<lua_types> value_list; //no params.
             contract_worker worker;
 
-            LuaContext context;
-            initialize_VM_baseENV(context);
+            //从虚拟机池取出全新的虚拟机，省去在核心线程上创建虚拟机和加载baseENV的开销
+            auto context = acquire_VM_context();
 
             //qi可能在执行合约中被进一步使用，所以这里记录当前的qi来计算虚拟机的执行消耗
             long long old_drops = nfa.qi.amount.value / TAIYI_USEMANA_EXECUTION_SCALE;
@@ -340,7 +344,7 @@ namespace taiyi { namespace chain {
                 auto session = start_undo_session();
                 clear_contract_handler_exe_point(); //初始化api执行消耗统计
                 const auto& caller = get<account_object, by_id>(nfa.owner_account);
-                worker.do_nfa_contract_function(caller, nfa, "on_heart_beat", value_list, contract, vm_drops, true, context, *this, false);
+                worker.do_nfa_contract_function(caller, nfa, "on_heart_beat", value_list, contract, vm_drops, true, *context, *this, false);
                 session.squash();
             }
             catch (const fc::exception& e) {
@@ -354,6 +358,8 @@ namespace taiyi { namespace chain {
                 wlog("NFA (${i}) process heart beat fail.", ("i", nfa.id));
             }
 
+            release_VM_context(std::move(context));
+
             int64_t used_drops = old_drops - vm_drops;
             api_exe_point = get_contract_handler_exe_point();
 
@@ -517,9 +523,11 @@ namespace taiyi { namespace chain {
                 continue;
 
             const auto& child_nfa = get<nfa_object, by_id>(_id);
+            account_id_type old_owner = child_nfa.owner_account;
             modify(child_nfa, [&]( nfa_object& obj ) {
                 obj.owner_account = new_owner.id;
             });
+            update_xinsu_proposal_votes(child_nfa, old_owner);
             
             recursion_loop_check.insert(_id);
             
@@ -572,6 +580,44 @@ namespace taiyi { namespace chain {
         return has_nfa_with_symbol(account, _xinsu_mark_nfa_symbol_id);
     }
     //=========================================================================
+    void database::update_xinsu_proposal_votes(const nfa_object& nfa, const optional<account_id_type>& old_owner)
+    {
+        if (nfa.symbol_id != _xinsu_mark_nfa_symbol_id)
+            return;
+        if (old_owner.valid() && *old_owner == nfa.owner_account)
+            return;
+        
+        //原所有者持有过这个心素标记，没有其他标记了才是失去心素
+        if (old_owner.valid() && !has_nfa_with_symbol(get<account_object, by_id>(*old_owner), _xinsu_mark_nfa_symbol_id))
+            adjust_proposal_votes(*old_owner, -1);
+        
+        //新所有者只有这一个心素标记才是刚成为心素
+        const auto& nfa_idx = get_index<nfa_index>().indices().get<by_owner_symbol>();
+        auto found = nfa_idx.lower_bound( boost::make_tuple(nfa.owner_account, _xinsu_mark_nfa_symbol_id, 0) );
+        uint32_t marks = 0;
+        while (found != nfa_idx.end() && found->owner_account == nfa.owner_account && found->symbol_id == _xinsu_mark_nfa_symbol_id && marks < 2) {
+            ++marks;
+            ++found;
+        }
+        if (marks == 1)
+            adjust_proposal_votes(nfa.owner_account, 1);
+    }
+    //=========================================================================
+    void database::adjust_proposal_votes(const account_id_type& voter, int64_t delta)
+    {
+        const auto& pvidx = get_index<proposal_vote_index>().indices().get<by_voter_proposal>();
+        auto found = pvidx.lower_bound(boost::make_tuple(voter));
+        while (found != pvidx.end() && found->voter == voter) {
+            const auto* proposal = find<proposal_object, by_id>(found->proposal_id);
+            if (proposal != nullptr) {
+                modify(*proposal, [&](proposal_object& obj) {
+                    obj.total_votes += delta;
+                });
+            }
+            ++found;
+        }
+    }
+    //=========================================================================
     bool database::is_dao_account(const account_object& account) const
     {
         return account.id == _dao_account_id;
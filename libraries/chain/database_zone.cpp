@@ -21,8 +21,6 @@
 
 #include <chain/util/uint256.hpp>
 
-#include <tyme/tyme.h>
-
 #include <fc/smart_ref_impl.hpp>
 #include <fc/uint128.hpp>
 
@@ -165,6 +163,11 @@ namespace taiyi { namespace chain {
         return tiandao.zone_moving_difficulty_map[(int)zone.type];
     }
     //=============================================================================
+    zone_route database::find_way_to_zone( const zone_object& from, const zone_object& to )
+    {
+        return _zone_router.find_route( from.id, to.id, get_tiandao_properties().zone_moving_difficulty_map );
+    }
+    //=============================================================================
     // 区域灵气浓度N，由区域的五行材质决定
     int64_t database::calculate_zone_spiritual_energy( const zone_object& zone ) const
     {
@@ -203,18 +206,17 @@ namespace taiyi { namespace chain {
         uint32_t bn = head_block_num();
         
         uint32_t days = bn / TAIYI_VDAY_BLOCK_NUM;
-        static const tyme::JulianDay s_start_day = tyme::SolarDay::from_ymd(2, 1, 1).get_julian_day(); //注意年月日参数是 1 based，使用时要调整到 0 based
-        tyme::SolarDay sday = s_start_day.next(days).get_solar_day();;
+        const auto& sday = _tiandao_calendar.get_day(days); //虚拟日0为公历2年1月1日，注意年月日是 1 based，使用时要调整到 0 based
 
         //one day means one virtual month
-        int yn = sday.get_year() - 1;
-        int mn = sday.get_month();
-        int dn = sday.get_day();
+        int yn = sday.year - 1;
+        int mn = sday.month;
+        int dn = sday.day;
         uint32_t tod = (bn / (TAIYI_VDAY_BLOCK_NUM/4)) % 4; //time on a day, 0=凌晨；1=上午；2=下午；3=夜晚
         //wlog("${y}年${m}月${d}日tod=${tod}, bn=${bn}", ("y", yn)("m", mn)("d", dn)("tod", tod)("bn", bn));
                 
         //solar term number
-        uint32_t tn = sday.get_term().get_index();
+        uint32_t tn = sday.term;
         tn = (tn + 21) % 24; //序号调整：序号0由冬至对齐到春分
         
         const auto& tiandao = get_tiandao_properties();
@@ -223,20 +225,10 @@ namespace taiyi { namespace chain {
             //next year
             FC_ASSERT(mn == 1, "start virtual month number (${mn}) must be 1!", ("mn", mn));
             
-            //统计活人
-            uint32_t live_num = 0;
-            const auto& actor_by_health_idx = get_index< actor_index, by_health >();
-            auto itr = actor_by_health_idx.lower_bound( std::numeric_limits<int16_t>::max() );
-            auto end = actor_by_health_idx.end();
-            while( itr != end )
-            {
-                if(itr->health <= 0)
-                    break;
-                ++live_num;
-                ++itr;
-            }
-            uint32_t amount_actor = (uint32_t)actor_by_health_idx.size();
-            uint32_t dead_num = amount_actor - live_num;
+            //统计活人，人数随角色创建和健康值变化增量维护
+            uint32_t live_num = tiandao.live_actor_num;
+            uint32_t dead_num = tiandao.dead_actor_num;
+            uint32_t amount_actor = live_num + dead_num;
             
             uint32_t born_this_year = amount_actor - tiandao.amount_actor_last_vyear;
             uint32_t dead_this_year = dead_num - tiandao.dead_actor_last_vyear;
@@ -41,94 +41,25 @@ namespace taiyi { namespace chain { namespace detail {
      * Class used to help the without_pending_transactions
      * implementation.
      *
-     * TODO:  Change the name of this class to better reflect the fact
-     * that it restores popped transactions as well as pending transactions.
+     * The pending transactions stay in the database's pending
+     * transaction pool; only the pending state is discarded and
+     * rebuilt by revalidate_pending_transactions() afterwards, which
+     * also restores popped transactions.
      */
     struct pending_transactions_restorer
     {
-        pending_transactions_restorer( database& db, std::vector<signed_transaction>&& pending_transactions )
-        : _db(db), _pending_transactions( std::move(pending_transactions) )
+        pending_transactions_restorer( database& db )
+        : _db(db)
         {
-            _db.clear_pending();
+            _db.reset_pending_transaction_session();
         }
         
         ~pending_transactions_restorer()
         {
-            auto start = fc::time_point::now();
-            bool apply_trxs = true;
-            uint32_t applied_txs = 0;
-            uint32_t postponed_txs = 0;
-            
-            for( const auto& tx : _db._popped_tx )
-            {
-                if( apply_trxs && fc::time_point::now() - start > TAIYI_PENDING_TRANSACTION_EXECUTION_LIMIT ) apply_trxs = false;
-                
-                if( apply_trxs )
-                {
-                    try {
-                        if( !_db.is_known_transaction( tx.id() ) ) {
-                            // since push_transaction() takes a signed_transaction,
-                            // the operation_results field will be ignored.
-                            _db._push_transaction( tx );
-                            applied_txs++;
-                        }
-                    } catch ( const fc::exception&  ) {}
-                }
-                else
-                {
-                    _db._pending_tx.push_back( tx );
-                    postponed_txs++;
-                }
-            }
-            _db._popped_tx.clear();
-            for( const signed_transaction& tx : _pending_transactions )
-            {
-                if( apply_trxs && fc::time_point::now() - start > TAIYI_PENDING_TRANSACTION_EXECUTION_LIMIT ) apply_trxs = false;
-                
-                if( apply_trxs )
-                {
-                    try
-                    {
-                        if( !_db.is_known_transaction( tx.id() ) ) {
-                            // since push_transaction() takes a signed_transaction,
-                            // the operation_results field will be ignored.
-                            _db._push_transaction( tx );
-                            applied_txs++;
-                        }
-                    }
-                    catch( const transaction_exception& e )
-                    {
-                        dlog( "Pending transaction became invalid after switching to block ${b} ${n} ${t}",
-                             ("b", _db.head_block_id())("n", _db.head_block_num())("t", _db.head_block_time()) );
-                        dlog( "The invalid transaction caused exception ${e}", ("e", e.to_detail_string()) );
-                        dlog( "${t}", ("t", tx) );
-                    }
-                    catch( const fc::exception& e )
-                    {
-                        
-                        /*
-                         dlog( "Pending transaction became invalid after switching to block ${b} ${n} ${t}",
-                         ("b", _db.head_block_id())("n", _db.head_block_num())("t", _db.head_block_time()) );
-                         dlog( "The invalid pending transaction caused exception ${e}", ("e", e.to_detail_string() ) );
-                         dlog( "${t}", ("t", tx) );
-                         */
-                    }
-                }
-                else
-                {
-                    _db._pending_tx.push_back( tx );
-                    postponed_txs++;
-                }
-            }
-            
-            if( postponed_txs++ )
-            {
-                wlog( "Postponed ${p} pending transactions. ${a} were applied.", ("p", postponed_txs)("a", applied_txs) );
-            }
+            _db.revalidate_pending_transactions();
         }
         
         database& _db;
-        std::vector< signed_transaction > _pending_transactions;
     };
 
     /**
@@ -153,9 +84,9 @@ namespace taiyi { namespace chain { namespace detail {
      * Pending transactions which no longer validate will be culled.
      */
     template< typename Lambda >
-    void without_pending_transactions(database& db, std::vector<signed_transaction>&& pending_transactions, Lambda callback)
+    void without_pending_transactions(database& db, Lambda callback)
     {
-        pending_transactions_restorer restorer( db, std::move(pending_transactions) );
+        pending_transactions_restorer restorer( db );
         callback();
         return;
     }
@@ -0,0 +1,362 @@
+#include <chain/taiyi_fwd.hpp>
+
+#include <chain/invariant_checker.hpp>
+#include <chain/database.hpp>
+#include <chain/global_property_object.hpp>
+#include <chain/asset_objects/asset_objects.hpp>
+#include <chain/taiyi_objects.hpp>
+#include <chain/tiandao_property_object.hpp>
+#include <chain/account_object.hpp>
+#include <chain/nfa_objects.hpp>
+#include <chain/actor_objects.hpp>
+#include <chain/siming_objects.hpp>
+#include <chain/proposal_processor.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iterator>
+#include <thread>
+
+namespace taiyi { namespace chain {
+
+    void invariant_totals::add( const invariant_totals& o, int sign )
+    {
+        auto apply = [sign]( share_type& a, const share_type& b ) {
+            if( sign > 0 )
+                a += b;
+            else
+                a -= b;
+        };
+
+        apply( supply, o.supply );
+        apply( account_qi, o.account_qi );
+        apply( vsf_adores, o.vsf_adores );
+        apply( reward_qi, o.reward_qi );
+        apply( reward_feigang, o.reward_feigang );
+        apply( nfa_qi, o.nfa_qi );
+        apply( cultivation_qi, o.cultivation_qi );
+        apply( gold, o.gold );
+        apply( food, o.food );
+        apply( wood, o.wood );
+        apply( fabric, o.fabric );
+        apply( herb, o.herb );
+        actors += o.actors * sign;
+        live_actors += o.live_actors * sign;
+    }
+
+    namespace {
+
+        /** 五种物质按符号计入合计，其他资产不参与 */
+        void add_material( const asset& a, invariant_totals& t )
+        {
+            if( a.symbol == GOLD_SYMBOL )
+                t.gold += a.amount;
+            else if( a.symbol == FOOD_SYMBOL )
+                t.food += a.amount;
+            else if( a.symbol == WOOD_SYMBOL )
+                t.wood += a.amount;
+            else if( a.symbol == FABRIC_SYMBOL )
+                t.fabric += a.amount;
+            else if( a.symbol == HERB_SYMBOL )
+                t.herb += a.amount;
+        }
+
+        void account_contribution( const account_object& a, invariant_totals& t )
+        {
+            t.supply += a.balance.amount;
+            t.supply += a.reward_yang_balance.amount;
+
+            t.account_qi += a.qi.amount;
+            t.reward_qi += a.reward_qi_balance.amount;
+            t.reward_feigang += a.reward_feigang_balance.amount;
+
+            t.vsf_adores += ( a.proxy == TAIYI_PROXY_TO_SELF_ACCOUNT ?
+                a.siming_adore_weight() :
+                ( TAIYI_MAX_PROXY_RECURSION_DEPTH > 0 ?
+                    a.proxied_vsf_adores[TAIYI_MAX_PROXY_RECURSION_DEPTH - 1] :
+                    a.qi.amount
+                )
+            );
+        }
+
+        //每个账号每种物质最多一个余额对象，直接扫描余额索引代替按账号逐个查找
+        void account_balance_contribution( const account_regular_balance_object& b, invariant_totals& t )
+        {
+            add_material( b.liquid, t );
+        }
+
+        void nfa_contribution( const nfa_object& n, invariant_totals& t )
+        {
+            t.nfa_qi += n.qi.amount;
+            t.cultivation_qi += n.cultivation_value;
+        }
+
+        void nfa_balance_contribution( const nfa_regular_balance_object& b, invariant_totals& t )
+        {
+            if( b.liquid.symbol == YANG_SYMBOL )
+                t.supply += b.liquid.amount;
+            else
+                add_material( b.liquid, t );
+        }
+
+        void nfa_material_contribution( const nfa_material_object& m, invariant_totals& t )
+        {
+            t.gold += m.gold.amount;
+            t.food += m.food.amount;
+            t.wood += m.wood.amount;
+            t.fabric += m.fabric.amount;
+            t.herb += m.herb.amount;
+        }
+
+        void reward_fund_contribution( const reward_fund_object& r, invariant_totals& t )
+        {
+            t.supply += r.reward_balance.amount;
+            t.reward_qi += r.reward_qi_balance.amount;
+        }
+
+        void actor_contribution( const actor_object& a, invariant_totals& t )
+        {
+            ++t.actors;
+            if( a.health > 0 )
+                ++t.live_actors;
+        }
+
+        /**
+         * 一个索引中每个对象的贡献之和。sharded为false的小索引全量扫描时不切分
+         */
+        template< typename IndexType >
+        class summed_index_checker : public invariant_checker::index_checker
+        {
+        public:
+            typedef typename IndexType::value_type object_type;
+            typedef void (*contribution_function)( const object_type&, invariant_totals& );
+
+            summed_index_checker( database& db, contribution_function contribution, bool sharded )
+                : _db( db ), _contribution( contribution ), _sharded( sharded ) {}
+
+            ~summed_index_checker()
+            {
+                stop_observing();
+            }
+
+            uint32_t shard_count( uint32_t thread_num )const override
+            {
+                return _sharded ? std::max( 1u, thread_num ) : 1;
+            }
+
+            void scan( uint32_t shard, uint32_t shards, invariant_totals& totals )const override
+            {
+                const auto& idx = _db.get_index< IndexType, by_id >();
+                if( idx.empty() )
+                    return;
+
+                if( shards <= 1 )
+                {
+                    for( const auto& o : idx )
+                        _contribution( o, totals );
+                    return;
+                }
+
+                //ID基本连续，按ID范围平均切分
+                int64_t first = idx.begin()->id._id;
+                int64_t last = std::prev( idx.end() )->id._id;
+                int64_t span = ( last - first ) / shards + 1;
+                int64_t begin = first + span * shard;
+                int64_t end = begin + span;
+                for( auto itr = idx.lower_bound( typename object_type::id_type( begin ) ); itr != idx.end() && itr->id._id < end; ++itr )
+                    _contribution( *itr, totals );
+            }
+
+            void observe( invariant_totals& running ) override
+            {
+                stop_observing();
+                auto& idx = _db.get_mutable_index< IndexType >();
+                auto contribution = _contribution;
+                _observer = idx.add_delta_observer( [contribution, &running]( const object_type& o, int sign ) {
+                    invariant_totals t;
+                    contribution( o, t );
+                    running.add( t, sign );
+                } );
+                _observing = true;
+            }
+
+            void stop_observing() override
+            {
+                if( !_observing )
+                    return;
+                if( _db.has_index< IndexType >() )
+                    _db.get_mutable_index< IndexType >().remove_delta_observer( _observer );
+                _observing = false;
+            }
+
+        private:
+            database&               _db;
+            contribution_function   _contribution;
+            bool                    _sharded;
+            bool                    _observing = false;
+            uint32_t                _observer = 0;
+        };
+
+        template< typename IndexType >
+        std::unique_ptr< invariant_checker::index_checker > make_checker( database& db, void (*contribution)( const typename IndexType::value_type&, invariant_totals& ), bool sharded )
+        {
+            return std::unique_ptr< invariant_checker::index_checker >( new summed_index_checker< IndexType >( db, contribution, sharded ) );
+        }
+
+    }
+    //=============================================================================
+    invariant_checker::invariant_checker( database& db )
+        : _db( db )
+    {
+        _checkers.push_back( make_checker< account_index >( db, account_contribution, true ) );
+        _checkers.push_back( make_checker< account_regular_balance_index >( db, account_balance_contribution, true ) );
+        _checkers.push_back( make_checker< nfa_index >( db, nfa_contribution, true ) );
+        _checkers.push_back( make_checker< nfa_regular_balance_index >( db, nfa_balance_contribution, true ) );
+        _checkers.push_back( make_checker< nfa_material_index >( db, nfa_material_contribution, true ) );
+        _checkers.push_back( make_checker< reward_fund_index >( db, reward_fund_contribution, false ) );
+        _checkers.push_back( make_checker< actor_index >( db, actor_contribution, true ) );
+    }
+    //=============================================================================
+    invariant_checker::~invariant_checker()
+    {
+    }
+    //=============================================================================
+    void invariant_checker::set_incremental( bool incremental )
+    {
+        for( auto& c : _checkers )
+            c->stop_observing();
+        _incremental = false;
+
+        if( !incremental )
+            return;
+
+        _running = scan();
+        for( auto& c : _checkers )
+            c->observe( _running );
+        _incremental = true;
+    }
+    //=============================================================================
+    invariant_totals invariant_checker::scan()const
+    {
+        struct work_unit
+        {
+            const index_checker*    checker;
+            uint32_t                shard;
+            uint32_t                shards;
+            invariant_totals        totals;
+            std::exception_ptr      error;
+        };
+
+        std::vector< work_unit > units;
+        for( const auto& c : _checkers )
+        {
+            uint32_t shards = c->shard_count( _thread_num );
+            for( uint32_t s = 0; s < shards; ++s )
+                units.push_back( work_unit{ c.get(), s, shards, invariant_totals(), nullptr } );
+        }
+
+        std::atomic< uint32_t > next( 0 );
+        auto worker = [&]() {
+            for( uint32_t i = next++; i < units.size(); i = next++ )
+            {
+                auto& u = units[ i ];
+                try
+                {
+                    u.checker->scan( u.shard, u.shards, u.totals );
+                }
+                catch( ... )
+                {
+                    u.error = std::current_exception();
+                }
+            }
+        };
+
+        uint32_t thread_num = std::max( 1u, std::min( _thread_num, (uint32_t)units.size() ) );
+        std::vector< std::thread > threads;
+        for( uint32_t i = 1; i < thread_num; ++i )
+            threads.emplace_back( worker );
+        worker(); //调用线程也参与扫描
+        for( auto& t : threads )
+            t.join();
+
+        invariant_totals totals;
+        for( const auto& u : units )
+        {
+            if( u.error )
+                std::rethrow_exception( u.error );
+            totals.add( u.totals );
+        }
+        return totals;
+    }
+    //=============================================================================
+    void invariant_checker::check()const
+    {
+        if( _incremental )
+        {
+            verify( _running );
+        }
+        else
+        {
+            verify( scan() );
+            // 增量维护的提案票数和重新计数一致
+            proposal_processor( _db ).validate_votes();
+        }
+    }
+    //=============================================================================
+    void invariant_checker::verify( const invariant_totals& t )const
+    {
+        const auto& gpo = _db.get_dynamic_global_properties();
+
+        // verify no siming has too many adores
+        const auto& siming_idx = _db.get_index< siming_index >().indices();
+        for( auto itr = siming_idx.begin(); itr != siming_idx.end(); ++itr )
+            FC_ASSERT(itr->adores <= gpo.total_qi.amount, "核对司命收到信仰总值的合理性失败");
+
+        asset total_supply = asset( t.supply, YANG_SYMBOL );
+        asset total_account_qi = asset( t.account_qi, QI_SYMBOL );
+        asset total_reward_qi = asset( t.reward_qi, QI_SYMBOL );
+        asset total_reward_feigang = asset( t.reward_feigang, QI_SYMBOL );
+        asset total_nfa_qi = asset( t.nfa_qi, QI_SYMBOL );
+        asset total_cultivation_qi = asset( t.cultivation_qi, QI_SYMBOL );
+        asset total_gold = asset( t.gold, GOLD_SYMBOL );
+        asset total_food = asset( t.food, FOOD_SYMBOL );
+        asset total_wood = asset( t.wood, WOOD_SYMBOL );
+        asset total_fabric = asset( t.fabric, FABRIC_SYMBOL );
+        asset total_herb = asset( t.herb, HERB_SYMBOL );
+
+        FC_ASSERT(total_account_qi.amount == t.vsf_adores, "核对由所有账号产生的信仰总值失败", ("total_account_qi", total_account_qi)("total_vsf_adores", t.vsf_adores));
+        FC_ASSERT(gpo.pending_rewarded_feigang == total_reward_feigang, "核对所有账号的未领取非罡失败", ("gpo.pending_rewarded_feigang", gpo.pending_rewarded_feigang)("total_reward_feigang", total_reward_feigang));
+        FC_ASSERT(gpo.pending_cultivation_qi == total_cultivation_qi, "核对参与修真的真气总量失败", ("gpo.pending_cultivation_qi", gpo.pending_cultivation_qi)("total_cultivation_qi", total_cultivation_qi));
+        FC_ASSERT(gpo.pending_rewarded_qi == total_reward_qi, "核对修真奖励池和账号未领取修真奖励真气失败", ("gpo.pending_rewarded_qi", gpo.pending_rewarded_qi)("total_reward_qi", total_reward_qi));
+        FC_ASSERT(gpo.total_qi == (total_account_qi + total_nfa_qi), "核对自由真气总量失败", ("gpo.total_qi", gpo.total_qi)("total_account_qi", total_account_qi)("total_nfa_qi", total_nfa_qi));
+
+        //统计所有非阳寿相关的等价真气，避免最后换算阳寿时候的整型误差
+        asset total_qi = total_account_qi + total_reward_feigang + total_nfa_qi + total_cultivation_qi + total_reward_qi;
+        //换算物质到等价真气
+        total_qi += total_gold * TAIYI_GOLD_QI_PRICE;
+        total_qi += total_food * TAIYI_FOOD_QI_PRICE;
+        total_qi += total_wood * TAIYI_WOOD_QI_PRICE;
+        total_qi += total_fabric * TAIYI_FABRIC_QI_PRICE;
+        total_qi += total_herb * TAIYI_HERB_QI_PRICE;
+
+        //统计以阳寿表示的全局总量
+        total_supply += total_qi * TAIYI_QI_SHARE_PRICE;
+        FC_ASSERT(gpo.current_supply == total_supply, "核对系统总阳寿量失败", ("gpo.current_supply", gpo.current_supply)("total_supply", total_supply));
+
+        //核对系统总物质量
+        FC_ASSERT(gpo.total_gold == total_gold, "核对系统总金石含量失败", ("gpo.total_gold", gpo.total_gold)("total_gold", total_gold));
+        FC_ASSERT(gpo.total_food == total_food, "核对系统总食物含量失败", ("gpo.total_food", gpo.total_food)("total_food", total_food));
+        FC_ASSERT(gpo.total_wood == total_wood, "核对系统总木材含量失败", ("gpo.total_wood", gpo.total_wood)("total_wood", total_wood));
+        FC_ASSERT(gpo.total_fabric == total_fabric, "核对系统总织物含量失败", ("gpo.total_fabric", gpo.total_fabric)("total_fabric", total_fabric));
+        FC_ASSERT(gpo.total_herb == total_herb, "核对系统总药材含量失败", ("gpo.total_herb", gpo.total_herb)("total_herb", total_herb));
+
+        //核对天道统计的生死人数
+        uint32_t live_actor_num = (uint32_t)t.live_actors;
+        uint32_t dead_actor_num = (uint32_t)( t.actors - t.live_actors );
+        const auto& tiandao = _db.get_tiandao_properties();
+        FC_ASSERT(tiandao.live_actor_num == live_actor_num, "核对天道统计的活人数失败", ("tiandao.live_actor_num", tiandao.live_actor_num)("live_actor_num", live_actor_num));
+        FC_ASSERT(tiandao.dead_actor_num == dead_actor_num, "核对天道统计的死亡人数失败", ("tiandao.dead_actor_num", tiandao.dead_actor_num)("dead_actor_num", dead_actor_num));
+    }
+
+} } // taiyi::chain
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <protocol/types.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace taiyi { namespace chain {
+
+    using taiyi::protocol::share_type;
+
+    class database;
+
+    /**
+     * 各个索引对供应量不变量的贡献，只累计数量，核对时再和全局属性中对应符号的资产比较
+     */
+    struct invariant_totals
+    {
+        share_type  supply;             ///< 直接以阳寿计的部分
+        share_type  account_qi;
+        share_type  vsf_adores;
+        share_type  reward_qi;
+        share_type  reward_feigang;
+        share_type  nfa_qi;
+        share_type  cultivation_qi;
+        share_type  gold;
+        share_type  food;
+        share_type  wood;
+        share_type  fabric;
+        share_type  herb;
+        int64_t     actors = 0;
+        int64_t     live_actors = 0;
+
+        /** sign为1时加上o，为-1时减去o */
+        void add( const invariant_totals& o, int sign = 1 );
+    };
+
+    /**
+     * 数据库不变量核对
+     *
+     * 每个参与合计的索引有一个独立的核对器，全量核对时大的索引按ID范围切成分片，在多个线程上扫描，
+     * 各分片的部分和最后合并。扫描只读取数据库，期间调用线程持有锁并等待扫描完成。
+     *
+     * 增量模式下各核对器在索引上注册delta_observer，对象被创建、修改、删除或撤销时立即用新旧值修正合计，
+     * 核对时只比较合计，不再扫描这些索引。司命信仰的核对与全局真气总量有关，每次仍然全量进行。
+     * 提案票数只在全量模式下和重新计数的结果核对。
+     */
+    class invariant_checker
+    {
+    public:
+        class index_checker
+        {
+        public:
+            virtual ~index_checker() {}
+
+            /** 全量扫描时切成的分片数量 */
+            virtual uint32_t shard_count( uint32_t thread_num )const = 0;
+            virtual void scan( uint32_t shard, uint32_t shards, invariant_totals& totals )const = 0;
+
+            virtual void observe( invariant_totals& running ) = 0;
+            virtual void stop_observing() = 0;
+        };
+
+        invariant_checker( database& db );
+        ~invariant_checker();
+
+        void set_thread_num( uint32_t thread_num ) { _thread_num = thread_num; }
+        uint32_t get_thread_num()const { return _thread_num; }
+
+        /**
+         * 开启时全量扫描一次作为初始合计，之后合计随索引修改维护；需要持有写锁
+         */
+        void set_incremental( bool incremental );
+        bool is_incremental()const { return _incremental; }
+
+        /** 全量扫描所有参与合计的索引 */
+        invariant_totals scan()const;
+
+        /** 增量模式下随修改维护的合计 */
+        const invariant_totals& get_running_totals()const { return _running; }
+
+        /** 核对所有不变量，失败时抛出异常 */
+        void check()const;
+
+    private:
+        void verify( const invariant_totals& totals )const;
+
+        database&                                       _db;
+        std::vector< std::unique_ptr< index_checker > > _checkers;
+        uint32_t                                        _thread_num = 0;
+        bool                                            _incremental = false;
+        invariant_totals                                _running;
+    };
+
+} } // taiyi::chain
@@ -0,0 +1,118 @@
+#include <chain/taiyi_fwd.hpp>
+
+#include <chain/lua_chunk_cache.hpp>
+
+#include <lua.hpp>
+
+namespace taiyi { namespace chain {
+
+    lua_chunk_cache::lua_chunk_cache()
+        : _hits(0), _misses(0)
+    {}
+    //=============================================================================
+    lua_chunk_cache::~lua_chunk_cache()
+    {
+        clear();
+    }
+    //=============================================================================
+    void lua_chunk_cache::set_capacity( uint32_t capacity )
+    {
+        std::lock_guard< std::mutex > guard( _mutex );
+        _capacity = capacity;
+        while( _entries.size() > _capacity )
+            erase( _entries.find( _lru.back() ) );
+    }
+    //=============================================================================
+    int lua_chunk_cache::load( lua_State* L, const contract_bin_code_id_type& code_id, const transaction_id_type& version, const std::vector<char>& code, const std::string& chunkname )
+    {
+        if( !is_enabled() )
+            return luaL_loadbuffer( L, code.data(), code.size(), chunkname.data() );
+
+        std::shared_ptr<const lua_ChunkImage> image;
+        {
+            std::lock_guard< std::mutex > guard( _mutex );
+            auto itr = _entries.find( code_id );
+            if( itr != _entries.end() )
+            {
+                if( itr->second.version == version && itr->second.code_size == code.size() )
+                {
+                    image = itr->second.image;
+                    _lru.splice( _lru.begin(), _lru, itr->second.lru_itr );
+                }
+                else
+                    erase( itr ); //合约已经被修改
+            }
+        }
+
+        if( image )
+        {
+            ++_hits;
+            return lua_loadchunkimage( L, image.get() );
+        }
+
+        ++_misses;
+        int status = luaL_loadbuffer( L, code.data(), code.size(), chunkname.data() );
+        if( status != LUA_OK )
+            return status;
+
+        //在合约运行之前从刚加载的函数生成镜像，镜像在虚拟机之外分配内存，不影响drops计量
+        image.reset( lua_newchunkimage( L ), []( const lua_ChunkImage* img ) { lua_freechunkimage( const_cast<lua_ChunkImage*>( img ) ); } );
+        if( !image )
+            return status;
+
+        std::lock_guard< std::mutex > guard( _mutex );
+        auto itr = _entries.find( code_id );
+        if( itr != _entries.end() )
+            erase( itr );
+
+        _lru.push_front( code_id );
+        chunk_entry& entry = _entries[ code_id ];
+        entry.version = version;
+        entry.code_size = code.size();
+        entry.image = image;
+        entry.lru_itr = _lru.begin();
+        _image_bytes += lua_chunkimagesize( image.get() );
+
+        while( _entries.size() > _capacity )
+            erase( _entries.find( _lru.back() ) );
+
+        return status;
+    }
+    //=============================================================================
+    void lua_chunk_cache::invalidate( const contract_bin_code_id_type& code_id )
+    {
+        std::lock_guard< std::mutex > guard( _mutex );
+        auto itr = _entries.find( code_id );
+        if( itr != _entries.end() )
+            erase( itr );
+    }
+    //=============================================================================
+    void lua_chunk_cache::clear()
+    {
+        std::lock_guard< std::mutex > guard( _mutex );
+        _entries.clear();
+        _lru.clear();
+        _image_bytes = 0;
+    }
+    //=============================================================================
+    uint32_t lua_chunk_cache::get_size()
+    {
+        std::lock_guard< std::mutex > guard( _mutex );
+        return _entries.size();
+    }
+    //=============================================================================
+    size_t lua_chunk_cache::get_image_bytes()
+    {
+        std::lock_guard< std::mutex > guard( _mutex );
+        return _image_bytes;
+    }
+    //=============================================================================
+    void lua_chunk_cache::erase( std::map<contract_bin_code_id_type, chunk_entry>::iterator itr )
+    {
+        //正在其他线程中加载的镜像由shared_ptr保持有效
+        _image_bytes -= lua_chunkimagesize( itr->second.image.get() );
+        _lru.erase( itr->second.lru_itr );
+        _entries.erase( itr );
+    }
+
+} } // taiyi::chain
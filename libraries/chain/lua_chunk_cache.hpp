@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chain/taiyi_object_types.hpp>
+
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct lua_State;
+struct lua_ChunkImage;
+
+namespace taiyi { namespace chain {
+
+    /**
+     * 合约字节码的解码缓存
+     *
+     * 不同虚拟机之间无法共享Proto，也不能缓存执行过的沙盒表（合约的drops计量包含了内存分配，
+     * 见lmem.c），因此这里缓存的是字节码解码后的镜像（lua_ChunkImage）。从镜像加载合约与
+     * luaL_loadbuffer加载原始字节码在虚拟机中创建的对象、内存分配的顺序和大小完全一致，
+     * 只是省去了字节码的逐字节解析和校验。
+     *
+     * 缓存以contract_bin_code_id_type为键，并记录合约的版本（contract_object::current_version），
+     * 版本不一致时重新加载；revise合约时也会主动作废对应的缓存。
+     */
+    class lua_chunk_cache
+    {
+    public:
+        lua_chunk_cache();
+        ~lua_chunk_cache();
+
+        /**
+         * 设置缓存的字节码数量上限，为0时不启用缓存
+         */
+        void set_capacity( uint32_t capacity );
+        bool is_enabled()const { return _capacity > 0; }
+
+        /**
+         * 加载合约字节码到虚拟机栈顶，等价于luaL_loadbuffer
+         */
+        int load( lua_State* L, const contract_bin_code_id_type& code_id, const transaction_id_type& version, const std::vector<char>& code, const std::string& chunkname );
+
+        void invalidate( const contract_bin_code_id_type& code_id );
+        void clear();
+
+        uint64_t get_hits()const { return _hits; }
+        uint64_t get_misses()const { return _misses; }
+        uint32_t get_size();
+        size_t get_image_bytes();
+
+    private:
+        struct chunk_entry
+        {
+            transaction_id_type                             version;
+            size_t                                          code_size = 0;
+            std::shared_ptr<const lua_ChunkImage>           image;
+            std::list<contract_bin_code_id_type>::iterator  lru_itr;
+        };
+
+        void erase( std::map<contract_bin_code_id_type, chunk_entry>::iterator itr );
+
+        uint32_t                                            _capacity = 0;
+
+        std::mutex                                          _mutex;
+        std::map<contract_bin_code_id_type, chunk_entry>    _entries;
+        std::list<contract_bin_code_id_type>                _lru; ///< 最近使用的在前
+        size_t                                              _image_bytes = 0;
+
+        std::atomic<uint64_t>                               _hits;
+        std::atomic<uint64_t>                               _misses;
+    };
+
+} } // taiyi::chain
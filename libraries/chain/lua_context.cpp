@@ -9,6 +9,7 @@
 #include <chain/contract_objects.hpp>
 
 #include <chain/lua_context.hpp>
+#include <chain/lua_chunk_cache.hpp>
 #include <chain/contract_handles.hpp>
 
 extern "C" {
@@ -74,7 +75,7 @@ namespace taiyi { namespace chain {
                 current_cbi->db.add_contract_handler_exe_point(3);
                 
                 const auto &baseENV = current_cbi->db.get<contract_bin_code_object, by_id>(0);
-                context.new_sandbox(contract->name, baseENV.lua_code_b.data(), baseENV.lua_code_b.size());
+                context.new_sandbox(contract->name, baseENV, current_cbi->db.get_lua_chunk_cache());
                 
                 contract_base_info cbi(current_cbi->db, context, current_cbi->db.get<account_object, by_id>(contract->owner).name, contract->name, current_cbi->caller, string(contract->creation_date), current_cbi->invoker_contract_name);
                 context.writeVariable(contract->name, "contract_base_info", &cbi);
@@ -103,7 +104,7 @@ namespace taiyi { namespace chain {
                 
                 const auto &contract_code = cbi.db.get<contract_bin_code_object, by_id>(contract->lua_code_b_id);
                 //lua加载脚本之后会返回一个函数(即此时栈顶的chunk块)，lua_pcall将默认调用此块
-                luaL_loadbuffer(context.mState, contract_code.lua_code_b.data(), contract_code.lua_code_b.size(), contract->name.data());
+                cbi.db.get_lua_chunk_cache().load(context.mState, contract_code.id, contract->current_version, contract_code.lua_code_b, contract->name);
                 lua_getglobal(context.mState, current_contract_name.c_str());
                 lua_getfield(context.mState, -1, contract->name.c_str());
                 //将栈顶变量赋值给距栈顶二格的函数的第一个upvalue(这个函数为load返回的函数，第一个upvalue为_ENV)
@@ -254,6 +255,7 @@ namespace taiyi { namespace chain {
         registerFunction("is_zone_valid", &contract_handler::is_zone_valid);        
         registerFunction("is_zone_valid_by_name", &contract_handler::is_zone_valid_by_name);
         registerFunction("connect_zones", &contract_handler::connect_zones);
+        registerFunction("find_way_to_zone", &contract_handler::find_way_to_zone);
         registerFunction("create_actor_talent_rule", &contract_handler::create_actor_talent_rule);
         registerFunction("create_actor", &contract_handler::create_actor);
         registerFunction("list_actors_on_zone", &contract_handler::list_actors_on_zone);
@@ -425,13 +427,14 @@ namespace taiyi { namespace chain {
         registerMember("favor_level", &contract_actor_relation_info::favor_level);
     }
     //=============================================================================
-    bool LuaContext::new_sandbox(string spacename, const char *condition, size_t condition_size)
+    bool LuaContext::new_sandbox(string spacename, const contract_bin_code_object& base_env, lua_chunk_cache& chunk_cache)
     {
         lua_getglobal(mState, "baseENV");
         if (lua_isnil(mState, -1))
         {
             lua_pop(mState, 1);
-            luaL_loadbuffer(mState, condition, condition_size, (spacename + " baseENV").data());
+            //baseENV合约发布后不可修改，版本固定
+            chunk_cache.load(mState, base_env.id, transaction_id_type(), base_env.lua_code_b, spacename + " baseENV");
             lua_setglobal(mState, "baseENV");
             lua_getglobal(mState, "baseENV");
         }
@@ -468,10 +471,10 @@ namespace taiyi { namespace chain {
         return true;
     }
     //=============================================================================
-    bool LuaContext::load_script_to_sandbox(string spacename, const char *script, size_t script_size)
+    bool LuaContext::load_script_to_sandbox(string spacename, const contract_object& contract, const contract_bin_code_object& code, lua_chunk_cache& chunk_cache)
     {
         //lua加载脚本之后会返回一个函数(即此时栈顶的chunk块)，lua_pcall将默认调用此块
-        int sta = luaL_loadbuffer(mState, script, script_size, spacename.data());
+        int sta = chunk_cache.load(mState, code.id, contract.current_version, code.lua_code_b, spacename);
         lua_getglobal(mState, spacename.data()); //想要使用的_ENV备用空间
         //将栈顶变量赋值给栈顶第二个函数的第一个upvalue(当前第二个函数为load返回的函数，第一个upvalue为_ENV)
         //注：upvalue:函数的外部引用变量在赋值成功以后，栈顶自动回弹一层
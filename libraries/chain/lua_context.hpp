@@ -97,6 +97,10 @@ using protocol::lua_types;
 
 using protocol::FunctionSummary;
 
+class contract_object;
+class contract_bin_code_object;
+class lua_chunk_cache;
+
 /**
  * Defines a Lua context
  * A Lua context is used to interpret Lua code. Since everything in Lua is a variable (including functions),
@@ -172,11 +176,11 @@ public:
     };
 
     void chain_function_bind();
-    bool new_sandbox(string spacename, const char *condition, size_t condition_size);
+    bool new_sandbox(string spacename, const contract_bin_code_object& base_env, lua_chunk_cache& chunk_cache);
     bool get_sandbox(string spacename);
     bool close_sandbox(string spacename);
     bool get_function(string spacename, string func);
-    bool load_script_to_sandbox(string spacename, const char *script, size_t script_size);
+    bool load_script_to_sandbox(string spacename, const contract_object& contract, const contract_bin_code_object& code, lua_chunk_cache& chunk_cache);
     
     /**
      * Move constructor
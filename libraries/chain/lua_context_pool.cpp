@@ -0,0 +1,185 @@
+#include <chain/taiyi_fwd.hpp>
+
+#include <chain/lua_context.hpp>
+#include <chain/lua_context_pool.hpp>
+#include <chain/lua_chunk_cache.hpp>
+
+#include <fc/log/logger.hpp>
+
+namespace taiyi { namespace chain {
+
+    lua_context_pool::lua_context_pool()
+        : _hits(0), _misses(0)
+    {}
+    //=============================================================================
+    lua_context_pool::~lua_context_pool()
+    {
+        stop();
+    }
+    //=============================================================================
+    void lua_context_pool::start( uint32_t capacity )
+    {
+        stop();
+
+        _capacity = capacity;
+        if( _capacity == 0 )
+            return;
+
+        _running = true;
+        _prewarm_thread.reset( new std::thread( [this]() { prewarm_loop(); } ) );
+        ilog( "Lua context pool started with capacity ${c}", ("c", _capacity) );
+    }
+    //=============================================================================
+    void lua_context_pool::stop()
+    {
+        {
+            std::lock_guard< std::mutex > guard( _mutex );
+            _running = false;
+        }
+        _cv.notify_all();
+
+        if( _prewarm_thread )
+        {
+            _prewarm_thread->join();
+            _prewarm_thread.reset();
+        }
+
+        _ready.clear();
+        _retired.clear();
+        _capacity = 0;
+    }
+    //=============================================================================
+    void lua_context_pool::set_base_env( const std::string& name, const contract_bin_code_id_type& code_id, const transaction_id_type& version, const std::vector<char>& code )
+    {
+        {
+            std::lock_guard< std::mutex > guard( _mutex );
+            if( _base_env && _base_env->code_id == code_id && _base_env->version == version )
+                return;
+
+            _base_env = std::make_shared<const base_env_code>( base_env_code{ name, code_id, version, code } );
+            ++_base_env_generation;
+
+            //之前预热的虚拟机加载的是旧的baseENV，全部作废
+            for( auto& context : _ready )
+                _retired.push_back( std::move( context ) );
+            _ready.clear();
+        }
+        _cv.notify_all();
+    }
+    //=============================================================================
+    std::unique_ptr<LuaContext> lua_context_pool::acquire()
+    {
+        std::shared_ptr<const base_env_code> base_env;
+        {
+            std::lock_guard< std::mutex > guard( _mutex );
+            FC_ASSERT( _base_env, "baseENV of lua context pool is not set." );
+
+            if( !_ready.empty() )
+            {
+                auto context = std::move( _ready.front() );
+                _ready.pop_front();
+                ++_hits;
+                _cv.notify_all();
+                return context;
+            }
+
+            base_env = _base_env;
+        }
+
+        if( is_enabled() )
+            ++_misses;
+        return create_context( *base_env );
+    }
+    //=============================================================================
+    void lua_context_pool::release( std::unique_ptr<LuaContext> context )
+    {
+        if( !context || !is_enabled() )
+            return;
+
+        {
+            std::lock_guard< std::mutex > guard( _mutex );
+            _retired.push_back( std::move( context ) );
+        }
+        _cv.notify_all();
+    }
+    //=============================================================================
+    uint32_t lua_context_pool::get_ready_size()
+    {
+        std::lock_guard< std::mutex > guard( _mutex );
+        return _ready.size();
+    }
+    //=============================================================================
+    void lua_context_pool::load_base_env( LuaContext& context, const std::string& name, const contract_bin_code_id_type& code_id, const std::vector<char>& code, lua_chunk_cache* chunk_cache )
+    {
+        lua_getglobal(context.mState, "baseENV");
+        if (lua_isnil(context.mState, -1))
+        {
+            lua_pop(context.mState, 1);
+            //baseENV合约发布后不可修改，版本固定
+            if( chunk_cache )
+                chunk_cache->load(context.mState, code_id, transaction_id_type(), code, name);
+            else
+                luaL_loadbuffer(context.mState, code.data(), code.size(), name.data());
+            lua_setglobal(context.mState, "baseENV");
+        }
+    }
+    //=============================================================================
+    std::unique_ptr<LuaContext> lua_context_pool::create_context( const base_env_code& base_env )
+    {
+        std::unique_ptr<LuaContext> context( new LuaContext() );
+        load_base_env( *context, base_env.name, base_env.code_id, base_env.code, _chunk_cache );
+        return context;
+    }
+    //=============================================================================
+    void lua_context_pool::prewarm_loop()
+    {
+        std::unique_lock< std::mutex > lock( _mutex );
+        while( _running )
+        {
+            if( !_retired.empty() )
+            {
+                //销毁用过的虚拟机（lua_close）也不占用核心线程
+                std::deque< std::unique_ptr<LuaContext> > retired;
+                retired.swap( _retired );
+                lock.unlock();
+                retired.clear();
+                lock.lock();
+                continue;
+            }
+
+            if( _base_env && _ready.size() < _capacity )
+            {
+                auto base_env = _base_env;
+                auto generation = _base_env_generation;
+                lock.unlock();
+
+                std::unique_ptr<LuaContext> context;
+                try
+                {
+                    context = create_context( *base_env );
+                }
+                catch( const fc::exception& e )
+                {
+                    elog( "Lua context pool failed to create context: ${e}", ("e", e.to_detail_string()) );
+                }
+
+                lock.lock();
+                if( !context )
+                {
+                    //创建失败时等待下一次请求再重试，避免空转
+                    _cv.wait( lock );
+                    continue;
+                }
+
+                if( generation == _base_env_generation && _ready.size() < _capacity )
+                    _ready.push_back( std::move( context ) );
+                else
+                    _retired.push_back( std::move( context ) );
+                continue;
+            }
+
+            _cv.wait( lock );
+        }
+    }
+
+} } // taiyi::chain
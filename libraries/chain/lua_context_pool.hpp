@@ -0,0 +1,105 @@
+#pragma once
+
+#include <chain/taiyi_object_types.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace taiyi { namespace chain {
+
+    class LuaContext;
+    class lua_chunk_cache;
+
+    /**
+     * 预热的Lua虚拟机池
+     *
+     * 每个虚拟机的创建（luaL_openlibs、chain_function_bind中大量的registerMember、加载baseENV字节码）
+     * 都由后台线程提前完成，核心线程直接取用。
+     *
+     * 注意：合约的drops计量包含了内存分配（见lmem.c），而内存分配又依赖于虚拟机内部的字符串表、
+     * 全局表大小以及GC状态，因此用过的虚拟机无法被“重置”到与新建虚拟机完全一致的状态。为了保证
+     * 共识，池中的每个虚拟机都只使用一次：取出的虚拟机与新建并执行initialize_VM_baseENV之后的
+     * 虚拟机完全等价，用过的虚拟机也交给后台线程销毁。
+     */
+    class lua_context_pool
+    {
+    public:
+        lua_context_pool();
+        ~lua_context_pool();
+
+        /**
+         * 启动后台预热线程
+         * @param capacity 预热好的虚拟机数量上限，为0时不启用池，所有虚拟机都在调用线程上同步创建
+         */
+        void start( uint32_t capacity );
+        void stop();
+        bool is_enabled()const { return _capacity > 0; }
+
+        /**
+         * 设置加载baseENV时使用的字节码缓存，需在start之前设置
+         */
+        void set_chunk_cache( lua_chunk_cache* chunk_cache ) { _chunk_cache = chunk_cache; }
+
+        /**
+         * 设置用于初始化虚拟机的baseENV字节码，字节码或合约版本改变时之前预热的虚拟机全部作废
+         * 只比较code_id和version，二者未变时不会复制字节码
+         */
+        void set_base_env( const std::string& name, const contract_bin_code_id_type& code_id, const transaction_id_type& version, const std::vector<char>& code );
+
+        /**
+         * 取出一个虚拟机，等价于新建LuaContext后执行initialize_VM_baseENV
+         * 池中没有可用的虚拟机时在调用线程上同步创建
+         */
+        std::unique_ptr<LuaContext> acquire();
+
+        /**
+         * 归还用过的虚拟机，池启用时由后台线程销毁
+         */
+        void release( std::unique_ptr<LuaContext> context );
+
+        uint64_t get_hits()const { return _hits; }
+        uint64_t get_misses()const { return _misses; }
+        uint32_t get_ready_size();
+
+        /**
+         * 在虚拟机中加载baseENV函数（与database::initialize_VM_baseENV共用，保证两种创建方式完全一致）
+         */
+        static void load_base_env( LuaContext& context, const std::string& name, const contract_bin_code_id_type& code_id, const std::vector<char>& code, lua_chunk_cache* chunk_cache );
+
+    private:
+        struct base_env_code
+        {
+            std::string                 name;
+            contract_bin_code_id_type   code_id;
+            transaction_id_type         version;
+            std::vector<char>           code;
+        };
+
+        std::unique_ptr<LuaContext> create_context( const base_env_code& base_env );
+        void prewarm_loop();
+
+        uint32_t                                    _capacity = 0;
+        lua_chunk_cache*                            _chunk_cache = nullptr;
+
+        std::mutex                                  _mutex;
+        std::condition_variable                     _cv;
+        bool                                        _running = false;
+        std::unique_ptr<std::thread>                _prewarm_thread;
+
+        std::shared_ptr<const base_env_code>        _base_env;
+        uint64_t                                    _base_env_generation = 0;
+
+        std::deque< std::unique_ptr<LuaContext> >   _ready;
+        std::deque< std::unique_ptr<LuaContext> >   _retired;
+
+        std::atomic<uint64_t>                       _hits;
+        std::atomic<uint64_t>                       _misses;
+    };
+
+} } // taiyi::chain
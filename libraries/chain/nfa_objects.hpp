@@ -5,6 +5,7 @@
 #include <protocol/taiyi_operations.hpp>
 
 #include <chain/taiyi_object_types.hpp>
+#include <chain/util/undo_encoding.hpp>
 
 namespace taiyi { namespace chain {
 
@@ -77,6 +78,7 @@ namespace taiyi { namespace chain {
         
         contract_id_type    main_contract = contract_id_type::max();
         lua_map             contract_data;
+        uint64_t            contract_data_size = 1; ///< fc::raw::pack_size(contract_data)，随写入增量维护
         
         asset               qi = asset( 0, QI_SYMBOL ); /// total qi shares held by this nfa, controls its heart_beat power
 
@@ -197,8 +199,9 @@ namespace mira {
 FC_REFLECT(taiyi::chain::nfa_symbol_object, (id)(creator_account)(authority_account)(authority_nfa_symbol)(symbol)(describe)(default_contract)(count)(max_count)(min_equivalent_qi)(is_sbt))
 CHAINBASE_SET_INDEX_TYPE(taiyi::chain::nfa_symbol_object, taiyi::chain::nfa_symbol_index)
 
-FC_REFLECT(taiyi::chain::nfa_object, (id)(creator_account)(owner_account)(active_account)(symbol_id)(parent)(main_contract)(contract_data)(qi)(debt_value)(debt_contract)(cultivation_value)(created_time)(next_tick_block))
+FC_REFLECT(taiyi::chain::nfa_object, (id)(creator_account)(owner_account)(active_account)(symbol_id)(parent)(main_contract)(contract_data)(contract_data_size)(qi)(debt_value)(debt_contract)(cultivation_value)(created_time)(next_tick_block))
 CHAINBASE_SET_INDEX_TYPE(taiyi::chain::nfa_object, taiyi::chain::nfa_index)
+TAIYI_SET_UNDO_ENCODER(taiyi::chain::nfa_object, taiyi::chain::util::contract_data_size_of)
 
 FC_REFLECT(taiyi::chain::nfa_material_object, (id)(nfa)(gold)(food)(wood)(fabric)(herb))
 CHAINBASE_SET_INDEX_TYPE(taiyi::chain::nfa_material_object, taiyi::chain::nfa_material_index)
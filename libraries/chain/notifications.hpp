@@ -12,6 +12,11 @@ namespace taiyi { namespace chain {
             block_num = taiyi::protocol::block_header::num_from_id( block_id );
         }
         
+        block_notification( const taiyi::protocol::signed_block& b, const taiyi::protocol::block_id_type& id ) : block_id(id), block(b)
+        {
+            block_num = taiyi::protocol::block_header::num_from_id( block_id );
+        }
+        
         taiyi::protocol::block_id_type          block_id;
         uint32_t                                block_num = 0;
         const taiyi::protocol::signed_block&    block;
@@ -24,6 +29,8 @@ namespace taiyi { namespace chain {
             transaction_id = tx.id();
         }
         
+        transaction_notification( const taiyi::protocol::signed_transaction& tx, const taiyi::protocol::transaction_id_type& id ) : transaction_id(id), transaction(tx) {}
+        
         taiyi::protocol::transaction_id_type          transaction_id;
         const taiyi::protocol::signed_transaction&    transaction;
     };
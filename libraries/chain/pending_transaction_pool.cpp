@@ -0,0 +1,113 @@
+#include <chain/pending_transaction_pool.hpp>
+
+#include <fc/io/raw.hpp>
+
+namespace taiyi { namespace chain {
+
+    const pending_transaction& pending_transaction_pool::add( const signed_transaction& trx, const transaction_id_type& id, bool applied )
+    {
+        pending_transaction ptx;
+        ptx.id = id;
+        ptx.trx = trx;
+        ptx.sequence = _next_sequence++;
+        ptx.expiration = trx.expiration;
+        ptx.size = fc::raw::pack_size( trx );
+        if( applied )
+        {
+            ptx.applied_epoch = _epoch;
+            ptx.verified_epoch = _verified_epoch;
+        }
+
+        auto result = _index.insert( std::move( ptx ) );
+        FC_ASSERT( result.second, "Transaction ${id} is already pending.", ("id", id) );
+
+        const auto& entry = *result.first;
+        _bytes += entry.size;
+        ++_stats.added;
+        return entry;
+    }
+    //=============================================================================
+    void pending_transaction_pool::erase( pending_transaction_index::iterator itr )
+    {
+        _bytes -= itr->size;
+        _index.erase( itr );
+    }
+    //=============================================================================
+    bool pending_transaction_pool::remove( const transaction_id_type& id )
+    {
+        auto itr = _index.find( id );
+        if( itr == _index.end() )
+            return false;
+        erase( itr );
+        return true;
+    }
+    //=============================================================================
+    bool pending_transaction_pool::contains( const transaction_id_type& id )const
+    {
+        return _index.find( id ) != _index.end();
+    }
+    //=============================================================================
+    const pending_transaction* pending_transaction_pool::find( const transaction_id_type& id )const
+    {
+        auto itr = _index.find( id );
+        return itr == _index.end() ? nullptr : &*itr;
+    }
+    //=============================================================================
+    const pending_transaction* pending_transaction_pool::find( uint64_t sequence )const
+    {
+        const auto& idx = _index.get< by_sequence >();
+        auto itr = idx.find( sequence );
+        return itr == idx.end() ? nullptr : &*itr;
+    }
+    //=============================================================================
+    void pending_transaction_pool::clear()
+    {
+        _index.clear();
+        _bytes = 0;
+        ++_epoch;
+    }
+    //=============================================================================
+    uint32_t pending_transaction_pool::remove_included( const std::vector< transaction_id_type >& ids )
+    {
+        uint32_t n = 0;
+        for( const auto& id : ids )
+        {
+            if( remove( id ) )
+                ++n;
+        }
+        _stats.included += n;
+        return n;
+    }
+    //=============================================================================
+    uint32_t pending_transaction_pool::remove_expired( fc::time_point_sec now )
+    {
+        //与_apply_transaction一致，到期时刻本身也算过期
+        auto& idx = _index.get< by_expiration >();
+        uint32_t n = 0;
+        while( !idx.empty() && idx.begin()->expiration <= now )
+        {
+            erase( _index.project< by_id >( idx.begin() ) );
+            ++n;
+        }
+        _stats.expired += n;
+        return n;
+    }
+    //=============================================================================
+    pending_transaction_pool_stats pending_transaction_pool::get_stats()const
+    {
+        pending_transaction_pool_stats s = _stats;
+        s.size = _index.size();
+        s.bytes = _bytes;
+        s.applied = 0;
+        s.verified = 0;
+        for( const auto& ptx : _index )
+        {
+            if( is_applied( ptx ) )
+                ++s.applied;
+            if( is_verified( ptx ) )
+                ++s.verified;
+        }
+        return s;
+    }
+
+} } // taiyi::chain
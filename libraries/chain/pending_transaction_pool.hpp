@@ -0,0 +1,123 @@
+#pragma once
+#include <protocol/block.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+
+
+namespace taiyi { namespace chain {
+
+    using namespace taiyi::protocol;
+
+    struct pending_transaction
+    {
+        transaction_id_type                 id;
+        signed_transaction                  trx;
+        uint64_t                            sequence = 0;       ///< 到达顺序
+        fc::time_point_sec                  expiration;
+        uint32_t                            size = 0;           ///< fc::raw::pack_size( trx )
+        mutable uint64_t                    applied_epoch = 0;  ///< 与交易池的epoch相等时表示已经应用在pending状态中
+        mutable uint64_t                    verified_epoch = 0; ///< 与交易池的verified_epoch相等时表示签名和权限已经检查过
+        mutable int64_t                     qi_cost = 0;        ///< 最近一次应用时消耗的气（非罡奖励）
+    };
+
+    struct pending_transaction_pool_stats
+    {
+        uint32_t    size = 0;               ///< 交易池中的交易数量
+        uint64_t    bytes = 0;
+        uint32_t    applied = 0;            ///< 已经应用在pending状态中的交易数量
+        uint32_t    verified = 0;           ///< 签名和权限检查仍然有效的交易数量
+        uint64_t    added = 0;
+        uint64_t    included = 0;           ///< 被区块打包后移出
+        uint64_t    expired = 0;
+        uint64_t    dropped = 0;            ///< 重新应用失败后移出
+        uint64_t    revalidated = 0;        ///< 重新应用的次数
+        uint64_t    verification_skipped = 0;   ///< 重新应用时跳过签名和权限检查的次数
+    };
+
+    /**
+     * 等待打包的交易池
+     *
+     * 交易按到达顺序和过期时间建立索引。新区块只会移出被打包（O(k)）和过期的交易，其余交易按到达顺序重新应用，
+     * pending状态总是包含交易池中的全部交易（超过重新应用的时间限制而推迟的除外）。
+     *
+     * 重新应用时只有签名和权限检查可以省略：交易进入交易池时已经检查过，之后只要没有任何账号权限发生变化，
+     * 检查结果就仍然有效。pending状态每次被撤销时epoch加一，账号权限变化时verified_epoch加一，都不需要逐个修改交易。
+     */
+    class pending_transaction_pool
+    {
+    public:
+        struct by_id;
+        struct by_sequence;
+        struct by_expiration;
+
+        typedef boost::multi_index_container<
+            pending_transaction,
+            boost::multi_index::indexed_by<
+                boost::multi_index::hashed_unique< boost::multi_index::tag< by_id >, boost::multi_index::member< pending_transaction, transaction_id_type, &pending_transaction::id >, std::hash< fc::ripemd160 > >,
+                boost::multi_index::ordered_unique< boost::multi_index::tag< by_sequence >, boost::multi_index::member< pending_transaction, uint64_t, &pending_transaction::sequence > >,
+                boost::multi_index::ordered_non_unique< boost::multi_index::tag< by_expiration >, boost::multi_index::member< pending_transaction, fc::time_point_sec, &pending_transaction::expiration > >
+            >
+        > pending_transaction_index;
+
+        /**
+         * 加入交易，applied为true时表示交易已经检查并应用在当前的pending状态中
+         */
+        const pending_transaction& add( const signed_transaction& trx, const transaction_id_type& id, bool applied );
+        bool remove( const transaction_id_type& id );
+        bool contains( const transaction_id_type& id )const;
+        const pending_transaction* find( const transaction_id_type& id )const;
+        const pending_transaction* find( uint64_t sequence )const;
+
+        size_t size()const { return _index.size(); }
+        bool empty()const { return _index.empty(); }
+        void clear();
+
+        /** 按到达顺序遍历 */
+        const pending_transaction_index::index< by_sequence >::type& by_arrival()const { return _index.get< by_sequence >(); }
+
+        bool is_applied( const pending_transaction& ptx )const { return ptx.applied_epoch == _epoch; }
+        void set_applied( const pending_transaction& ptx ) { ptx.applied_epoch = _epoch; }
+        void set_qi_cost( const pending_transaction& ptx, int64_t qi_cost ) { ptx.qi_cost = qi_cost; }
+
+        /** pending状态被撤销，所有交易变为未应用 */
+        void reset_applied() { ++_epoch; }
+
+        bool is_verified( const pending_transaction& ptx )const { return ptx.verified_epoch == _verified_epoch; }
+        void set_verified( const pending_transaction& ptx ) { ptx.verified_epoch = _verified_epoch; }
+
+        /** 账号权限发生了变化，所有交易都要重新检查签名和权限 */
+        void reset_verified() { ++_verified_epoch; }
+
+        /** 移出已经被区块打包的交易，返回移出的数量 */
+        uint32_t remove_included( const std::vector< transaction_id_type >& ids );
+
+        /** 移出now时已经过期的交易 */
+        uint32_t remove_expired( fc::time_point_sec now );
+
+        void count_dropped() { ++_stats.dropped; }
+        void count_revalidated( bool verification_skipped )
+        {
+            ++_stats.revalidated;
+            if( verification_skipped )
+                ++_stats.verification_skipped;
+        }
+
+        pending_transaction_pool_stats get_stats()const;
+
+    private:
+        void erase( pending_transaction_index::iterator itr );
+
+        pending_transaction_index                                   _index;
+        uint64_t                                                    _next_sequence = 1;
+        uint64_t                                                    _epoch = 1;
+        uint64_t                                                    _verified_epoch = 1;
+        uint64_t                                                    _bytes = 0;
+        pending_transaction_pool_stats                              _stats;
+    };
+
+} } // taiyi::chain
+
+FC_REFLECT( taiyi::chain::pending_transaction_pool_stats, (size)(bytes)(applied)(verified)(added)(included)(expired)(dropped)(revalidated)(verification_skipped) )
@@ -26,7 +26,7 @@ namespace taiyi { namespace chain {
             
             FC_ASSERT(foundPosI->creator == proposal_owner, "Only proposal owner can remove it...");
             
-            remove_proposal< by_id >(foundPosI, proposalIndex, votesIndex, byVoterIdx, obj_perf);
+            remove_proposal< by_id >(db, foundPosI, proposalIndex, votesIndex, byVoterIdx, obj_perf);
             
             if( obj_perf.done )
                 break;
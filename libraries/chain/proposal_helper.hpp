@@ -1,6 +1,7 @@
 #pragma once
 
 #include <chain/database.hpp>
+#include <chain/account_object.hpp>
 #include <chain/proposal_objects.hpp>
 
 #include <boost/container/flat_set.hpp>
@@ -65,7 +66,7 @@ namespace taiyi { namespace chain {
     public:
         
         template< typename ByProposalType, typename ProposalObjectIterator, typename ProposalIndex, typename VotesIndex, typename ByVoterIdx >
-        static ProposalObjectIterator remove_proposal(ProposalObjectIterator& proposal, ProposalIndex& proposalIndex, VotesIndex& votesIndex, const ByVoterIdx& byVoterIdx, proposal_removing_reducer& obj_perf)
+        static ProposalObjectIterator remove_proposal(database& db, ProposalObjectIterator& proposal, ProposalIndex& proposalIndex, VotesIndex& votesIndex, const ByVoterIdx& byVoterIdx, proposal_removing_reducer& obj_perf)
         {
             // Now remove all votes specific to given proposal.
             auto propI = byVoterIdx.lower_bound( boost::make_tuple(proposal->id, account_id_type()) );            
@@ -75,6 +76,14 @@ namespace taiyi { namespace chain {
                 if(obj_perf.done)
                     return result_itr;
                 
+                //删除可能在这里中断，留下的提案的票数要和剩下的投票一致
+                if( db.is_xinsu(db.get<account_object, by_id>(propI->voter)) )
+                {
+                    db.modify(*proposal, [&](proposal_object& obj) {
+                        obj.total_votes -= 1;
+                    });
+                }
+                
                 propI = votesIndex. template erase<by_proposal_voter>(propI);
             }
             
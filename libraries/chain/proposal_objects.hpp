@@ -35,7 +35,7 @@ namespace taiyi { namespace chain {
         time_point_sec          end_date;       // end_date (when the proposal expires and can no longer valid)
         std::string             subject;        // subject (a very brief description or title for the proposal)
                         
-        uint64_t                total_votes = 0;// This will be calculate every maintenance period
+        uint64_t                total_votes = 0;// 当前心素投票数，随投票和心素变化增量维护
         bool                    removed = false;
         
         time_point_sec get_end_date_with_delay() const { return end_date + TAIYI_PROPOSAL_MAINTENANCE_CLEANUP; }
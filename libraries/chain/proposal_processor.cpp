@@ -13,6 +13,8 @@
 
 #include <fc/macros.hpp>
 
+#include <map>
+
 namespace taiyi { namespace chain {
         
     const std::string proposal_processor::removing_name = "proposal_processor_remove";
@@ -38,7 +40,7 @@ namespace taiyi { namespace chain {
         
         while( itr != found )
         {
-            itr = proposal_helper::remove_proposal<by_end_date>(itr, proposalIndex, votesIndex, byVoterIdx, obj_perf);
+            itr = proposal_helper::remove_proposal<by_end_date>(db, itr, proposalIndex, votesIndex, byVoterIdx, obj_perf);
             if(obj_perf.done)
                 break;
         }
@@ -71,16 +73,28 @@ namespace taiyi { namespace chain {
         return ret;
     }
     //=========================================================================
-    void proposal_processor::calculate_votes(const t_proposals& proposals)
+    void proposal_processor::validate_votes()
     {
-        for( auto& item : proposals )
+        //同一个投票者通常投了多个提案，心素身份只查一次
+        std::map<account_id_type, bool> xinsu;
+        std::map<proposal_id_type, uint64_t> recount;
+        
+        const auto& pvidx = db.get_index<proposal_vote_index>().indices().get<by_proposal_voter>();
+        for( const auto& vote : pvidx )
         {
-            const proposal_object& _item = item;
-            auto total_votes = calculate_votes(_item.id);
-            
-            db.modify(_item, [&](auto& proposal) {
-                proposal.total_votes = total_votes;
-            });
+            auto found = xinsu.find( vote.voter );
+            if( found == xinsu.end() )
+                found = xinsu.emplace( vote.voter, db.is_xinsu(db.get<account_object, by_id>(vote.voter)) ).first;
+            if( found->second )
+                recount[ vote.proposal_id ] += 1;
+        }
+        
+        const auto& pidx = db.get_index<proposal_index>().indices().get<by_id>();
+        for( const auto& proposal : pidx )
+        {
+            auto found = recount.find( proposal.id );
+            uint64_t total_votes = found == recount.end() ? 0 : found->second;
+            FC_ASSERT( proposal.total_votes == total_votes, "核对提案#${p}的票数失败", ("p", proposal.id)("total_votes", proposal.total_votes)("recount", total_votes) );
         }
     }
     //=========================================================================
@@ -176,12 +190,18 @@ namespace taiyi { namespace chain {
             return true;
         };
         
+        //执行提案可能改变心素从而改变后面提案的票数，是否执行仍以维护周期开始时的票数为准
+        std::vector<uint64_t> total_votes;
+        total_votes.reserve(proposals.size());
         for( auto& item : proposals )
+            total_votes.push_back(item.get().total_votes);
+        
+        for( size_t i = 0; i < proposals.size(); ++i )
         {
-            const proposal_object& _item = item;
+            const proposal_object& _item = proposals[i];
             
             //Proposals without any votes shouldn't be treated as active
-            if( _item.total_votes == 0 )
+            if( total_votes[i] == 0 )
                 break;
             
             if( processing(_item) ) {
@@ -237,9 +257,7 @@ namespace taiyi { namespace chain {
             return;
         }
         
-        //Calculate total_votes for every active proposal
-        calculate_votes(active_proposals);
-        
+        //total_votes随投票和心素变化增量维护，这里不再重新计算
         //Filter all active proposals by total_votes, remove proposals which votes is less than set
         filter_by_votes(active_proposals);
                 
@@ -32,7 +32,6 @@ namespace taiyi { namespace chain {
         void find_active_proposals( const time_point_sec& head_time, t_proposals& proposals );
         
         uint64_t calculate_votes( const proposal_id_type& id );
-        void calculate_votes( const t_proposals& proposals );
         void filter_by_votes( t_proposals& proposals );
                 
         void update_settings( const time_point_sec& head_time );
@@ -47,6 +46,9 @@ namespace taiyi { namespace chain {
         const static std::string& get_calculating_name();
         
         void run( const block_notification& note );
+        
+        /** 核对所有提案增量维护的票数和重新计数的结果一致，失败时抛出异常。要扫描所有投票，只在全量核对不变量时调用 */
+        void validate_votes();
     };
     
 } } // namespace taiyi::chain
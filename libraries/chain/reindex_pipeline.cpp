@@ -0,0 +1,120 @@
+#include <chain/reindex_pipeline.hpp>
+
+#include <fc/io/raw.hpp>
+
+#include <algorithm>
+
+namespace taiyi { namespace chain {
+
+    reindex_pipeline::reindex_pipeline( const block_log& log, uint32_t first_block, uint32_t last_block, uint32_t depth, uint32_t thread_num )
+        : _log( log ), _first_block( first_block ), _last_block( last_block ), _depth( std::max< uint32_t >( depth, 1 ) ), _start( fc::time_point::now() ),
+          _next_to_read( first_block ), _next_to_consume( first_block ), _slots( _depth ), _errors( _depth )
+    {
+        thread_num = std::max< uint32_t >( thread_num, 1 );
+        for( uint32_t i = 0; i < thread_num; ++i )
+            _threads.emplace_back( [this]() { worker(); } );
+    }
+    //=============================================================================
+    reindex_pipeline::~reindex_pipeline()
+    {
+        {
+            std::lock_guard< std::mutex > lock( _mutex );
+            _stop = true;
+        }
+        _consumed.notify_all();
+        for( auto& t : _threads )
+            t.join();
+    }
+    //=============================================================================
+    std::shared_ptr< const prepared_block > reindex_pipeline::prepare( uint32_t block_num )const
+    {
+        auto b = _log.read_block_by_num( block_num );
+        FC_ASSERT( b.valid(), "Block ${n} is not in block log.", ("n", block_num) );
+
+        auto result = std::make_shared< prepared_block >();
+        result->block = std::move( *b );
+        result->block_id = result->block.id();
+        result->block_size = fc::raw::pack_size( result->block );
+        result->trx_ids.reserve( result->block.transactions.size() );
+        for( const auto& trx : result->block.transactions )
+            result->trx_ids.push_back( trx.id() );
+        return result;
+    }
+    //=============================================================================
+    void reindex_pipeline::worker()
+    {
+        std::unique_lock< std::mutex > lock( _mutex );
+        while( true )
+        {
+            //只读取深度范围内的区块，应用线程取走一个才能再读一个
+            _consumed.wait( lock, [this]() {
+                return _stop || _next_to_read > _last_block || _next_to_read < _next_to_consume + _depth;
+            } );
+            if( _stop || _next_to_read > _last_block )
+                return;
+
+            uint32_t block_num = _next_to_read++;
+            lock.unlock();
+
+            std::shared_ptr< const prepared_block > b;
+            std::exception_ptr error;
+            auto start = fc::time_point::now();
+            try
+            {
+                b = prepare( block_num );
+            }
+            catch( ... )
+            {
+                error = std::current_exception();
+            }
+            auto elapsed = fc::time_point::now() - start;
+
+            lock.lock();
+            _slots[ block_num % _depth ] = std::move( b );
+            _errors[ block_num % _depth ] = error;
+            _prepare_us += elapsed.count();
+            ++_ready;
+            _produced.notify_all();
+        }
+    }
+    //=============================================================================
+    std::shared_ptr< const prepared_block > reindex_pipeline::next()
+    {
+        std::unique_lock< std::mutex > lock( _mutex );
+        if( _next_to_consume > _last_block )
+            return std::shared_ptr< const prepared_block >();
+
+        uint32_t slot = _next_to_consume % _depth;
+        if( !_slots[ slot ] && !_errors[ slot ] )
+        {
+            auto start = fc::time_point::now();
+            _produced.wait( lock, [&]() { return _slots[ slot ] || _errors[ slot ]; } );
+            _wait_us += ( fc::time_point::now() - start ).count();
+        }
+
+        if( _errors[ slot ] )
+            std::rethrow_exception( _errors[ slot ] );
+
+        std::shared_ptr< const prepared_block > b;
+        b.swap( _slots[ slot ] );
+        --_ready;
+        ++_next_to_consume;
+        _consumed.notify_all();
+        return b;
+    }
+    //=============================================================================
+    reindex_pipeline::stats reindex_pipeline::get_stats()const
+    {
+        std::lock_guard< std::mutex > lock( _mutex );
+        stats s;
+        s.depth = _depth;
+        s.thread_num = _threads.size();
+        s.ready = _ready;
+        s.consumed = _next_to_consume - _first_block;
+        s.prepare_us = _prepare_us;
+        s.wait_us = _wait_us;
+        s.elapsed_us = ( fc::time_point::now() - _start ).count();
+        return s;
+    }
+
+} } // taiyi::chain
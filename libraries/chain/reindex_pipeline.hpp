@@ -0,0 +1,83 @@
+#pragma once
+
+#include <chain/block_log.hpp>
+
+#include <fc/time.hpp>
+
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace taiyi { namespace chain {
+
+    /**
+     * 在工作线程上预先读取、反序列化并计算好哈希的区块
+     */
+    struct prepared_block
+    {
+        signed_block                        block;
+        block_id_type                       block_id;
+        std::vector< transaction_id_type >  trx_ids;
+        uint32_t                            block_size = 0;     ///< fc::raw::pack_size( block )
+    };
+
+    /**
+     * 重放区块的读取流水线
+     *
+     * 工作线程从区块日志中读取区块，反序列化后预先计算区块ID、交易ID和区块大小，应用区块的线程
+     * 按区块号顺序取用。流水线的深度限制了已经读出但还没有应用的区块数量，应用线程落后时工作线程等待。
+     */
+    class reindex_pipeline
+    {
+    public:
+        struct stats
+        {
+            uint32_t    depth = 0;
+            uint32_t    thread_num = 0;
+            uint32_t    ready = 0;          ///< 已经准备好等待应用的区块数量
+            uint32_t    consumed = 0;       ///< 已经交给应用线程的区块数量
+            uint64_t    prepare_us = 0;     ///< 工作线程读取和准备区块的累计时间
+            uint64_t    wait_us = 0;        ///< 应用线程等待区块的累计时间
+            uint64_t    elapsed_us = 0;
+        };
+
+        reindex_pipeline( const block_log& log, uint32_t first_block, uint32_t last_block, uint32_t depth, uint32_t thread_num );
+        ~reindex_pipeline();
+
+        /**
+         * 按顺序返回下一个区块，全部取完后返回空；工作线程读取区块出错时在这里重新抛出
+         */
+        std::shared_ptr< const prepared_block > next();
+
+        stats get_stats()const;
+
+    private:
+        void worker();
+        std::shared_ptr< const prepared_block > prepare( uint32_t block_num )const;
+
+        const block_log&                                        _log;
+        const uint32_t                                          _first_block;
+        const uint32_t                                          _last_block;
+        const uint32_t                                          _depth;
+        const fc::time_point                                    _start;
+
+        mutable std::mutex                                      _mutex;
+        std::condition_variable                                 _produced;
+        std::condition_variable                                 _consumed;
+        uint32_t                                                _next_to_read;
+        uint32_t                                                _next_to_consume;
+        uint32_t                                                _ready = 0;
+        bool                                                    _stop = false;
+        std::vector< std::shared_ptr< const prepared_block > >  _slots;     ///< 区块号对深度取模
+        std::vector< std::exception_ptr >                       _errors;
+
+        uint64_t                                                _prepare_us = 0;
+        uint64_t                                                _wait_us = 0;
+
+        std::vector< std::thread >                              _threads;
+    };
+
+} } // taiyi::chain
@@ -0,0 +1,93 @@
+#include <chain/signature_key_cache.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace taiyi { namespace chain {
+
+    void signature_key_cache::prefetch( const signed_block& b, const chain_id_type& chain_id, fc::ecc::canonical_signature_type canon_type )
+    {
+        if( !is_enabled() || b.transactions.empty() )
+            return;
+
+        std::vector< fc::optional< flat_set< public_key_type > > > keys( b.transactions.size() );
+        std::vector< transaction_id_type > ids( b.transactions.size() );
+        std::atomic< uint32_t > next( 0 );
+
+        auto worker = [&]() {
+            for( uint32_t i = next++; i < b.transactions.size(); i = next++ )
+            {
+                const auto& trx = b.transactions[ i ];
+                ids[ i ] = trx.id();
+                try
+                {
+                    keys[ i ] = trx.get_signature_keys( chain_id, canon_type );
+                }
+                catch( const fc::exception& )
+                {
+                    //应用交易时会重新恢复并抛出异常
+                }
+            }
+        };
+
+        uint32_t thread_num = std::max( 1u, std::min( _thread_num, (uint32_t)b.transactions.size() ) );
+        std::vector< std::thread > threads;
+        for( uint32_t i = 1; i < thread_num; ++i )
+            threads.emplace_back( worker );
+        worker(); //调用线程也参与恢复
+        for( auto& t : threads )
+            t.join();
+
+        std::lock_guard< std::mutex > guard( _mutex );
+        uint64_t generation = ++_generation;
+        std::vector< transaction_id_type > cached;
+        for( size_t i = 0; i < keys.size(); ++i )
+        {
+            if( !keys[ i ].valid() )
+                continue;
+
+            entry& e = _entries[ ids[ i ] ];
+            e.signatures = b.transactions[ i ].signatures;
+            e.keys = std::move( *keys[ i ] );
+            e.canon_type = canon_type;
+            e.generation = generation;
+            cached.push_back( ids[ i ] );
+        }
+        _blocks.emplace_back( generation, std::move( cached ) );
+
+        while( _blocks.size() > _capacity )
+        {
+            for( const auto& id : _blocks.front().second )
+            {
+                auto itr = _entries.find( id );
+                if( itr != _entries.end() && itr->second.generation == _blocks.front().first )
+                    _entries.erase( itr );
+            }
+            _blocks.pop_front();
+        }
+    }
+    //=============================================================================
+    bool signature_key_cache::get( const transaction_id_type& trx_id, const signed_transaction& trx, fc::ecc::canonical_signature_type canon_type, flat_set< public_key_type >& keys )const
+    {
+        std::lock_guard< std::mutex > guard( _mutex );
+        auto itr = _entries.find( trx_id );
+        if( itr == _entries.end() || itr->second.canon_type != canon_type || itr->second.signatures != trx.signatures )
+        {
+            ++_misses;
+            return false;
+        }
+
+        keys = itr->second.keys;
+        ++_hits;
+        return true;
+    }
+    //=============================================================================
+    void signature_key_cache::clear()
+    {
+        std::lock_guard< std::mutex > guard( _mutex );
+        _entries.clear();
+        _blocks.clear();
+    }
+
+} } // taiyi::chain
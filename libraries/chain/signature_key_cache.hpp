@@ -0,0 +1,67 @@
+#pragma once
+
+#include <protocol/block.hpp>
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace taiyi { namespace chain {
+
+    using namespace taiyi::protocol;
+
+    /**
+     * 交易签名公钥的预先恢复缓存
+     *
+     * 从签名恢复公钥（get_signature_keys）与链上状态无关，可以在拿写锁之前并行完成。
+     * 缓存以交易ID为键，同时记录签名本身：交易ID不包含签名，只有签名也完全一致时才命中，
+     * 因此缓存的结果与在_apply_transaction中直接恢复的完全相同。
+     * 恢复失败（重复签名、无效签名）的交易不缓存，应用时照常恢复并抛出同样的异常。
+     */
+    class signature_key_cache
+    {
+    public:
+        /**
+         * 最多保留最近几个区块的恢复结果
+         */
+        void set_capacity( uint32_t blocks ) { _capacity = blocks; }
+        void set_thread_num( uint32_t thread_num ) { _thread_num = thread_num; }
+        bool is_enabled()const { return _thread_num > 0 && _capacity > 0; }
+
+        /**
+         * 在多个线程上恢复区块中所有交易的签名公钥并缓存，全部完成后返回；调用时不需要数据库锁
+         */
+        void prefetch( const signed_block& b, const chain_id_type& chain_id, fc::ecc::canonical_signature_type canon_type );
+
+        /**
+         * 取出缓存的签名公钥，没有缓存时返回false
+         */
+        bool get( const transaction_id_type& trx_id, const signed_transaction& trx, fc::ecc::canonical_signature_type canon_type, flat_set< public_key_type >& keys )const;
+
+        void clear();
+
+        uint64_t get_hits()const { return _hits; }
+        uint64_t get_misses()const { return _misses; }
+
+    private:
+        struct entry
+        {
+            std::vector< signature_type >       signatures;
+            flat_set< public_key_type >         keys;
+            fc::ecc::canonical_signature_type   canon_type;
+            uint64_t                            generation = 0;     ///< 缓存它的区块的序号
+        };
+
+        uint32_t                                                        _capacity = 4;
+        uint32_t                                                        _thread_num = 0;
+
+        mutable std::mutex                                              _mutex;
+        std::map< transaction_id_type, entry >                          _entries;
+        std::deque< std::pair< uint64_t, std::vector< transaction_id_type > > > _blocks;    ///< 每个区块缓存的交易，先进先出
+        uint64_t                                                        _generation = 0;
+        mutable uint64_t                                                _hits = 0;
+        mutable uint64_t                                                _misses = 0;
+    };
+
+} } // taiyi::chain
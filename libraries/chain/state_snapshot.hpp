@@ -0,0 +1,38 @@
+#pragma once
+
+#include <chain/global_property_object.hpp>
+#include <chain/hardfork_property_object.hpp>
+#include <chain/siming_objects.hpp>
+#include <chain/taiyi_objects.hpp>
+
+#include <vector>
+
+namespace taiyi { namespace chain {
+
+    /**
+     * 最后应用的块之后的全局状态副本。
+     *
+     * 写线程在块应用完成、块被弹出以及数据库打开之后发布新的副本，发布后副本不再修改。
+     * API线程取得副本后不需要持有数据库的读锁，写线程也不会等待读取副本的线程。
+     * 副本不包含交易池中还没有打包的交易造成的修改
+     */
+    struct state_snapshot
+    {
+        state_snapshot( const dynamic_global_property_object& dgpo, const siming_schedule_object& wso, const hardfork_property_object& hpo )
+            : dynamic_global_properties( dgpo ), siming_schedule( wso ), hardfork_properties( hpo ) {}
+
+        dynamic_global_property_object      dynamic_global_properties;
+        siming_schedule_object              siming_schedule;
+        hardfork_property_object            hardfork_properties;
+        std::vector< reward_fund_object >   reward_funds;           ///< 按ID排序
+
+        const reward_fund_object* find_reward_fund( const reward_fund_name_type& name )const
+        {
+            for( const auto& fund : reward_funds )
+                if( fund.name == name )
+                    return &fund;
+            return nullptr;
+        }
+    };
+
+} } // taiyi::chain
@@ -108,6 +108,9 @@ namespace taiyi { namespace chain {
         
         uint32_t    amount_actor_last_vyear = 0;
         uint32_t    dead_actor_last_vyear = 0;
+        
+        uint32_t    live_actor_num = 0; //当前健康值大于0的角色数，随角色创建和健康值变化增量维护
+        uint32_t    dead_actor_num = 0; //当前健康值小于等于0的角色数
     };
 
     typedef multi_index_container<
@@ -120,5 +123,5 @@ namespace taiyi { namespace chain {
 
 } } // taiyi::chain
 
-FC_REFLECT( taiyi::chain::tiandao_property_object, (id)(cruelty)(enjoyment)(decay)(falsity)(v_years)(v_months)(v_days)(v_timeonday)(v_times)(next_npc_born_time)(zone_grow_gold_speed_map)(zone_grow_food_speed_map)(zone_grow_wood_speed_map)(zone_grow_fabric_speed_map)(zone_grow_herb_speed_map)(zone_gold_max_map)(zone_food_max_map)(zone_wood_max_map)(zone_fabric_max_map)(zone_herb_max_map)(zone_moving_difficulty_map)(zone_type_connection_max_num_map)(amount_actor_last_vyear)(dead_actor_last_vyear) )
+FC_REFLECT( taiyi::chain::tiandao_property_object, (id)(cruelty)(enjoyment)(decay)(falsity)(v_years)(v_months)(v_days)(v_timeonday)(v_times)(next_npc_born_time)(zone_grow_gold_speed_map)(zone_grow_food_speed_map)(zone_grow_wood_speed_map)(zone_grow_fabric_speed_map)(zone_grow_herb_speed_map)(zone_gold_max_map)(zone_food_max_map)(zone_wood_max_map)(zone_fabric_max_map)(zone_herb_max_map)(zone_moving_difficulty_map)(zone_type_connection_max_num_map)(amount_actor_last_vyear)(dead_actor_last_vyear)(live_actor_num)(dead_actor_num) )
 CHAINBASE_SET_INDEX_TYPE( taiyi::chain::tiandao_property_object, taiyi::chain::tiandao_property_index )
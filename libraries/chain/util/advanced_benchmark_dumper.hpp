@@ -80,6 +80,8 @@ namespace taiyi { namespace chain { namespace util {
         
         template< typename COLLECTION >
         void dump_impl( const total_info< COLLECTION >& src, const std::string& src_file_name );
+
+        void add( const std::string& str, uint64_t time );
         
     public:
 
@@ -100,9 +102,14 @@ namespace taiyi { namespace chain { namespace util {
         void set_enabled( bool val ) { enabled = val; }
         bool is_enabled() { return enabled; }
         
+        /** 计时单位为微秒 */
         void begin();
         template< bool APPLY_CONTEXT = false >
         void end( const std::string& str );
+
+        /** 开始时间由调用方保存，计时范围内可以嵌套begin/end（比如虚拟操作的插件通知） */
+        uint64_t now()const;
+        void end_since( uint64_t since, const std::string& str );
         
         void dump();
     };
@@ -0,0 +1,74 @@
+#include <chain/util/index_configuration.hpp>
+
+#include <fc/variant_object.hpp>
+#include <fc/exception/exception.hpp>
+
+namespace taiyi { namespace chain { namespace util {
+
+    namespace {
+
+        /** overlay中的对象逐项合并进base，其他值直接替换 */
+        fc::variant merge_configuration( const fc::variant& base, const fc::variant& overlay )
+        {
+            if( !base.is_object() || !overlay.is_object() )
+                return overlay;
+
+            fc::mutable_variant_object result( base.get_object() );
+            for( const auto& e : overlay.get_object() )
+                result[ e.key() ] = merge_configuration( result[ e.key() ], e.value() );
+            return fc::variant( result );
+        }
+
+        fc::variant get_member( const fc::variant& v, const char* key )
+        {
+            if( !v.is_object() || !v.get_object().contains( key ) )
+                return fc::variant();
+            return v.get_object()[ key ];
+        }
+
+    }
+
+    std::string index_name_of_object_type( const std::string& value_type_name )
+    {
+        std::string name = value_type_name;
+        auto pos = name.rfind( "::" );
+        if( pos != std::string::npos )
+            name = name.substr( pos + 2 );
+
+        const std::string suffix = "_object";
+        if( name.size() > suffix.size() && name.compare( name.size() - suffix.size(), suffix.size(), suffix ) == 0 )
+            name.resize( name.size() - suffix.size() );
+        return name + "_index";
+    }
+    //=============================================================================
+    fc::variant index_database_configuration( const fc::variant& cfg, const std::string& index_name )
+    {
+        if( !cfg.is_object() )
+            return cfg;
+
+        const auto& obj = cfg.get_object();
+        fc::variant global = get_member( cfg, "global" );
+        fc::variant base = get_member( cfg, "base" );
+
+        auto itr = obj.find( index_name );
+        if( itr != obj.end() )
+        {
+            FC_ASSERT( itr->value().is_object(), "database.cfg中的${n}必须是对象", ("n", index_name) );
+            fc::mutable_variant_object overlay( itr->value().get_object() );
+            auto stats = overlay.find( "statistics" );
+            if( stats != overlay.end() )
+            {
+                global = merge_configuration( global, fc::mutable_variant_object( "statistics", stats->value() ) );
+                overlay.erase( "statistics" );
+            }
+
+            base = merge_configuration( base, fc::variant( overlay ) );
+        }
+
+        fc::mutable_variant_object result( obj );
+        result[ "global" ] = global;
+        result[ "base" ] = base;
+        return fc::variant( result );
+    }
+
+} } } // taiyi::chain::util
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <fc/variant.hpp>
+
+#include <string>
+
+namespace taiyi { namespace chain { namespace util {
+
+    /** 由对象类型名得到database.cfg中索引的节名，如taiyi::chain::nfa_object对应nfa_index */
+    std::string index_name_of_object_type( const std::string& value_type_name );
+
+    /**
+     * 得到一个索引实际使用的数据库配置。
+     *
+     * database.cfg中与索引同名的节（如nfa_index）逐项覆盖base中的设置，节中没有的设置沿用base。
+     * 默认配置不带任何索引节，节中只应使用base已有的设置，其他键不会被读取。
+     * 节中的statistics只为这个索引打开RocksDB统计。所有索引共用global.shared_cache。
+     */
+    fc::variant index_database_configuration( const fc::variant& cfg, const std::string& index_name );
+
+} } } // taiyi::chain::util
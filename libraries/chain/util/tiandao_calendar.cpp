@@ -0,0 +1,76 @@
+#include <chain/util/tiandao_calendar.hpp>
+
+#include <tyme/tyme.h>
+
+#include <fc/exception/exception.hpp>
+
+namespace taiyi { namespace chain {
+
+static const tyme::SolarDay& s_start_solar_day()
+{
+    static const tyme::SolarDay start = tyme::SolarDay::from_ymd(tiandao_calendar::start_year, 1, 1);
+    return start;
+}
+//=============================================================================
+uint32_t tiandao_calendar::get_day_count()
+{
+    static const uint32_t count = tyme::SolarDay::from_ymd(end_year, 12, 31).subtract(s_start_solar_day()) + 1;
+    return count;
+}
+//=============================================================================
+const tiandao_calendar::day_info& tiandao_calendar::get_day( uint32_t days )
+{
+    if( days < _first_day || days - _first_day >= _days.size() )
+        load_year( days );
+    return _days[ days - _first_day ];
+}
+//=============================================================================
+void tiandao_calendar::load_year( uint32_t days )
+{
+    FC_ASSERT( days < get_day_count(), "virtual day ${d} is out of calendar range.", ("d", days) );
+
+    int year = s_start_solar_day().get_julian_day().next( days ).get_solar_day().get_year();
+    tyme::SolarDay year_start = tyme::SolarDay::from_ymd( year, 1, 1 );
+    tyme::JulianDay year_start_jd = year_start.get_julian_day();
+
+    //下一个节气开始的日子，超出tyme支持的范围时没有下一个节气
+    auto next_term_start = []( const tyme::SolarTerm& term ) -> fc::optional<tyme::SolarDay> {
+        try {
+            return term.next(1).get_solar_day();
+        }
+        catch( const std::invalid_argument& ) {
+            return fc::optional<tyme::SolarDay>();
+        }
+    };
+
+    tyme::SolarTerm term = year_start.get_term();
+    fc::optional<tyme::SolarDay> next_start = next_term_start( term );
+
+    _days.clear();
+    _days.reserve( 366 );
+    for( int i = 0; ; ++i )
+    {
+        tyme::SolarDay d = year_start_jd.next( i ).get_solar_day();
+
+        //节气之间至少相隔数日，这里逐日推进即可
+        while( next_start.valid() && !d.is_before( *next_start ) )
+        {
+            term = term.next(1);
+            next_start = next_term_start( term );
+        }
+
+        day_info info;
+        info.year = (uint16_t)d.get_year();
+        info.month = (uint8_t)d.get_month();
+        info.day = (uint8_t)d.get_day();
+        info.term = (uint8_t)term.get_index();
+        _days.push_back( info );
+
+        if( info.month == 12 && info.day == 31 )
+            break;
+    }
+
+    _first_day = (uint32_t)year_start.subtract( s_start_solar_day() );
+}
+
+} } // namespace taiyi::chain
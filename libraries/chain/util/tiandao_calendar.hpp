@@ -0,0 +1,43 @@
+#pragma once
+
+#include <chain/taiyi_fwd.hpp>
+
+#include <vector>
+
+namespace taiyi { namespace chain {
+
+/**
+ * 天道虚拟历法：第N个虚拟日（head_block_num / TAIYI_VDAY_BLOCK_NUM）对应的公历年月日和节气
+ *
+ * 虚拟日0对应公历2年1月1日，年月日和节气与tyme逐日计算的结果完全一致，
+ * 但是节气只在每年开始时通过tyme计算，年内的日期按年缓存，每个区块查询是O(1)的。
+ * tyme_tests只逐日校验抽样的年份（首尾两年、1582年历法切换和几种闰年），
+ * 全部范围由programs/util/tiandao_calendar --verify与tyme逐日比对。
+ */
+class tiandao_calendar
+{
+public:
+    struct day_info
+    {
+        uint16_t    year = 0;   ///< 公历年，1 based
+        uint8_t     month = 0;  ///< 1 based
+        uint8_t     day = 0;    ///< 1 based
+        uint8_t     term = 0;   ///< tyme节气序号，0为冬至
+    };
+
+    static const uint16_t start_year = 2;
+    static const uint16_t end_year = 9999; ///< tyme支持的最后一年
+
+    /** 虚拟日总数，超出范围时get_day抛出异常 */
+    static uint32_t get_day_count();
+
+    const day_info& get_day( uint32_t days );
+
+private:
+    void load_year( uint32_t days );
+
+    uint32_t                _first_day = 0;     ///< _days[0]对应的虚拟日
+    std::vector<day_info>   _days;              ///< 缓存的一整年
+};
+
+} } // namespace taiyi::chain
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chainbase/chainbase.hpp>
+
+#include <fc/io/raw.hpp>
+
+#include <vector>
+
+namespace taiyi { namespace chain { namespace util {
+
+    /**
+     * 对象数据达到这个大小（字节）时，undo状态保存序列化后的旧值而不是完整副本，0表示总是保存完整副本。
+     * 进程内所有数据库共用，由database::open设置
+     */
+    inline uint64_t& undo_encoding_threshold()
+    {
+        static uint64_t threshold = 0;
+        return threshold;
+    }
+
+    /** 以增量维护的contract_data_size作为对象数据大小 */
+    struct contract_data_size_of
+    {
+        template< typename ObjectType >
+        uint64_t operator()( const ObjectType& o )const { return o.contract_data_size; }
+    };
+
+    /**
+     * 带有lua_map的对象第一次被修改时，undo状态中只保存一块序列化后的字节，而不是深拷贝整个容器，
+     * 撤销时再反序列化回对象。对象所有需要撤销的字段都必须在FC_REFLECT中
+     */
+    template< typename ObjectType, typename SizeOf >
+    struct reflected_undo_encoder
+    {
+        static bool encode( const ObjectType& o, std::vector< char >& out )
+        {
+            uint64_t threshold = undo_encoding_threshold();
+            if( threshold == 0 || SizeOf()( o ) < threshold )
+                return false;
+            out = fc::raw::pack_to_vector( o );
+            return true;
+        }
+
+        static void decode( const std::vector< char >& in, ObjectType& o )
+        {
+            fc::datastream< const char* > ds( in.data(), in.size() );
+            fc::raw::unpack( ds, o );
+        }
+    };
+
+} } } // taiyi::chain::util
+
+/**
+ *  This macro must be used at global scope, after FC_REFLECT of OBJECT_TYPE, and OBJECT_TYPE must be fully qualified
+ */
+#define TAIYI_SET_UNDO_ENCODER( OBJECT_TYPE, SIZE_OF ) \
+    namespace chainbase { template<> struct undo_value_encoder< OBJECT_TYPE > : taiyi::chain::util::reflected_undo_encoder< OBJECT_TYPE, SIZE_OF > {}; }
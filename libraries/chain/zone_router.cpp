@@ -0,0 +1,320 @@
+#include <chain/taiyi_fwd.hpp>
+
+#include <chain/zone_router.hpp>
+#include <chain/database.hpp>
+#include <chain/zone_objects.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+
+namespace taiyi { namespace chain {
+
+    namespace {
+
+        void insert_sorted( std::vector< int64_t >& v, int64_t id )
+        {
+            auto itr = std::lower_bound( v.begin(), v.end(), id );
+            if( itr == v.end() || *itr != id )
+                v.insert( itr, id );
+        }
+
+        void erase_sorted( std::vector< int64_t >& v, int64_t id )
+        {
+            auto itr = std::lower_bound( v.begin(), v.end(), id );
+            if( itr != v.end() && *itr == id )
+                v.erase( itr );
+        }
+
+        typedef std::pair< uint64_t, int64_t > queue_item;   ///< 天数，区域
+        typedef std::priority_queue< queue_item, std::vector< queue_item >, std::greater< queue_item > > min_queue;
+
+    }
+
+    zone_router::zone_router( database& db )
+        : _db( db ), _hits(0), _misses(0)
+    {}
+    //=============================================================================
+    zone_router::~zone_router()
+    {
+        detach();
+    }
+    //=============================================================================
+    void zone_router::attach()
+    {
+        detach();
+
+        std::lock_guard< std::mutex > guard( _mutex );
+
+        //修改区域时先以-1再以+1通知，删除只有-1。区域只会因为撤销创建而删除，此时它的连接已经先被撤销，
+        //所以没有连接的区域先从图中移除，如果是修改再按新值加回
+        _zone_observer = _db.get_mutable_index< zone_index >().add_delta_observer( [this]( const zone_object& z, int sign ) {
+            std::lock_guard< std::mutex > guard( _mutex );
+            if( !_built )
+                return;
+
+            auto itr = _nodes.find( z.id._id );
+            if( sign < 0 )
+            {
+                if( itr != _nodes.end() && itr->second.out.empty() && itr->second.in.empty() )
+                {
+                    _nodes.erase( itr );
+                    clear_cache();
+                }
+            }
+            else if( itr == _nodes.end() || itr->second.type != (int)z.type )
+            {
+                _nodes[ z.id._id ].type = (int)z.type;
+                clear_cache();
+            }
+        } );
+
+        _connect_observer = _db.get_mutable_index< zone_connect_index >().add_delta_observer( [this]( const zone_connect_object& c, int sign ) {
+            std::lock_guard< std::mutex > guard( _mutex );
+            clear_cache();
+            if( !_built )
+                return;
+            if( sign > 0 )
+                add_connect( c.from._id, c.to._id );
+            else
+                remove_connect( c.from._id, c.to._id );
+        } );
+
+        _attached = true;
+        _built = false;
+        _nodes.clear();
+        clear_cache();
+    }
+    //=============================================================================
+    void zone_router::detach()
+    {
+        std::lock_guard< std::mutex > guard( _mutex );
+        if( !_attached )
+            return;
+
+        if( _db.has_index< zone_index >() )
+            _db.get_mutable_index< zone_index >().remove_delta_observer( _zone_observer );
+        if( _db.has_index< zone_connect_index >() )
+            _db.get_mutable_index< zone_connect_index >().remove_delta_observer( _connect_observer );
+
+        _attached = false;
+        _built = false;
+        _nodes.clear();
+        clear_cache();
+    }
+    //=============================================================================
+    void zone_router::set_cache_capacity( uint32_t capacity )
+    {
+        std::lock_guard< std::mutex > guard( _mutex );
+        _cache_capacity = capacity;
+        while( _cache.size() > _cache_capacity )
+        {
+            _cache.erase( _lru.back() );
+            _lru.pop_back();
+        }
+    }
+    //=============================================================================
+    void zone_router::build()
+    {
+        _nodes.clear();
+
+        const auto& zone_idx = _db.get_index< zone_index, by_id >();
+        for( const auto& z : zone_idx )
+            _nodes[ z.id._id ].type = (int)z.type;
+
+        const auto& connect_idx = _db.get_index< zone_connect_index, by_id >();
+        for( const auto& c : connect_idx )
+            add_connect( c.from._id, c.to._id );
+
+        _built = true;
+    }
+    //=============================================================================
+    void zone_router::add_connect( int64_t from, int64_t to )
+    {
+        insert_sorted( _nodes[ from ].out, to );
+        insert_sorted( _nodes[ to ].in, from );
+    }
+    //=============================================================================
+    void zone_router::remove_connect( int64_t from, int64_t to )
+    {
+        erase_sorted( _nodes[ from ].out, to );
+        erase_sorted( _nodes[ to ].in, from );
+    }
+    //=============================================================================
+    void zone_router::clear_cache()
+    {
+        _cache.clear();
+        _lru.clear();
+    }
+    //=============================================================================
+    uint64_t zone_router::weight( int64_t zone )const
+    {
+        auto itr = _nodes.find( zone );
+        FC_ASSERT( itr != _nodes.end() && itr->second.type >= 0 && itr->second.type < (int)_moving_difficulty.size(), "区域#${z}的类型没有对应的移动难度", ("z", zone) );
+        return _moving_difficulty[ itr->second.type ];
+    }
+    //=============================================================================
+    zone_route zone_router::find_route( zone_id_type from, zone_id_type to, const std::vector< int >& moving_difficulty )
+    {
+        std::lock_guard< std::mutex > guard( _mutex );
+
+        if( !_built )
+            build();
+
+        if( moving_difficulty != _moving_difficulty )
+        {
+            _moving_difficulty = moving_difficulty;
+            clear_cache();
+        }
+
+        route_key key( from._id, to._id );
+        auto itr = _cache.find( key );
+        if( itr != _cache.end() )
+        {
+            ++_hits;
+            _lru.splice( _lru.begin(), _lru, itr->second.lru_itr );
+            return itr->second.route;
+        }
+
+        ++_misses;
+        zone_route route = search( from._id, to._id );
+
+        if( _cache_capacity > 0 )
+        {
+            if( _cache.size() >= _cache_capacity )
+            {
+                _cache.erase( _lru.back() );
+                _lru.pop_back();
+            }
+            _lru.push_front( key );
+            _cache[ key ] = cache_entry{ route, _lru.begin() };
+        }
+
+        return route;
+    }
+    //=============================================================================
+    zone_route zone_router::search( int64_t from, int64_t to )const
+    {
+        zone_route route;
+        if( _nodes.find( from ) == _nodes.end() || _nodes.find( to ) == _nodes.end() )
+            return route;
+
+        if( from == to )
+        {
+            route.found = true;
+            return route;
+        }
+
+        //双向Dijkstra：正向从起点沿出边搜索，反向从终点沿入边搜索，边u->v的权重为weight(v)。
+        //best为已知最短路线的天数，两侧队首天数之和不小于best时停止。
+        //搜索顺序只由图和区域ID决定，search_cost在各节点上相同
+        std::unordered_map< int64_t, uint64_t > dist_f, dist_b;
+        std::unordered_map< int64_t, int64_t > parent_f, parent_b;
+        std::unordered_map< int64_t, bool > done_f, done_b;
+        min_queue queue_f, queue_b;
+
+        dist_f[ from ] = 0;
+        dist_b[ to ] = 0;
+        queue_f.push( queue_item( 0, from ) );
+        queue_b.push( queue_item( 0, to ) );
+
+        uint64_t best = std::numeric_limits< uint64_t >::max();
+        int64_t meet_u = -1, meet_v = -1;
+
+        while( !queue_f.empty() && !queue_b.empty() )
+        {
+            if( best != std::numeric_limits< uint64_t >::max() && queue_f.top().first + queue_b.top().first >= best )
+                break;
+
+            if( queue_f.top().first <= queue_b.top().first )
+            {
+                queue_item item = queue_f.top();
+                queue_f.pop();
+                int64_t u = item.second;
+                if( done_f[ u ] || item.first > dist_f[ u ] )
+                    continue;
+                done_f[ u ] = true;
+                ++route.search_cost;
+
+                for( int64_t v : _nodes.at( u ).out )
+                {
+                    ++route.search_cost;
+                    uint64_t d = item.first + weight( v );
+                    auto dv = dist_f.find( v );
+                    if( dv == dist_f.end() || d < dv->second )
+                    {
+                        dist_f[ v ] = d;
+                        parent_f[ v ] = u;
+                        queue_f.push( queue_item( d, v ) );
+                    }
+
+                    auto bv = dist_b.find( v );
+                    if( bv != dist_b.end() && d + bv->second < best )
+                    {
+                        best = d + bv->second;
+                        meet_u = u;
+                        meet_v = v;
+                    }
+                }
+            }
+            else
+            {
+                queue_item item = queue_b.top();
+                queue_b.pop();
+                int64_t v = item.second;
+                if( done_b[ v ] || item.first > dist_b[ v ] )
+                    continue;
+                done_b[ v ] = true;
+                ++route.search_cost;
+
+                uint64_t w = weight( v );
+                for( int64_t u : _nodes.at( v ).in )
+                {
+                    ++route.search_cost;
+                    uint64_t d = item.first + w;
+                    auto du = dist_b.find( u );
+                    if( du == dist_b.end() || d < du->second )
+                    {
+                        dist_b[ u ] = d;
+                        parent_b[ u ] = v;
+                        queue_b.push( queue_item( d, u ) );
+                    }
+
+                    auto fu = dist_f.find( u );
+                    if( fu != dist_f.end() && fu->second + d < best )
+                    {
+                        best = fu->second + d;
+                        meet_u = u;
+                        meet_v = v;
+                    }
+                }
+            }
+        }
+
+        if( meet_u < 0 )
+            return route;
+
+        //起点到meet_u，边meet_u->meet_v，meet_v到终点
+        std::vector< int64_t > head;
+        for( int64_t z = meet_u; z != from; z = parent_f.at( z ) )
+            head.push_back( z );
+        std::reverse( head.begin(), head.end() );
+
+        for( int64_t z : head )
+            route.zones.push_back( zone_id_type( z ) );
+        for( int64_t z = meet_v; ; z = parent_b.at( z ) )
+        {
+            route.zones.push_back( zone_id_type( z ) );
+            if( z == to )
+                break;
+        }
+
+        for( const auto& z : route.zones )
+            route.moving_days += weight( z._id );
+        route.found = true;
+
+        return route;
+    }
+
+} } // taiyi::chain
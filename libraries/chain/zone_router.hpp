@@ -0,0 +1,100 @@
+#pragma once
+
+#include <chain/taiyi_object_types.hpp>
+
+#include <atomic>
+#include <list>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace taiyi { namespace chain {
+
+    class database;
+
+    /** 两个区域之间的最短路线 */
+    struct zone_route
+    {
+        bool                            found = false;
+        uint64_t                        moving_days = 0;    ///< 沿路线移动的总天数
+        std::vector< zone_id_type >     zones;              ///< 依次途经的区域，不含起点，含终点
+        uint64_t                        search_cost = 0;    ///< 寻路的计算量，确定的区域数加松弛的连接数，随路线缓存
+    };
+
+    /**
+     * 区域寻路
+     *
+     * 区域连接是单向的，从a移动到b的天数由b的类型决定（见database::calculate_moving_days_to_zone）。
+     * 路由器在内存中保存连接的邻接表和每个区域的类型，通过索引的delta_observer随连接创建、区域类型修改以及撤销增量维护，
+     * 注册观察者后第一次查询时从索引完整构建。查询使用双向Dijkstra，最近查询的路线保存在LRU缓存中，
+     * 连接变化、区域删除或者区域类型修改时缓存清空。
+     *
+     * 天数相同的路线按区域ID确定地选择，同一状态下的查询结果（包括search_cost）与是否命中缓存无关，可以在合约中使用
+     */
+    class zone_router
+    {
+    public:
+        zone_router( database& db );
+        ~zone_router();
+
+        /** 在区域和连接索引上注册观察者，需要在索引创建后、持有写锁时调用 */
+        void attach();
+        void detach();
+
+        /** 缓存的路线数量上限，为0时不缓存 */
+        void set_cache_capacity( uint32_t capacity );
+
+        /**
+         * 查找从from到to移动天数最少的路线，moving_difficulty为各区域类型的移动天数（tiandao_property_object::zone_moving_difficulty_map）。
+         * 需要持有数据库的读锁或写锁
+         */
+        zone_route find_route( zone_id_type from, zone_id_type to, const std::vector< int >& moving_difficulty );
+
+        uint64_t get_cache_hits()const { return _hits; }
+        uint64_t get_cache_misses()const { return _misses; }
+
+    private:
+        struct zone_node
+        {
+            int                     type = 0;
+            std::vector< int64_t >  out;    ///< 按ID排序
+            std::vector< int64_t >  in;     ///< 按ID排序
+        };
+
+        typedef std::pair< int64_t, int64_t > route_key;
+
+        struct cache_entry
+        {
+            zone_route                      route;
+            std::list< route_key >::iterator  lru_itr;
+        };
+
+        void build();
+        void add_connect( int64_t from, int64_t to );
+        void remove_connect( int64_t from, int64_t to );
+        void clear_cache();
+
+        zone_route search( int64_t from, int64_t to )const;
+        uint64_t weight( int64_t zone )const;
+
+        database&                                   _db;
+
+        std::mutex                                  _mutex;
+        bool                                        _attached = false;
+        bool                                        _built = false;
+        uint32_t                                    _zone_observer = 0;
+        uint32_t                                    _connect_observer = 0;
+        std::unordered_map< int64_t, zone_node >    _nodes;
+        std::vector< int >                          _moving_difficulty;
+
+        uint32_t                                    _cache_capacity = 0;
+        std::map< route_key, cache_entry >          _cache;
+        std::list< route_key >                      _lru;   ///< 最近使用的在前
+
+        std::atomic< uint64_t >                     _hits;
+        std::atomic< uint64_t >                     _misses;
+    };
+
+} } // taiyi::chain
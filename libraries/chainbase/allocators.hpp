@@ -12,6 +12,7 @@
 #include <boost/interprocess/sync/sharable_lock.hpp>
 #include <boost/interprocess/sync/file_lock.hpp>
 
+#include <boost/pool/pool_alloc.hpp>
 #include <boost/thread.hpp>
 #include <boost/thread/locks.hpp>
 
@@ -22,6 +23,13 @@ namespace chainbase {
 
     template< typename T >
     using allocator = std::allocator< T >;
+
+    /**
+     * Allocator for the nodes of undo state containers. Freed nodes go back to a pool shared by
+     * all undo states of the same node size, so the undo sessions of later blocks reuse them.
+     */
+    template< typename T >
+    using undo_node_allocator = boost::fast_pool_allocator< T >;
     
     typedef boost::shared_mutex read_write_mutex;
     typedef boost::shared_lock< read_write_mutex > read_lock;
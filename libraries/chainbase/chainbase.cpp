@@ -57,7 +57,7 @@ namespace chainbase {
         _database_cfg = database_cfg;
         
         for( auto& item : _index_list )
-            item->open( _data_dir, _database_cfg );
+            item->open( _data_dir, get_index_configuration( item->value_type_name() ) );
         
         _is_open = true;
     }
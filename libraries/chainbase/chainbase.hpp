@@ -24,10 +24,13 @@
 
 #include <array>
 #include <atomic>
+#include <deque>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <stdexcept>
 #include <typeindex>
+#include <vector>
 #include <typeinfo>
 
 #ifndef CHAINBASE_NUM_RW_LOCKS
@@ -53,6 +56,15 @@ namespace helpers
         size_t      _item_additional_allocation = 0;
         /// Additional memory used for container internal structures (like tree nodes).
         size_t      _additional_container_allocation = 0;
+        /// Entries held by all undo states of the index (old, removed and new objects)
+        size_t      _undo_state_items = 0;
+        /// Memory held by all undo states of the index, including the serialized old values
+        size_t      _undo_state_allocation = 0;
+        /// Part of _undo_state_allocation held by serialized old values
+        size_t      _undo_state_packed_allocation = 0;
+        /// Objects held in the object cache of the index and its capacity, 0 for in-memory indices
+        size_t      _cache_usage = 0;
+        size_t      _cache_size = 0;
     };
 
     template <class IndexType>
@@ -128,24 +140,38 @@ namespace chainbase {
     template<typename Constructor, typename Allocator>  \
     OBJECT_TYPE( Constructor&& c, Allocator&&  ) { c(*this); }
     
+    /**
+     * Decides how the undo state remembers the value of an object before its first modification
+     * in a revision. By default a full copy is kept. This may be specialized for objects owning
+     * large dynamic containers: when encode returns true only the serialized bytes are kept and
+     * decode writes them back into an existing object on undo.
+     */
+    template< typename value_type >
+    struct undo_value_encoder
+    {
+        static bool encode( const value_type&, std::vector< char >& ) { return false; }
+        static void decode( const std::vector< char >&, value_type& ) {}
+    };
+    
     template< typename value_type >
     class undo_state
     {
     public:
-        typedef typename value_type::id_type                      id_type;
-        typedef allocator< std::pair<const id_type, value_type> > id_value_allocator_type;
-        typedef allocator< id_type >                              id_allocator_type;
+        typedef typename value_type::id_type                                      id_type;
+        typedef undo_node_allocator< std::pair<const id_type, value_type> >       id_value_allocator_type;
+        typedef undo_node_allocator< std::pair<const id_type, std::vector<char> > > id_bytes_allocator_type;
+        typedef undo_node_allocator< id_type >                                    id_allocator_type;
         
+        /// Undo state nodes come from a pool shared by the undo states, not from the index allocator
         template<typename T>
-        undo_state( allocator<T> al )
-        :old_values( id_value_allocator_type( al ) ),
-        removed_values( id_value_allocator_type( al ) ),
-        new_ids( id_allocator_type( al ) ){}
+        undo_state( allocator<T> ) {}
         
-        typedef boost::interprocess::map< id_type, value_type, std::less<id_type>, id_value_allocator_type >  id_value_type_map;
-        typedef boost::interprocess::set< id_type, std::less<id_type>, id_allocator_type >                    id_type_set;
+        typedef boost::interprocess::map< id_type, value_type, std::less<id_type>, id_value_allocator_type >          id_value_type_map;
+        typedef boost::interprocess::map< id_type, std::vector<char>, std::less<id_type>, id_bytes_allocator_type >   id_bytes_map;
+        typedef boost::interprocess::set< id_type, std::less<id_type>, id_allocator_type >                            id_type_set;
         
         id_value_type_map            old_values;
+        id_bytes_map                 old_packed;    ///< old values stored by undo_value_encoder
         id_value_type_map            removed_values;
         id_type_set                  new_ids;
         id_type                      old_next_id = 0;
@@ -193,6 +219,7 @@ namespace chainbase {
         typedef typename index_type::value_type                       value_type;
         typedef allocator< generic_index >                            allocator_type;
         typedef undo_state< value_type >                              undo_state_type;
+        typedef typename value_type::id_type                          id_type;
         
         generic_index( allocator<value_type> a, bfs::path p ) :_stack(a),_indices( a, p ),_size_of_value_type( sizeof(typename MultiIndexType::value_type) ),_size_of_this(sizeof(*this))
         {
@@ -232,27 +259,57 @@ namespace chainbase {
             _indices.set_next_id( _next_id );
             
             on_create( *insert_result.first );
+            notify_delta( *insert_result.first, 1 );
             return *insert_result.first;
         }
 
         template<typename Modifier>
         void modify( const value_type& obj, Modifier&& m ) {
+            notify_delta( obj, -1 );
             on_modify( obj );
             auto ok = _indices.modify( _indices.iterator_to( obj ), m );
             if( !ok ) BOOST_THROW_EXCEPTION( std::logic_error( "Could not modify object, most likely a uniqueness constraint was violated" ) );
+            notify_delta( obj, 1 );
         }
         
         void remove( const value_type& obj ) {
+            notify_delta( obj, -1 );
             on_remove( obj );
             _indices.erase( _indices.iterator_to( obj ) );
         }
 
         template< typename ByIndex, typename IterType >
         IterType erase( IterType objI ) {
+            notify_delta( *objI, -1 );
             on_remove( *objI );
             return _indices.template mutable_get< ByIndex >().erase( objI );
         }
         
+        /**
+         * Delta observers are called with -1 before an object is modified or removed and with +1 after
+         * it was created or modified, including the changes made by undo, so aggregates over the index
+         * can be maintained incrementally. Loading the index (open) and clear() are not observed.
+         */
+        typedef std::function< void( const value_type&, int ) > delta_observer;
+        
+        uint32_t add_delta_observer( delta_observer o )
+        {
+            _delta_observers.emplace_back( ++_last_delta_observer, std::move( o ) );
+            return _last_delta_observer;
+        }
+        
+        void remove_delta_observer( uint32_t handle )
+        {
+            for( auto itr = _delta_observers.begin(); itr != _delta_observers.end(); ++itr )
+            {
+                if( itr->first == handle )
+                {
+                    _delta_observers.erase( itr );
+                    return;
+                }
+            }
+        }
+        
         template<typename CompatibleKey>
         const value_type* find( CompatibleKey&& key )const {
             auto itr = _indices.find( std::forward<CompatibleKey>(key) );
@@ -366,20 +423,46 @@ namespace chainbase {
         void undo() {
             if( !enabled() ) return;
             
-            const auto& head = _stack.back();
+            auto& head = _stack.back();
             
             for( auto& item : head.old_values ) {
                 bool ok = false;
                 auto itr = _indices.find( item.second.id );
                 if( itr != _indices.end() )
                 {
+                    notify_delta( *itr, -1 );
                     ok = _indices.modify( itr, [&]( value_type& v ) {
                         v = std::move( item.second );
                     });
+                    if( ok ) notify_delta( *itr, 1 );
                 }
                 else
                 {
-                    ok = _indices.emplace( std::move( item.second ) ).second;
+                    auto insert_result = _indices.emplace( std::move( item.second ) );
+                    ok = insert_result.second;
+                    if( ok ) notify_delta( *insert_result.first, 1 );
+                }
+                
+                if( !ok ) BOOST_THROW_EXCEPTION( std::logic_error( "Could not modify object, most likely a uniqueness constraint was violated" ) );
+            }
+            
+            for( const auto& item : head.old_packed ) {
+                bool ok = false;
+                auto decode = [&]( value_type& v ) {
+                    undo_value_encoder< value_type >::decode( item.second, v );
+                };
+                auto itr = _indices.find( item.first );
+                if( itr != _indices.end() )
+                {
+                    notify_delta( *itr, -1 );
+                    ok = _indices.modify( itr, decode );
+                    if( ok ) notify_delta( *itr, 1 );
+                }
+                else
+                {
+                    auto insert_result = _indices.emplace( decode, _indices.get_allocator() );
+                    ok = insert_result.second;
+                    if( ok ) notify_delta( *insert_result.first, 1 );
                 }
                 
                 if( !ok ) BOOST_THROW_EXCEPTION( std::logic_error( "Could not modify object, most likely a uniqueness constraint was violated" ) );
@@ -387,14 +470,17 @@ namespace chainbase {
             
             for( const auto& id : head.new_ids )
             {
-                _indices.erase( _indices.find( id ) );
+                auto itr = _indices.find( id );
+                notify_delta( *itr, -1 );
+                _indices.erase( itr );
             }
             _next_id = head.old_next_id;
             _indices.set_next_id( _next_id );
             
             for( auto& item : head.removed_values ) {
-                bool ok = _indices.emplace( std::move( item.second ) ).second;
-                if( !ok ) BOOST_THROW_EXCEPTION( std::logic_error( "Could not restore object, most likely a uniqueness constraint was violated" ) );
+                auto insert_result = _indices.emplace( std::move( item.second ) );
+                if( !insert_result.second ) BOOST_THROW_EXCEPTION( std::logic_error( "Could not restore object, most likely a uniqueness constraint was violated" ) );
+                notify_delta( *insert_result.first, 1 );
             }
             
             _stack.pop_back();
@@ -462,14 +548,21 @@ namespace chainbase {
             
             // We can only be outside type A/AB (the nop path) if B is not nop, so it suffices to iterate through B's three containers.
             
-            for( const auto& item : state.old_values )
+            // Serialized old values (old_packed) are upd entries too, an object is in at most one of
+            // old_values and old_packed of a state.
+            auto is_updated = [&]( const id_type& id ) {
+                return prev_state.old_values.find( id ) != prev_state.old_values.end()
+                    || prev_state.old_packed.find( id ) != prev_state.old_packed.end();
+            };
+            
+            for( auto& item : state.old_values )
             {
                 if( prev_state.new_ids.find( item.second.id ) != prev_state.new_ids.end() )
                 {
                     // new+upd -> new, type A
                     continue;
                 }
-                if( prev_state.old_values.find( item.second.id ) != prev_state.old_values.end() )
+                if( is_updated( item.second.id ) )
                 {
                     // upd(was=X) + upd(was=Y) -> upd(was=X), type A
                     continue;
@@ -477,7 +570,17 @@ namespace chainbase {
                 // del+upd -> N/A
                 assert( prev_state.removed_values.find(item.second.id) == prev_state.removed_values.end() );
                 // nop+upd(was=Y) -> upd(was=Y), type B
-                prev_state.old_values.emplace( std::move(item) );
+                prev_state.old_values.emplace( item.first, std::move( item.second ) );
+            }
+            
+            for( auto& item : state.old_packed )
+            {
+                if( prev_state.new_ids.find( item.first ) != prev_state.new_ids.end() )
+                    continue;
+                if( is_updated( item.first ) )
+                    continue;
+                assert( prev_state.removed_values.find( item.first ) == prev_state.removed_values.end() );
+                prev_state.old_packed.emplace( item.first, std::move( item.second ) );
             }
 
             // *+new, but we assume the N/A cases don't happen, leaving type B nop+new -> new
@@ -501,6 +604,15 @@ namespace chainbase {
                     prev_state.old_values.erase(obj.second.id);
                     continue;
                 }
+                auto pit = prev_state.old_packed.find(obj.second.id);
+                if( pit != prev_state.old_packed.end() )
+                {
+                    // upd(was=X) + del(was=Y) -> del(was=X), X is restored from its serialized form into Y
+                    undo_value_encoder< value_type >::decode( pit->second, obj.second );
+                    prev_state.removed_values.emplace( std::move(obj) );
+                    prev_state.old_packed.erase(pit);
+                    continue;
+                }
                 // del + del -> N/A
                 assert( prev_state.removed_values.find( obj.second.id ) == prev_state.removed_values.end() );
                 // nop + del(was=Y) -> del(was=Y)
@@ -533,6 +645,80 @@ namespace chainbase {
                 undo();
         }
 
+        /**
+         * Adds the entries and memory held by the undo stack to info. Copied objects are counted by
+         * their sizeof only, like the items of the index itself.
+         */
+        void gather_undo_statistics( helpers::index_statistic_info& info )const
+        {
+            const size_t node_overhead = 4 * sizeof( void* );
+            for( const auto& state : _stack )
+            {
+                size_t copies = state.old_values.size() + state.removed_values.size();
+                info._undo_state_items += copies + state.old_packed.size() + state.new_ids.size();
+                info._undo_state_allocation += copies * ( sizeof( typename undo_state_type::id_value_type_map::value_type ) + node_overhead );
+                info._undo_state_allocation += state.new_ids.size() * ( sizeof( id_type ) + node_overhead );
+                for( const auto& item : state.old_packed )
+                {
+                    info._undo_state_allocation += sizeof( item ) + node_overhead + item.second.capacity();
+                    info._undo_state_packed_allocation += item.second.capacity();
+                }
+            }
+        }
+        
+        /**
+         * Number of objects created, modified or removed in the newest undo state, 0 without undo state.
+         */
+        size_t head_change_count()const
+        {
+            if( !enabled() )
+                return 0;
+            const auto& head = _stack.back();
+            return head.new_ids.size() + head.old_values.size() + head.old_packed.size() + head.removed_values.size();
+        }
+
+        /**
+         * Visits the changes recorded in the newest undo state: created objects with their current value,
+         * modified objects with the value before their first modification and the current value, removed
+         * objects with their value before the undo state began. Objects are passed by reference into the
+         * index and the undo state; only old values kept serialized by undo_value_encoder are decoded,
+         * into objects appended to decoded, which the caller keeps alive as long as it uses them.
+         */
+        template< typename OnCreated, typename OnModified, typename OnRemoved >
+        void visit_head_changes( std::deque< value_type >& decoded, OnCreated&& on_created, OnModified&& on_modified, OnRemoved&& on_removed )const
+        {
+            if( !enabled() )
+                return;
+            const auto& head = _stack.back();
+
+            for( const auto& id : head.new_ids )
+            {
+                auto itr = _indices.find( id );
+                if( itr != _indices.end() )
+                    on_created( *itr );
+            }
+
+            for( const auto& item : head.old_values )
+            {
+                auto itr = _indices.find( item.first );
+                if( itr != _indices.end() )
+                    on_modified( item.second, *itr );
+            }
+
+            for( const auto& item : head.old_packed )
+            {
+                auto itr = _indices.find( item.first );
+                if( itr == _indices.end() )
+                    continue;
+                decoded.emplace_back( *itr );
+                undo_value_encoder< value_type >::decode( item.second, decoded.back() );
+                on_modified( decoded.back(), *itr );
+            }
+
+            for( const auto& item : head.removed_values )
+                on_removed( item.second );
+        }
+
         void set_revision( int64_t revision )
         {
             if( _stack.size() != 0 ) BOOST_THROW_EXCEPTION( std::logic_error("cannot set revision while there is an existing undo stack") );
@@ -556,6 +742,16 @@ namespace chainbase {
             if( itr != head.old_values.end() )
                 return;
             
+            if( head.old_packed.find( v.id ) != head.old_packed.end() )
+                return;
+            
+            std::vector< char > packed;
+            if( undo_value_encoder< value_type >::encode( v, packed ) )
+            {
+                head.old_packed.emplace( v.id, std::move( packed ) );
+                return;
+            }
+            
             head.old_values.emplace( std::pair< typename value_type::id_type, const value_type& >( v.id, v ) );
         }
         
@@ -575,6 +771,14 @@ namespace chainbase {
                 return;
             }
             
+            auto pitr = head.old_packed.find( v.id );
+            if( pitr != head.old_packed.end() ) {
+                auto removed = head.removed_values.emplace( std::pair< typename value_type::id_type, const value_type& >( v.id, v ) ).first;
+                undo_value_encoder< value_type >::decode( pitr->second, removed->second );
+                head.old_packed.erase( pitr );
+                return;
+            }
+            
             if( head.removed_values.count( v.id ) )
                 return;
             
@@ -588,7 +792,14 @@ namespace chainbase {
             head.new_ids.insert( v.id );
         }
         
+        void notify_delta( const value_type& v, int sign )const {
+            for( const auto& o : _delta_observers )
+                o.second( v, sign );
+        }
+        
         boost::interprocess::deque< undo_state_type, allocator<undo_state_type> > _stack;
+        std::vector< std::pair< uint32_t, delta_observer > > _delta_observers;
+        uint32_t                                              _last_delta_observer = 0;
         
         /**
          *  Each new session increments the revision, a squash will decrement the revision by combining
@@ -652,6 +863,7 @@ namespace chainbase {
         virtual void    commit( int64_t revision )const = 0;
         virtual void    undo_all()const = 0;
         virtual uint32_t type_id()const  = 0;
+        virtual std::string value_type_name()const = 0;
         
         virtual statistic_info get_statistics(bool onlyStaticInfo) const = 0;
         virtual size_t size() const = 0;
@@ -699,12 +911,20 @@ namespace chainbase {
         virtual void     commit( int64_t revision )const  override { _base.commit(revision); }
         virtual void     undo_all() const override {_base.undo_all(); }
         virtual uint32_t type_id()const override { return BaseIndex::value_type::type_id; }
+        virtual std::string value_type_name()const override { return boost::core::demangle( typeid( typename BaseIndex::value_type ).name() ); }
         
         virtual statistic_info get_statistics(bool onlyStaticInfo) const override final
         {
             typedef typename BaseIndex::index_type index_type;
             helpers::index_statistic_provider<index_type> provider;
-            return provider.gather_statistics(_base.indices(), onlyStaticInfo);
+            statistic_info info = provider.gather_statistics(_base.indices(), onlyStaticInfo);
+            _base.gather_undo_statistics( info );
+            if( !onlyStaticInfo )
+            {
+                info._cache_usage = _base.get_cache_usage();
+                info._cache_size = _base.get_cache_size();
+            }
+            return info;
         }
         
         virtual size_t size() const override final
@@ -837,6 +1057,12 @@ namespace chainbase {
         };
         
     public:
+        /**
+         * Gives the configuration an index is opened with, from the demangled name of its value type
+         * and the configuration passed to open. Without a resolver every index gets that configuration.
+         */
+        typedef std::function< boost::any( const std::string& value_type_name, const boost::any& database_cfg ) > index_configuration_resolver;
+
         void open( const bfs::path& dir, uint32_t flags = 0, const boost::any& database_cfg = nullptr );
         void close();
         void flush();
@@ -926,9 +1152,25 @@ namespace chainbase {
             for( const auto& i : _index_list ) i->set_revision( revision );
         }
         
-        void print_stats()
+        /** Must be set before the indices are opened */
+        void set_index_configuration_resolver( index_configuration_resolver resolver ) { _index_cfg_resolver = std::move( resolver ); }
+
+        /** The configuration passed to open */
+        const boost::any& get_database_configuration()const { return _database_cfg; }
+
+        boost::any get_index_configuration( const std::string& value_type_name )const
+        {
+            return _index_cfg_resolver ? _index_cfg_resolver( value_type_name, _database_cfg ) : _database_cfg;
+        }
+
+        /** Prints the storage statistics of every index, under the name of its value type */
+        void print_stats()const
         {
-            for( const auto& i : _index_list )  i->print_stats();
+            for( const auto& i : _index_list )
+            {
+                std::cout << i->value_type_name() << ":" << std::endl;
+                i->print_stats();
+            }
         }
         
         template<typename MultiIndexType>
@@ -1198,7 +1440,7 @@ namespace chainbase {
             _index_map[ type_id ].reset( new_index );
             _index_list.push_back( new_index );
             
-            if( _is_open ) new_index->open( _data_dir, _database_cfg );
+            if( _is_open ) new_index->open( _data_dir, get_index_configuration( type_name ) );
         }
         
         read_write_mutex_manager                                    _rw_manager;
@@ -1226,6 +1468,7 @@ namespace chainbase {
         int32_t                                                     _undo_session_count = 0;
         size_t                                                      _file_size = 0;
         boost::any                                                  _database_cfg = nullptr;
+        index_configuration_resolver                                _index_cfg_resolver;
     };
     
 }  // namepsace chainbase
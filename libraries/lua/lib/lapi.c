@@ -736,6 +736,10 @@ LUA_API long long lua_getdrops (lua_State *L) {
   return L->drops;
 }
 
+LUA_API long long lua_getmemdrops (lua_State *L) {
+  return L->memdrops;
+}
+
 
 /*
 ** set functions (stack -> Lua)
@@ -920,6 +924,20 @@ LUA_API int lua_getdropsenabled (lua_State *L) {
     return L->enable_drops;
 }
 
+/*
+** Whether chunks loaded from now on charge drops by basic blocks (the
+** default) or instruction by instruction. Drops charged are the same
+** either way; returns the previous setting.
+*/
+LUA_API int lua_setblockmetering (lua_State *L, int enable) {
+    int pre_enable;
+    lua_lock(L);
+    pre_enable = G(L)->meters.enabled;
+    G(L)->meters.enabled = enable;
+    lua_unlock(L);
+    return pre_enable;
+}
+
 /*
 ** 'load' and 'call' functions (run Lua code)
 */
@@ -1052,6 +1070,57 @@ LUA_API int lua_dump (lua_State *L, lua_Writer writer, void *data, int strip) {
 }
 
 
+/*
+** make an image of the Lua function on the top of the stack; the function
+** must be a main chunk just loaded and not run yet
+*/
+LUA_API lua_ChunkImage *lua_newchunkimage (lua_State *L) {
+  lua_ChunkImage *img = NULL;
+  TValue *o;
+  lua_lock(L);
+  api_checknelems(L, 1);
+  o = L->top - 1;
+  if (ttisLclosure(o))
+    img = luaU_makeimage(clLvalue(o));
+  lua_unlock(L);
+  return img;
+}
+
+
+LUA_API void lua_freechunkimage (lua_ChunkImage *img) {
+  luaU_freeimage(img);
+}
+
+
+LUA_API size_t lua_chunkimagesize (const lua_ChunkImage *img) {
+  return luaU_imagesize(img);
+}
+
+
+/*
+** load a chunk from its image, same result (and same memory usage) as
+** 'lua_load' of the binary chunk the image was made from
+*/
+LUA_API int lua_loadchunkimage (lua_State *L, const lua_ChunkImage *img) {
+  int status;
+  lua_lock(L);
+  status = luaD_protectedloadimage(L, img);
+  if (status == LUA_OK) {  /* no errors? */
+    LClosure *f = clLvalue(L->top - 1);  /* get newly created function */
+    if (f->nupvalues >= 1) {  /* does it have an upvalue? */
+      /* get global table from registry */
+      Table *reg = hvalue(&G(L)->l_registry);
+      const TValue *gt = luaH_getint(reg, LUA_RIDX_GLOBALS);
+      /* set global table as 1st upvalue of 'f' (may be LUA_ENV) */
+      setobj(L, f->upvals[0]->v, gt);
+      luaC_upvalbarrier(L, f->upvals[0]);
+    }
+  }
+  lua_unlock(L);
+  return status;
+}
+
+
 LUA_API int lua_status (lua_State *L) {
   return L->status;
 }
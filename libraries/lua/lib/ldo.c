@@ -800,3 +800,43 @@ int luaD_protectedparser (lua_State *L, ZIO *z, const char *name,
 }
 
 
+/*
+** Execute a protected load of a chunk image. Parser buffers are set up
+** and released as in 'luaD_protectedparser', so both ways of loading a
+** chunk make the same calls to the allocator.
+*/
+struct SImage {  /* data to 'f_loadimage' */
+  const lua_ChunkImage *img;
+  Mbuffer buff;
+  Dyndata dyd;
+};
+
+
+static void f_loadimage (lua_State *L, void *ud) {
+  LClosure *cl;
+  struct SImage *p = cast(struct SImage *, ud);
+  cl = luaU_loadimage(L, p->img);
+  lua_assert(cl->nupvalues == cl->p->sizeupvalues);
+  luaF_initupvals(L, cl);
+}
+
+
+int luaD_protectedloadimage (lua_State *L, const lua_ChunkImage *img) {
+  struct SImage p;
+  int status;
+  L->nny++;  /* cannot yield during loading */
+  p.img = img;
+  p.dyd.actvar.arr = NULL; p.dyd.actvar.size = 0;
+  p.dyd.gt.arr = NULL; p.dyd.gt.size = 0;
+  p.dyd.label.arr = NULL; p.dyd.label.size = 0;
+  luaZ_initbuffer(L, &p.buff);
+  status = luaD_pcall(L, f_loadimage, &p, savestack(L, L->top), L->errfunc);
+  luaZ_freebuffer(L, &p.buff);
+  luaM_freearray(L, p.dyd.actvar.arr, p.dyd.actvar.size);
+  luaM_freearray(L, p.dyd.gt.arr, p.dyd.gt.size);
+  luaM_freearray(L, p.dyd.label.arr, p.dyd.label.size);
+  L->nny--;
+  return status;
+}
+
+
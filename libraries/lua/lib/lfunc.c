@@ -10,7 +10,9 @@
 #include "lprefix.h"
 
 
+#include <limits.h>
 #include <stddef.h>
+#include <string.h>
 
 #include "lua.h"
 
@@ -18,6 +20,7 @@
 #include "lgc.h"
 #include "lmem.h"
 #include "lobject.h"
+#include "lopcodes.h"
 #include "lstate.h"
 
 
@@ -118,11 +121,20 @@ Proto *luaF_newproto (lua_State *L) {
   f->linedefined = 0;
   f->lastlinedefined = 0;
   f->source = NULL;
+  f->meterslot = 0;
   return f;
 }
 
 
 void luaF_freeproto (lua_State *L, Proto *f) {
+  if (f->meterslot != 0) {
+    global_State *g = G(L);
+    (*g->frealloc)(g->ud, g->meters.meter[f->meterslot],
+                   f->sizecode * sizeof(BlockMeter), 0);
+    g->meters.meter[f->meterslot] = NULL;
+    if (f->meterslot < g->meters.firstfree)
+      g->meters.firstfree = f->meterslot;
+  }
   luaM_freearray(L, f->code, f->sizecode);
   luaM_freearray(L, f->p, f->sizep);
   luaM_freearray(L, f->k, f->sizek);
@@ -133,6 +145,194 @@ void luaF_freeproto (lua_State *L, Proto *f) {
 }
 
 
+/*
+** {======================================================
+** Drop meters
+** =======================================================
+**
+** 'luaV_execute' charges OP_DROPS[op] for every instruction it fetches.
+** The meter of a prototype has, for every instruction, the sum of
+** OP_DROPS and the number of instructions from it to the end of its
+** basic block, so the interpreter can charge a whole block when it
+** enters it and then only count down the instructions left in the
+** block. All instructions of a block but the
+** last are 'straight': they always go on to the next instruction, and
+** their fast paths cannot raise errors, call functions or allocate
+** memory. When a straight instruction leaves its fast path (a
+** metamethod, an error), the interpreter first gives back the drops of
+** the rest of the block and charges it instruction by instruction (see
+** 'leaveblock' in lvm.c). So nothing can look at 'L->drops' while a
+** block is charged ahead and, as a block is only charged ahead when the
+** drops left cover all of it, the drops left at any point are the same
+** as when charging instruction by instruction.
+**
+** Meters are allocated directly with 'frealloc': they do not count as
+** memory used by the state (which is charged in drops too) and do not
+** change GC pacing.
+*/
+
+
+/* limit for the drops of one block; longer runs are split */
+#define MAXBLOCKDROPS	(UINT_MAX / 2)
+
+
+/* instruction that always goes on to the next one; the slow paths of
+   those that have one start with 'leaveblock' */
+static int isstraight (Instruction i) {
+  switch (GET_OPCODE(i)) {
+    case OP_MOVE: case OP_LOADK: case OP_LOADNIL: case OP_NOT:
+    case OP_GETUPVAL: case OP_SETUPVAL:
+    case OP_GETTABUP: case OP_GETTABLE: case OP_SELF:
+    case OP_SETTABUP: case OP_SETTABLE:
+    case OP_ADD: case OP_SUB: case OP_MUL: case OP_MOD: case OP_POW:
+    case OP_DIV: case OP_IDIV: case OP_BAND: case OP_BOR: case OP_BXOR:
+    case OP_SHL: case OP_SHR: case OP_UNM: case OP_BNOT:
+      return 1;
+    case OP_LOADBOOL:
+      return GETARG_C(i) == 0;
+    default:
+      return 0;
+  }
+}
+
+
+/* instruction that may skip the one after it */
+static int skipsnext (Instruction i) {
+  switch (GET_OPCODE(i)) {
+    case OP_LOADKX: case OP_EQ: case OP_LT: case OP_LE:
+    case OP_TEST: case OP_TESTSET:
+      return 1;
+    case OP_LOADBOOL:
+      return GETARG_C(i) != 0;
+    case OP_SETLIST:
+      return GETARG_C(i) == 0;
+    default:
+      return 0;
+  }
+}
+
+
+static int newmeterslot (global_State *g) {
+  MeterTable *mt = &g->meters;
+  int i;
+  for (i = (mt->firstfree > 0 ? mt->firstfree : 1); i < mt->size; i++) {
+    if (mt->meter[i] == NULL) {
+      mt->firstfree = i + 1;
+      return i;
+    }
+  }
+  if (mt->size <= USHRT_MAX) {  /* may grow? */
+    int newsize = (mt->size == 0) ? 64 : mt->size * 2;
+    BlockMeter **m;
+    if (newsize > USHRT_MAX + 1) newsize = USHRT_MAX + 1;
+    m = (BlockMeter **)(*g->frealloc)(g->ud, mt->meter,
+                                      mt->size * sizeof(BlockMeter *),
+                                      newsize * sizeof(BlockMeter *));
+    if (m != NULL) {
+      i = (mt->size == 0) ? 1 : mt->size;
+      memset(m + mt->size, 0, (newsize - mt->size) * sizeof(BlockMeter *));
+      mt->meter = m;
+      mt->size = newsize;
+      mt->firstfree = i + 1;
+      return i;
+    }
+  }
+  return 0;  /* no slot: prototype will be charged instruction by instruction */
+}
+
+
+static void markleader (lu_byte *leader, int n, int pc) {
+  if (pc >= 0 && pc < n)
+    leader[pc] = 1;
+}
+
+
+/* fill 'meter' for the code of 'f'; 0 if some instruction has no cost */
+static int buildmeter (const Proto *f, BlockMeter *meter, lu_byte *leader) {
+  int n = f->sizecode;
+  int pc;
+  memset(leader, 0, n);
+  leader[0] = 1;
+  for (pc = 0; pc < n; pc++) {
+    Instruction i = f->code[pc];
+    switch (GET_OPCODE(i)) {
+      case OP_JMP: case OP_FORLOOP: case OP_FORPREP: case OP_TFORLOOP:
+        markleader(leader, n, pc + 1 + GETARG_sBx(i));  /* jump target */
+        break;
+      default: break;
+    }
+    if (!isstraight(i)) {
+      markleader(leader, n, pc + 1);
+      if (skipsnext(i))
+        markleader(leader, n, pc + 2);
+    }
+  }
+  for (pc = n - 1; pc >= 0; pc--) {  /* sum up to block ends backwards */
+    long long d = OP_DROPS[GET_OPCODE(f->code[pc])];
+    if (d <= 0 || d > MAXBLOCKDROPS)
+      return 0;
+    meter[pc].drops = (unsigned int)d;
+    meter[pc].len = 1;
+    if (isstraight(f->code[pc]) && pc + 1 < n && !leader[pc + 1]) {
+      if (meter[pc + 1].drops > MAXBLOCKDROPS - meter[pc].drops)
+        leader[pc + 1] = 1;  /* split a block too long */
+      else {
+        meter[pc].drops += meter[pc + 1].drops;
+        meter[pc].len += meter[pc + 1].len;
+      }
+    }
+  }
+  return 1;
+}
+
+
+/*
+** Build the drop meters of a prototype just loaded and of all its
+** nested prototypes. Prototypes without a meter (no free slot, no
+** memory, or meters disabled) are charged instruction by instruction.
+*/
+void luaF_meterproto (lua_State *L, Proto *f) {
+  global_State *g = G(L);
+  BlockMeter *meter;
+  lu_byte *leader;
+  int slot, i;
+  for (i = 0; i < f->sizep; i++)
+    luaF_meterproto(L, f->p[i]);
+  if (!g->meters.enabled || f->meterslot != 0 || f->sizecode == 0)
+    return;
+  slot = newmeterslot(g);
+  if (slot == 0)
+    return;
+  meter = (BlockMeter *)(*g->frealloc)(g->ud, NULL, 0,
+                                       f->sizecode * sizeof(BlockMeter));
+  leader = (lu_byte *)(*g->frealloc)(g->ud, NULL, 0, f->sizecode);
+  if (meter != NULL && leader != NULL && buildmeter(f, meter, leader)) {
+    g->meters.meter[slot] = meter;
+    f->meterslot = cast(unsigned short, slot);
+    meter = NULL;
+  }
+  else if (slot < g->meters.firstfree)
+    g->meters.firstfree = slot;
+  if (meter != NULL)
+    (*g->frealloc)(g->ud, meter, f->sizecode * sizeof(BlockMeter), 0);
+  if (leader != NULL)
+    (*g->frealloc)(g->ud, leader, f->sizecode, 0);
+}
+
+
+/* free the meter table of a state whose prototypes are all freed */
+void luaF_freemeters (lua_State *L) {
+  global_State *g = G(L);
+  if (g->meters.meter != NULL)
+    (*g->frealloc)(g->ud, g->meters.meter,
+                   g->meters.size * sizeof(BlockMeter *), 0);
+  g->meters.meter = NULL;
+  g->meters.size = g->meters.firstfree = 0;
+}
+
+/* }====================================================== */
+
+
 /*
 ** Look for n-th local variable at line 'line' in function 'func'.
 ** Returns NULL if not found.
@@ -47,6 +47,11 @@ struct UpVal {
 #define upisopen(up)	((up)->v != &(up)->u.value)
 
 
+/* drop meter of a prototype, or NULL if it has none */
+#define luaF_getmeter(g,f)  \
+	((f)->meterslot != 0 ? (g)->meters.meter[(f)->meterslot] : NULL)
+
+
 LUAI_FUNC Proto *luaF_newproto (lua_State *L);
 LUAI_FUNC CClosure *luaF_newCclosure (lua_State *L, int nelems);
 LUAI_FUNC LClosure *luaF_newLclosure (lua_State *L, int nelems);
@@ -54,6 +59,8 @@ LUAI_FUNC void luaF_initupvals (lua_State *L, LClosure *cl);
 LUAI_FUNC UpVal *luaF_findupval (lua_State *L, StkId level);
 LUAI_FUNC void luaF_close (lua_State *L, StkId level);
 LUAI_FUNC void luaF_freeproto (lua_State *L, Proto *f);
+LUAI_FUNC void luaF_meterproto (lua_State *L, Proto *f);
+LUAI_FUNC void luaF_freemeters (lua_State *L);
 LUAI_FUNC const char *luaF_getlocalname (const Proto *func, int local_number,
                                          int pc);
 
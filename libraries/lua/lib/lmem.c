@@ -90,6 +90,7 @@ void *luaM_realloc_ (lua_State *L, void *block, size_t osize, size_t nsize) {
   L->memUsed += nsize;
   if(L->enable_drops != 0) {
     L->drops -= (L->memUsed / CONTRACT_MEM_UNIT_SIZE) * CONTRACT_MEN_UNIT_DROP_COST;
+    L->memdrops += (L->memUsed / CONTRACT_MEM_UNIT_SIZE) * CONTRACT_MEN_UNIT_DROP_COST;
     L->memUsed = L->memUsed % CONTRACT_MEM_UNIT_SIZE;
     if (L->drops < 0) {
       luaD_throw(L, LUA_ERRMEM);
@@ -409,6 +409,8 @@ typedef struct Proto {
   lu_byte numparams;  /* number of fixed parameters */
   lu_byte is_vararg;
   lu_byte maxstacksize;  /* number of registers needed by this function */
+  unsigned short meterslot;  /* drop meter in 'g->meters' (0: none); fits
+                                in padding, so 'sizeof(Proto)' is unchanged */
   int sizeupvalues;  /* size of 'upvalues' */
   int sizek;  /* size of 'k' */
   int sizecode;
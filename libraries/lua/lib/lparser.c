@@ -1645,6 +1645,7 @@ LClosure *luaY_parser (lua_State *L, ZIO *z, Mbuffer *buff,
   /* all scopes should be correctly finished */
   lua_assert(dyd->actvar.n == 0 && dyd->gt.n == 0 && dyd->label.n == 0);
   L->top--;  /* remove scanner's table */
+  luaF_meterproto(L, cl->p);
   return cl;  /* closure is on the stack, too */
 }
 
@@ -66,6 +66,14 @@ typedef struct LG {
 } LG;
 
 
+/*
+** Size of the main block as counted in 'totalbytes'. The meter table is
+** left out, so that GC pacing (and what finalizers observe) is the same
+** with and without drop meters.
+*/
+#define countedLG	(sizeof(LG) - sizeof(MeterTable))
+
+
 
 #define fromstate(L)	(cast(LX *, cast(lu_byte *, (L)) - offsetof(LX, l)))
 
@@ -239,6 +247,7 @@ static void preinit_thread (lua_State *L, global_State *g) {
   L->enable_drops = 0;
   L->drops = 0;
   L->memUsed = 0;
+  L->memdrops = 0;
 }
 
 
@@ -251,7 +260,8 @@ static void close_state (lua_State *L) {
     luai_userstateclose(L);
   luaM_freearray(L, G(L)->strt.hash, G(L)->strt.size);
   freestack(L);
-  lua_assert(gettotalbytes(g) == sizeof(LG));
+  luaF_freemeters(L);
+  lua_assert(gettotalbytes(g) == countedLG);
   (*g->frealloc)(g->ud, fromstate(L), sizeof(LG), 0);  /* free main block */
 }
 
@@ -327,11 +337,14 @@ LUA_API lua_State *lua_newstate (lua_Alloc f, void *ud) {
   g->gray = g->grayagain = NULL;
   g->weak = g->ephemeron = g->allweak = NULL;
   g->twups = NULL;
-  g->totalbytes = sizeof(LG);
+  g->totalbytes = countedLG;
   g->GCdebt = 0;
   g->gcfinnum = 0;
   g->gcpause = LUAI_GCPAUSE;
   g->gcstepmul = LUAI_GCMUL;
+  g->meters.meter = NULL;
+  g->meters.size = g->meters.firstfree = 0;
+  g->meters.enabled = 1;
   for (i=0; i < LUA_NUMTAGS; i++) g->mt[i] = NULL;
   if (luaD_rawrunprotected(L, f_luaopen, NULL) != LUA_OK) {
     /* memory allocation error: free partial state */
@@ -131,6 +131,29 @@ typedef struct CallInfo {
 #define getoah(st)	((st) & CIST_OAH)
 
 
+/*
+** Drops and number of instructions from an instruction to the end of its
+** basic block (see 'luaF_meterproto')
+*/
+typedef struct BlockMeter {
+  unsigned int drops;
+  unsigned int len;
+} BlockMeter;
+
+
+/*
+** Drop meters of the prototypes of a state. Slot 0 is never used, so a
+** prototype with 'meterslot' 0 has no meter. Allocated directly with
+** 'frealloc', outside of the memory accounting of the state.
+*/
+typedef struct MeterTable {
+  BlockMeter **meter;  /* meter[i]: meter of the prototype in slot i */
+  int size;  /* size of 'meter' */
+  int firstfree;  /* no free slot below this one */
+  int enabled;  /* build meters for newly loaded prototypes */
+} MeterTable;
+
+
 /*
 ** 'global state', shared by all threads of this state
 */
@@ -169,6 +192,7 @@ typedef struct global_State {
   TString *tmname[TM_N];  /* array with tag-method names */
   struct Table *mt[LUA_NUMTAGS];  /* metatables for basic types */
   TString *strcache[STRCACHE_N][STRCACHE_M];  /* cache for strings in API */
+  MeterTable meters;  /* drop meters of prototypes (see 'luaF_meterproto') */
 } global_State;
 
 
@@ -202,6 +226,7 @@ struct lua_State {
   int enable_drops;
   long long drops;
   size_t memUsed;
+  long long memdrops;  /* drops charged for memory since the thread was created */
 };
 
 
@@ -118,6 +118,12 @@ typedef const char * (*lua_Reader) (lua_State *L, void *ud, size_t *sz);
 typedef int (*lua_Writer) (lua_State *L, const void *p, size_t sz, void *ud);
 
 
+/*
+** Decoded image of a precompiled chunk (see lundump.c)
+*/
+typedef struct lua_ChunkImage lua_ChunkImage;
+
+
 /*
 ** Type for memory-allocation functions
 */
@@ -251,6 +257,7 @@ LUA_API void *(lua_newuserdata) (lua_State *L, size_t sz);
 LUA_API int   (lua_getmetatable) (lua_State *L, int objindex);
 LUA_API int  (lua_getuservalue) (lua_State *L, int idx);
 LUA_API long long (lua_getdrops) (lua_State *L);
+LUA_API long long (lua_getmemdrops) (lua_State *L);
 
 
 /*
@@ -268,6 +275,7 @@ LUA_API void  (lua_setuservalue) (lua_State *L, int idx);
 LUA_API int   (lua_setdrops) (lua_State *L, long long drops);
 LUA_API int   (lua_enabledrops) (lua_State *L, int enable, int reset_memused);
 LUA_API int   (lua_getdropsenabled) (lua_State *L);
+LUA_API int   (lua_setblockmetering) (lua_State *L, int enable);
 
 /*
 ** 'load' and 'call' functions (load and run Lua code)
@@ -285,6 +293,11 @@ LUA_API int   (lua_load) (lua_State *L, lua_Reader reader, void *dt,
 
 LUA_API int (lua_dump) (lua_State *L, lua_Writer writer, void *data, int strip);
 
+LUA_API lua_ChunkImage *(lua_newchunkimage) (lua_State *L);
+LUA_API void  (lua_freechunkimage) (lua_ChunkImage *img);
+LUA_API size_t (lua_chunkimagesize) (const lua_ChunkImage *img);
+LUA_API int   (lua_loadchunkimage) (lua_State *L, const lua_ChunkImage *img);
+
 
 /*
 ** coroutine functions
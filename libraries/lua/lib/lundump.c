@@ -10,6 +10,7 @@
 #include "lprefix.h"
 
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "lua.h"
@@ -274,6 +275,335 @@ LClosure *luaU_undump(lua_State *L, ZIO *Z, const char *name) {
   LoadFunction(&S, cl->p, NULL);
   lua_assert(cl->nupvalues == cl->p->sizeupvalues);
   luai_verifycode(L, buff, cl->p);
+  luaF_meterproto(L, cl->p);
+  return cl;
+}
+
+
+
+/*
+** Decoded images of precompiled chunks.
+**
+** An image keeps the contents of a loaded chunk in plain C memory (outside
+** of any lua_State), so the same chunk can be loaded again into any state
+** without decoding and checking the dump. 'luaU_loadimage' creates the
+** objects in exactly the same order and with exactly the same sizes as
+** 'luaU_undump' does for the original dump, so memory accounting (drops)
+** of a state does not depend on whether a chunk came from an image.
+*/
+
+typedef struct ImgString {
+  char *s;  /* NULL: no string */
+  size_t len;
+} ImgString;
+
+
+typedef struct ImgConst {
+  int tt;
+  int b;
+  lua_Number n;
+  lua_Integer i;
+  ImgString s;
+} ImgConst;
+
+
+typedef struct ImgUpval {
+  ImgString name;
+  lu_byte instack;
+  lu_byte idx;
+} ImgUpval;
+
+
+typedef struct ImgLocVar {
+  ImgString varname;
+  int startpc;
+  int endpc;
+} ImgLocVar;
+
+
+typedef struct ImgProto {
+  ImgString source;  /* NULL when reusing parent's source */
+  int linedefined;
+  int lastlinedefined;
+  lu_byte numparams;
+  lu_byte is_vararg;
+  lu_byte maxstacksize;
+  int sizecode;
+  Instruction *code;
+  int sizek;
+  ImgConst *k;
+  int sizeupvalues;
+  ImgUpval *upvalues;
+  int sizep;
+  struct ImgProto *p;
+  int sizelineinfo;
+  int *lineinfo;
+  int sizelocvars;
+  ImgLocVar *locvars;
+} ImgProto;
+
+
+struct lua_ChunkImage {
+  lu_byte nupvalues;
+  size_t nbytes;  /* total size of the image */
+  ImgProto main;
+};
+
+
+static void *imgalloc (lua_ChunkImage *img, size_t size, int *ok) {
+  void *b;
+  if (size == 0)
+    return NULL;
+  b = malloc(size);
+  if (b == NULL)
+    *ok = 0;
+  else
+    img->nbytes += size;
+  return b;
+}
+
+
+static void MakeString (lua_ChunkImage *img, ImgString *is, const TString *ts,
+                        int *ok) {
+  is->s = NULL;
+  is->len = 0;
+  if (ts == NULL)
+    return;
+  is->len = tsslen(ts);
+  is->s = (char *)imgalloc(img, is->len + 1, ok);
+  if (is->s != NULL)
+    memcpy(is->s, getstr(ts), is->len + 1);
+}
+
+
+static void MakeProto (lua_ChunkImage *img, ImgProto *ip, const Proto *f,
+                       const TString *psource, int *ok) {
+  int i;
+  memset(ip, 0, sizeof(ImgProto));
+  if (f->source != psource)  /* 'LoadFunction' did load a source? */
+    MakeString(img, &ip->source, f->source, ok);
+  ip->linedefined = f->linedefined;
+  ip->lastlinedefined = f->lastlinedefined;
+  ip->numparams = f->numparams;
+  ip->is_vararg = f->is_vararg;
+  ip->maxstacksize = f->maxstacksize;
+  ip->sizecode = f->sizecode;
+  ip->code = (Instruction *)imgalloc(img, f->sizecode * sizeof(Instruction), ok);
+  if (ip->code != NULL)
+    memcpy(ip->code, f->code, f->sizecode * sizeof(Instruction));
+  ip->sizek = f->sizek;
+  ip->k = (ImgConst *)imgalloc(img, f->sizek * sizeof(ImgConst), ok);
+  for (i = 0; ip->k != NULL && i < f->sizek; i++) {
+    const TValue *o = &f->k[i];
+    ImgConst *c = &ip->k[i];
+    memset(c, 0, sizeof(ImgConst));
+    c->tt = ttype(o);
+    switch (c->tt) {
+    case LUA_TBOOLEAN:
+      c->b = bvalue(o);
+      break;
+    case LUA_TNUMFLT:
+      c->n = fltvalue(o);
+      break;
+    case LUA_TNUMINT:
+      c->i = ivalue(o);
+      break;
+    case LUA_TSHRSTR:
+    case LUA_TLNGSTR:
+      MakeString(img, &c->s, tsvalue(o), ok);
+      break;
+    default:
+      break;
+    }
+  }
+  ip->sizeupvalues = f->sizeupvalues;
+  ip->upvalues = (ImgUpval *)imgalloc(img, f->sizeupvalues * sizeof(ImgUpval), ok);
+  for (i = 0; ip->upvalues != NULL && i < f->sizeupvalues; i++) {
+    ip->upvalues[i].instack = f->upvalues[i].instack;
+    ip->upvalues[i].idx = f->upvalues[i].idx;
+    MakeString(img, &ip->upvalues[i].name, f->upvalues[i].name, ok);
+  }
+  ip->sizep = f->sizep;
+  ip->p = (ImgProto *)imgalloc(img, f->sizep * sizeof(ImgProto), ok);
+  if (ip->p != NULL)
+    memset(ip->p, 0, f->sizep * sizeof(ImgProto));
+  for (i = 0; ip->p != NULL && i < f->sizep; i++)
+    MakeProto(img, &ip->p[i], f->p[i], f->source, ok);
+  ip->sizelineinfo = f->sizelineinfo;
+  ip->lineinfo = (int *)imgalloc(img, f->sizelineinfo * sizeof(int), ok);
+  if (ip->lineinfo != NULL)
+    memcpy(ip->lineinfo, f->lineinfo, f->sizelineinfo * sizeof(int));
+  ip->sizelocvars = f->sizelocvars;
+  ip->locvars = (ImgLocVar *)imgalloc(img, f->sizelocvars * sizeof(ImgLocVar), ok);
+  for (i = 0; ip->locvars != NULL && i < f->sizelocvars; i++) {
+    ip->locvars[i].startpc = f->locvars[i].startpc;
+    ip->locvars[i].endpc = f->locvars[i].endpc;
+    MakeString(img, &ip->locvars[i].varname, f->locvars[i].varname, ok);
+  }
+}
+
+
+static void FreeProto (ImgProto *ip) {
+  int i;
+  free(ip->source.s);
+  free(ip->code);
+  for (i = 0; ip->k != NULL && i < ip->sizek; i++)
+    free(ip->k[i].s.s);
+  free(ip->k);
+  for (i = 0; ip->upvalues != NULL && i < ip->sizeupvalues; i++)
+    free(ip->upvalues[i].name.s);
+  free(ip->upvalues);
+  for (i = 0; ip->p != NULL && i < ip->sizep; i++)
+    FreeProto(&ip->p[i]);
+  free(ip->p);
+  free(ip->lineinfo);
+  for (i = 0; ip->locvars != NULL && i < ip->sizelocvars; i++)
+    free(ip->locvars[i].varname.s);
+  free(ip->locvars);
+}
+
+
+/*
+** make an image of a chunk just loaded by 'luaU_undump' (before it runs)
+*/
+lua_ChunkImage *luaU_makeimage (const LClosure *cl) {
+  int ok = 1;
+  lua_ChunkImage *img = (lua_ChunkImage *)malloc(sizeof(lua_ChunkImage));
+  if (img == NULL)
+    return NULL;
+  img->nupvalues = cl->nupvalues;
+  img->nbytes = sizeof(lua_ChunkImage);
+  MakeProto(img, &img->main, cl->p, NULL, &ok);
+  if (!ok) {
+    luaU_freeimage(img);
+    return NULL;
+  }
+  return img;
+}
+
+
+void luaU_freeimage (lua_ChunkImage *img) {
+  if (img == NULL)
+    return;
+  FreeProto(&img->main);
+  free(img);
+}
+
+
+size_t luaU_imagesize (const lua_ChunkImage *img) {
+  return img->nbytes;
+}
+
+
+/* same as 'LoadString' */
+static TString *ImageString (lua_State *L, const ImgString *is) {
+  if (is->s == NULL)
+    return NULL;
+  else if (is->len <= LUAI_MAXSHORTLEN)  /* short string? */
+    return luaS_newlstr(L, is->s, is->len);
+  else {  /* long string */
+    TString *ts = luaS_createlngstrobj(L, is->len);
+    memcpy(getstr(ts), is->s, is->len);
+    return ts;
+  }
+}
+
+
+/* same as 'LoadFunction' */
+static void ImageFunction (lua_State *L, const ImgProto *ip, Proto *f,
+                           TString *psource) {
+  int i;
+  f->source = ImageString(L, &ip->source);
+  if (f->source == NULL)  /* no source in dump? */
+    f->source = psource;  /* reuse parent's source */
+  f->linedefined = ip->linedefined;
+  f->lastlinedefined = ip->lastlinedefined;
+  f->numparams = ip->numparams;
+  f->is_vararg = ip->is_vararg;
+  f->maxstacksize = ip->maxstacksize;
+  /* code */
+  f->code = luaM_newvector(L, ip->sizecode, Instruction);
+  f->sizecode = ip->sizecode;
+  if (ip->sizecode > 0)
+    memcpy(f->code, ip->code, ip->sizecode * sizeof(Instruction));
+  /* constants */
+  f->k = luaM_newvector(L, ip->sizek, TValue);
+  f->sizek = ip->sizek;
+  for (i = 0; i < ip->sizek; i++)
+    setnilvalue(&f->k[i]);
+  for (i = 0; i < ip->sizek; i++) {
+    TValue *o = &f->k[i];
+    const ImgConst *c = &ip->k[i];
+    switch (c->tt) {
+    case LUA_TNIL:
+      setnilvalue(o);
+      break;
+    case LUA_TBOOLEAN:
+      setbvalue(o, c->b);
+      break;
+    case LUA_TNUMFLT:
+      setfltvalue(o, c->n);
+      break;
+    case LUA_TNUMINT:
+      setivalue(o, c->i);
+      break;
+    case LUA_TSHRSTR:
+    case LUA_TLNGSTR:
+      setsvalue2n(L, o, ImageString(L, &c->s));
+      break;
+    default:
+      lua_assert(0);
+    }
+  }
+  /* upvalues */
+  f->upvalues = luaM_newvector(L, ip->sizeupvalues, Upvaldesc);
+  f->sizeupvalues = ip->sizeupvalues;
+  for (i = 0; i < ip->sizeupvalues; i++)
+    f->upvalues[i].name = NULL;
+  for (i = 0; i < ip->sizeupvalues; i++) {
+    f->upvalues[i].instack = ip->upvalues[i].instack;
+    f->upvalues[i].idx = ip->upvalues[i].idx;
+  }
+  /* protos */
+  f->p = luaM_newvector(L, ip->sizep, Proto *);
+  f->sizep = ip->sizep;
+  for (i = 0; i < ip->sizep; i++)
+    f->p[i] = NULL;
+  for (i = 0; i < ip->sizep; i++) {
+    f->p[i] = luaF_newproto(L);
+    ImageFunction(L, &ip->p[i], f->p[i], f->source);
+  }
+  /* debug */
+  f->lineinfo = luaM_newvector(L, ip->sizelineinfo, int);
+  f->sizelineinfo = ip->sizelineinfo;
+  if (ip->sizelineinfo > 0)
+    memcpy(f->lineinfo, ip->lineinfo, ip->sizelineinfo * sizeof(int));
+  f->locvars = luaM_newvector(L, ip->sizelocvars, LocVar);
+  f->sizelocvars = ip->sizelocvars;
+  for (i = 0; i < ip->sizelocvars; i++)
+    f->locvars[i].varname = NULL;
+  for (i = 0; i < ip->sizelocvars; i++) {
+    f->locvars[i].varname = ImageString(L, &ip->locvars[i].varname);
+    f->locvars[i].startpc = ip->locvars[i].startpc;
+    f->locvars[i].endpc = ip->locvars[i].endpc;
+  }
+  for (i = 0; i < ip->sizeupvalues; i++)
+    f->upvalues[i].name = ImageString(L, &ip->upvalues[i].name);
+}
+
+
+/*
+** load a chunk from its image; same as 'luaU_undump'
+*/
+LClosure *luaU_loadimage (lua_State *L, const lua_ChunkImage *img) {
+  LClosure *cl;
+  cl = luaF_newLclosure(L, img->nupvalues);
+  setclLvalue(L, L->top, cl);
+  luaD_inctop(L);
+  cl->p = luaF_newproto(L);
+  ImageFunction(L, &img->main, cl->p, NULL);
+  lua_assert(cl->nupvalues == cl->p->sizeupvalues);
+  luaF_meterproto(L, cl->p);
   return cl;
 }
 
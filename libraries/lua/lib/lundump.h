@@ -25,6 +25,12 @@
 /* load one chunk; from lundump.c */
 LUAI_FUNC LClosure* luaU_undump (lua_State* L, ZIO* Z, const char* name);
 
+/* decoded images of precompiled chunks; from lundump.c */
+LUAI_FUNC lua_ChunkImage* luaU_makeimage (const LClosure* cl);
+LUAI_FUNC void luaU_freeimage (lua_ChunkImage* img);
+LUAI_FUNC size_t luaU_imagesize (const lua_ChunkImage* img);
+LUAI_FUNC LClosure* luaU_loadimage (lua_State* L, const lua_ChunkImage* img);
+
 /* dump one chunk; from ldump.c */
 LUAI_FUNC int luaU_dump (lua_State* L, const Proto* f, lua_Writer w,
                          void* data, int strip);
@@ -767,19 +767,38 @@ void luaV_finishOp (lua_State *L) {
 #define vmbreak		break
 
 
+/*
+** Leave the fast path of a straight instruction (see 'luaF_meterproto')
+** for something that may look at the drops left (a metamethod, an error,
+** an allocation): if the block was charged ahead, give back the drops of
+** its instructions after this one, which are then charged one by one.
+*/
+#define leaveblock()  \
+  { if (prepaid) { \
+      L->drops += meter[pcRel(ci->u.l.savedpc, cl->p)].drops \
+                  - OP_DROPS[GET_OPCODE(i)]; \
+      prepaid = 0; } }
+
+
+/* charge the drops of the current instruction; stop if they run out */
+#define chargeop()  \
+  { L->drops -= OP_DROPS[GET_OPCODE(i)]; \
+    if (L->drops < 0) { vmbreak; } }
+
+
 /*
 ** copy of 'luaV_gettable', but protecting the call to potential
 ** metamethod (which can reallocate the stack)
 */
 #define gettableProtected(L,t,k,v)  { const TValue *slot; \
   if (luaV_fastget(L,t,k,slot,luaH_get)) { setobj2s(L, v, slot); } \
-  else Protect(luaV_finishget(L,t,k,v,slot)); }
+  else { leaveblock(); Protect(luaV_finishget(L,t,k,v,slot)); } }
 
 
 /* same for 'luaV_settable' */
 #define settableProtected(L,t,k,v) { const TValue *slot; \
-  if (!luaV_fastset(L,t,k,slot,luaH_get,v)) \
-    Protect(luaV_finishset(L,t,k,v,slot)); }
+  if (!luaV_fastset(L,t,k,slot,luaH_get,v)) { \
+    leaveblock(); Protect(luaV_finishset(L,t,k,v,slot)); } }
 
 
 
@@ -788,24 +807,41 @@ void luaV_execute (lua_State *L) {
   LClosure *cl;
   TValue *k;
   StkId base;
+  const BlockMeter *meter;  /* see 'luaF_meterproto' */
+  int blockleft;  /* instructions left in the current block after this one */
+  int prepaid;  /* drops of the current block already charged? */
   ci->callstatus |= CIST_FRESH;  /* fresh invocation of 'luaV_execute" */
  newframe:  /* reentry point when frame changes (call/return) */
   lua_assert(ci == L->ci);
   cl = clLvalue(ci->func);  /* local reference to function's closure */
   k = cl->p->k;  /* local reference to function's constant table */
   base = ci->u.l.base;  /* local copy of function's base */
+  meter = luaF_getmeter(G(L), cl->p);
+  blockleft = prepaid = 0;  /* look up the meter at the next instruction */
   /* main loop of interpreter */
   for (;;) {
     Instruction i;
     StkId ra;
     vmfetch();
 
-    if(L->enable_drops != 0) {
-      long long cost = OP_DROPS[GET_OPCODE(i)];
-      L->drops -= cost;
-      if (L->drops < 0) {
-        vmbreak;
+    /* drops cannot be enabled or disabled in the middle of a block */
+    if (blockleft > 0) {
+      blockleft--;
+      if (!prepaid)
+        chargeop();
+    }
+    else if(L->enable_drops != 0) {
+      if (meter != NULL) {  /* entering a block */
+        const BlockMeter *bm = &meter[pcRel(ci->u.l.savedpc, cl->p)];
+        blockleft = cast_int(bm->len) - 1;
+        /* charge the rest of the block at once only if it cannot run out
+           of drops in the middle; otherwise charge it one by one */
+        prepaid = (L->drops >= (long long)bm->drops && !L->hookmask);
+        if (prepaid)
+          L->drops -= bm->drops;
       }
+      if (!prepaid)
+        chargeop();
     }
     
     vmdispatch (GET_OPCODE(i)) {
@@ -892,7 +928,7 @@ void luaV_execute (lua_State *L) {
         if (luaV_fastget(L, rb, key, aux, luaH_getstr)) {
           setobj2s(L, ra, aux);
         }
-        else Protect(luaV_finishget(L, rb, rc, ra, aux));
+        else { leaveblock(); Protect(luaV_finishget(L, rb, rc, ra, aux)); }
         vmbreak;
       }
       vmcase(OP_ADD) {
@@ -906,7 +942,7 @@ void luaV_execute (lua_State *L) {
         else if (tonumber(rb, &nb) && tonumber(rc, &nc)) {
           setfltvalue(ra, luai_numadd(L, nb, nc));
         }
-        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_ADD)); }
+        else { leaveblock(); Protect(luaT_trybinTM(L, rb, rc, ra, TM_ADD)); }
         vmbreak;
       }
       vmcase(OP_SUB) {
@@ -920,7 +956,7 @@ void luaV_execute (lua_State *L) {
         else if (tonumber(rb, &nb) && tonumber(rc, &nc)) {
           setfltvalue(ra, luai_numsub(L, nb, nc));
         }
-        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_SUB)); }
+        else { leaveblock(); Protect(luaT_trybinTM(L, rb, rc, ra, TM_SUB)); }
         vmbreak;
       }
       vmcase(OP_MUL) {
@@ -934,7 +970,7 @@ void luaV_execute (lua_State *L) {
         else if (tonumber(rb, &nb) && tonumber(rc, &nc)) {
           setfltvalue(ra, luai_nummul(L, nb, nc));
         }
-        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_MUL)); }
+        else { leaveblock(); Protect(luaT_trybinTM(L, rb, rc, ra, TM_MUL)); }
         vmbreak;
       }
       vmcase(OP_DIV) {  /* float division (always with floats) */
@@ -944,7 +980,7 @@ void luaV_execute (lua_State *L) {
         if (tonumber(rb, &nb) && tonumber(rc, &nc)) {
           setfltvalue(ra, luai_numdiv(L, nb, nc));
         }
-        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_DIV)); }
+        else { leaveblock(); Protect(luaT_trybinTM(L, rb, rc, ra, TM_DIV)); }
         vmbreak;
       }
       vmcase(OP_BAND) {
@@ -954,7 +990,7 @@ void luaV_execute (lua_State *L) {
         if (tointeger(rb, &ib) && tointeger(rc, &ic)) {
           setivalue(ra, intop(&, ib, ic));
         }
-        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_BAND)); }
+        else { leaveblock(); Protect(luaT_trybinTM(L, rb, rc, ra, TM_BAND)); }
         vmbreak;
       }
       vmcase(OP_BOR) {
@@ -964,7 +1000,7 @@ void luaV_execute (lua_State *L) {
         if (tointeger(rb, &ib) && tointeger(rc, &ic)) {
           setivalue(ra, intop(|, ib, ic));
         }
-        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_BOR)); }
+        else { leaveblock(); Protect(luaT_trybinTM(L, rb, rc, ra, TM_BOR)); }
         vmbreak;
       }
       vmcase(OP_BXOR) {
@@ -974,7 +1010,7 @@ void luaV_execute (lua_State *L) {
         if (tointeger(rb, &ib) && tointeger(rc, &ic)) {
           setivalue(ra, intop(^, ib, ic));
         }
-        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_BXOR)); }
+        else { leaveblock(); Protect(luaT_trybinTM(L, rb, rc, ra, TM_BXOR)); }
         vmbreak;
       }
       vmcase(OP_SHL) {
@@ -984,7 +1020,7 @@ void luaV_execute (lua_State *L) {
         if (tointeger(rb, &ib) && tointeger(rc, &ic)) {
           setivalue(ra, luaV_shiftl(ib, ic));
         }
-        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_SHL)); }
+        else { leaveblock(); Protect(luaT_trybinTM(L, rb, rc, ra, TM_SHL)); }
         vmbreak;
       }
       vmcase(OP_SHR) {
@@ -994,7 +1030,7 @@ void luaV_execute (lua_State *L) {
         if (tointeger(rb, &ib) && tointeger(rc, &ic)) {
           setivalue(ra, luaV_shiftl(ib, -ic));
         }
-        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_SHR)); }
+        else { leaveblock(); Protect(luaT_trybinTM(L, rb, rc, ra, TM_SHR)); }
         vmbreak;
       }
       vmcase(OP_MOD) {
@@ -1003,6 +1039,7 @@ void luaV_execute (lua_State *L) {
         lua_Number nb; lua_Number nc;
         if (ttisinteger(rb) && ttisinteger(rc)) {
           lua_Integer ib = ivalue(rb); lua_Integer ic = ivalue(rc);
+          if (ic == 0) leaveblock();  /* 'luaV_mod' raises an error */
           setivalue(ra, luaV_mod(L, ib, ic));
         }
         else if (tonumber(rb, &nb) && tonumber(rc, &nc)) {
@@ -1010,7 +1047,7 @@ void luaV_execute (lua_State *L) {
           luai_nummod(L, nb, nc, m);
           setfltvalue(ra, m);
         }
-        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_MOD)); }
+        else { leaveblock(); Protect(luaT_trybinTM(L, rb, rc, ra, TM_MOD)); }
         vmbreak;
       }
       vmcase(OP_IDIV) {  /* floor division */
@@ -1019,12 +1056,13 @@ void luaV_execute (lua_State *L) {
         lua_Number nb; lua_Number nc;
         if (ttisinteger(rb) && ttisinteger(rc)) {
           lua_Integer ib = ivalue(rb); lua_Integer ic = ivalue(rc);
+          if (ic == 0) leaveblock();  /* 'luaV_div' raises an error */
           setivalue(ra, luaV_div(L, ib, ic));
         }
         else if (tonumber(rb, &nb) && tonumber(rc, &nc)) {
           setfltvalue(ra, luai_numidiv(L, nb, nc));
         }
-        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_IDIV)); }
+        else { leaveblock(); Protect(luaT_trybinTM(L, rb, rc, ra, TM_IDIV)); }
         vmbreak;
       }
       vmcase(OP_POW) {
@@ -1034,7 +1072,7 @@ void luaV_execute (lua_State *L) {
         if (tonumber(rb, &nb) && tonumber(rc, &nc)) {
           setfltvalue(ra, luai_numpow(L, nb, nc));
         }
-        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_POW)); }
+        else { leaveblock(); Protect(luaT_trybinTM(L, rb, rc, ra, TM_POW)); }
         vmbreak;
       }
       vmcase(OP_UNM) {
@@ -1048,6 +1086,7 @@ void luaV_execute (lua_State *L) {
           setfltvalue(ra, luai_numunm(L, nb));
         }
         else {
+          leaveblock();
           Protect(luaT_trybinTM(L, rb, rb, ra, TM_UNM));
         }
         vmbreak;
@@ -1059,6 +1098,7 @@ void luaV_execute (lua_State *L) {
           setivalue(ra, intop(^, ~l_castS2U(0), ib));
         }
         else {
+          leaveblock();
           Protect(luaT_trybinTM(L, rb, rb, ra, TM_BNOT));
         }
         vmbreak;
@@ -48,6 +48,7 @@ namespace taiyi { namespace plugins { namespace account_by_key {
     account_by_key_api::account_by_key_api(): my( new detail::account_by_key_api_impl() )
     {
         JSON_RPC_REGISTER_API( TAIYI_ACCOUNT_BY_KEY_API_PLUGIN_NAME );
+        JSON_RPC_REGISTER_READ_ONLY_API( TAIYI_ACCOUNT_BY_KEY_API_PLUGIN_NAME );
     }
     
     account_by_key_api::~account_by_key_api() {}
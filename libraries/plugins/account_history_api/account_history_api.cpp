@@ -122,6 +122,7 @@ namespace taiyi { namespace plugins { namespace account_history {
         my = std::make_unique< account_history_api_impl >();
         
         JSON_RPC_REGISTER_API( TAIYI_ACCOUNT_HISTORY_API_PLUGIN_NAME );
+        JSON_RPC_REGISTER_READ_ONLY_API( TAIYI_ACCOUNT_HISTORY_API_PLUGIN_NAME );
     }
     
     account_history_api::~account_history_api() {}
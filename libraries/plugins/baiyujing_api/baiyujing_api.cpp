@@ -34,7 +34,7 @@ namespace taiyi { namespace plugins { namespace baiyujing_api {
         class baiyujing_api_impl
         {
         public:
-            baiyujing_api_impl() : _chain( appbase::app().get_plugin< taiyi::plugins::chain::chain_plugin >() ), _db( _chain.db() )
+            baiyujing_api_impl() : _chain( appbase::app().get_plugin< taiyi::plugins::chain::chain_plugin >() ), _db( _chain.db() ), _eval( _db )
             {
                 _on_post_apply_block_conn = _db.add_post_apply_block_handler([&]( const block_notification& note ) { on_post_apply_block( note.block ); }, appbase::app().get_plugin<taiyi::plugins::baiyujing_api::baiyujing_api_plugin>(), 0);
             }
@@ -90,6 +90,7 @@ namespace taiyi { namespace plugins { namespace baiyujing_api {
                 (get_nfa_action_info)
                 (eval_nfa_action)
                 (eval_nfa_action_with_string_args)
+                (get_eval_stats)
                              
                 (find_actor)
                 (find_actors)
@@ -126,6 +127,7 @@ namespace taiyi { namespace plugins { namespace baiyujing_api {
             )
             
             void on_post_apply_block( const signed_block& b );
+            api_eval_action_return eval_action( int64_t nfa_id, const string& action_name, const vector<lua_types>& value_list );
             
             taiyi::plugins::chain::chain_plugin&                              _chain;
             chain::database&                                                  _db;
@@ -142,6 +144,8 @@ namespace taiyi { namespace plugins { namespace baiyujing_api {
             boost::signals2::connection                                       _on_post_apply_block_conn;
             
             boost::mutex                                                      _mtx;
+            
+            eval_service                                                      _eval;
         };
 
         DEFINE_API_IMPL( baiyujing_api_impl, get_version )
@@ -339,7 +343,8 @@ namespace taiyi { namespace plugins { namespace baiyujing_api {
         {
             CHECK_ARG_SIZE( 0 )
             scheduled_hardfork shf;
-            const auto& hpo = _db.get( hardfork_property_id_type() );
+            auto snapshot = _db.get_state_snapshot();
+            const auto& hpo = snapshot->hardfork_properties;
             shf.hf_version = hpo.next_hardfork;
             shf.live_time = hpo.next_hardfork_time;
             return shf;
@@ -350,7 +355,8 @@ namespace taiyi { namespace plugins { namespace baiyujing_api {
             CHECK_ARG_SIZE( 1 )
             string name = args[0].as< string >();
             
-            auto fund = _db.find< reward_fund_object, by_name >( name );
+            auto snapshot = _db.get_state_snapshot();
+            auto fund = snapshot->find_reward_fund( name );
             FC_ASSERT( fund != nullptr, "Invalid reward fund name" );
             
             return api_reward_fund_object( *fund );
@@ -887,22 +893,15 @@ namespace taiyi { namespace plugins { namespace baiyujing_api {
             return result;
         }
 
-        DEFINE_API_IMPL( baiyujing_api_impl, eval_nfa_action )
+        api_eval_action_return baiyujing_api_impl::eval_action( int64_t nfa_id, const string& action_name, const vector<lua_types>& value_list )
         {
-            CHECK_ARG_SIZE( 3 )
-            
-            const auto& nfa = _db.get<chain::nfa_object, chain::by_id>(args[0].as<int64_t>());
-            string action_name = args[1].as< string >();
-            vector<lua_types> value_list = args[2].as< vector<lua_types> >();
-
             api_eval_action_return result;
             contract_worker worker;
 
-            LuaContext context;
-            _db.initialize_VM_baseENV(context);
-            
-            long long vm_drops = 100000000;
-            result.err = worker.eval_nfa_contract_action(nfa, action_name, value_list, result.eval_result, vm_drops, true, context, _db);
+            _eval.run( [&]( LuaContext& context, long long& vm_drops ) {
+                const auto& nfa = _db.get<chain::nfa_object, chain::by_id>(nfa_id);
+                result.err = worker.eval_nfa_contract_action(nfa, action_name, value_list, result.eval_result, vm_drops, true, context, _db);
+            } );
 
             if(result.err == "") {
                 for(auto& temp : worker.get_result().contract_affecteds) {
@@ -915,39 +914,40 @@ namespace taiyi { namespace plugins { namespace baiyujing_api {
             return result;
         }
         
+        DEFINE_API_IMPL( baiyujing_api_impl, eval_nfa_action )
+        {
+            CHECK_ARG_SIZE( 3 )
+            
+            int64_t nfa_id = args[0].as<int64_t>();
+            string action_name = args[1].as< string >();
+            vector<lua_types> value_list = args[2].as< vector<lua_types> >();
+
+            return eval_action(nfa_id, action_name, value_list);
+        }
+        
         DEFINE_API_IMPL( baiyujing_api_impl, eval_nfa_action_with_string_args )
         {
             CHECK_ARG_SIZE( 3 )
             
-            const auto& nfa = _db.get<chain::nfa_object, chain::by_id>(args[0].as<int64_t>());
+            int64_t nfa_id = args[0].as<int64_t>();
             string action_name = args[1].as< string >();
             string action_parameters_str = args[2].as< string >();
             fc::variant action_args = fc::json::from_string(action_parameters_str);
             vector<lua_types> value_list = protocol::from_variants_to_lua_types(action_args.as<fc::variants>());
 
-            api_eval_action_return result;
-            contract_worker worker;
-
-            LuaContext context;
-            _db.initialize_VM_baseENV(context);
-            
-            long long vm_drops = 100000000;
-            result.err = worker.eval_nfa_contract_action(nfa, action_name, value_list, result.eval_result, vm_drops, true, context, _db);
-
-            if(result.err == "") {
-                for(auto& temp : worker.get_result().contract_affecteds) {
-                    if(temp.which() == contract_affected_type::tag<contract_narrate>::value) {
-                        result.narrate_logs.push_back(temp.get<contract_narrate>().message);
-                    }
-                }
-            }
-            else {
+            api_eval_action_return result = eval_action(nfa_id, action_name, value_list);
+            if(result.err != "")
                 result.narrate_logs.push_back(result.err);
-            }
 
             return result;
         }
         
+        DEFINE_API_IMPL( baiyujing_api_impl, get_eval_stats )
+        {
+            CHECK_ARG_SIZE( 0 )
+            return _eval.get_stats();
+        }
+        
         DEFINE_API_IMPL( baiyujing_api_impl, find_actor )
         {
             CHECK_ARG_SIZE( 1 )
@@ -1477,11 +1477,90 @@ namespace taiyi { namespace plugins { namespace baiyujing_api {
     baiyujing_api::baiyujing_api() : my( new detail::baiyujing_api_impl() )
     {
         JSON_RPC_REGISTER_API( TAIYI_BAIYUJING_API_PLUGIN_NAME );
+        JSON_RPC_REGISTER_STREAM_METHODS( TAIYI_BAIYUJING_API_PLUGIN_NAME, (get_block)(find_nfas)(list_nfas)(list_actors)(list_actors_below_health)(list_actors_on_zone) );
+        JSON_RPC_REGISTER_READ_ONLY_METHODS( TAIYI_BAIYUJING_API_PLUGIN_NAME,
+            (get_version)
+            (get_config)
+            (get_dynamic_global_properties)
+            (get_chain_properties)
+            (get_siming_schedule)
+            (get_hardfork_version)
+            (get_next_scheduled_hardfork)
+            (get_reward_fund)
+            (eval_nfa_action)
+            (eval_nfa_action_with_string_args)
+            (get_eval_stats)
+            (get_state)
+            (get_active_simings)
+            (get_block_header)
+            (get_block)
+            (get_ops_in_block)
+            (get_key_references)
+            (get_accounts)
+            (lookup_account_names)
+            (lookup_accounts)
+            (get_account_count)
+            (get_owner_history)
+            (get_recovery_request)
+            (get_withdraw_routes)
+            (get_qi_delegations)
+            (get_expiring_qi_delegations)
+            (get_simings)
+            (get_siming_by_account)
+            (get_simings_by_adore)
+            (lookup_siming_accounts)
+            (get_siming_count)
+            (get_transaction_hex)
+            (get_transaction)
+            (get_transaction_results)
+            (get_required_signatures)
+            (get_potential_signatures)
+            (verify_authority)
+            (verify_account_authority)
+            (get_account_history)
+            (get_account_resources)
+            (find_nfa_symbol)
+            (find_nfa_symbol_by_contract)
+            (find_nfa)
+            (find_nfas)
+            (list_nfas)
+            (get_nfa_history)
+            (get_nfa_action_info)
+            (find_actor)
+            (find_actors)
+            (list_actors)
+            (get_actor_history)
+            (list_actors_below_health)
+            (find_actor_talent_rules)
+            (list_actors_on_zone)
+            (get_tiandao_properties)
+            (find_zones)
+            (find_zones_by_name)
+            (list_zones)
+            (list_zones_by_type)
+            (list_to_zones_by_from)
+            (list_from_zones_by_to)
+            (find_way_to_zone)
+            (list_zones_by_prohibited_contract)
+            (list_contracts_prohibited_by_zone)
+            (list_relations_from_actor)
+            (list_relations_to_actor)
+            (get_relation_from_to_actor)
+            (get_actor_connections)
+            (list_actor_groups)
+            (find_actor_group)
+            (list_actor_friends)
+            (get_actor_needs)
+            (list_actor_mating_targets_by_zone)
+            (stat_people_by_zone)
+            (stat_people_by_base)
+            (get_contract_source_code)
+        );
     }
     
     baiyujing_api::~baiyujing_api() {}
     
-    void baiyujing_api::api_startup()
+    void baiyujing_api::api_startup( const eval_service_options& eval_options )
     {
         auto database = appbase::app().find_plugin< database_api::database_api_plugin >();
         if( database != nullptr )
@@ -1518,6 +1597,13 @@ namespace taiyi { namespace plugins { namespace baiyujing_api {
         {
             my->_p2p = p2p;
         }
+        
+        my->_eval.start( eval_options );
+    }
+    
+    void baiyujing_api::api_shutdown()
+    {
+        my->_eval.stop();
     }
 
     DEFINE_LOCKLESS_APIS( baiyujing_api,
@@ -1526,6 +1612,15 @@ namespace taiyi { namespace plugins { namespace baiyujing_api {
         (broadcast_transaction)
         (broadcast_transaction_synchronous)
         (broadcast_block)
+        (get_dynamic_global_properties)
+        (get_chain_properties)
+        (get_siming_schedule)
+        (get_hardfork_version)
+        (get_next_scheduled_hardfork)
+        (get_reward_fund)
+        (eval_nfa_action)
+        (eval_nfa_action_with_string_args)
+        (get_eval_stats)
     )
 
     DEFINE_READ_APIS( baiyujing_api,
@@ -1534,12 +1629,6 @@ namespace taiyi { namespace plugins { namespace baiyujing_api {
         (get_block_header)
         (get_block)
         (get_ops_in_block)
-        (get_dynamic_global_properties)
-        (get_chain_properties)
-        (get_siming_schedule)
-        (get_hardfork_version)
-        (get_next_scheduled_hardfork)
-        (get_reward_fund)
         (get_key_references)
         (get_accounts)
         (lookup_account_names)
@@ -1572,8 +1661,6 @@ namespace taiyi { namespace plugins { namespace baiyujing_api {
         (list_nfas)
         (get_nfa_history)
         (get_nfa_action_info)
-        (eval_nfa_action)
-        (eval_nfa_action_with_string_args)
                      
         (find_actor)
         (find_actors)
@@ -7,6 +7,7 @@
 #include <plugins/account_by_key_api/account_by_key_api.hpp>
 #include <plugins/network_broadcast_api/network_broadcast_api.hpp>
 #include <plugins/baiyujing_api/baiyujing_api_legacy_objects.hpp>
+#include <plugins/baiyujing_api/eval_service.hpp>
 
 #include <fc/optional.hpp>
 #include <fc/variant.hpp>
@@ -465,6 +466,7 @@ DEFINE_API_ARGS( get_nfa_history,                   vector< variant >, get_nfa_h
 DEFINE_API_ARGS( get_nfa_action_info,               vector< variant >, api_contract_action_info )
 DEFINE_API_ARGS( eval_nfa_action,                   vector< variant >, api_eval_action_return )
 DEFINE_API_ARGS( eval_nfa_action_with_string_args,  vector< variant >, api_eval_action_return )
+DEFINE_API_ARGS( get_eval_stats,                    vector< variant >, api_eval_stats )
 
 DEFINE_API_ARGS( find_actor,                        vector< variant >, optional< database_api::api_actor_object > )
 DEFINE_API_ARGS( find_actors,                       vector< variant >, vector< database_api::api_actor_object > )
@@ -558,6 +560,7 @@ DEFINE_API_ARGS( get_contract_source_code,          vector< variant >, string )
             (get_nfa_history)
             (eval_nfa_action)
             (eval_nfa_action_with_string_args)
+            (get_eval_stats)
             (get_nfa_action_info)
                     
             (find_actor)
@@ -596,7 +599,8 @@ DEFINE_API_ARGS( get_contract_source_code,          vector< variant >, string )
         
     private:
         friend class baiyujing_api_plugin;
-        void api_startup();
+        void api_startup( const eval_service_options& eval_options );
+        void api_shutdown();
         
         std::unique_ptr< detail::baiyujing_api_impl > my;
     };
@@ -634,6 +638,7 @@ FC_REFLECT( taiyi::plugins::baiyujing_api::broadcast_transaction_synchronous_ret
 FC_REFLECT( taiyi::plugins::baiyujing_api::api_resource_assets, (gold)(food)(wood)(fabric)(herb) )
 
 FC_REFLECT(taiyi::plugins::baiyujing_api::api_nfa_object, (id)(creator_account)(owner_account)(active_account)(symbol)(parent)(children)(main_contract)(contract_data)(qi)(debt_value)(debt_contract)(cultivation_value)(created_time)(next_tick_block)(gold)(food)(wood)(fabric)(herb)(material_gold)(material_food)(material_wood)(material_fabric)(material_herb)(five_phase))
+JSON_RPC_STREAM_REFLECTED( taiyi::plugins::baiyujing_api::api_nfa_object )
 
 FC_REFLECT( taiyi::plugins::baiyujing_api::api_contract_action_info, (exist)(consequence) )
 
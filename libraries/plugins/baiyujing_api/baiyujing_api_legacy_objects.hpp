@@ -3,6 +3,7 @@
 #include <plugins/baiyujing_api/baiyujing_api_legacy_operations.hpp>
 
 #include <plugins/block_api/block_api_objects.hpp>
+#include <plugins/json_rpc/json_stream.hpp>
 
 namespace taiyi { namespace plugins { namespace baiyujing_api {
 
@@ -138,5 +139,7 @@ namespace fc {
 }
 
 FC_REFLECT( taiyi::plugins::baiyujing_api::legacy_signed_transaction, (ref_block_num)(ref_block_prefix)(expiration)(operations)(operation_results)(extensions)(signatures)(transaction_id)(block_num)(transaction_num) )
+JSON_RPC_STREAM_REFLECTED( taiyi::plugins::baiyujing_api::legacy_signed_transaction )
 
 FC_REFLECT( taiyi::plugins::baiyujing_api::legacy_signed_block, (previous)(timestamp)(siming)(transaction_merkle_root)(extensions)(siming_signature)(transactions)(block_id)(signing_key)(transaction_ids) )
+JSON_RPC_STREAM_REFLECTED( taiyi::plugins::baiyujing_api::legacy_signed_block )
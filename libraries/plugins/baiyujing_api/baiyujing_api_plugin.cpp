@@ -4,6 +4,8 @@
 
 namespace taiyi { namespace plugins { namespace baiyujing_api {
 
+    namespace bpo = boost::program_options;
+
     baiyujing_api_plugin::baiyujing_api_plugin() {}
     baiyujing_api_plugin::~baiyujing_api_plugin() {}
     
@@ -12,18 +14,36 @@ namespace taiyi { namespace plugins { namespace baiyujing_api {
         cli.add_options()
         ("disable-get-block", "Disable get_block API call" )
         ;
+        cfg.add_options()
+        ("eval-threads", bpo::value< uint32_t >()->default_value( 2 ), "Threads running eval_nfa_action calls, 0 to run them on the api thread" )
+        ("eval-queue-size", bpo::value< uint32_t >()->default_value( 64 ), "Eval calls waiting for a thread before more are rejected" )
+        ("eval-context-pool-size", bpo::value< uint32_t >()->default_value( 8 ), "Number of pre-warmed lua contexts kept ready for eval calls, 0 to disable" )
+        ("eval-max-drops", bpo::value< int64_t >()->default_value( 100000000 ), "Drops given to every eval call" )
+        ("eval-timeout-ms", bpo::value< uint32_t >()->default_value( 1000 ), "Wall clock limit of an eval call in milliseconds, including its time in the queue" )
+        ;
     }
     
     void baiyujing_api_plugin::plugin_initialize( const variables_map& options )
     {
         api = std::make_shared< baiyujing_api >();
+        
+        _eval_options.threads = options.at( "eval-threads" ).as< uint32_t >();
+        _eval_options.queue_size = options.at( "eval-queue-size" ).as< uint32_t >();
+        _eval_options.context_pool_size = options.at( "eval-context-pool-size" ).as< uint32_t >();
+        _eval_options.max_drops = options.at( "eval-max-drops" ).as< int64_t >();
+        _eval_options.timeout = fc::milliseconds( options.at( "eval-timeout-ms" ).as< uint32_t >() );
+        FC_ASSERT( _eval_options.max_drops > 0, "eval-max-drops must be positive" );
+        FC_ASSERT( _eval_options.timeout.count() > 0, "eval-timeout-ms must be positive" );
     }
     
     void baiyujing_api_plugin::plugin_startup()
     {
-        api->api_startup();
+        api->api_startup( _eval_options );
     }
     
-    void baiyujing_api_plugin::plugin_shutdown() {}
+    void baiyujing_api_plugin::plugin_shutdown()
+    {
+        api->api_shutdown();
+    }
 
 } } } // taiyi::plugins::baiyujing_api
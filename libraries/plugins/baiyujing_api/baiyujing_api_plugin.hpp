@@ -4,6 +4,7 @@
 #include <plugins/json_rpc/json_rpc_plugin.hpp>
 #include <plugins/database_api/database_api_plugin.hpp>
 #include <plugins/block_api/block_api_plugin.hpp>
+#include <plugins/baiyujing_api/eval_service.hpp>
 
 #define TAIYI_BAIYUJING_API_PLUGIN_NAME "baiyujing_api"
 
@@ -31,6 +32,9 @@ namespace taiyi { namespace plugins { namespace baiyujing_api {
         virtual void plugin_shutdown() override;
         
         std::shared_ptr< class baiyujing_api > api;
+        
+    private:
+        eval_service_options _eval_options;
     };
 
 } } } // taiyi::plugins::baiyujing_api
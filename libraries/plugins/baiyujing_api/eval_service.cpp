@@ -0,0 +1,229 @@
+#include <plugins/baiyujing_api/eval_service.hpp>
+
+#include <chain/database.hpp>
+#include <chain/contract_objects.hpp>
+#include <chain/lua_context.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/log/logger.hpp>
+
+#include <algorithm>
+
+namespace taiyi { namespace plugins { namespace baiyujing_api {
+
+    namespace {
+
+        /** Instructions between two checks of the wall clock */
+        const int eval_hook_count = 1000;
+
+        thread_local fc::time_point eval_deadline;
+        thread_local bool           eval_deadline_reached = false;
+
+        /**
+         * Once the deadline is reached the error is raised again at every instruction, so contract
+         * code catching it with pcall is stopped as soon as it gets control back
+         */
+        void eval_deadline_hook( lua_State* L, lua_Debug* )
+        {
+            if( eval_deadline_reached || fc::time_point::now() >= eval_deadline )
+            {
+                if( !eval_deadline_reached )
+                {
+                    eval_deadline_reached = true;
+                    lua_sethook( L, &eval_deadline_hook, LUA_MASKCOUNT, 1 );
+                }
+                luaL_error( L, "eval reached its time limit" );
+            }
+        }
+
+    }
+
+    eval_service::eval_service( chain::database& db )
+        : _db( db ), _accepted(0), _rejected(0), _timed_out(0), _failed(0), _completed(0)
+    {}
+
+    eval_service::~eval_service()
+    {
+        stop();
+    }
+
+    void eval_service::start( const eval_service_options& options )
+    {
+        stop();
+
+        _options = options;
+        _contexts.set_chunk_cache( &_db.get_lua_chunk_cache() );
+        _contexts.start( _options.context_pool_size );
+
+        std::lock_guard< std::mutex > guard( _mutex );
+        _running = true;
+        for( uint32_t i = 0; i < _options.threads; ++i )
+            _threads.emplace_back( [this]() { worker_loop(); } );
+
+        ilog( "Eval service started with ${t} threads, queue size ${q}, ${d} drops and ${ms}ms per eval",
+            ("t", _options.threads)("q", _options.queue_size)("d", _options.max_drops)("ms", _options.timeout.count() / 1000) );
+    }
+
+    void eval_service::stop()
+    {
+        {
+            std::lock_guard< std::mutex > guard( _mutex );
+            _running = false;
+        }
+        _queue_cv.notify_all();
+
+        for( auto& t : _threads )
+            t.join();
+        _threads.clear();
+
+        _contexts.stop();
+    }
+
+    void eval_service::run( const eval_function& eval )
+    {
+        eval_task task;
+        task.eval = &eval;
+        task.deadline = fc::time_point::now() + _options.timeout;
+
+        if( _options.threads == 0 )
+        {
+            ++_accepted;
+            {
+                std::lock_guard< std::mutex > guard( _mutex );
+                ++_busy;
+            }
+            execute( task );
+            std::lock_guard< std::mutex > guard( _mutex );
+            --_busy;
+        }
+        else
+        {
+            std::unique_lock< std::mutex > lock( _mutex );
+            FC_ASSERT( _running, "Eval service is not running" );
+            //idle workers take queued evals at once, only the evals waiting beyond them count against the queue size
+            if( _queue.size() >= _options.queue_size + ( _options.threads - _busy ) )
+            {
+                ++_rejected;
+                FC_THROW( "Eval service is busy, ${n} evals are waiting, retry later", ("n", _queue.size()) );
+            }
+
+            ++_accepted;
+            _queue.push_back( &task );
+            _max_queue_depth = std::max( _max_queue_depth, uint32_t( _queue.size() ) );
+            _queue_cv.notify_one();
+
+            //the task lives on this stack, wait until a worker is done with it even past the deadline
+            _done_cv.wait( lock, [&task]() { return task.done; } );
+        }
+
+        if( task.error )
+            std::rethrow_exception( task.error );
+    }
+
+    void eval_service::worker_loop()
+    {
+        std::unique_lock< std::mutex > lock( _mutex );
+        while( true )
+        {
+            _queue_cv.wait( lock, [this]() { return !_running || !_queue.empty(); } );
+
+            //evals already queued are still answered when stopping
+            if( _queue.empty() )
+                return;
+
+            eval_task* task = _queue.front();
+            _queue.pop_front();
+            ++_busy;
+            lock.unlock();
+
+            execute( *task );
+
+            lock.lock();
+            --_busy;
+            task->done = true;
+            _done_cv.notify_all();
+        }
+    }
+
+    void eval_service::execute( eval_task& task )
+    {
+        if( fc::time_point::now() >= task.deadline )
+        {
+            ++_timed_out;
+            task.error = std::make_exception_ptr( fc::timeout_exception( FC_LOG_MESSAGE( error,
+                "Eval timed out after waiting ${ms}ms in the queue", ("ms", _options.timeout.count() / 1000) ) ) );
+            return;
+        }
+
+        eval_deadline = task.deadline;
+        eval_deadline_reached = false;
+
+        try
+        {
+            _db.with_read_lock( [&]()
+            {
+                const auto& contract_base = _db.get< chain::contract_object, chain::by_id >( chain::contract_id_type() );
+                const auto& contract_base_code = _db.get< chain::contract_bin_code_object, chain::by_id >( contract_base.lua_code_b_id );
+                _contexts.set_base_env( contract_base.name, contract_base_code.id, contract_base.current_version, contract_base_code.lua_code_b );
+
+                std::unique_ptr< chain::LuaContext > context = _contexts.acquire();
+                lua_sethook( context->mState, &eval_deadline_hook, LUA_MASKCOUNT, eval_hook_count );
+
+                long long vm_drops = _options.max_drops;
+                try
+                {
+                    (*task.eval)( *context, vm_drops );
+                }
+                catch( ... )
+                {
+                    _contexts.release( std::move( context ) );
+                    throw;
+                }
+                _contexts.release( std::move( context ) );
+            } );
+        }
+        catch( ... )
+        {
+            task.error = std::current_exception();
+        }
+
+        if( eval_deadline_reached )
+        {
+            ++_timed_out;
+            task.error = std::make_exception_ptr( fc::timeout_exception( FC_LOG_MESSAGE( error,
+                "Eval stopped at its time limit of ${ms}ms", ("ms", _options.timeout.count() / 1000) ) ) );
+        }
+        else if( task.error )
+            ++_failed;
+        else
+            ++_completed;
+    }
+
+    api_eval_stats eval_service::get_stats()
+    {
+        api_eval_stats stats;
+        stats.threads = _options.threads;
+        stats.queue_size = _options.queue_size;
+        stats.max_drops = _options.max_drops;
+        stats.timeout_ms = _options.timeout.count() / 1000;
+
+        {
+            std::lock_guard< std::mutex > guard( _mutex );
+            stats.queue_depth = _queue.size();
+            stats.max_queue_depth = _max_queue_depth;
+            stats.running = _busy;
+        }
+
+        stats.accepted = _accepted;
+        stats.rejected = _rejected;
+        stats.timed_out = _timed_out;
+        stats.failed = _failed;
+        stats.completed = _completed;
+
+        stats.contexts_ready = _contexts.get_ready_size();
+        stats.context_hits = _contexts.get_hits();
+        stats.context_misses = _contexts.get_misses();
+        return stats;
+    }
+
+} } } // taiyi::plugins::baiyujing_api
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <chain/lua_context_pool.hpp>
+
+#include <fc/time.hpp>
+#include <fc/reflect/reflect.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace taiyi { namespace chain {
+    class database;
+    class LuaContext;
+} }
+
+namespace taiyi { namespace plugins { namespace baiyujing_api {
+
+    struct eval_service_options
+    {
+        uint32_t            threads = 2;                ///< Worker threads, 0 to run evals on the calling thread
+        uint32_t            queue_size = 64;            ///< Evals waiting for a worker, more are rejected
+        uint32_t            context_pool_size = 8;      ///< Pre-warmed lua contexts, 0 to create them on demand
+        int64_t             max_drops = 100000000;      ///< Drops given to every eval
+        fc::microseconds    timeout = fc::milliseconds( 1000 ); ///< Wall clock cap of an eval, including its time in the queue
+    };
+
+    struct api_eval_stats
+    {
+        uint32_t    threads = 0;
+        uint32_t    queue_size = 0;
+        int64_t     max_drops = 0;
+        int64_t     timeout_ms = 0;
+
+        uint32_t    queue_depth = 0;        ///< Evals waiting for a worker now
+        uint32_t    max_queue_depth = 0;
+        uint32_t    running = 0;            ///< Evals running now
+
+        uint64_t    accepted = 0;
+        uint64_t    rejected = 0;           ///< Turned away because the queue was full
+        uint64_t    timed_out = 0;          ///< Stopped at the wall clock cap, in the queue or while running
+        uint64_t    failed = 0;             ///< Finished with an error, timeouts not included
+        uint64_t    completed = 0;
+
+        uint32_t    contexts_ready = 0;
+        uint64_t    context_hits = 0;
+        uint64_t    context_misses = 0;
+    };
+
+    /**
+     * Runs contract evaluations for the api on a bounded set of worker threads.
+     *
+     * Every eval gets a fresh lua context with baseENV loaded, taken from a pool pre-warmed by
+     * a background thread, and runs under the chainbase read lock so it sees a consistent state.
+     * Callers queue without holding the lock. An eval runs with at most max_drops drops and is
+     * stopped by a lua count hook once its wall clock cap is reached, which bounds how long it
+     * can keep the writer waiting. Evals that find the queue full are rejected right away.
+     */
+    class eval_service
+    {
+    public:
+        typedef std::function< void( chain::LuaContext& context, long long& vm_drops ) > eval_function;
+
+        eval_service( chain::database& db );
+        ~eval_service();
+
+        void start( const eval_service_options& options );
+        void stop();
+
+        /**
+         * Runs eval with a fresh context under the read lock and waits for it to finish.
+         * Throws when the queue is full, when the wall clock cap is reached, and rethrows what eval throws.
+         */
+        void run( const eval_function& eval );
+
+        api_eval_stats get_stats();
+
+    private:
+        struct eval_task
+        {
+            const eval_function*    eval = nullptr;
+            fc::time_point          deadline;
+            std::exception_ptr      error;
+            bool                    done = false;
+        };
+
+        void worker_loop();
+        void execute( eval_task& task );
+
+        chain::database&                    _db;
+        eval_service_options                _options;
+        chain::lua_context_pool             _contexts;
+
+        std::mutex                          _mutex;
+        std::condition_variable             _queue_cv;
+        std::condition_variable             _done_cv;
+        bool                                _running = false;
+        std::vector< std::thread >          _threads;
+        std::deque< eval_task* >            _queue;
+
+        uint32_t                            _busy = 0;      ///< Evals being executed
+        uint32_t                            _max_queue_depth = 0;
+        std::atomic< uint64_t >             _accepted;
+        std::atomic< uint64_t >             _rejected;
+        std::atomic< uint64_t >             _timed_out;
+        std::atomic< uint64_t >             _failed;
+        std::atomic< uint64_t >             _completed;
+    };
+
+} } } // taiyi::plugins::baiyujing_api
+
+FC_REFLECT( taiyi::plugins::baiyujing_api::api_eval_stats,
+    (threads)(queue_size)(max_drops)(timeout_ms)
+    (queue_depth)(max_queue_depth)(running)
+    (accepted)(rejected)(timed_out)(failed)(completed)
+    (contexts_ready)(context_hits)(context_misses) )
@@ -31,6 +31,8 @@ namespace taiyi { namespace plugins { namespace block_api {
     block_api::block_api() : my( new block_api_impl() )
     {
         JSON_RPC_REGISTER_API( TAIYI_BLOCK_API_PLUGIN_NAME );
+        JSON_RPC_REGISTER_READ_ONLY_API( TAIYI_BLOCK_API_PLUGIN_NAME );
+        JSON_RPC_REGISTER_STREAM_METHODS( TAIYI_BLOCK_API_PLUGIN_NAME, (get_block) );
     }
     
     block_api::~block_api() {}
@@ -38,4 +38,5 @@ FC_REFLECT( taiyi::plugins::block_api::get_block_header_args, (block_num) )
 FC_REFLECT( taiyi::plugins::block_api::get_block_header_return, (header) )
 FC_REFLECT( taiyi::plugins::block_api::get_block_args, (block_num) )
 FC_REFLECT( taiyi::plugins::block_api::get_block_return, (block) )
+JSON_RPC_STREAM_REFLECTED( taiyi::plugins::block_api::get_block_return )
 
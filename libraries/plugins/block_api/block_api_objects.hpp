@@ -7,6 +7,8 @@
 #include <chain/siming_objects.hpp>
 #include <chain/database.hpp>
 
+#include <plugins/json_rpc/json_stream.hpp>
+
 namespace taiyi { namespace plugins { namespace block_api {
 
     using namespace taiyi::chain;
@@ -31,3 +33,4 @@ namespace taiyi { namespace plugins { namespace block_api {
 } } } // taiyi::plugins::database_api
 
 FC_REFLECT_DERIVED( taiyi::plugins::block_api::api_signed_block_object, (taiyi::protocol::signed_block), (block_id)(signing_key)(transaction_ids) )
+JSON_RPC_STREAM_REFLECTED( taiyi::plugins::block_api::api_signed_block_object )
@@ -89,6 +89,17 @@ namespace taiyi { namespace plugins { namespace chain {
             uint32_t                         flush_interval = 0;
             bool                             replay_in_memory = false;
             std::vector< std::string >       replay_memory_indices{};
+            uint32_t                         lua_context_pool_size = 0;
+            uint32_t                         lua_chunk_cache_size = 0;
+            uint32_t                         block_log_compression_chunk = 0;
+            uint32_t                         replay_pipeline_depth = 0;
+            uint32_t                         replay_pipeline_threads = 0;
+            uint32_t                         signature_recovery_threads = 0;
+            bool                             incremental_pending_transactions = true;
+            uint64_t                         undo_encoding_threshold = 0;
+            uint32_t                         invariant_check_threads = 0;
+            bool                             incremental_invariants = true;
+            uint32_t                         zone_route_cache_size = 0;
             flat_map<uint32_t,block_id_type> loaded_checkpoints;
             
             uint32_t                         allow_future_time = 5;
@@ -308,6 +319,14 @@ namespace taiyi { namespace plugins { namespace chain {
             ("checkpoint,c", bpo::value<vector<string>>()->composing(), "Pairs of [BLOCK_NUM,BLOCK_ID] that should be enforced as checkpoints.")
             ("flush-state-interval", bpo::value<uint32_t>(), "flush state changes to disk every N blocks")
             ("memory-replay-indices", bpo::value<vector<string>>()->multitoken()->composing(), "Specify which indices should be in memory during replay")
+            ("lua-context-pool-size", bpo::value<uint32_t>()->default_value( 32 ), "Number of pre-warmed lua contexts kept ready for NFA heart beats, 0 to disable. Each ready context is a full lua state with the standard libraries, chain bindings and baseENV loaded, so memory grows linearly with this size")
+            ("lua-chunk-cache-size", bpo::value<uint32_t>()->default_value( 1024 ), "Number of decoded contract chunks kept in memory, 0 to disable")
+            ("block-log-compression-chunk", bpo::value<uint32_t>()->default_value( 0 ), "Number of blocks per compressed chunk when a new block log is created, 0 for the uncompressed format")
+            ("replay-pipeline-depth", bpo::value<uint32_t>()->default_value( 64 ), "Number of blocks read and hashed ahead of the applied block during replay, 0 to disable")
+            ("replay-pipeline-threads", bpo::value<uint32_t>()->default_value( 2 ), "Number of threads reading blocks ahead during replay")
+            ("signature-recovery-threads", bpo::value<uint32_t>()->default_value( 4 ), "Number of threads recovering transaction signature keys of incoming blocks before the write lock, 0 to disable")
+            ("incremental-pending-transactions", bpo::value<bool>()->default_value( true ), "Skip signature and authority checks when re-applying pending transactions already checked since the last authority change")
+            ("undo-encoding-threshold", bpo::value<uint64_t>()->default_value( 4096 ), "Contract data size in bytes from which undo states keep contracts and NFAs serialized instead of copied, 0 to always copy")
             ;
         cli.add_options()
             ("proposal-remove-threshold", bpo::value<uint16_t>()->default_value( 200 ), "Maximum numbers of proposals/votes which can be removed in the same cycle")
@@ -320,6 +339,9 @@ namespace taiyi { namespace plugins { namespace chain {
             ("dump-memory-details", bpo::bool_switch()->default_value(false), "Dump database objects memory usage info. Use set-benchmark-interval to set dump interval.")
             ("check-locks", bpo::bool_switch()->default_value(false), "Check correctness of chainbase locking" )
             ("validate-database-invariants", bpo::bool_switch()->default_value(false), "Validate all supply invariants check out" )
+            ("invariant-check-threads", bpo::value<uint32_t>()->default_value( 4 ), "Number of threads scanning the database when validating invariants")
+            ("incremental-invariants", bpo::value<bool>()->default_value( true ), "Maintain invariant totals as objects change instead of scanning the database on every check")
+            ("zone-route-cache-size", bpo::value<uint32_t>()->default_value( 4096 ), "Number of recently found routes between zones kept in memory, 0 to disable")
             ("database-cfg", bpo::value<bfs::path>()->default_value("database.cfg"), "The database configuration file location")
             ("memory-replay,m", bpo::bool_switch()->default_value(false), "Replay with state in memory instead of on disk")
 #ifdef IS_TEST_NET
@@ -350,7 +372,18 @@ namespace taiyi { namespace plugins { namespace chain {
         my->benchmark_interval  = options.count( "set-benchmark-interval" ) ? options.at( "set-benchmark-interval" ).as<uint32_t>() : 0;
         my->check_locks         = options.at( "check-locks" ).as< bool >();
         my->validate_invariants = options.at( "validate-database-invariants" ).as<bool>();
+        my->invariant_check_threads = options.at( "invariant-check-threads" ).as<uint32_t>();
+        my->incremental_invariants = options.at( "incremental-invariants" ).as<bool>();
+        my->zone_route_cache_size = options.at( "zone-route-cache-size" ).as< uint32_t >();
         my->dump_memory_details = options.at( "dump-memory-details" ).as<bool>();
+        my->lua_context_pool_size = options.at( "lua-context-pool-size" ).as< uint32_t >();
+        my->lua_chunk_cache_size = options.at( "lua-chunk-cache-size" ).as< uint32_t >();
+        my->block_log_compression_chunk = options.at( "block-log-compression-chunk" ).as< uint32_t >();
+        my->replay_pipeline_depth = options.at( "replay-pipeline-depth" ).as< uint32_t >();
+        my->replay_pipeline_threads = options.at( "replay-pipeline-threads" ).as< uint32_t >();
+        my->signature_recovery_threads = options.at( "signature-recovery-threads" ).as< uint32_t >();
+        my->incremental_pending_transactions = options.at( "incremental-pending-transactions" ).as< bool >();
+        my->undo_encoding_threshold = options.at( "undo-encoding-threshold" ).as< uint64_t >();
         if( options.count( "flush-state-interval" ) )
             my->flush_interval = options.at( "flush-state-interval" ).as<uint32_t>();
         else
@@ -435,7 +468,8 @@ namespace taiyi { namespace plugins { namespace chain {
             for (auto idx : abstract_index_cntr)
             {
                 auto info = idx->get_statistics(onlyStaticInfo);
-                index_memory_details_cntr.emplace_back(std::move(info._value_type_name), info._item_count, info._item_sizeof, info._item_additional_allocation, info._additional_container_allocation);
+                index_memory_details_cntr.emplace_back(std::move(info._value_type_name), info._item_count, info._item_sizeof, info._item_additional_allocation, info._additional_container_allocation,
+                    info._undo_state_items, info._undo_state_allocation, info._undo_state_packed_allocation, info._cache_usage, info._cache_size);
             }
         };
         
@@ -464,13 +498,25 @@ namespace taiyi { namespace plugins { namespace chain {
         db_open_args.initial_qi_supply = 0;
         db_open_args.chainbase_flags = my->chainbase_flags;
         db_open_args.do_validate_invariants = my->validate_invariants;
+        db_open_args.invariant_check_threads = my->invariant_check_threads;
+        db_open_args.incremental_invariants = my->incremental_invariants;
+        db_open_args.zone_route_cache_size = my->zone_route_cache_size;
         db_open_args.stop_replay_at = my->stop_replay_at;
         db_open_args.benchmark_is_enabled = my->benchmark_is_enabled;
         db_open_args.database_cfg = database_config;
         db_open_args.replay_in_memory = my->replay_in_memory;
         db_open_args.replay_memory_indices = my->replay_memory_indices;
-
-        auto benchmark_lambda = [&dumper, &get_indexes_memory_details, dump_memory_details] ( uint32_t current_block_number, const chainbase::database::abstract_index_cntr_t& abstract_index_cntr ) {
+        db_open_args.lua_context_pool_size = my->lua_context_pool_size;
+        db_open_args.lua_chunk_cache_size = my->lua_chunk_cache_size;
+        db_open_args.block_log_compression_chunk = my->block_log_compression_chunk;
+        db_open_args.reindex_pipeline_depth = my->replay_pipeline_depth;
+        db_open_args.reindex_pipeline_threads = my->replay_pipeline_threads;
+        db_open_args.signature_recovery_threads = my->signature_recovery_threads;
+        db_open_args.incremental_pending_transactions = my->incremental_pending_transactions;
+        db_open_args.undo_encoding_threshold = my->undo_encoding_threshold;
+
+        const auto& db = my->db;
+        auto benchmark_lambda = [&dumper, &get_indexes_memory_details, dump_memory_details, &db] ( uint32_t current_block_number, const chainbase::database::abstract_index_cntr_t& abstract_index_cntr ) {
             if( current_block_number == 0 ) // initial call
             {
                 typedef taiyi::utilities::benchmark_dumper::database_object_sizeof_cntr_t database_object_sizeof_cntr_t;
@@ -491,6 +537,14 @@ namespace taiyi { namespace plugins { namespace chain {
             
             const taiyi::utilities::benchmark_dumper::measurement& measure = dumper.measure(current_block_number, get_indexes_memory_details);
             ilog( "Performance report at block ${n}. Elapsed time: ${rt} ms (real), ${ct} ms (cpu). Memory usage: ${cm} (current), ${pm} (peak) kilobytes.", ("n", current_block_number)("rt", measure.real_ms)("ct", measure.cpu_ms)("cm", measure.current_mem)("pm", measure.peak_mem) );
+            
+            auto pipeline = db.get_reindex_pipeline_stats();
+            if( pipeline.depth > 0 && pipeline.elapsed_us > 0 )
+            {
+                ilog( "Replay pipeline at block ${n}: ${bps} blocks/s, ${r} of ${d} blocks ready, ${p} ms preparing blocks on ${t} threads, ${w} ms waiting for blocks.",
+                      ("n", current_block_number)("bps", uint64_t( pipeline.consumed ) * 1000000 / pipeline.elapsed_us)("r", pipeline.ready)("d", pipeline.depth)
+                      ("p", pipeline.prepare_us / 1000)("t", pipeline.thread_num)("w", pipeline.wait_us / 1000) );
+            }
         };
 
         if(my->replay)
@@ -563,6 +617,10 @@ namespace taiyi { namespace plugins { namespace chain {
         
         check_time_in_block( block );
         
+        //签名公钥的恢复与状态无关，在进入写队列之前完成
+        if( !( skip & ( taiyi::chain::database::skip_transaction_signatures | taiyi::chain::database::skip_authority_check ) ) )
+            my->db.prefetch_signature_keys( block );
+        
         boost::promise< void > prom;
         write_context cxt;
         cxt.req_ptr = &block;
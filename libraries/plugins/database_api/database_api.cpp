@@ -28,6 +28,7 @@ namespace taiyi { namespace plugins { namespace database_api {
             (get_siming_schedule)
             (get_hardfork_properties)
             (get_reward_funds)
+            (get_pending_transaction_pool_stats)
             (list_simings)
             (find_simings)
             (list_siming_adores)
@@ -138,6 +139,8 @@ namespace taiyi { namespace plugins { namespace database_api {
     database_api::database_api() : my( new database_api_impl() )
     {
         JSON_RPC_REGISTER_API( TAIYI_DATABASE_API_PLUGIN_NAME );
+        JSON_RPC_REGISTER_READ_ONLY_API( TAIYI_DATABASE_API_PLUGIN_NAME );
+        JSON_RPC_REGISTER_STREAM_METHODS( TAIYI_DATABASE_API_PLUGIN_NAME, (list_accounts)(find_accounts)(list_nfas)(find_nfas)(list_actors)(find_actors) );
     }
     
     database_api::~database_api() {}
@@ -168,36 +171,37 @@ namespace taiyi { namespace plugins { namespace database_api {
          );
     }
     
+    //以下全局状态读取最后应用的块之后发布的副本，不需要数据库的读锁
     DEFINE_API_IMPL( database_api_impl, get_dynamic_global_properties )
     {
-        return _db.get_dynamic_global_properties();
+        return _db.get_state_snapshot()->dynamic_global_properties;
     }
     
     DEFINE_API_IMPL( database_api_impl, get_siming_schedule )
     {
-        return api_siming_schedule_object( _db.get_siming_schedule_object() );
+        return api_siming_schedule_object( _db.get_state_snapshot()->siming_schedule );
     }
     
     DEFINE_API_IMPL( database_api_impl, get_hardfork_properties )
     {
-        return _db.get_hardfork_property_object();
+        return _db.get_state_snapshot()->hardfork_properties;
     }
     
     DEFINE_API_IMPL( database_api_impl, get_reward_funds )
     {
         get_reward_funds_return result;
         
-        const auto& rf_idx = _db.get_index< reward_fund_index, chain::by_id >();
-        auto itr = rf_idx.begin();
-        
-        while( itr != rf_idx.end() )
-        {
-            result.funds.push_back( *itr );
-            ++itr;
-        }
+        auto snapshot = _db.get_state_snapshot();
+        for( const auto& fund : snapshot->reward_funds )
+            result.funds.push_back( fund );
         
         return result;
     }
+    
+    DEFINE_API_IMPL( database_api_impl, get_pending_transaction_pool_stats )
+    {
+        return _db.get_pending_transaction_pool().get_stats();
+    }
 
     //********************************************************************
     //                                                                  //
@@ -321,7 +325,8 @@ namespace taiyi { namespace plugins { namespace database_api {
 
     DEFINE_API_IMPL( database_api_impl, get_active_simings )
     {
-        const auto& wso = _db.get_siming_schedule_object();
+        auto snapshot = _db.get_state_snapshot();
+        const auto& wso = snapshot->siming_schedule;
         size_t n = wso.current_shuffled_simings.size();
         get_active_simings_return result;
         result.simings.reserve( n );
@@ -1335,29 +1340,6 @@ namespace taiyi { namespace plugins { namespace database_api {
         return result;
     }
     
-    //pre_from 用于避免相邻节点的循环通路
-    bool is_connect(chain::zone_id_type from, chain::zone_id_type dest, chain::zone_id_type pre_from, int depth, const mira::index_adapter< chain::zone_connect_index, chain::by_zone_from >& zone_connect_by_from_idx, std::vector<string>& way_points, chain::database& db) {
-        if(depth > 10)
-            return false;
-        auto itz = zone_connect_by_from_idx.lower_bound( from );
-        while(itz != zone_connect_by_from_idx.end()) {
-            if(itz->from != from)
-                break;
-            if(itz->to != pre_from) {
-                if(itz->to == dest) {
-                    way_points.push_back(db.get< chain::zone_object, chain::by_id >(dest).name);
-                    return true;
-                }
-                if(is_connect(itz->to, dest, from, depth+1, zone_connect_by_from_idx, way_points, db)) {
-                    way_points.insert(way_points.begin(), db.get< chain::zone_object, chain::by_id >(itz->to).name);
-                    return true;
-                }
-            }
-            itz++;
-        }
-        return false;
-    }
-
     DEFINE_API_IMPL( database_api_impl, find_way_to_zone )
     {
         const auto* from_zone = _db.find< chain::zone_object, chain::by_name >( args.from_zone );
@@ -1366,21 +1348,11 @@ namespace taiyi { namespace plugins { namespace database_api {
         FC_ASSERT( to_zone != nullptr );
 
         find_way_to_zone_return result;
-        const auto& zone_connect_by_from_idx = _db.get_index< zone_connect_index >().indices().get< chain::by_zone_from >();
-        auto itz = zone_connect_by_from_idx.lower_bound( from_zone->id );
-        while(itz != zone_connect_by_from_idx.end()) {
-            if(itz->from != from_zone->id)
-                break;
-            if(itz->to == to_zone->id) {
-                result.way_points.push_back(to_zone->name);
-                break;
-            }
-            if(is_connect(itz->to, to_zone->id, from_zone->id, 1, zone_connect_by_from_idx, result.way_points, _db)) {
-                result.way_points.insert(result.way_points.begin(), _db.get< chain::zone_object, chain::by_id >(itz->to).name);
-                break;
-            }
-            itz++;
-        }
+        auto route = _db.find_way_to_zone( *from_zone, *to_zone );
+        result.way_points.reserve( route.zones.size() );
+        for( const auto& z : route.zones )
+            result.way_points.push_back( _db.get< chain::zone_object, chain::by_id >( z ).name );
+        result.moving_days = route.moving_days;
         return result;
     }
     
@@ -1598,17 +1570,21 @@ namespace taiyi { namespace plugins { namespace database_api {
        return _db.get_tiandao_properties();
     }
 
-    DEFINE_LOCKLESS_APIS( database_api, (get_config)(get_version) )
-    
-    DEFINE_READ_APIS( database_api,
+    DEFINE_LOCKLESS_APIS( database_api,
+        (get_config)
+        (get_version)
         (get_dynamic_global_properties)
         (get_siming_schedule)
         (get_hardfork_properties)
         (get_reward_funds)
+        (get_active_simings)
+    )
+    
+    DEFINE_READ_APIS( database_api,
+        (get_pending_transaction_pool_stats)
         (list_simings)
         (find_simings)
         (list_siming_adores)
-        (get_active_simings)
         (list_accounts)
         (find_accounts)
         (list_owner_histories)
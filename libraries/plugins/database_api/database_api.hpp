@@ -41,6 +41,11 @@ namespace taiyi { namespace plugins { namespace database_api {
             (get_hardfork_properties)
             (get_reward_funds)
 
+            /**
+             * @brief Retrieve statistics of the local pending transaction pool
+             */
+            (get_pending_transaction_pool_stats)
+
             //***********
             // Simings //
             //***********
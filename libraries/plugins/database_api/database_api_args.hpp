@@ -115,6 +115,11 @@ namespace taiyi { namespace plugins { namespace database_api {
     typedef void_type                      get_hardfork_properties_args;
     typedef api_hardfork_property_object   get_hardfork_properties_return;
     
+    /* get_pending_transaction_pool_stats */
+    
+    typedef void_type                                   get_pending_transaction_pool_stats_args;
+    typedef taiyi::chain::pending_transaction_pool_stats get_pending_transaction_pool_stats_return;
+    
     /* get_reward_funds */
     
     typedef void_type get_reward_funds_args;
@@ -468,7 +473,8 @@ namespace taiyi { namespace plugins { namespace database_api {
     };
     struct find_way_to_zone_return
     {
-        vector<string> way_points;
+        vector<string> way_points;  ///< 不含起点，含终点，没有路线时为空
+        uint64_t       moving_days = 0;
     };
 
     struct list_contracts_prohibited_by_zone_args
@@ -556,6 +562,7 @@ FC_REFLECT( taiyi::plugins::database_api::list_siming_adores_return, (adores) )
 FC_REFLECT( taiyi::plugins::database_api::get_active_simings_return, (simings) )
 
 FC_REFLECT( taiyi::plugins::database_api::list_accounts_return, (accounts) )
+JSON_RPC_STREAM_REFLECTED( taiyi::plugins::database_api::list_accounts_return )
 
 FC_REFLECT( taiyi::plugins::database_api::find_accounts_args, (accounts) )
 
@@ -612,6 +619,7 @@ FC_REFLECT( taiyi::plugins::database_api::find_nfa_symbol_return, (result) )
 FC_REFLECT( taiyi::plugins::database_api::find_nfa_symbol_by_contract_args, (contract) )
 
 FC_REFLECT( taiyi::plugins::database_api::list_nfas_return, (result) )
+JSON_RPC_STREAM_REFLECTED( taiyi::plugins::database_api::list_nfas_return )
 
 FC_REFLECT( taiyi::plugins::database_api::find_nfas_args, (ids) )
 
@@ -623,6 +631,7 @@ FC_REFLECT( taiyi::plugins::database_api::find_actor_return, (result) )
 
 FC_REFLECT( taiyi::plugins::database_api::find_actors_args, (actor_ids) )
 FC_REFLECT( taiyi::plugins::database_api::list_actors_return, (result) )
+JSON_RPC_STREAM_REFLECTED( taiyi::plugins::database_api::list_actors_return )
 
 FC_REFLECT( taiyi::plugins::database_api::find_actor_talent_rules_args, (ids) )
 FC_REFLECT( taiyi::plugins::database_api::find_actor_talent_rules_return, (rules) )
@@ -632,7 +641,7 @@ FC_REFLECT( taiyi::plugins::database_api::list_zones_return, (result) )
 FC_REFLECT( taiyi::plugins::database_api::find_zones_by_name_args, (name_list) )
 
 FC_REFLECT( taiyi::plugins::database_api::find_way_to_zone_args, (from_zone)(to_zone) )
-FC_REFLECT( taiyi::plugins::database_api::find_way_to_zone_return, (way_points) )
+FC_REFLECT( taiyi::plugins::database_api::find_way_to_zone_return, (way_points)(moving_days) )
 
 FC_REFLECT( taiyi::plugins::database_api::list_contracts_prohibited_by_zone_args, (zone) )
 FC_REFLECT( taiyi::plugins::database_api::list_contracts_prohibited_by_zone_return, (contracts) )
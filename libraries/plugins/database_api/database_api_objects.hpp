@@ -12,6 +12,8 @@
 #include <chain/zone_objects.hpp>
 #include <chain/contract_objects.hpp>
 
+#include <plugins/json_rpc/json_stream.hpp>
+
 namespace taiyi { namespace plugins { namespace database_api {
 
     using namespace taiyi::chain;
@@ -465,6 +467,7 @@ namespace taiyi { namespace plugins { namespace database_api {
 } } } // taiyi::plugins::database_api
 
 FC_REFLECT( taiyi::plugins::database_api::api_account_object, (id)(name)(owner)(active)(posting)(memo_key)(json_metadata)(proxy)(last_owner_update)(last_account_update)(created)(mined)(recovery_account)(last_account_recovery)(can_adore)(balance)(reward_yang_balance)(reward_qi_balance)(reward_feigang_balance)(qi)(delegated_qi)(received_qi)(qi_withdraw_rate)(next_qi_withdrawal_time)(withdrawn)(to_withdraw)(withdraw_routes)(proxied_vsf_adores)(simings_adored_for)(is_xinsu)(gold)(food)(wood)(fabric)(herb) )
+JSON_RPC_STREAM_REFLECTED( taiyi::plugins::database_api::api_account_object )
 
 FC_REFLECT( taiyi::plugins::database_api::api_owner_authority_history_object, (id)(account)(previous_owner_authority)(last_valid_time) )
 
@@ -481,7 +484,9 @@ FC_REFLECT( taiyi::plugins::database_api::api_hardfork_property_object, (id)(pro
 FC_REFLECT(taiyi::plugins::database_api::api_nfa_symbol_object, (id)(id)(creator_account)(authority_account)(authority_nfa_symbol)(symbol)(describe)(default_contract)(count)(max_count)(min_equivalent_qi)(is_sbt))
 
 FC_REFLECT(taiyi::plugins::database_api::api_nfa_object, (id)(creator_account)(owner_account)(active_account)(symbol)(parent)(children)(main_contract)(contract_data)(qi)(debt_value)(debt_contract)(cultivation_value)(created_time)(next_tick_block)(gold)(food)(wood)(fabric)(herb)(material_gold)(material_food)(material_wood)(material_fabric)(material_herb)(five_phase))
+JSON_RPC_STREAM_REFLECTED( taiyi::plugins::database_api::api_nfa_object )
 
 FC_REFLECT( taiyi::plugins::database_api::api_actor_object, (id)(name)(nfa_id)(age)(health)(health_max)(init_attribute_amount_max)(strength)(strength_max)(physique)(physique_max)(agility)(agility_max)(vitality)(vitality_max)(comprehension)(comprehension_max)(willpower)(willpower_max)(charm)(charm_max)(mood)(mood_max)(talents)(born)(gender)(sexuality)(fertility)(born_time)(born_vyears)(born_vmonths)(born_vdays)(born_vtod)(born_vtimes)(five_phase)(standpoint)(standpoint_type)(loyalty)(location)(base_name)(last_update)(next_tick_block) )
+JSON_RPC_STREAM_REFLECTED( taiyi::plugins::database_api::api_actor_object )
 
 FC_REFLECT( taiyi::plugins::database_api::api_actor_relation_object, (id)(actor_owner)(actor_name)(target_owner)(target_name)(favor)(favor_level)(last_update) )
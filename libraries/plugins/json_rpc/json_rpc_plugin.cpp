@@ -10,6 +10,12 @@
 
 #include <chainbase/chainbase.hpp>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
 #define ENABLE_JSON_RPC_LOG
 
 namespace taiyi { namespace plugins { namespace json_rpc {
@@ -33,7 +39,24 @@ namespace taiyi { namespace plugins { namespace json_rpc {
             fc::optional< fc::variant >      result;
             fc::optional< json_rpc_error >   error;
             fc::variant                      id;
+            
+            std::string                      raw_result;     ///< Result already written as JSON by a stream method, not reflected
         };
+        
+        void write_response( std::string& out, const json_rpc_response& response )
+        {
+            if( response.raw_result.empty() )
+            {
+                out += fc::json::to_string( response );
+                return;
+            }
+            
+            out += "{\"jsonrpc\":\"2.0\",\"result\":";
+            out += response.raw_result;
+            out += ",\"id\":";
+            out += fc::json::to_string( response.id );
+            out += '}';
+        }
 
         typedef void_type             get_methods_args;
         typedef vector< string >      get_methods_return;
@@ -44,6 +67,100 @@ namespace taiyi { namespace plugins { namespace json_rpc {
         };
 
         typedef api_method_signature  get_signature_return;
+
+        struct get_method_stats_args
+        {
+            vector< string > methods;   ///< Canonical api.method names, empty for every method that has been called
+        };
+
+        struct api_method_stats
+        {
+            string               method;
+            uint64_t             count = 0;
+            uint64_t             errors = 0;
+            uint64_t             total_us = 0;
+            uint64_t             max_us = 0;
+            vector< uint64_t >   buckets;    ///< Call counts per latency bucket, see bucket_bounds_us
+        };
+
+        struct get_method_stats_return
+        {
+            vector< uint64_t >           bucket_bounds_us;   ///< Exclusive upper bound of each bucket, the last bucket is unbounded
+            vector< api_method_stats >   stats;
+        };
+
+        /**
+         * Latency histogram of one api method, buckets double in width starting at 1us.
+         * Updated from every thread executing calls without locking.
+         */
+        class method_latency_histogram
+        {
+        public:
+            static const uint32_t bucket_count = 24;
+
+            method_latency_histogram()
+            {
+                for( auto& b : _buckets )
+                    b.store( 0, std::memory_order_relaxed );
+            }
+
+            static uint64_t bucket_bound( uint32_t bucket ) { return uint64_t( 1 ) << bucket; }
+
+            void record( uint64_t us, bool error )
+            {
+                uint32_t bucket = 0;
+                while( bucket + 1 < bucket_count && us >= bucket_bound( bucket ) )
+                    ++bucket;
+
+                _buckets[ bucket ].fetch_add( 1, std::memory_order_relaxed );
+                _count.fetch_add( 1, std::memory_order_relaxed );
+                _total_us.fetch_add( us, std::memory_order_relaxed );
+                if( error )
+                    _errors.fetch_add( 1, std::memory_order_relaxed );
+
+                uint64_t max_us = _max_us.load( std::memory_order_relaxed );
+                while( us > max_us && !_max_us.compare_exchange_weak( max_us, us, std::memory_order_relaxed ) ) {}
+            }
+
+            api_method_stats get( const string& method )const
+            {
+                api_method_stats result;
+                result.method = method;
+                result.count = _count.load( std::memory_order_relaxed );
+                result.errors = _errors.load( std::memory_order_relaxed );
+                result.total_us = _total_us.load( std::memory_order_relaxed );
+                result.max_us = _max_us.load( std::memory_order_relaxed );
+                result.buckets.reserve( bucket_count );
+                for( const auto& b : _buckets )
+                    result.buckets.push_back( b.load( std::memory_order_relaxed ) );
+                return result;
+            }
+
+        private:
+            std::atomic< uint64_t >                             _count{ 0 };
+            std::atomic< uint64_t >                             _errors{ 0 };
+            std::atomic< uint64_t >                             _total_us{ 0 };
+            std::atomic< uint64_t >                             _max_us{ 0 };
+            std::array< std::atomic< uint64_t >, bucket_count > _buckets;
+        };
+
+        /**
+         * Shared by the calling thread and the executor tasks of one batch. Tasks that start
+         * after every element has been taken return without touching the messages.
+         */
+        struct batch_state
+        {
+            batch_state( vector< fc::variant >&& m, fc::time_point d ) : messages( std::move( m ) ), responses( messages.size() ), deadline( d ) {}
+
+            vector< fc::variant >        messages;
+            vector< json_rpc_response >  responses;
+            fc::time_point               deadline;
+
+            std::atomic< size_t >        next{ 0 };
+            std::atomic< size_t >        finished{ 0 };
+            std::mutex                   mutex;
+            std::condition_variable      done;
+        };
         
         class json_rpc_logger
         {
@@ -130,12 +247,18 @@ namespace taiyi { namespace plugins { namespace json_rpc {
             ~json_rpc_plugin_impl();
             
             void add_api_method( const string& api_name, const string& method_name, const api_method& api, const api_method_signature& sig );
+            void add_api_stream_method( const string& api_name, const string& method_name, const api_stream_method& api );
+            void add_read_only_method( const string& api_name, const string& method_name );
             
             api_method* find_api_method( std::string api, std::string method );
             api_method* process_params( string method, const fc::variant_object& request, fc::variant& func_args, string* method_name );
             void rpc_id( const fc::variant_object& request, json_rpc_response& response );
             void rpc_jsonrpc( const fc::variant_object& request, json_rpc_response& response );
             json_rpc_response rpc( const fc::variant& message );
+            json_rpc_response batch_timeout( const fc::variant& message );
+            bool is_read_only( const fc::variant& message )const;
+            vector< json_rpc_response > rpc_batch( vector< fc::variant >&& messages );
+            void run_batch( batch_state& batch );
             
             void initialize();
             
@@ -148,12 +271,24 @@ namespace taiyi { namespace plugins { namespace json_rpc {
             DECLARE_API(
                 (get_methods)
                 (get_signature)
+                (get_method_stats)
             )
             
             map< string, api_description >                     _registered_apis;
             vector< string >                                   _methods;
             map< string, map< string, api_method_signature > > _method_sigs;
+            map< string, api_stream_method >                   _stream_methods;
+            std::set< string >                                 _read_only_methods;
+            bool                                               _stream_serialization = true;
             std::unique_ptr< json_rpc_logger >                 _logger;
+
+            /** Filled while apis are registered, read only afterwards */
+            map< string, std::unique_ptr< method_latency_histogram > >  _method_stats;
+
+            batch_executor                                     _batch_executor;
+            uint32_t                                           _batch_max_size = 0;
+            fc::microseconds                                   _batch_time_budget;
+            uint32_t                                           _batch_concurrency = 1;
         };
 
         json_rpc_plugin_impl::json_rpc_plugin_impl() {}
@@ -167,11 +302,27 @@ namespace taiyi { namespace plugins { namespace json_rpc {
             std::stringstream canonical_name;
             canonical_name << api_name << '.' << method_name;
             _methods.push_back( canonical_name.str() );
+            _method_stats[ canonical_name.str() ].reset( new method_latency_histogram() );
+        }
+        
+        void json_rpc_plugin_impl::add_api_stream_method( const string& api_name, const string& method_name, const api_stream_method& api )
+        {
+            string canonical_name = api_name + "." + method_name;
+            FC_ASSERT( _method_stats.count( canonical_name ), "Method ${m} must be registered before its stream method", ("m", canonical_name) );
+            _stream_methods[ canonical_name ] = api;
+        }
+        
+        void json_rpc_plugin_impl::add_read_only_method( const string& api_name, const string& method_name )
+        {
+            string canonical_name = api_name + "." + method_name;
+            FC_ASSERT( _method_stats.count( canonical_name ), "Method ${m} must be registered before it is marked read-only", ("m", canonical_name) );
+            _read_only_methods.insert( canonical_name );
         }
 
         void json_rpc_plugin_impl::initialize()
         {
             JSON_RPC_REGISTER_API( "jsonrpc" );
+            JSON_RPC_REGISTER_READ_ONLY_API( "jsonrpc" );
         }
         
         get_methods_return json_rpc_plugin_impl::get_methods( const get_methods_args& args, bool lock )
@@ -196,6 +347,36 @@ namespace taiyi { namespace plugins { namespace json_rpc {
             return method_itr->second;
         }
         
+        get_method_stats_return json_rpc_plugin_impl::get_method_stats( const get_method_stats_args& args, bool lock )
+        {
+            FC_UNUSED( lock )
+            get_method_stats_return result;
+            
+            for( uint32_t i = 0; i < method_latency_histogram::bucket_count; ++i )
+                result.bucket_bounds_us.push_back( method_latency_histogram::bucket_bound( i ) );
+            
+            if( args.methods.empty() )
+            {
+                for( const auto& s : _method_stats )
+                {
+                    auto stats = s.second->get( s.first );
+                    if( stats.count )
+                        result.stats.push_back( std::move( stats ) );
+                }
+            }
+            else
+            {
+                for( const auto& m : args.methods )
+                {
+                    auto itr = _method_stats.find( m );
+                    FC_ASSERT( itr != _method_stats.end(), "Method ${m} does not exist.", ("m", m) );
+                    result.stats.push_back( itr->second->get( m ) );
+                }
+            }
+            
+            return result;
+        }
+        
         api_method* json_rpc_plugin_impl::find_api_method( std::string api, std::string method )
         {
             auto api_itr = _registered_apis.find( api );
@@ -298,7 +479,31 @@ namespace taiyi { namespace plugins { namespace json_rpc {
                             {
                                 if( call )
                                 {
-                                    response.result = (*call)( func_args );
+                                    auto& stats = *_method_stats.at( method_name );
+                                    auto start = fc::time_point::now();
+                                    
+                                    try
+                                    {
+                                        // The logger records results as variants
+                                        auto stream = ( _stream_serialization && !_logger ) ? _stream_methods.find( method_name ) : _stream_methods.end();
+                                        if( stream != _stream_methods.end() )
+                                        {
+                                            string raw;
+                                            stream->second( func_args, raw );
+                                            response.raw_result = std::move( raw );
+                                        }
+                                        else
+                                        {
+                                            response.result = (*call)( func_args );
+                                        }
+                                    }
+                                    catch( ... )
+                                    {
+                                        stats.record( ( fc::time_point::now() - start ).count(), true );
+                                        throw;
+                                    }
+                                    
+                                    stats.record( ( fc::time_point::now() - start ).count(), false );
                                 }
                             }
                             catch( const chainbase::lock_exception& e )
@@ -388,6 +593,89 @@ namespace taiyi { namespace plugins { namespace json_rpc {
             return response;
         }
         
+        json_rpc_response json_rpc_plugin_impl::batch_timeout( const fc::variant& message )
+        {
+            json_rpc_response response;
+            
+            if( message.is_object() )
+                rpc_id( message.get_object(), response );
+            
+            if( !response.error.valid() )
+                response.error = json_rpc_error( JSON_RPC_SERVER_ERROR, "Batch time budget of " + std::to_string( _batch_time_budget.count() / 1000 ) + "ms exceeded before the request started" );
+            
+            return response;
+        }
+        
+        void json_rpc_plugin_impl::run_batch( batch_state& batch )
+        {
+            const size_t size = batch.messages.size();
+            
+            for( size_t i = batch.next++; i < size; i = batch.next++ )
+            {
+                if( fc::time_point::now() > batch.deadline )
+                    batch.responses[ i ] = batch_timeout( batch.messages[ i ] );
+                else
+                    batch.responses[ i ] = rpc( batch.messages[ i ] );
+                
+                if( ++batch.finished == size )
+                {
+                    std::lock_guard< std::mutex > guard( batch.mutex );
+                    batch.done.notify_all();
+                }
+            }
+        }
+        
+        bool json_rpc_plugin_impl::is_read_only( const fc::variant& message )const
+        {
+            if( !message.is_object() )
+                return false;
+            
+            const auto& request = message.get_object();
+            if( !request.contains( "method" ) || !request[ "method" ].is_string() )
+                return false;
+            
+            string method = request[ "method" ].as_string();
+            if( method == "call" )
+            {
+                if( !request.contains( "params" ) || !request[ "params" ].is_array() )
+                    return false;
+                
+                const auto& v = request[ "params" ].get_array();
+                if( v.size() < 2 || !v[0].is_string() || !v[1].is_string() )
+                    return false;
+                
+                method = v[0].as_string() + "." + v[1].as_string();
+            }
+            
+            return _read_only_methods.count( method ) > 0;
+        }
+        
+        vector< json_rpc_response > json_rpc_plugin_impl::rpc_batch( vector< fc::variant >&& messages )
+        {
+            fc::time_point deadline = _batch_time_budget.count() ? fc::time_point::now() + _batch_time_budget : fc::time_point::maximum();
+            auto batch = std::make_shared< batch_state >( std::move( messages ), deadline );
+            
+            // A later request may depend on the state changed by an earlier one, e.g. two broadcasts spending the same balance,
+            // so only batches that change nothing run out of order.
+            // The logger writes numbered files and is not thread safe.
+            if( _batch_executor && !_logger && _batch_concurrency > 1
+                && std::all_of( batch->messages.begin(), batch->messages.end(), [this]( const fc::variant& m ) { return is_read_only( m ); } ) )
+            {
+                size_t helpers = std::min< size_t >( batch->messages.size(), _batch_concurrency ) - 1;
+                for( size_t i = 0; i < helpers; ++i )
+                    _batch_executor( [this, batch]() { run_batch( *batch ); } );
+            }
+            
+            // The calling thread may itself be an executor thread, so it takes elements too instead of only waiting.
+            // Afterwards it only waits for elements other threads have already started.
+            run_batch( *batch );
+            
+            std::unique_lock< std::mutex > lock( batch->mutex );
+            batch->done.wait( lock, [&batch]() { return batch->finished == batch->messages.size(); } );
+            
+            return std::move( batch->responses );
+        }
+        
     } //detail
 
     using detail::json_rpc_error;
@@ -401,6 +689,10 @@ namespace taiyi { namespace plugins { namespace json_rpc {
     {
         cfg.add_options()
             ("log-json-rpc", bpo::value< string >(), "json-rpc log directory name.")
+            ("rpc-batch-max-size", bpo::value< uint32_t >()->default_value( 0 ), "Maximum number of requests in a batch, 0 for no limit.")
+            ("rpc-batch-time-budget-ms", bpo::value< uint32_t >()->default_value( 0 ), "Requests of a batch not started within this many milliseconds are answered with an error, 0 for no limit.")
+            ("rpc-stream-serialization", bpo::value< bool >()->default_value( true ), "Write results of methods that support it as JSON directly instead of through fc::variant.")
+            ("rpc-batch-concurrency", bpo::value< uint32_t >()->default_value( 8 ), "Maximum number of threads executing the requests of one batch made only of read-only methods, 1 executes all batches sequentially. Batches with other methods always run sequentially.")
         ;
     }
 
@@ -408,6 +700,11 @@ namespace taiyi { namespace plugins { namespace json_rpc {
     {
         my->initialize();
         
+        my->_batch_max_size = options.at( "rpc-batch-max-size" ).as< uint32_t >();
+        my->_batch_time_budget = fc::milliseconds( options.at( "rpc-batch-time-budget-ms" ).as< uint32_t >() );
+        my->_stream_serialization = options.at( "rpc-stream-serialization" ).as< bool >();
+        my->_batch_concurrency = std::max< uint32_t >( options.at( "rpc-batch-concurrency" ).as< uint32_t >(), 1 );
+        
         if( options.count( "log-json-rpc" ) )
         {
             auto dir_name = options.at( "log-json-rpc" ).as< string >();
@@ -432,6 +729,21 @@ namespace taiyi { namespace plugins { namespace json_rpc {
     {
         my->add_api_method( api_name, method_name, api, sig );
     }
+    
+    void json_rpc_plugin::add_api_stream_method( const string& api_name, const string& method_name, const api_stream_method& api )
+    {
+        my->add_api_stream_method( api_name, method_name, api );
+    }
+
+    void json_rpc_plugin::add_read_only_method( const string& api_name, const string& method_name )
+    {
+        my->add_read_only_method( api_name, method_name );
+    }
+    
+    void json_rpc_plugin::set_batch_executor( const batch_executor& executor )
+    {
+        my->_batch_executor = executor;
+    }
 
     string json_rpc_plugin::call( const string& message )
     {
@@ -442,16 +754,28 @@ namespace taiyi { namespace plugins { namespace json_rpc {
             if( v.is_array() )
             {
                 vector< fc::variant > messages = v.as< vector< fc::variant > >();
-                vector< json_rpc_response > responses;
+                
+                if( my->_batch_max_size && messages.size() > my->_batch_max_size )
+                {
+                    json_rpc_response response;
+                    response.error = json_rpc_error( JSON_RPC_INVALID_REQUEST, "Batch of " + std::to_string( messages.size() ) + " requests exceeds the limit of " + std::to_string( my->_batch_max_size ) );
+                    return fc::json::to_string( response );
+                }
                 
                 if( messages.size() )
                 {
-                    responses.reserve( messages.size() );
+                    auto responses = my->rpc_batch( std::move( messages ) );
                     
-                    for( auto& m : messages )
-                        responses.push_back( my->rpc( m ) );
+                    string out = "[";
+                    for( size_t i = 0; i < responses.size(); ++i )
+                    {
+                        if( i )
+                            out += ',';
+                        detail::write_response( out, responses[i] );
+                    }
+                    out += ']';
                     
-                    return fc::json::to_string( responses );
+                    return out;
                 }
                 else
                 {
@@ -463,7 +787,9 @@ namespace taiyi { namespace plugins { namespace json_rpc {
             }
             else
             {
-                return fc::json::to_string( my->rpc( v ) );
+                string out;
+                detail::write_response( out, my->rpc( v ) );
+                return out;
             }
         }
         catch( const fc::exception& e )
@@ -486,3 +812,6 @@ FC_REFLECT( taiyi::plugins::json_rpc::detail::json_rpc_error, (code)(message)(da
 FC_REFLECT( taiyi::plugins::json_rpc::detail::json_rpc_response, (jsonrpc)(result)(error)(id) )
 
 FC_REFLECT( taiyi::plugins::json_rpc::detail::get_signature_args, (method) )
+FC_REFLECT( taiyi::plugins::json_rpc::detail::get_method_stats_args, (methods) )
+FC_REFLECT( taiyi::plugins::json_rpc::detail::api_method_stats, (method)(count)(errors)(total_us)(max_us)(buckets) )
+FC_REFLECT( taiyi::plugins::json_rpc::detail::get_method_stats_return, (bucket_bounds_us)(stats) )
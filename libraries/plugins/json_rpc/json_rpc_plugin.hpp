@@ -2,6 +2,8 @@
 #include <chain/taiyi_fwd.hpp>
 #include <appbase/application.hpp>
 
+#include <plugins/json_rpc/json_stream.hpp>
+
 #include <fc/variant.hpp>
 #include <fc/io/json.hpp>
 #include <fc/reflect/variant.hpp>
@@ -9,6 +11,10 @@
 
 #include <boost/config.hpp>
 #include <boost/any.hpp>
+#include <boost/preprocessor/seq/for_each.hpp>
+#include <boost/preprocessor/stringize.hpp>
+
+#include <set>
 
 /**
  * This plugin holds bindings for all APIs and their methods
@@ -43,6 +49,39 @@
    for_each_api( vtor );                                                                        \
 }
 
+#define JSON_RPC_METHOD_NAME( r, data, method ) BOOST_PP_STRINGIZE( method ),
+
+/**
+ * Results of the listed methods are serialized with to_json_stream instead of through fc::variant.
+ * Use after JSON_RPC_REGISTER_API.
+ */
+#define JSON_RPC_REGISTER_STREAM_METHODS( API_NAME, METHODS )                                   \
+{                                                                                               \
+   taiyi::plugins::json_rpc::detail::register_api_stream_method_visitor vtor( API_NAME,          \
+      { BOOST_PP_SEQ_FOR_EACH( JSON_RPC_METHOD_NAME, _, METHODS ) } );                            \
+   for_each_api( vtor );                                                                        \
+}
+
+/**
+ * The listed methods do not change state, a batch made only of such methods may run concurrently.
+ * Use after JSON_RPC_REGISTER_API.
+ */
+#define JSON_RPC_REGISTER_READ_ONLY_METHODS( API_NAME, METHODS )                                \
+{                                                                                               \
+   taiyi::plugins::json_rpc::detail::register_read_only_method_visitor vtor( API_NAME,           \
+      { BOOST_PP_SEQ_FOR_EACH( JSON_RPC_METHOD_NAME, _, METHODS ) } );                            \
+   for_each_api( vtor );                                                                        \
+}
+
+/**
+ * No method of the api changes state. Use after JSON_RPC_REGISTER_API.
+ */
+#define JSON_RPC_REGISTER_READ_ONLY_API( API_NAME )                                             \
+{                                                                                               \
+   taiyi::plugins::json_rpc::detail::register_read_only_method_visitor vtor( API_NAME );         \
+   for_each_api( vtor );                                                                        \
+}
+
 #define JSON_RPC_PARSE_ERROR        (-32700)
 #define JSON_RPC_INVALID_REQUEST    (-32600)
 #define JSON_RPC_METHOD_NOT_FOUND   (-32601)
@@ -74,6 +113,22 @@ namespace taiyi { namespace plugins { namespace json_rpc {
      */
     typedef std::map< string, api_method > api_description;
 
+    /**
+     * @brief Internal type used to bind api methods whose
+     * result is written as JSON directly.
+     *
+     * Arguments: Variant object of propert arg type, output the JSON result is appended to
+     */
+    typedef std::function< void( const fc::variant&, std::string& ) > api_stream_method;
+
+    /**
+     * @brief Runs a task on another thread.
+     *
+     * Used to execute the elements of a batch request concurrently.
+     * The task may be run after the batch has already completed.
+     */
+    typedef std::function< void( const std::function< void() >& ) > batch_executor;
+
     struct api_method_signature
     {
         fc::variant args;
@@ -101,8 +156,17 @@ namespace taiyi { namespace plugins { namespace json_rpc {
         virtual void plugin_shutdown() override;
         
         void add_api_method( const string& api_name, const string& method_name, const api_method& api, const api_method_signature& sig );
+        void add_api_stream_method( const string& api_name, const string& method_name, const api_stream_method& api );
+        void add_read_only_method( const string& api_name, const string& method_name );
         string call( const string& body );
         
+        /**
+         * Elements of a batch request made only of read-only methods are spread over the executor
+         * while the calling thread works on them as well. Other batches, and all batches without
+         * an executor, run sequentially in request order. Must not be changed while calls are in progress.
+         */
+        void set_batch_executor( const batch_executor& executor );
+        
     private:
         std::unique_ptr< detail::json_rpc_plugin_impl > my;
     };
@@ -132,6 +196,53 @@ namespace taiyi { namespace plugins { namespace json_rpc {
             taiyi::plugins::json_rpc::json_rpc_plugin& _json_rpc_plugin;
         };
         
+        class register_api_stream_method_visitor
+        {
+        public:
+            register_api_stream_method_visitor( const std::string& api_name, std::set< std::string > methods ) : _api_name( api_name ), _methods( std::move( methods ) ), _json_rpc_plugin( appbase::app().get_plugin< taiyi::plugins::json_rpc::json_rpc_plugin >() )
+            {}
+            
+            template< typename Plugin, typename Method, typename Args, typename Ret >
+            void operator()(Plugin& plugin, const std::string& method_name, Method method, Args* args, Ret* ret )
+            {
+                if( _methods.count( method_name ) == 0 )
+                    return;
+                
+                _json_rpc_plugin.add_api_stream_method(
+                    _api_name,
+                    method_name,
+                    [&plugin,method]( const fc::variant& args, std::string& out ) { to_json_stream( out, (plugin.*method)( args.as< Args >(), true ) ); }
+                );
+            }
+            
+        private:
+            std::string _api_name;
+            std::set< std::string > _methods;
+            taiyi::plugins::json_rpc::json_rpc_plugin& _json_rpc_plugin;
+        };
+        
+        class register_read_only_method_visitor
+        {
+        public:
+            /** Without methods every method of the api is read-only */
+            register_read_only_method_visitor( const std::string& api_name, std::set< std::string > methods = std::set< std::string >() ) : _api_name( api_name ), _methods( std::move( methods ) ), _json_rpc_plugin( appbase::app().get_plugin< taiyi::plugins::json_rpc::json_rpc_plugin >() )
+            {}
+            
+            template< typename Plugin, typename Method, typename Args, typename Ret >
+            void operator()(Plugin& plugin, const std::string& method_name, Method method, Args* args, Ret* ret )
+            {
+                if( _methods.size() && _methods.count( method_name ) == 0 )
+                    return;
+                
+                _json_rpc_plugin.add_read_only_method( _api_name, method_name );
+            }
+            
+        private:
+            std::string _api_name;
+            std::set< std::string > _methods;
+            taiyi::plugins::json_rpc::json_rpc_plugin& _json_rpc_plugin;
+        };
+        
     } //detail
 
 } } } // taiyi::plugins::json_rpc
@@ -0,0 +1,238 @@
+#pragma once
+
+#include <protocol/fixed_string.hpp>
+
+#include <chainbase/chainbase.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/optional.hpp>
+#include <fc/reflect/reflect.hpp>
+#include <fc/variant.hpp>
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Streaming JSON serializer for api results.
+ *
+ * Reflected types marked with JSON_RPC_STREAM_REFLECTED are written field by field straight
+ * into the output string, as are integers, strings, account names, object ids, optionals and
+ * vectors. Every other type is converted with fc::to_variant and written with fc::json, so the
+ * output is identical to fc::json::to_string( fc::variant( value ) ).
+ *
+ * Only mark types whose fc::to_variant is the generic reflected one. Mark them next to their
+ * FC_REFLECT, in a header included wherever the type is serialized.
+ */
+
+namespace taiyi { namespace plugins { namespace json_rpc {
+
+    template< typename T > struct json_stream_reflected : std::false_type {};
+
+    template< typename T > void to_json_stream( std::string& out, const T& v );
+
+    namespace detail { namespace json_stream {
+
+        inline void write_string( std::string& out, const char* s, size_t n )
+        {
+            static const char hex[] = "0123456789abcdef";
+
+            out += '"';
+            for( size_t i = 0; i < n; ++i )
+            {
+                char c = s[i];
+                switch( c )
+                {
+                    case '\b': out += "\\b"; break;
+                    case '\f': out += "\\f"; break;
+                    case '\n': out += "\\n"; break;
+                    case '\r': out += "\\r"; break;
+                    case '\t': out += "\\t"; break;
+                    case '\\': out += "\\\\"; break;
+                    case '\"': out += "\\\""; break;
+                    default:
+                        if( uint8_t( c ) < 0x20 )
+                        {
+                            out += "\\u00";
+                            out += hex[ uint8_t( c ) >> 4 ];
+                            out += hex[ uint8_t( c ) & 0xf ];
+                        }
+                        else
+                            out += c;
+                }
+            }
+            out += '"';
+        }
+
+        /** Large integers are quoted, the same as fc::json::stringify_large_ints_and_doubles */
+        inline void write_int( std::string& out, int64_t i )
+        {
+            if( i > 0xffffffff )
+                out += '"' + std::to_string( i ) + '"';
+            else
+                out += std::to_string( i );
+        }
+
+        inline void write_uint( std::string& out, uint64_t i )
+        {
+            if( i > 0xffffffff )
+                out += '"' + std::to_string( i ) + '"';
+            else
+                out += std::to_string( i );
+        }
+
+        template< typename T >
+        using is_number = std::integral_constant< bool, std::is_integral< T >::value && !std::is_same< T, bool >::value && !std::is_same< T, char >::value >;
+
+        template< typename T >
+        void write( std::string& out, const T& v );
+
+        template< typename T >
+        class member_writer
+        {
+        public:
+            member_writer( std::string& out, const T& val ) : _out( out ), _val( val ) {}
+
+            template< typename Member, class Class, Member (Class::*member) >
+            void operator()( const char* name )const { add( name, _val.*member ); }
+
+        private:
+            template< typename M >
+            void add( const char* name, const M& m )const
+            {
+                key( name );
+                write( _out, m );
+            }
+
+            /** Unset optional members are left out, as fc::to_variant does for reflected objects */
+            template< typename M >
+            void add( const char* name, const fc::optional< M >& m )const
+            {
+                if( m.valid() )
+                    add( name, *m );
+            }
+
+            void key( const char* name )const
+            {
+                if( !_first )
+                    _out += ',';
+                _first = false;
+                _out += '"';
+                _out += name;
+                _out += "\":";
+            }
+
+            std::string&    _out;
+            const T&        _val;
+            mutable bool    _first = true;
+        };
+
+        /** Types without their own writer, either walked by reflection or converted through fc::variant */
+        template< typename T, typename Enable = void >
+        struct writer
+        {
+            static void write( std::string& out, const T& v ) { write( out, v, std::integral_constant< bool, json_stream_reflected< T >::value >() ); }
+
+            static void write( std::string& out, const T& v, std::true_type )
+            {
+                out += '{';
+                fc::reflector< T >::visit( member_writer< T >( out, v ) );
+                out += '}';
+            }
+
+            static void write( std::string& out, const T& v, std::false_type )
+            {
+                out += fc::json::to_string( fc::variant( v ) );
+            }
+        };
+
+        template<>
+        struct writer< bool >
+        {
+            static void write( std::string& out, bool v ) { out += v ? "true" : "false"; }
+        };
+
+        template<>
+        struct writer< std::string >
+        {
+            static void write( std::string& out, const std::string& v ) { write_string( out, v.data(), v.size() ); }
+        };
+
+        template< typename T >
+        struct writer< T, typename std::enable_if< is_number< T >::value >::type >
+        {
+            static void write( std::string& out, const T& v )
+            {
+                if( std::is_signed< T >::value )
+                    write_int( out, int64_t( v ) );
+                else
+                    write_uint( out, uint64_t( v ) );
+            }
+        };
+
+        template< typename Storage >
+        struct writer< taiyi::protocol::fixed_string_impl< Storage > >
+        {
+            static void write( std::string& out, const taiyi::protocol::fixed_string_impl< Storage >& v )
+            {
+                std::string s( v );
+                write_string( out, s.data(), s.size() );
+            }
+        };
+
+        template< typename T >
+        struct writer< chainbase::oid< T > >
+        {
+            static void write( std::string& out, const chainbase::oid< T >& v ) { write_int( out, v._id ); }
+        };
+
+        template< typename T >
+        struct writer< fc::optional< T > >
+        {
+            static void write( std::string& out, const fc::optional< T >& v )
+            {
+                if( v.valid() )
+                    json_stream::write( out, *v );
+                else
+                    out += "null";
+            }
+        };
+
+        /** vector<char> is written as hex by fc and goes through fc::variant */
+        template< typename T >
+        struct writer< std::vector< T >, typename std::enable_if< !std::is_same< T, char >::value >::type >
+        {
+            static void write( std::string& out, const std::vector< T >& v )
+            {
+                out += '[';
+                for( size_t i = 0; i < v.size(); ++i )
+                {
+                    if( i )
+                        out += ',';
+                    json_stream::write( out, v[i] );
+                }
+                out += ']';
+            }
+        };
+
+        template< typename T >
+        void write( std::string& out, const T& v )
+        {
+            writer< T >::write( out, v );
+        }
+
+    } } // detail::json_stream
+
+    template< typename T >
+    void to_json_stream( std::string& out, const T& v )
+    {
+        detail::json_stream::write( out, v );
+    }
+
+} } } // taiyi::plugins::json_rpc
+
+/**
+ *  This macro must be used at global scope, after FC_REFLECT of TYPE, and TYPE must be fully qualified
+ */
+#define JSON_RPC_STREAM_REFLECTED( TYPE ) \
+    namespace taiyi { namespace plugins { namespace json_rpc { template<> struct json_stream_reflected< TYPE > : std::true_type {}; } } }
@@ -0,0 +1,112 @@
+#include <plugins/siming/block_packer.hpp>
+
+#include <algorithm>
+#include <limits>
+
+namespace taiyi { namespace plugins { namespace siming {
+
+    block_packing_priority block_packing_priority_from_string( const std::string& s )
+    {
+        if( s == "age" )
+            return block_packing_priority::age;
+        if( s == "qi" )
+            return block_packing_priority::qi_cost;
+        if( s == "size" )
+            return block_packing_priority::size;
+        FC_THROW( "Unknown block packing priority ${s}, expected one of age, qi, size", ("s", s) );
+    }
+    //=============================================================================
+    std::vector< const chain::pending_transaction* > block_packer::order_candidates( const chain::pending_transaction_pool& pool, fc::time_point_sec when, uint32_t* expired )const
+    {
+        std::vector< const chain::pending_transaction* > candidates;
+        candidates.reserve( pool.size() );
+        uint32_t n_expired = 0;
+        for( const auto& ptx : pool.by_arrival() )
+        {
+            if( ptx.expiration < when )
+            {
+                ++n_expired;
+                continue;
+            }
+            candidates.push_back( &ptx );
+        }
+        if( expired )
+            *expired = n_expired;
+
+        //稳定排序，优先级相同时保持到达顺序
+        switch( _priority )
+        {
+            case block_packing_priority::age:
+                break;
+            case block_packing_priority::qi_cost:
+                std::stable_sort( candidates.begin(), candidates.end(), []( const chain::pending_transaction* a, const chain::pending_transaction* b ) {
+                    return a->qi_cost > b->qi_cost;
+                } );
+                break;
+            case block_packing_priority::size:
+                std::stable_sort( candidates.begin(), candidates.end(), []( const chain::pending_transaction* a, const chain::pending_transaction* b ) {
+                    return a->size < b->size;
+                } );
+                break;
+        }
+        return candidates;
+    }
+    //=============================================================================
+    block_packing_result block_packer::pack( const chain::pending_transaction_pool& pool, fc::time_point_sec when, uint64_t block_size, uint64_t maximum_block_size, const apply_function& apply )const
+    {
+        block_packing_result result;
+        auto candidates = order_candidates( pool, when, &result.expired );
+        result.packed.reserve( candidates.size() );
+
+        //min_size[i]是第i个以及之后所有候选交易中最小的大小
+        std::vector< uint32_t > min_size( candidates.size() + 1, std::numeric_limits< uint32_t >::max() );
+        for( size_t i = candidates.size(); i > 0; --i )
+            min_size[ i - 1 ] = std::min( min_size[ i ], candidates[ i - 1 ]->size );
+
+        std::vector< const chain::pending_transaction* > failed;
+        for( size_t i = 0; i < candidates.size(); ++i )
+        {
+            if( block_size + min_size[ i ] >= maximum_block_size )
+            {
+                result.postponed += candidates.size() - i;
+                break;
+            }
+
+            const auto* ptx = candidates[ i ];
+            if( block_size + ptx->size >= maximum_block_size )
+            {
+                ++result.postponed;
+                continue;
+            }
+
+            if( apply( *ptx ) )
+            {
+                block_size += ptx->size;
+                result.packed.push_back( ptx );
+            }
+            else
+                failed.push_back( ptx );
+        }
+
+        if( _priority != block_packing_priority::age && result.packed.size() )
+        {
+            for( const auto* ptx : failed )
+            {
+                if( block_size + ptx->size < maximum_block_size && apply( *ptx ) )
+                {
+                    block_size += ptx->size;
+                    result.packed.push_back( ptx );
+                    ++result.retried;
+                }
+                else
+                    ++result.failed;
+            }
+        }
+        else
+            result.failed = failed.size();
+
+        result.block_size = block_size;
+        return result;
+    }
+
+} } } // taiyi::plugins::siming
@@ -0,0 +1,60 @@
+#pragma once
+#include <chain/pending_transaction_pool.hpp>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace taiyi { namespace plugins { namespace siming {
+
+    enum class block_packing_priority
+    {
+        age,        ///< 按到达顺序
+        qi_cost,    ///< 消耗气多的交易优先，相同时按到达顺序
+        size        ///< 小交易优先，相同时按到达顺序
+    };
+
+    block_packing_priority block_packing_priority_from_string( const std::string& s );
+
+    struct block_packing_result
+    {
+        std::vector< const chain::pending_transaction* > packed;    ///< 按应用顺序
+        uint64_t    block_size = 0;         ///< 打包后的区块大小
+        uint32_t    expired = 0;
+        uint32_t    postponed = 0;          ///< 区块放不下而留在交易池中的交易
+        uint32_t    failed = 0;
+        uint32_t    retried = 0;            ///< 第一轮失败、最后重试成功的交易
+    };
+
+    /**
+     * 出块时从交易池挑选交易
+     *
+     * 交易大小在进入交易池时已经计算好。候选交易按优先级排序后依次尝试，放不下的交易只是跳过，
+     * 直到剩余空间比剩下所有候选交易都小，所以排在前面的大交易不会让后面的小交易饿死。
+     * 不按到达顺序时交易可能排在它依赖的交易前面而失败，这些交易在第一轮之后再尝试一次。
+     */
+    class block_packer
+    {
+    public:
+        /** 在当前出块状态上应用交易，失败时返回false并且不留下任何修改 */
+        typedef std::function< bool( const chain::pending_transaction& ) > apply_function;
+
+        block_packer( block_packing_priority priority = block_packing_priority::age ) : _priority( priority ) {}
+
+        void set_priority( block_packing_priority priority ) { _priority = priority; }
+        block_packing_priority get_priority()const { return _priority; }
+
+        /** 在when时还没有过期的交易，按优先级排列 */
+        std::vector< const chain::pending_transaction* > order_candidates( const chain::pending_transaction_pool& pool, fc::time_point_sec when, uint32_t* expired = nullptr )const;
+
+        /**
+         * @param block_size 还没有交易时的区块大小
+         * @param maximum_block_size 区块大小必须小于这个值
+         */
+        block_packing_result pack( const chain::pending_transaction_pool& pool, fc::time_point_sec when, uint64_t block_size, uint64_t maximum_block_size, const apply_function& apply )const;
+
+    private:
+        block_packing_priority _priority;
+    };
+
+} } } // taiyi::plugins::siming
@@ -49,10 +49,9 @@ chain::signed_block block_producer::_generate_block(fc::time_point_sec when, con
     apply_pending_transactions( siming_owner, when, pending_block );
     
     // We have temporarily broken the invariant that
-    // _pending_tx_session is the result of applying _pending_tx, as
-    // _pending_tx now consists of the set of postponed transactions.
-    // However, the push_block() call below will re-create the
-    // _pending_tx_session.
+    // _pending_tx_session is the result of applying the applied
+    // transactions of the pending transaction pool. However, the
+    // push_block() call below will re-create the _pending_tx_session.
     
     if( !(skip & chain::database::skip_siming_signature) )
         pending_block.sign( block_signing_private_key, fc::ecc::bip_0062);
@@ -111,7 +110,7 @@ void block_producer::apply_pending_transactions(const chain::account_name_type&
     // the value of the "when" variable is known, which means we need to
     // re-apply pending transactions in this method.
     //
-    _db.pending_transaction_session().reset();
+    _db.reset_pending_transaction_session();
     _db.pending_transaction_session() = _db.start_undo_session();
 
     /// modify current siming so transaction evaluators can know who included the transaction
@@ -119,56 +118,42 @@ void block_producer::apply_pending_transactions(const chain::account_name_type&
         dgp.current_siming = siming_owner;
     });
 
-    uint64_t postponed_tx_count = 0;
-    // pop pending state (reset to head block state)
-    for( const chain::signed_transaction& tx : _db._pending_tx )
-    {
-        // Only include transactions that have not expired yet for currently generating block,
-        // this should clear problem transactions and allow block production to continue
-
-        if( postponed_tx_count > TAIYI_BLOCK_GENERATION_POSTPONED_TX_LIMIT )
-            break;
-
-        if( tx.expiration < when )
-            continue;
-
-        uint64_t new_total_size = total_block_size + fc::raw::pack_size( tx );
-
-        // postpone transaction if it would make block too big
-        if( new_total_size >= maximum_transaction_partition_size )
-        {
-            postponed_tx_count++;
-            continue;
-        }
-
+    // Only include transactions that have not expired yet for currently generating block,
+    // this should clear problem transactions and allow block production to continue
+    auto result = _packer.pack( _db.get_pending_transaction_pool(), when, total_block_size, maximum_transaction_partition_size, [&]( const chain::pending_transaction& ptx ) {
         try
         {
             _db.set_producing( true ); //这使得在op执行或者响应的时候可以获得“出块验证”的标识
 
             auto temp_session = _db.start_undo_session();
-            _db.apply_transaction( tx, _db.get_node_properties().skip_flags );
+            _db.apply_transaction( ptx.trx, _db.get_node_properties().skip_flags );
             temp_session.squash();
 
             _db.set_producing( false );
-
-            total_block_size = new_total_size;
-            pending_block.transactions.push_back( tx ); //出块节点将通过验证的交易打包进新块
+            return true;
         }
         catch ( const fc::exception& e )
         {
             _db.set_producing( false );
             // Do nothing, transaction will not be re-applied
             //wlog( "Transaction was not processed while generating block due to ${e}", ("e", e) );
-            //wlog( "The transaction was ${t}", ("t", tx) );
+            //wlog( "The transaction was ${t}", ("t", ptx.trx) );
+            return false;
         }
-    }
-    if( postponed_tx_count > 0 )
+    });
+
+    //出块节点将通过验证的交易按应用的顺序打包进新块
+    pending_block.transactions.reserve( result.packed.size() );
+    for( const auto* ptx : result.packed )
+        pending_block.transactions.push_back( ptx->trx );
+
+    if( result.postponed > 0 )
     {
-        wlog( "Postponed ${n} transactions due to block size limit", ("n", _db._pending_tx.size() - pending_block.transactions.size()) );
+        wlog( "Postponed ${n} transactions due to block size limit", ("n", result.postponed) );
     }
 
     //由于是为了出块在当前状态上验证了交易，因此要回滚状态到之前的链头部
-    _db.pending_transaction_session().reset();
+    _db.reset_pending_transaction_session();
 
     pending_block.transaction_merkle_root = pending_block.calculate_merkle_root();
 }
@@ -4,6 +4,7 @@
 
 #include <plugins/chain/abstract_block_producer.hpp>
 #include <plugins/chain/chain_plugin.hpp>
+#include <plugins/siming/block_packer.hpp>
 
 namespace taiyi { namespace plugins { namespace siming {
 
@@ -20,8 +21,14 @@ namespace taiyi { namespace plugins { namespace siming {
          */
         chain::signed_block generate_block(fc::time_point_sec when, const chain::account_name_type& siming_owner, const fc::ecc::private_key& block_signing_private_key, uint32_t skip = chain::database::skip_nothing);
         
+        /**
+         * 从交易池挑选交易的优先级，默认按到达顺序
+         */
+        void set_packing_priority( block_packing_priority priority ) { _packer.set_priority( priority ); }
+        
     private:
         chain::database& _db;
+        block_packer _packer;
         
         chain::signed_block _generate_block(fc::time_point_sec when, const chain::account_name_type& siming_owner, const fc::ecc::private_key& block_signing_private_key);
         
@@ -382,6 +382,7 @@ namespace taiyi { namespace plugins { namespace siming {
             ("required-participation", bpo::value< uint32_t >()->default_value( 33 ), "Percent of simings (0-99) that must be participating in order to produce blocks")
             ("siming,w", bpo::value<vector<string>>()->composing()->multitoken(), "name of siming controlled by this node (e.g. initsiming )" )
             ("private-key", bpo::value<vector<string>>()->composing()->multitoken(), "WIF PRIVATE KEY to be used by one or more simings or miners" )
+            ("block-packing-priority", bpo::value<string>()->default_value( "age" ), "Order in which pending transactions are packed into produced blocks: age, qi (qi cost, highest first) or size (smallest first)" )
         ;
         cli.add_options()
             ("enable-stale-production", bpo::bool_switch()->default_value( false ), "Enable block production, even if the chain is stale.")
@@ -415,6 +416,8 @@ namespace taiyi { namespace plugins { namespace siming {
             my->_required_siming_participation = TAIYI_1_PERCENT * options.at( "required-participation" ).as< uint32_t >();
         }
         
+        my->_block_producer->set_packing_priority( block_packing_priority_from_string( options.at( "block-packing-priority" ).as< string >() ) );
+        
         my->_post_apply_block_conn = my->_db.add_post_apply_block_handler([&](const chain::block_notification& note) { my->on_post_apply_block( note ); }, *this, 0);
         my->_pre_apply_operation_conn = my->_db.add_pre_apply_operation_handler([&](const chain::operation_notification& note) { my->on_pre_apply_operation( note ); }, *this, 0);
         my->_post_apply_operation_conn = my->_db.add_pre_apply_operation_handler([&](const chain::operation_notification& note) { my->on_post_apply_operation( note ); }, *this, 0);
@@ -151,7 +151,7 @@ namespace taiyi { namespace plugins { namespace webserver {
             asio::io_service           thread_pool_ios;
             asio::io_service::work     thread_pool_work;
             
-            plugins::json_rpc::json_rpc_plugin* api;
+            plugins::json_rpc::json_rpc_plugin* api = nullptr;
             boost::signals2::connection         chain_sync_con;
         };
 
@@ -488,6 +488,7 @@ namespace taiyi { namespace plugins { namespace webserver {
     {
         my->api = appbase::app().find_plugin< plugins::json_rpc::json_rpc_plugin >();
         FC_ASSERT( my->api != nullptr, "Could not find API Register Plugin" );
+        my->api->set_batch_executor( [this]( const std::function< void() >& task ) { my->thread_pool_ios.post( task ); } );
         
         plugins::chain::chain_plugin* chain = appbase::app().find_plugin< plugins::chain::chain_plugin >();
         if( chain != nullptr && chain->get_state() != appbase::abstract_plugin::started )
@@ -506,6 +507,9 @@ namespace taiyi { namespace plugins { namespace webserver {
     void webserver_plugin::plugin_shutdown()
     {
         my->stop_webserver();
+        
+        if( my->api )
+            my->api->set_batch_executor( plugins::json_rpc::batch_executor() );
     }
 
 } } } // taiyi::plugins::webserver
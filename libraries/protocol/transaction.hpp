@@ -78,6 +78,15 @@ namespace taiyi { namespace protocol {
                               uint32_t max_account_auths = TAIYI_MAX_SIG_CHECK_ACCOUNTS,
                               canonical_signature_type canon_type = fc::ecc::fc_canonical)const;
         
+        /** Same as above with the keys already recovered by get_signature_keys */
+        void verify_authority(const flat_set<public_key_type>& signature_keys,
+                              const authority_getter& get_active,
+                              const authority_getter& get_owner,
+                              const authority_getter& get_posting,
+                              uint32_t max_recursion/* = TAIYI_MAX_SIG_CHECK_DEPTH*/,
+                              uint32_t max_membership = TAIYI_MAX_AUTHORITY_MEMBERSHIP,
+                              uint32_t max_account_auths = TAIYI_MAX_SIG_CHECK_ACCOUNTS)const;
+        
         set<public_key_type> minimize_required_signatures(const chain_id_type& chain_id,
                                                           const flat_set<public_key_type>& available_keys,
                                                           const authority_getter& get_active,
@@ -22,14 +22,20 @@ namespace taiyi { namespace utilities {
     public:
         struct index_memory_details_t
         {
-            index_memory_details_t(std::string&& name, size_t size, size_t i_sizeof, size_t item_add_allocation, size_t add_container_allocation) :
+            index_memory_details_t(std::string&& name, size_t size, size_t i_sizeof, size_t item_add_allocation, size_t add_container_allocation,
+                size_t undo_items = 0, size_t undo_allocation = 0, size_t undo_packed_allocation = 0,
+                size_t c_usage = 0, size_t c_size = 0) :
                 index_name(name), index_size(size), item_sizeof(i_sizeof),
                 item_additional_allocation(item_add_allocation),
-                additional_container_allocation(add_container_allocation)
+                additional_container_allocation(add_container_allocation),
+                undo_state_items(undo_items), undo_state_allocation(undo_allocation),
+                undo_state_packed_allocation(undo_packed_allocation),
+                cache_usage(c_usage), cache_size(c_size)
             {
                 total_index_mem_usage = additional_container_allocation;
                 total_index_mem_usage += item_additional_allocation;
                 total_index_mem_usage += index_size*item_sizeof;
+                total_index_mem_usage += undo_state_allocation;
             }
             
             std::string    index_name;
@@ -39,6 +45,14 @@ namespace taiyi { namespace utilities {
             size_t         item_additional_allocation = 0;
             /// Additional memory used for container internal structures (like tree nodes).
             size_t         additional_container_allocation = 0;
+            /// Entries and memory held by the undo states of the index
+            size_t         undo_state_items = 0;
+            size_t         undo_state_allocation = 0;
+            /// Part of undo_state_allocation held by serialized old values
+            size_t         undo_state_packed_allocation = 0;
+            /// Objects held in the object cache of the index and its capacity
+            size_t         cache_usage = 0;
+            size_t         cache_size = 0;
             size_t         total_index_mem_usage = 0;
         };
 
@@ -175,7 +189,7 @@ namespace taiyi { namespace utilities {
 
 } } // taiyi::utilities
 
-FC_REFLECT( taiyi::utilities::benchmark_dumper::index_memory_details_t, (index_name)(index_size)(item_sizeof)(item_additional_allocation)(additional_container_allocation)(total_index_mem_usage) )
+FC_REFLECT( taiyi::utilities::benchmark_dumper::index_memory_details_t, (index_name)(index_size)(item_sizeof)(item_additional_allocation)(additional_container_allocation)(undo_state_items)(undo_state_allocation)(undo_state_packed_allocation)(cache_usage)(cache_size)(total_index_mem_usage) )
 
 FC_REFLECT( taiyi::utilities::benchmark_dumper::database_object_sizeof_t, (object_name)(object_size) )
 
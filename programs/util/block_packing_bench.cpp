@@ -0,0 +1,180 @@
+#include <plugins/siming/block_packer.hpp>
+
+#include <protocol/config.hpp>
+#include <protocol/taiyi_operations.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/time.hpp>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace taiyi::chain;
+using namespace taiyi::plugins::siming;
+
+/**
+ * 合成交易：大多数是小交易，少数是带大量参数的合约调用，消耗的气与大小大致相关
+ */
+struct synthetic_transaction
+{
+    signed_transaction  trx;
+    int64_t             qi_cost = 0;
+};
+
+static vector< synthetic_transaction > make_transactions( std::mt19937_64& rng, uint32_t count, uint32_t& next_id, uint32_t large_per_mille )
+{
+    vector< synthetic_transaction > result;
+    result.reserve( count );
+    for( uint32_t i = 0; i < count; ++i )
+    {
+        synthetic_transaction st;
+        bool large = rng() % 1000 < large_per_mille;
+        uint32_t memo_size = large ? 8 * 1024 + rng() % ( 24 * 1024 ) : rng() % 256;
+
+        transfer_operation op;
+        op.from = "alice";
+        op.to = "bob";
+        op.amount = asset( 1, YANG_SYMBOL );
+        op.memo = string( memo_size, 'x' );
+        st.trx.operations.push_back( op );
+        st.trx.ref_block_prefix = next_id++;
+        st.trx.set_expiration( fc::time_point_sec( TAIYI_GENESIS_TIME ) + fc::hours( 1 ) );
+        st.trx.signatures.resize( 1 );
+        st.qi_cost = large ? 1000 + rng() % 50000 : rng() % 200;
+        result.push_back( std::move( st ) );
+    }
+    return result;
+}
+
+static void add_to_pool( pending_transaction_pool& pool, const vector< synthetic_transaction >& txs )
+{
+    for( const auto& st : txs )
+        pool.set_qi_cost( pool.add( st.trx, st.trx.id(), false ), st.qi_cost );
+}
+
+int main( int argc, char** argv )
+{
+    try
+    {
+        uint64_t seed = 1;
+        uint32_t initial = 20000;
+        uint32_t arrivals = 500;
+        uint32_t blocks = 50;
+        uint32_t block_size = TAIYI_MAX_BLOCK_SIZE;
+        uint32_t large_per_mille = 20;
+        uint32_t fail_per_mille = 10;
+
+        for( int i = 1; i < argc; ++i )
+        {
+            std::string arg = argv[i];
+            auto next = [&]() -> uint64_t {
+                FC_ASSERT( i + 1 < argc, "Missing value for ${a}", ("a", arg) );
+                return std::stoull( argv[++i] );
+            };
+            if( arg == "--seed" )
+                seed = next();
+            else if( arg == "--initial" )
+                initial = next();
+            else if( arg == "--arrivals" )
+                arrivals = next();
+            else if( arg == "--blocks" )
+                blocks = next();
+            else if( arg == "--block-size" )
+                block_size = next();
+            else if( arg == "--large-per-mille" )
+                large_per_mille = next();
+            else if( arg == "--fail-per-mille" )
+                fail_per_mille = next();
+            else
+            {
+                std::cerr << "block_packing_bench [--seed N] [--initial N] [--arrivals N] [--blocks N] [--block-size BYTES]\n"
+                "                    [--large-per-mille N] [--fail-per-mille N]\n"
+                "\n"
+                "Packs a synthetic mempool into consecutive blocks with every packing priority and reports\n"
+                "  transactions per block, block fill and packing latency. The mempool, the arrivals between\n"
+                "  blocks and the simulated apply failures only depend on the seed, so the counts are\n"
+                "  reproducible and only the latency varies between runs.\n"
+                "\n"
+                "  --initial:          transactions in the mempool before the first block (20000)\n"
+                "  --arrivals:         transactions arriving between two blocks (500)\n"
+                "  --blocks:           blocks to produce (50)\n"
+                "  --block-size:       maximum block size (TAIYI_MAX_BLOCK_SIZE)\n"
+                "  --large-per-mille:  share of large contract calls, 8KB to 32KB (20)\n"
+                "  --fail-per-mille:   share of transactions failing to apply (10)\n";
+                return arg == "-h" || arg == "--help" ? 0 : 1;
+            }
+        }
+
+        //所有优先级使用完全相同的交易池和到达序列
+        std::mt19937_64 rng( seed );
+        uint32_t next_id = 0;
+        auto initial_txs = make_transactions( rng, initial, next_id, large_per_mille );
+        vector< vector< synthetic_transaction > > arrival_batches;
+        for( uint32_t b = 0; b < blocks; ++b )
+            arrival_batches.push_back( make_transactions( rng, arrivals, next_id, large_per_mille ) );
+
+        fc::time_point_sec when( TAIYI_GENESIS_TIME );
+        uint64_t empty_block_size = 256;
+
+        std::cout << std::left << std::setw( 8 ) << "priority"
+            << std::right << std::setw( 12 ) << "tx/block" << std::setw( 10 ) << "fill%"
+            << std::setw( 14 ) << "avg us" << std::setw( 14 ) << "max us"
+            << std::setw( 12 ) << "applies" << std::setw( 12 ) << "failed" << std::setw( 12 ) << "retried"
+            << std::setw( 12 ) << "left" << "\n";
+
+        for( auto priority : { block_packing_priority::age, block_packing_priority::qi_cost, block_packing_priority::size } )
+        {
+            pending_transaction_pool pool;
+            add_to_pool( pool, initial_txs );
+            block_packer packer( priority );
+
+            uint64_t packed = 0, bytes = 0, applies = 0, failed = 0, retried = 0;
+            int64_t total_us = 0, max_us = 0;
+            for( uint32_t b = 0; b < blocks; ++b )
+            {
+                auto apply = [&]( const pending_transaction& ptx ) {
+                    ++applies;
+                    return ( ptx.trx.ref_block_prefix * 2654435761u ) % 1000 >= fail_per_mille;
+                };
+
+                auto start = fc::time_point::now();
+                auto result = packer.pack( pool, when, empty_block_size, block_size, apply );
+                int64_t us = ( fc::time_point::now() - start ).count();
+                total_us += us;
+                max_us = std::max( max_us, us );
+
+                packed += result.packed.size();
+                bytes += result.block_size;
+                failed += result.failed;
+                retried += result.retried;
+
+                vector< transaction_id_type > included;
+                for( const auto* ptx : result.packed )
+                    included.push_back( ptx->id );
+                pool.remove_included( included );
+                add_to_pool( pool, arrival_batches[ b ] );
+            }
+
+            const char* name = priority == block_packing_priority::age ? "age" : priority == block_packing_priority::qi_cost ? "qi" : "size";
+            std::cout << std::left << std::setw( 8 ) << name << std::right << std::fixed << std::setprecision( 1 )
+                << std::setw( 12 ) << double( packed ) / blocks
+                << std::setw( 10 ) << 100.0 * bytes / ( uint64_t( block_size ) * blocks )
+                << std::setw( 14 ) << double( total_us ) / blocks << std::setw( 14 ) << max_us
+                << std::setw( 12 ) << applies << std::setw( 12 ) << failed << std::setw( 12 ) << retried
+                << std::setw( 12 ) << pool.size() << "\n";
+        }
+
+        return 0;
+    }
+    catch( const fc::exception& e )
+    {
+        std::cerr << e.to_detail_string() << "\n";
+    }
+    return 1;
+}
@@ -0,0 +1,195 @@
+#include <lua.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <csetjmp>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * 解释器微基准：典型的合约热点循环，每个脚本开头定义了循环次数N
+ */
+struct bench_script
+{
+    const char* name;
+    const char* code;
+};
+
+static const bench_script scripts[] = {
+    { "arith",      "local s = 0 for i = 1, N do s = s + i * 2 % 7 end return s" },
+    { "branch",     "local i, c = 0, 0 while i < N do i = i + 1 if i % 3 == 0 then c = c + 1 elseif i % 5 == 0 then c = c - 1 end end return c" },
+    { "moves",      "local a, b, c, d = 1, 2, 3, 4 for i = 1, N do a, b, c, d = b, c, d, a local e = not a local f = nil end return a" },
+    { "logic",      "local x = 0 for i = 1, N do local t = (i % 2 == 0) and not (i % 3 == 0) if t then x = x + 1 end end return x" },
+    { "call",       "local function f(a, b) return a + b end local s = 0 for i = 1, N do s = f(s, i) end return s" },
+    { "upvalue",    "local c = 0 local function inc() c = c + 1 end for i = 1, N do inc() end return c" },
+    { "tailcall",   "local function f(n, a) if n == 0 then return a end return f(n - 1, a + 1) end local s = 0 for i = 1, N // 50 do s = s + f(50, 0) end return s" },
+    { "table",      "local t = {} for i = 1, N do t[i] = i end local s = 0 for i = 1, #t do s = s + t[i] end return s" },
+    { "pairs",      "local t = {} for i = 1, 100 do t[i] = i t['k' .. i] = i end local s = 0 for r = 1, N // 200 do for k, v in pairs(t) do s = s + v end for i, v in ipairs(t) do s = s + i end end return s" },
+    { "closure",    "local s = 0 for i = 1, N // 10 do local f = function() return i end s = s + f() end return s" },
+    { "metamethod", "local mt = {__add = function(a, b) return a.v + b end, __index = function(t, k) return 1 end} local o = setmetatable({v = 1}, mt) local s = 0 for i = 1, N // 10 do s = s + (o + i) + o.x end return s" },
+    { "pcall",      "local n = 0 for i = 1, N // 10 do if not pcall(error, 'x') then n = n + 1 end end return n" },
+    { "string",     "local s = 0 for i = 1, N // 10 do s = s + #tostring(i) + ('abc'):len() end return s" },
+    { "concat",     "local s = '' for i = 1, N // 1000 do s = s .. 'x' end return #s" },
+};
+
+struct run_result
+{
+    int         status = 0;
+    bool        panic = false;
+    long long   drops = 0;
+    std::string value;
+    double      seconds = 0;
+
+    bool operator==( const run_result& o )const { return status == o.status && panic == o.panic && drops == o.drops && value == o.value; }
+    bool operator!=( const run_result& o )const { return !( *this == o ); }
+};
+
+static jmp_buf panic_jump;
+
+/** 耗尽drops后释放内存也会抛出错误，在保护模式之外时跳回这里 */
+static int on_panic( lua_State* )
+{
+    longjmp( panic_jump, 1 );
+    return 0;
+}
+
+/** 在新的虚拟机中运行脚本，与合约执行一样先关闭drops载入，再打开drops运行 */
+static run_result run_script( const bench_script& s, long long n, long long budget, bool block_metering )
+{
+    run_result r;
+    lua_State* L = luaL_newstate();
+    luaL_openlibs( L );
+    lua_atpanic( L, on_panic );
+    lua_setblockmetering( L, block_metering ? 1 : 0 );
+
+    std::string code = "local N = " + std::to_string( n ) + " " + s.code;
+    if( setjmp( panic_jump ) )
+    {
+        //虚拟机状态已不可用，不再关闭
+        r.panic = true;
+        r.drops = lua_getdrops( L );
+        return r;
+    }
+
+    r.status = luaL_loadstring( L, code.c_str() );
+    auto start = std::chrono::steady_clock::now();
+    if( r.status == LUA_OK )
+    {
+        lua_enabledrops( L, 1, 1 );
+        lua_setdrops( L, budget );
+        r.status = lua_pcall( L, 0, 1, 0 );
+        r.drops = lua_getdrops( L );
+        lua_enabledrops( L, 0, 0 );
+    }
+    r.seconds = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+
+    if( r.drops >= 0 && lua_gettop( L ) > 0 && lua_type( L, -1 ) == LUA_TNUMBER )
+        r.value = lua_tostring( L, -1 );
+    lua_close( L );
+    return r;
+}
+
+/**
+ * 以两种计量方式运行脚本，结果不一致时重试几次。
+ * 虚拟机的字符串哈希种子是随机的，内存消耗的drops会随之略有不同，与计量方式无关
+ */
+static bool run_both( const bench_script& s, long long n, long long budget, run_result& op, run_result& block )
+{
+    for( int attempt = 0; attempt < 5; ++attempt )
+    {
+        op = run_script( s, n, budget, false );
+        block = run_script( s, n, budget, true );
+        if( op == block )
+            return true;
+    }
+    return false;
+}
+
+int main( int argc, char** argv )
+{
+    long long n = 2000000;
+    uint32_t repeat = 5;
+    long long sweep = 2000;
+
+    for( int i = 1; i < argc; ++i )
+    {
+        std::string arg = argv[i];
+        if( ( arg == "--n" || arg == "--repeat" || arg == "--sweep" ) && i + 1 < argc )
+        {
+            long long v = std::stoll( argv[++i] );
+            if( arg == "--n" )
+                n = v;
+            else if( arg == "--repeat" )
+                repeat = uint32_t( v );
+            else
+                sweep = v;
+        }
+        else
+        {
+            std::cerr << "lua_drops_bench [--n N] [--repeat N] [--sweep N]\n"
+            "\n"
+            "Runs interpreter micro-benchmarks with drops enabled, charging drops instruction by\n"
+            "  instruction and by basic blocks, and reports the best time of each. Fails if the two\n"
+            "  ways charge different drops, return different values, or stop at a different point\n"
+            "  for any drop budget from 1 to --sweep.\n"
+            "\n"
+            "  --n:       loop count of the benchmarks (2000000)\n"
+            "  --repeat:  runs of each benchmark, the fastest is reported (5)\n"
+            "  --sweep:   largest drop budget checked for running out of drops (2000)\n";
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+    }
+
+    const long long unlimited = 1LL << 62;
+    bool mismatch = false;
+
+    std::cout << std::left << std::setw( 12 ) << "script"
+        << std::right << std::setw( 16 ) << "drops" << std::setw( 14 ) << "per-op ms" << std::setw( 14 ) << "block ms"
+        << std::setw( 10 ) << "speedup" << "\n";
+
+    for( const auto& s : scripts )
+    {
+        run_result best_op, best_block;
+        for( uint32_t r = 0; r < repeat; ++r )
+        {
+            run_result op, block;
+            if( !run_both( s, n, unlimited, op, block ) )
+            {
+                std::cout << s.name << ": drops " << op.drops << " != " << block.drops << " or value " << op.value << " != " << block.value << "\n";
+                mismatch = true;
+            }
+            if( r == 0 || op.seconds < best_op.seconds )
+                best_op = op;
+            if( r == 0 || block.seconds < best_block.seconds )
+                best_block = block;
+        }
+
+        std::cout << std::left << std::setw( 12 ) << s.name << std::right << std::fixed << std::setprecision( 1 )
+            << std::setw( 16 ) << unlimited - best_block.drops
+            << std::setw( 14 ) << best_op.seconds * 1000 << std::setw( 14 ) << best_block.seconds * 1000
+            << std::setprecision( 2 ) << std::setw( 10 ) << best_op.seconds / std::max( best_block.seconds, 1e-9 ) << "\n";
+    }
+
+    //drops不足时两种计量方式必须在同一条指令处停止
+    for( const auto& s : scripts )
+    {
+        for( long long budget = 1; budget <= sweep; ++budget )
+        {
+            run_result op, block;
+            if( !run_both( s, 2000, budget, op, block ) )
+            {
+                std::cout << s.name << " with " << budget << " drops: " << op.drops << " != " << block.drops << "\n";
+                mismatch = true;
+                break;
+            }
+        }
+    }
+
+    std::cout << ( mismatch ? "MISMATCH\n" : "drops identical\n" );
+    return mismatch ? 1 : 0;
+}
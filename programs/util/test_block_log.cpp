@@ -1,59 +1,192 @@
 #include <chain/database.hpp>
+#include <chain/compressed_block_log.hpp>
 #include <protocol/block.hpp>
 #include <fc/io/raw.hpp>
 
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+using taiyi::chain::block_log;
+using taiyi::chain::compressed_block_log;
+
+/**
+ * 把src中的全部区块按顺序写入新建的dst，chunk_blocks为0时写成未压缩的格式
+ */
+static void convert_block_log( const fc::path& src, const fc::path& dst, uint32_t chunk_blocks )
+{
+    FC_ASSERT( !fc::exists( dst ) || fc::file_size( dst ) == 0, "${f} already exists.", ("f", dst.generic_string()) );
+
+    block_log in;
+    in.open( src );
+    FC_ASSERT( in.head().valid(), "${f} is empty.", ("f", src.generic_string()) );
+    in.set_read_ahead( true );
+
+    block_log out;
+    out.open( dst, chunk_blocks );
+
+    auto start = fc::time_point::now();
+    uint32_t last_block_num = in.head()->block_num();
+    for( uint32_t n = 1; n <= last_block_num; ++n )
+    {
+        out.append( *in.read_block_by_num( n ) );
+        if( n % 100000 == 0 )
+            std::cerr << "   " << double( n ) * 100 / last_block_num << "%   " << n << " of " << last_block_num << "\n";
+    }
+    out.close();
+    auto end = fc::time_point::now();
+
+    uint64_t src_size = fc::file_size( src );
+    uint64_t dst_size = fc::file_size( dst );
+    std::cout << "converted " << last_block_num << " blocks in " << ( end - start ).count() / 1000 << " ms, "
+              << src_size << " -> " << dst_size << " bytes (" << double( dst_size ) * 100 / src_size << "%)\n";
+}
+
+/**
+ * 比较两个区块日志中的每个区块，顺序读一遍再随机读一遍
+ */
+static bool verify_block_log( const fc::path& a, const fc::path& b )
+{
+    block_log log_a, log_b;
+    log_a.open( a );
+    log_b.open( b );
+
+    uint32_t last_block_num = log_a.head().valid() ? log_a.head()->block_num() : 0;
+    if( last_block_num != ( log_b.head().valid() ? log_b.head()->block_num() : 0 ) )
+    {
+        std::cerr << "head block mismatch\n";
+        return false;
+    }
+
+    auto compare = [&]( uint32_t n ) {
+        auto block_a = log_a.read_block_by_num( n );
+        auto block_b = log_b.read_block_by_num( n );
+        if( !block_a.valid() || !block_b.valid() || fc::raw::pack_to_vector( *block_a ) != fc::raw::pack_to_vector( *block_b ) )
+        {
+            std::cerr << "block " << n << " mismatch\n";
+            return false;
+        }
+        return true;
+    };
+
+    auto start = fc::time_point::now();
+    log_a.set_read_ahead( true );
+    log_b.set_read_ahead( true );
+    for( uint32_t n = 1; n <= last_block_num; ++n )
+    {
+        if( !compare( n ) )
+            return false;
+    }
+    auto sequential = fc::time_point::now();
+
+    log_a.set_read_ahead( false );
+    log_b.set_read_ahead( false );
+    uint32_t random_reads = std::min< uint32_t >( last_block_num, 10000 );
+    uint64_t seed = 0x9E3779B97F4A7C15ull;
+    for( uint32_t i = 0; i < random_reads; ++i )
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        if( !compare( 1 + ( seed >> 33 ) % last_block_num ) )
+            return false;
+    }
+    auto end = fc::time_point::now();
+
+    std::cout << "verified " << last_block_num << " blocks, sequential " << ( sequential - start ).count() / 1000 << " ms, "
+              << random_reads << " random reads " << ( end - sequential ).count() / 1000 << " ms\n";
+    return true;
+}
+
+static void self_test()
+{
+    //taiyi::chain::database db;
+    taiyi::chain::block_log log;
+
+    fc::temp_directory temp_dir( "." );
+
+    //db.open( temp_dir );
+    log.open( temp_dir.path() / "log" );
+
+    idump( (log.head() ) );
+
+    taiyi::protocol::signed_block b1;
+    b1.siming = "alice";
+    b1.previous = taiyi::protocol::block_id_type();
+
+    log.append( b1 );
+    log.flush();
+    idump( (b1) );
+    idump( ( log.head() ) );
+    idump( (fc::raw::pack_size(b1)) );
+
+    taiyi::protocol::signed_block b2;
+    b2.siming = "bob";
+    b2.previous = b1.id();
+
+    log.append( b2 );
+    log.flush();
+    idump( (b2) );
+    idump( (log.head() ) );
+    idump( (fc::raw::pack_size(b2)) );
+
+    auto r1 = log.read_block( 0 );
+    idump( (r1) );
+    idump( (fc::raw::pack_size(r1.first)) );
+
+    auto r2 = log.read_block( r1.second );
+    idump( (r2) );
+    idump( (fc::raw::pack_size(r2.first)) );
+
+    idump( (log.read_head()) );
+    idump( (fc::raw::pack_size(log.read_head())));
+
+    auto r3 = log.read_block( r2.second );
+    idump( (r3) );
+}
+
 int main( int argc, char** argv, char** envp )
 {
     try
     {
-        //taiyi::chain::database db;
-        taiyi::chain::block_log log;
-        
-        fc::temp_directory temp_dir( "." );
-        
-        //db.open( temp_dir );
-        log.open( temp_dir.path() / "log" );
-        
-        idump( (log.head() ) );
-        
-        taiyi::protocol::signed_block b1;
-        b1.siming = "alice";
-        b1.previous = taiyi::protocol::block_id_type();
-        
-        log.append( b1 );
-        log.flush();
-        idump( (b1) );
-        idump( ( log.head() ) );
-        idump( (fc::raw::pack_size(b1)) );
-        
-        taiyi::protocol::signed_block b2;
-        b2.siming = "bob";
-        b2.previous = b1.id();
-        
-        log.append( b2 );
-        log.flush();
-        idump( (b2) );
-        idump( (log.head() ) );
-        idump( (fc::raw::pack_size(b2)) );
-        
-        auto r1 = log.read_block( 0 );
-        idump( (r1) );
-        idump( (fc::raw::pack_size(r1.first)) );
-        
-        auto r2 = log.read_block( r1.second );
-        idump( (r2) );
-        idump( (fc::raw::pack_size(r2.first)) );
-        
-        idump( (log.read_head()) );
-        idump( (fc::raw::pack_size(log.read_head())));
-        
-        auto r3 = log.read_block( r2.second );
-        idump( (r3) );
+        std::string command = argc > 1 ? argv[1] : "";
+        if( command == "convert" && ( argc == 4 || argc == 5 ) )
+        {
+            uint32_t chunk_blocks = argc == 5 ? std::stoul( argv[4] ) : compressed_block_log::default_chunk_blocks;
+            convert_block_log( argv[2], argv[3], chunk_blocks );
+        }
+        else if( command == "verify" && argc == 4 )
+        {
+            if( !verify_block_log( argv[2], argv[3] ) )
+                return 1;
+        }
+        else if( argc == 1 )
+        {
+            self_test();
+        }
+        else
+        {
+            std::cerr << "test_block_log [convert <src> <dst> [chunk_blocks] | verify <block_log_a> <block_log_b>]\n"
+            "\n"
+            "Without parameters runs a small self test of the block log.\n"
+            "\n"
+            "  convert:\n"
+            "    Copy all blocks of src into the new block log dst. chunk_blocks is the number of blocks\n"
+            "      per compressed chunk (default " << compressed_block_log::default_chunk_blocks << "), 0 writes the uncompressed format.\n"
+            "\n"
+            "  verify:\n"
+            "    Compare every block of two block logs of any format, sequentially and at random.\n"
+            "\n";
+            return 1;
+        }
+    }
+    catch ( const fc::exception& e )
+    {
+        std::cerr << e.to_detail_string() << "\n";
+        return 1;
     }
     catch ( const std::exception& e )
     {
         edump( ( std::string( e.what() ) ) );
     }
-    
+
     return 0;
 }
@@ -0,0 +1,125 @@
+#include <chain/util/tiandao_calendar.hpp>
+
+#include <tyme/tyme.h>
+
+#include <fc/exception/exception.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/time.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace std;
+using taiyi::chain::tiandao_calendar;
+
+/**
+ * 历法表中的一行：从first_day开始，年、月、节气不变，日期逐日加一
+ */
+struct calendar_run
+{
+    uint32_t    first_day = 0;
+    uint16_t    year = 0;
+    uint8_t     month = 0;
+    uint8_t     day = 0;
+    uint8_t     term = 0;
+};
+
+FC_REFLECT( calendar_run, (first_day)(year)(month)(day)(term) )
+
+int main( int argc, char** argv )
+{
+    try
+    {
+        bool need_help = argc < 2;
+        bool verify = false;
+        std::string output;
+        for( int i = 1; i < argc; ++i )
+        {
+            std::string arg = argv[i];
+            if( arg == "-h" || arg == "--help" )
+                need_help = true;
+            else if( arg == "--verify" )
+                verify = true;
+            else
+                output = arg;
+        }
+
+        if( need_help )
+        {
+            std::cerr << "tiandao_calendar [--verify] [output]\n"
+            "\n"
+            "Generates the virtual calendar index used by process_tiandao: virtual day N\n"
+            "  (head_block_num / TAIYI_VDAY_BLOCK_NUM) mapped to solar year, month, day and solar term.\n"
+            "\n"
+            "Parameters:\n"
+            "\n"
+            "  --verify:\n"
+            "    Cross-check every day of the index against tyme.\n"
+            "\n"
+            "  output:\n"
+            "    Write the index to this file as fc::raw packed vector of runs. A run starts\n"
+            "      whenever year, month or solar term changes, days in a run are consecutive.\n"
+            "\n";
+            return 1;
+        }
+
+        uint32_t day_count = tiandao_calendar::get_day_count();
+        tiandao_calendar calendar;
+        std::vector< calendar_run > runs;
+
+        auto start = fc::time_point::now();
+        for( uint32_t n = 0; n < day_count; ++n )
+        {
+            const auto& d = calendar.get_day( n );
+            if( runs.size() )
+            {
+                const auto& r = runs.back();
+                if( r.year == d.year && r.month == d.month && r.term == d.term && r.day + ( n - r.first_day ) == d.day )
+                    continue;
+            }
+            runs.push_back( calendar_run{ n, d.year, d.month, d.day, d.term } );
+        }
+        auto end = fc::time_point::now();
+
+        std::cout << "days: " << day_count << ", runs: " << runs.size() << ", packed size: " << fc::raw::pack_size( runs )
+                  << ", built in " << ( end - start ).count() / 1000 << " ms\n";
+
+        if( verify )
+        {
+            tyme::JulianDay start_day = tyme::SolarDay::from_ymd( tiandao_calendar::start_year, 1, 1 ).get_julian_day();
+            uint32_t mismatch = 0;
+            start = fc::time_point::now();
+            for( uint32_t n = 0; n < day_count; ++n )
+            {
+                tyme::SolarDay sday = start_day.next( n ).get_solar_day();
+                const auto& d = calendar.get_day( n );
+                if( d.year != sday.get_year() || d.month != sday.get_month() || d.day != sday.get_day() || d.term != sday.get_term().get_index() )
+                {
+                    if( mismatch++ < 10 )
+                        std::cerr << "mismatch at virtual day " << n << ": " << sday.to_string() << "\n";
+                }
+            }
+            end = fc::time_point::now();
+
+            std::cout << "verified against tyme in " << ( end - start ).count() / 1000 << " ms, mismatches: " << mismatch << "\n";
+            if( mismatch )
+                return 1;
+        }
+
+        if( output.size() )
+        {
+            auto data = fc::raw::pack_to_vector( runs );
+            std::ofstream out( output, std::ios::out | std::ios::binary );
+            out.write( data.data(), data.size() );
+            out.close();
+            std::cout << "written to " << output << "\n";
+        }
+    }
+    catch ( const fc::exception& e )
+    {
+        std::cout << e.to_detail_string() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -7,9 +7,16 @@
 
 #include <protocol/taiyi_operations.hpp>
 #include <chain/account_object.hpp>
+#include <chain/zone_objects.hpp>
+#include <chain/cultivation_objects.hpp>
+#include <chain/transaction_object.hpp>
+#include <chain/util/index_configuration.hpp>
+
+#include <utilities/database_configuration.hpp>
 
 #include <fc/crypto/digest.hpp>
 #include <fc/crypto/hex.hpp>
+#include <fc/io/json.hpp>
 #include "../db_fixture/database_fixture.hpp"
 
 #include <algorithm>
@@ -322,4 +329,175 @@ BOOST_AUTO_TEST_CASE( adjust_balance_test )
     BOOST_REQUIRE( db->get_balance( "alice", YANG_SYMBOL ) == asset( 0, YANG_SYMBOL ) );
 }
 
+BOOST_AUTO_TEST_CASE( zone_router_test )
+{
+    try
+    {
+        BOOST_TEST_MESSAGE( "Testing zone_router" );
+        
+        auto session = db->start_undo_session();
+        
+        //a->b->d 经过林地(2天)，a->c->d 经过原野(1天)，c->e 单向
+        std::vector< zone_id_type > z;
+        const E_ZONE_TYPE types[] = { YUANYE, LINDI, YUANYE, YUANYE, YUANYE };
+        for( int i = 0; i < 5; ++i )
+        {
+            z.push_back( db->create< zone_object >( [&]( zone_object& o ) {
+                o.name = "test_zone_" + std::to_string( i );
+                o.nfa_id = nfa_id_type( 1000000 + i );
+                o.type = types[i];
+            } ).id );
+        }
+        auto connect = [&]( int from, int to ) {
+            return db->create< zone_connect_object >( [&]( zone_connect_object& o ) { o.from = z[from]; o.to = z[to]; } ).id;
+        };
+        connect( 0, 1 ); connect( 1, 3 ); connect( 0, 2 ); connect( 2, 4 );
+        
+        auto find = [&]( int from, int to ) { return db->find_way_to_zone( db->get< zone_object >( z[from] ), db->get< zone_object >( z[to] ) ); };
+        
+        BOOST_TEST_MESSAGE( " --- Testing one way connections" );
+        BOOST_REQUIRE( !find( 4, 0 ).found );
+        BOOST_REQUIRE( find( 0, 0 ).found && find( 0, 0 ).zones.empty() );
+        
+        BOOST_TEST_MESSAGE( " --- Testing shortest route" );
+        auto route = find( 0, 3 );
+        BOOST_REQUIRE( route.found );
+        BOOST_REQUIRE( route.zones == std::vector< zone_id_type >( { z[1], z[3] } ) );
+        BOOST_REQUIRE_EQUAL( route.moving_days, uint64_t( db->calculate_moving_days_to_zone( db->get< zone_object >( z[1] ) ) + db->calculate_moving_days_to_zone( db->get< zone_object >( z[3] ) ) ) );
+        
+        BOOST_REQUIRE( route.search_cost > 0 );
+        auto cost = route.search_cost;
+        
+        BOOST_TEST_MESSAGE( " --- Testing cached route is dropped on new connection" );
+        auto hits = db->get_zone_router().get_cache_hits();
+        BOOST_REQUIRE_EQUAL( find( 0, 3 ).search_cost, route.search_cost );
+        BOOST_REQUIRE_EQUAL( db->get_zone_router().get_cache_hits(), hits + 1 );
+        
+        {
+            auto inner = db->start_undo_session();
+            connect( 2, 3 );
+            route = find( 0, 3 );
+            BOOST_REQUIRE( route.zones == std::vector< zone_id_type >( { z[2], z[3] } ) );
+            
+            BOOST_TEST_MESSAGE( " --- Testing zone type change" );
+            db->modify( db->get< zone_object >( z[2] ), []( zone_object& o ) { o.type = SHANYUE; } );
+            route = find( 0, 3 );
+            BOOST_REQUIRE( route.zones == std::vector< zone_id_type >( { z[1], z[3] } ) );
+            
+            inner.undo();
+        }
+        
+        BOOST_TEST_MESSAGE( " --- Testing undo restores the graph" );
+        route = find( 0, 3 );
+        BOOST_REQUIRE( route.zones == std::vector< zone_id_type >( { z[1], z[3] } ) );
+        BOOST_REQUIRE_EQUAL( route.search_cost, cost );
+        BOOST_REQUIRE( !find( 2, 3 ).found );
+        
+        BOOST_TEST_MESSAGE( " --- Testing cached route is dropped on zone removal" );
+        {
+            auto inner = db->start_undo_session();
+            db->create< zone_object >( [&]( zone_object& o ) {
+                o.name = "test_zone_5";
+                o.nfa_id = nfa_id_type( 1000005 );
+                o.type = YUANYE;
+            } );
+            find( 0, 3 );
+            hits = db->get_zone_router().get_cache_hits();
+            find( 0, 3 );
+            BOOST_REQUIRE_EQUAL( db->get_zone_router().get_cache_hits(), hits + 1 );
+            inner.undo();
+        }
+        auto misses = db->get_zone_router().get_cache_misses();
+        route = find( 0, 3 );
+        BOOST_REQUIRE_EQUAL( db->get_zone_router().get_cache_misses(), misses + 1 );
+        BOOST_REQUIRE_EQUAL( route.search_cost, cost );
+        
+        session.undo();
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( clean_cultivations_test )
+{
+    try
+    {
+        BOOST_TEST_MESSAGE( "Testing clean_cultivations only dissolves cultivations not started before their deadline" );
+        
+        auto session = db->start_undo_session();
+        
+        uint32_t now = db->head_block_num();
+        const uint32_t not_started = std::numeric_limits< uint32_t >::max();
+        auto create = [&]( uint32_t start_deadline, uint32_t start_time ) {
+            return db->create< cultivation_object >( [&]( cultivation_object& o ) {
+                o.manager_nfa_id = nfa_id_type( 1000000 );
+                o.create_time = now - 1;
+                o.start_deadline = start_deadline;
+                o.start_time = start_time;
+                o.last_update_time = start_time;
+            } ).id;
+        };
+        
+        auto expired = create( now - 1, not_started );
+        auto due_now = create( now, not_started );
+        auto waiting = create( now + 10, not_started );
+        std::vector< cultivation_id_type > started;
+        for( int i = 0; i < 10; ++i )
+            started.push_back( create( now - 1, now ) );
+        
+        db->clean_cultivations();
+        
+        BOOST_REQUIRE( db->find< cultivation_object >( expired ) == nullptr );
+        BOOST_REQUIRE( db->find< cultivation_object >( due_now ) == nullptr );
+        BOOST_REQUIRE( db->find< cultivation_object >( waiting ) != nullptr );
+        for( const auto& id : started )
+            BOOST_REQUIRE_EQUAL( db->get< cultivation_object >( id ).start_time, now );
+        
+        session.undo();
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( index_configuration_test )
+{
+    try
+    {
+        BOOST_REQUIRE_EQUAL( util::index_name_of_object_type( "taiyi::chain::nfa_object" ), "nfa_index" );
+        BOOST_REQUIRE_EQUAL( util::index_name_of_object_type( boost::core::demangle( typeid( transaction_object ).name() ) ), "transaction_index" );
+
+        fc::variant cfg = taiyi::utilities::default_database_configuration();
+        uint64_t total = cfg["global"]["shared_cache"]["capacity"].as_uint64();
+
+        BOOST_TEST_MESSAGE( "--- Without a section an index uses base" );
+        auto account = util::index_database_configuration( cfg, "account_index" );
+        BOOST_REQUIRE_EQUAL( fc::json::to_string( account["base"] ), fc::json::to_string( cfg["base"] ) );
+        BOOST_REQUIRE_EQUAL( fc::json::to_string( account["global"] ), fc::json::to_string( cfg["global"] ) );
+
+        BOOST_TEST_MESSAGE( "--- Index sections override base, the rest is kept" );
+        fc::mutable_variant_object custom( cfg.get_object() );
+        custom( "nfa_index", fc::mutable_variant_object
+            ( "block_based_table_options", fc::mutable_variant_object
+                ( "bloom_filter_policy", fc::mutable_variant_object( "bits_per_key", 14 ) ) ) );
+        auto nfa = util::index_database_configuration( fc::variant( custom ), "nfa_index" );
+        BOOST_REQUIRE_EQUAL( nfa["base"]["block_based_table_options"]["bloom_filter_policy"]["bits_per_key"].as_uint64(), 14u );
+        BOOST_REQUIRE_EQUAL( nfa["base"]["block_based_table_options"]["bloom_filter_policy"]["use_block_based_builder"].as_bool(), cfg["base"]["block_based_table_options"]["bloom_filter_policy"]["use_block_based_builder"].as_bool() );
+        BOOST_REQUIRE_EQUAL( nfa["base"]["block_based_table_options"]["block_size"].as_uint64(), cfg["base"]["block_based_table_options"]["block_size"].as_uint64() );
+        BOOST_REQUIRE_EQUAL( fc::json::to_string( util::index_database_configuration( fc::variant( custom ), "account_index" )["base"] ), fc::json::to_string( cfg["base"] ) );
+
+        BOOST_TEST_MESSAGE( "--- All indexes share the whole cache" );
+        BOOST_REQUIRE_EQUAL( nfa["global"]["shared_cache"]["capacity"].as_uint64(), total );
+
+        BOOST_TEST_MESSAGE( "--- Statistics can be turned on for one index" );
+        custom( "account_index", fc::mutable_variant_object( "statistics", true ) );
+        account = util::index_database_configuration( fc::variant( custom ), "account_index" );
+        BOOST_REQUIRE( account["global"]["statistics"].as_bool() );
+        BOOST_REQUIRE( !account["base"].get_object().contains( "statistics" ) );
+        BOOST_REQUIRE( !util::index_database_configuration( fc::variant( custom ), "nfa_index" )["global"]["statistics"].as_bool() );
+
+        BOOST_TEST_MESSAGE( "--- Bad settings are rejected" );
+        custom( "account_index", true );
+        BOOST_REQUIRE_THROW( util::index_database_configuration( fc::variant( custom ), "account_index" ), fc::assert_exception );
+    }
+    FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -17,6 +17,12 @@
 
 #include <fc/crypto/digest.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <limits>
+#include <thread>
+
 #include "../db_fixture/database_fixture.hpp"
 
 using namespace taiyi;
@@ -26,7 +32,7 @@ using namespace taiyi::plugins;
 
 BOOST_AUTO_TEST_SUITE(block_tests)
 
-void open_test_database( database& db, const fc::path& dir )
+void open_test_database( database& db, const fc::path& dir, bool incremental_pending_transactions = true )
 {
     database::open_args args;
     args.data_dir = dir;
@@ -34,6 +40,7 @@ void open_test_database( database& db, const fc::path& dir )
     args.initial_supply = INITIAL_TEST_SUPPLY;
     args.initial_qi_supply = INITIAL_TEST_QI_SUPPLY;
     args.database_cfg = taiyi::utilities::default_database_configuration();
+    args.incremental_pending_transactions = incremental_pending_transactions;
     db.open( args );
 }
 
@@ -152,66 +159,71 @@ BOOST_AUTO_TEST_CASE( undo_block )
 BOOST_AUTO_TEST_CASE( fork_blocks )
 {
     try {
-        fc::temp_directory data_dir1( taiyi::utilities::temp_directory_path() );
-        fc::temp_directory data_dir2( taiyi::utilities::temp_directory_path() );
-        
-        //TODO This test needs 6-7 ish simings prior to fork
-        
-        database db1;
-        siming::block_producer bp1( db1 );
-        db1.set_log_hardforks(false);
-        open_test_database( db1, data_dir1.path() );
-        database db2;
-        siming::block_producer bp2( db2 );
-        db2.set_log_hardforks(false);
-        open_test_database( db2, data_dir2.path() );
-        
-        auto init_account_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("init_key")) );
-        for( uint32_t i = 0; i < 10; ++i )
+        for( bool incremental : { false, true } )
         {
-            auto b = bp1.generate_block(db1.get_slot_time(1), db1.get_scheduled_siming(1), init_account_priv_key, database::skip_nothing);
-            try {
-                PUSH_BLOCK( db2, b );
-            } FC_CAPTURE_AND_RETHROW( ("db2") );
-        }
-        for( uint32_t i = 10; i < 13; ++i )
-        {
-            auto b =  bp1.generate_block(db1.get_slot_time(1), db1.get_scheduled_siming(1), init_account_priv_key, database::skip_nothing);
-        }
-        string db1_tip = db1.head_block_id().str();
-        uint32_t next_slot = 3;
-        for( uint32_t i = 13; i < 16; ++i )
-        {
-            auto b =  bp2.generate_block(db2.get_slot_time(next_slot), db2.get_scheduled_siming(next_slot), init_account_priv_key, database::skip_nothing);
-            next_slot = 1;
-            // notify both databases of the new block.
-            // only db2 should switch to the new fork, db1 should not
-            PUSH_BLOCK( db1, b );
+            BOOST_TEST_MESSAGE( "--- Test incremental pending transactions " << ( incremental ? "on" : "off" ) );
+            
+            fc::temp_directory data_dir1( taiyi::utilities::temp_directory_path() );
+            fc::temp_directory data_dir2( taiyi::utilities::temp_directory_path() );
+            
+            //TODO This test needs 6-7 ish simings prior to fork
+            
+            database db1;
+            siming::block_producer bp1( db1 );
+            db1.set_log_hardforks(false);
+            open_test_database( db1, data_dir1.path(), incremental );
+            database db2;
+            siming::block_producer bp2( db2 );
+            db2.set_log_hardforks(false);
+            open_test_database( db2, data_dir2.path(), incremental );
+            
+            auto init_account_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("init_key")) );
+            for( uint32_t i = 0; i < 10; ++i )
+            {
+                auto b = bp1.generate_block(db1.get_slot_time(1), db1.get_scheduled_siming(1), init_account_priv_key, database::skip_nothing);
+                try {
+                    PUSH_BLOCK( db2, b );
+                } FC_CAPTURE_AND_RETHROW( ("db2") );
+            }
+            for( uint32_t i = 10; i < 13; ++i )
+            {
+                auto b =  bp1.generate_block(db1.get_slot_time(1), db1.get_scheduled_siming(1), init_account_priv_key, database::skip_nothing);
+            }
+            string db1_tip = db1.head_block_id().str();
+            uint32_t next_slot = 3;
+            for( uint32_t i = 13; i < 16; ++i )
+            {
+                auto b =  bp2.generate_block(db2.get_slot_time(next_slot), db2.get_scheduled_siming(next_slot), init_account_priv_key, database::skip_nothing);
+                next_slot = 1;
+                // notify both databases of the new block.
+                // only db2 should switch to the new fork, db1 should not
+                PUSH_BLOCK( db1, b );
+                BOOST_CHECK_EQUAL(db1.head_block_id().str(), db1_tip);
+                BOOST_CHECK_EQUAL(db2.head_block_id().str(), b.id().str());
+            }
+            
+            //The two databases are on distinct forks now, but at the same height. Make a block on db2, make it invalid, then
+            //pass it to db1 and assert that db1 doesn't switch to the new fork.
+            signed_block good_block;
+            BOOST_CHECK_EQUAL(db1.head_block_num(), 13);
+            BOOST_CHECK_EQUAL(db2.head_block_num(), 13);
+            {
+                auto b = bp2.generate_block(db2.get_slot_time(1), db2.get_scheduled_siming(1), init_account_priv_key, database::skip_nothing);
+                good_block = b;
+                b.transactions.emplace_back(signed_transaction());
+                b.transactions.back().operations.emplace_back(transfer_operation());
+                b.sign( init_account_priv_key );
+                BOOST_CHECK_EQUAL(b.block_num(), 14);
+                TAIYI_CHECK_THROW(PUSH_BLOCK( db1, b ), fc::exception);
+            }
+            BOOST_CHECK_EQUAL(db1.head_block_num(), 13);
             BOOST_CHECK_EQUAL(db1.head_block_id().str(), db1_tip);
-            BOOST_CHECK_EQUAL(db2.head_block_id().str(), b.id().str());
-        }
-        
-        //The two databases are on distinct forks now, but at the same height. Make a block on db2, make it invalid, then
-        //pass it to db1 and assert that db1 doesn't switch to the new fork.
-        signed_block good_block;
-        BOOST_CHECK_EQUAL(db1.head_block_num(), 13);
-        BOOST_CHECK_EQUAL(db2.head_block_num(), 13);
-        {
-            auto b = bp2.generate_block(db2.get_slot_time(1), db2.get_scheduled_siming(1), init_account_priv_key, database::skip_nothing);
-            good_block = b;
-            b.transactions.emplace_back(signed_transaction());
-            b.transactions.back().operations.emplace_back(transfer_operation());
-            b.sign( init_account_priv_key );
-            BOOST_CHECK_EQUAL(b.block_num(), 14);
-            TAIYI_CHECK_THROW(PUSH_BLOCK( db1, b ), fc::exception);
+            
+            // assert that db1 switches to new fork with good block
+            BOOST_CHECK_EQUAL(db2.head_block_num(), 14);
+            PUSH_BLOCK( db1, good_block );
+            BOOST_CHECK_EQUAL(db1.head_block_id().str(), db2.head_block_id().str());
         }
-        BOOST_CHECK_EQUAL(db1.head_block_num(), 13);
-        BOOST_CHECK_EQUAL(db1.head_block_id().str(), db1_tip);
-        
-        // assert that db1 switches to new fork with good block
-        BOOST_CHECK_EQUAL(db2.head_block_num(), 14);
-        PUSH_BLOCK( db1, good_block );
-        BOOST_CHECK_EQUAL(db1.head_block_id().str(), db2.head_block_id().str());
     }
     catch (const fc::exception& e) {
         edump((e.to_detail_string()));
@@ -222,56 +234,61 @@ BOOST_AUTO_TEST_CASE( fork_blocks )
 BOOST_AUTO_TEST_CASE( switch_forks_undo_create )
 {
     try {
-        fc::temp_directory dir1( taiyi::utilities::temp_directory_path() ), dir2( taiyi::utilities::temp_directory_path() );
-        database db1, db2;
-        siming::block_producer bp1( db1 ), bp2( db2 );
-        db1.set_log_hardforks(false);
-        open_test_database( db1, dir1.path() );
-        db2.set_log_hardforks(false);
-        open_test_database( db2, dir2.path() );
-        
-        auto init_account_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("init_key")) );
-        public_key_type init_account_pub_key  = init_account_priv_key.get_public_key();
-        db1.get_index< account_index >();
-
-        //*
-        signed_transaction trx;
-        account_create_operation cop;
-        cop.new_account_name = "alice";
-        cop.creator = TAIYI_INIT_SIMING_NAME;
-        cop.owner = authority(1, init_account_pub_key, 1);
-        cop.active = cop.owner;
-        cop.fee = db1.get_siming_schedule_object().median_props.account_creation_fee;
-        trx.operations.push_back(cop);
-        trx.set_expiration( db1.head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
-        trx.sign( init_account_priv_key, db1.get_chain_id(), fc::ecc::fc_canonical );
-        PUSH_TX( db1, trx );
-        //*/
-        // generate blocks
-        // db1 : A
-        // db2 : B C D
-        
-        auto b = bp1.generate_block(db1.get_slot_time(1), db1.get_scheduled_siming(1), init_account_priv_key, database::skip_nothing);
-        
-        auto alice_id = db1.get_account( "alice" ).id;
-        BOOST_CHECK( db1.get(alice_id).name == "alice" );
-        
-        b = bp2.generate_block(db2.get_slot_time(1), db2.get_scheduled_siming(1), init_account_priv_key, database::skip_nothing);
-        db1.push_block(b);
-        b = bp2.generate_block(db2.get_slot_time(1), db2.get_scheduled_siming(1), init_account_priv_key, database::skip_nothing);
-        db1.push_block(b);
-        TAIYI_REQUIRE_THROW(db2.get(alice_id), std::exception);
-        db1.get(alice_id); /// it should be included in the pending state
-        db1.clear_pending(); // clear it so that we can verify it was properly removed from pending state.
-        TAIYI_REQUIRE_THROW(db1.get(alice_id), std::exception);
-        
-        PUSH_TX( db2, trx );
-        
-        b = bp2.generate_block(db2.get_slot_time(1), db2.get_scheduled_siming(1), init_account_priv_key, database::skip_nothing);
-        db1.push_block(b);
-        
-        BOOST_CHECK( db1.get(alice_id).name == "alice");
-        BOOST_CHECK( db2.get(alice_id).name == "alice");
+        for( bool incremental : { false, true } )
+        {
+            BOOST_TEST_MESSAGE( "--- Test incremental pending transactions " << ( incremental ? "on" : "off" ) );
+            
+            fc::temp_directory dir1( taiyi::utilities::temp_directory_path() ), dir2( taiyi::utilities::temp_directory_path() );
+            database db1, db2;
+            siming::block_producer bp1( db1 ), bp2( db2 );
+            db1.set_log_hardforks(false);
+            open_test_database( db1, dir1.path(), incremental );
+            db2.set_log_hardforks(false);
+            open_test_database( db2, dir2.path(), incremental );
+            
+            auto init_account_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("init_key")) );
+            public_key_type init_account_pub_key  = init_account_priv_key.get_public_key();
+            db1.get_index< account_index >();
+
+            //*
+            signed_transaction trx;
+            account_create_operation cop;
+            cop.new_account_name = "alice";
+            cop.creator = TAIYI_INIT_SIMING_NAME;
+            cop.owner = authority(1, init_account_pub_key, 1);
+            cop.active = cop.owner;
+            cop.fee = db1.get_siming_schedule_object().median_props.account_creation_fee;
+            trx.operations.push_back(cop);
+            trx.set_expiration( db1.head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+            trx.sign( init_account_priv_key, db1.get_chain_id(), fc::ecc::fc_canonical );
+            PUSH_TX( db1, trx );
+            //*/
+            // generate blocks
+            // db1 : A
+            // db2 : B C D
+            
+            auto b = bp1.generate_block(db1.get_slot_time(1), db1.get_scheduled_siming(1), init_account_priv_key, database::skip_nothing);
+            
+            auto alice_id = db1.get_account( "alice" ).id;
+            BOOST_CHECK( db1.get(alice_id).name == "alice" );
+            
+            b = bp2.generate_block(db2.get_slot_time(1), db2.get_scheduled_siming(1), init_account_priv_key, database::skip_nothing);
+            db1.push_block(b);
+            b = bp2.generate_block(db2.get_slot_time(1), db2.get_scheduled_siming(1), init_account_priv_key, database::skip_nothing);
+            db1.push_block(b);
+            TAIYI_REQUIRE_THROW(db2.get(alice_id), std::exception);
+            db1.get(alice_id); /// it should be included in the pending state
+            db1.clear_pending(); // clear it so that we can verify it was properly removed from pending state.
+            TAIYI_REQUIRE_THROW(db1.get(alice_id), std::exception);
+            
+            PUSH_TX( db2, trx );
+            
+            b = bp2.generate_block(db2.get_slot_time(1), db2.get_scheduled_siming(1), init_account_priv_key, database::skip_nothing);
+            db1.push_block(b);
+            
+            BOOST_CHECK( db1.get(alice_id).name == "alice");
+            BOOST_CHECK( db2.get(alice_id).name == "alice");
+        }
     }
     catch (const fc::exception& e) {
         edump((e.to_detail_string()));
@@ -282,51 +299,56 @@ BOOST_AUTO_TEST_CASE( switch_forks_undo_create )
 BOOST_AUTO_TEST_CASE( duplicate_transactions )
 {
     try {
-        fc::temp_directory dir1( taiyi::utilities::temp_directory_path() ), dir2( taiyi::utilities::temp_directory_path() );
-        database db1, db2;
-        siming::block_producer bp1( db1 );
-        db1.set_log_hardforks(false);
-        open_test_database( db1, dir1.path() );
-        db2.set_log_hardforks(false);
-        open_test_database( db2, dir2.path() );
-        BOOST_CHECK( db1.get_chain_id() == db2.get_chain_id() );
-        
-        auto skip_sigs = database::skip_transaction_signatures | database::skip_authority_check;
-        
-        auto init_account_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("init_key")) );
-        public_key_type init_account_pub_key  = init_account_priv_key.get_public_key();
-        
-        signed_transaction trx;
-        account_create_operation cop;
-        cop.new_account_name = "alice";
-        cop.creator = TAIYI_INIT_SIMING_NAME;
-        cop.fee = db1.get_siming_schedule_object().median_props.account_creation_fee;
-        cop.owner = authority(1, init_account_pub_key, 1);
-        cop.active = cop.owner;
-        trx.operations.push_back(cop);
-        trx.set_expiration( db1.head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
-        trx.sign( init_account_priv_key, db1.get_chain_id(), fc::ecc::fc_canonical );
-        PUSH_TX( db1, trx, skip_sigs );
-        
-        trx = decltype(trx)();
-        transfer_operation t;
-        t.from = TAIYI_INIT_SIMING_NAME;
-        t.to = "alice";
-        t.amount = asset(500,YANG_SYMBOL);
-        trx.operations.push_back(t);
-        trx.set_expiration( db1.head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
-        trx.sign( init_account_priv_key, db1.get_chain_id(), fc::ecc::fc_canonical );
-        PUSH_TX( db1, trx, skip_sigs );
-        
-        TAIYI_CHECK_THROW(PUSH_TX( db1, trx, skip_sigs ), fc::exception);
-        
-        auto b = bp1.generate_block( db1.get_slot_time(1), db1.get_scheduled_siming( 1 ), init_account_priv_key, skip_sigs );
-        PUSH_BLOCK( db2, b, skip_sigs );
-        
-        TAIYI_CHECK_THROW(PUSH_TX( db1, trx, skip_sigs ), fc::exception);
-        TAIYI_CHECK_THROW(PUSH_TX( db2, trx, skip_sigs ), fc::exception);
-        BOOST_CHECK_EQUAL(db1.get_balance( "alice", YANG_SYMBOL ).amount.value, 500);
-        BOOST_CHECK_EQUAL(db2.get_balance( "alice", YANG_SYMBOL ).amount.value, 500);
+        for( bool incremental : { false, true } )
+        {
+            BOOST_TEST_MESSAGE( "--- Test incremental pending transactions " << ( incremental ? "on" : "off" ) );
+            
+            fc::temp_directory dir1( taiyi::utilities::temp_directory_path() ), dir2( taiyi::utilities::temp_directory_path() );
+            database db1, db2;
+            siming::block_producer bp1( db1 );
+            db1.set_log_hardforks(false);
+            open_test_database( db1, dir1.path(), incremental );
+            db2.set_log_hardforks(false);
+            open_test_database( db2, dir2.path(), incremental );
+            BOOST_CHECK( db1.get_chain_id() == db2.get_chain_id() );
+            
+            auto skip_sigs = database::skip_transaction_signatures | database::skip_authority_check;
+            
+            auto init_account_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("init_key")) );
+            public_key_type init_account_pub_key  = init_account_priv_key.get_public_key();
+            
+            signed_transaction trx;
+            account_create_operation cop;
+            cop.new_account_name = "alice";
+            cop.creator = TAIYI_INIT_SIMING_NAME;
+            cop.fee = db1.get_siming_schedule_object().median_props.account_creation_fee;
+            cop.owner = authority(1, init_account_pub_key, 1);
+            cop.active = cop.owner;
+            trx.operations.push_back(cop);
+            trx.set_expiration( db1.head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+            trx.sign( init_account_priv_key, db1.get_chain_id(), fc::ecc::fc_canonical );
+            PUSH_TX( db1, trx, skip_sigs );
+            
+            trx = decltype(trx)();
+            transfer_operation t;
+            t.from = TAIYI_INIT_SIMING_NAME;
+            t.to = "alice";
+            t.amount = asset(500,YANG_SYMBOL);
+            trx.operations.push_back(t);
+            trx.set_expiration( db1.head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+            trx.sign( init_account_priv_key, db1.get_chain_id(), fc::ecc::fc_canonical );
+            PUSH_TX( db1, trx, skip_sigs );
+            
+            TAIYI_CHECK_THROW(PUSH_TX( db1, trx, skip_sigs ), fc::exception);
+            
+            auto b = bp1.generate_block( db1.get_slot_time(1), db1.get_scheduled_siming( 1 ), init_account_priv_key, skip_sigs );
+            PUSH_BLOCK( db2, b, skip_sigs );
+            
+            TAIYI_CHECK_THROW(PUSH_TX( db1, trx, skip_sigs ), fc::exception);
+            TAIYI_CHECK_THROW(PUSH_TX( db2, trx, skip_sigs ), fc::exception);
+            BOOST_CHECK_EQUAL(db1.get_balance( "alice", YANG_SYMBOL ).amount.value, 500);
+            BOOST_CHECK_EQUAL(db2.get_balance( "alice", YANG_SYMBOL ).amount.value, 500);
+        }
     }
     catch (const fc::exception& e) {
         edump((e.to_detail_string()));
@@ -337,54 +359,59 @@ BOOST_AUTO_TEST_CASE( duplicate_transactions )
 BOOST_AUTO_TEST_CASE( tapos )
 {
     try {
-        fc::temp_directory dir1( taiyi::utilities::temp_directory_path() );
-        database db1;
-        siming::block_producer bp1( db1 );
-        db1.set_log_hardforks(false);
-        open_test_database( db1, dir1.path() );
-        
-        auto init_account_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("init_key")) );
-        public_key_type init_account_pub_key  = init_account_priv_key.get_public_key();
-        
-        auto b = bp1.generate_block( db1.get_slot_time(1), db1.get_scheduled_siming( 1 ), init_account_priv_key, database::skip_nothing);
-        
-        BOOST_TEST_MESSAGE( "Creating a transaction with reference block" );
-        idump((db1.head_block_id()));
-        signed_transaction trx;
-        //This transaction must be in the next block after its reference, or it is invalid.
-        trx.set_reference_block( db1.head_block_id() );
-        
-        account_create_operation cop;
-        cop.new_account_name = "alice";
-        cop.creator = TAIYI_INIT_SIMING_NAME;
-        cop.fee = db1.get_siming_schedule_object().median_props.account_creation_fee;
-        cop.owner = authority(1, init_account_pub_key, 1);
-        cop.active = cop.owner;
-        trx.operations.push_back(cop);
-        trx.set_expiration( db1.head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
-        trx.sign( init_account_priv_key, db1.get_chain_id(), fc::ecc::fc_canonical );
-        
-        BOOST_TEST_MESSAGE( "Pushing Pending Transaction" );
-        idump((trx));
-        db1.push_transaction(trx);
-        BOOST_TEST_MESSAGE( "Generating a block" );
-        b = bp1.generate_block(db1.get_slot_time(1), db1.get_scheduled_siming(1), init_account_priv_key, database::skip_nothing);
-        trx.clear();
-        
-        transfer_operation t;
-        t.from = TAIYI_INIT_SIMING_NAME;
-        t.to = "alice";
-        t.amount = asset(50,YANG_SYMBOL);
-        trx.operations.push_back(t);
-        trx.set_expiration( db1.head_block_time() + fc::seconds(2) );
-        trx.sign( init_account_priv_key, db1.get_chain_id(), fc::ecc::fc_canonical );
-        idump((trx)(db1.head_block_time()));
-        b = bp1.generate_block(db1.get_slot_time(1), db1.get_scheduled_siming(1), init_account_priv_key, database::skip_nothing);
-        idump((b));
-        b = bp1.generate_block(db1.get_slot_time(1), db1.get_scheduled_siming(1), init_account_priv_key, database::skip_nothing);
-        trx.signatures.clear();
-        trx.sign( init_account_priv_key, db1.get_chain_id(), fc::ecc::fc_canonical );
-        BOOST_REQUIRE_THROW( db1.push_transaction(trx, 0/*database::skip_transaction_signatures | database::skip_authority_check*/), fc::exception );
+        for( bool incremental : { false, true } )
+        {
+            BOOST_TEST_MESSAGE( "--- Test incremental pending transactions " << ( incremental ? "on" : "off" ) );
+            
+            fc::temp_directory dir1( taiyi::utilities::temp_directory_path() );
+            database db1;
+            siming::block_producer bp1( db1 );
+            db1.set_log_hardforks(false);
+            open_test_database( db1, dir1.path(), incremental );
+            
+            auto init_account_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("init_key")) );
+            public_key_type init_account_pub_key  = init_account_priv_key.get_public_key();
+            
+            auto b = bp1.generate_block( db1.get_slot_time(1), db1.get_scheduled_siming( 1 ), init_account_priv_key, database::skip_nothing);
+            
+            BOOST_TEST_MESSAGE( "Creating a transaction with reference block" );
+            idump((db1.head_block_id()));
+            signed_transaction trx;
+            //This transaction must be in the next block after its reference, or it is invalid.
+            trx.set_reference_block( db1.head_block_id() );
+            
+            account_create_operation cop;
+            cop.new_account_name = "alice";
+            cop.creator = TAIYI_INIT_SIMING_NAME;
+            cop.fee = db1.get_siming_schedule_object().median_props.account_creation_fee;
+            cop.owner = authority(1, init_account_pub_key, 1);
+            cop.active = cop.owner;
+            trx.operations.push_back(cop);
+            trx.set_expiration( db1.head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+            trx.sign( init_account_priv_key, db1.get_chain_id(), fc::ecc::fc_canonical );
+            
+            BOOST_TEST_MESSAGE( "Pushing Pending Transaction" );
+            idump((trx));
+            db1.push_transaction(trx);
+            BOOST_TEST_MESSAGE( "Generating a block" );
+            b = bp1.generate_block(db1.get_slot_time(1), db1.get_scheduled_siming(1), init_account_priv_key, database::skip_nothing);
+            trx.clear();
+            
+            transfer_operation t;
+            t.from = TAIYI_INIT_SIMING_NAME;
+            t.to = "alice";
+            t.amount = asset(50,YANG_SYMBOL);
+            trx.operations.push_back(t);
+            trx.set_expiration( db1.head_block_time() + fc::seconds(2) );
+            trx.sign( init_account_priv_key, db1.get_chain_id(), fc::ecc::fc_canonical );
+            idump((trx)(db1.head_block_time()));
+            b = bp1.generate_block(db1.get_slot_time(1), db1.get_scheduled_siming(1), init_account_priv_key, database::skip_nothing);
+            idump((b));
+            b = bp1.generate_block(db1.get_slot_time(1), db1.get_scheduled_siming(1), init_account_priv_key, database::skip_nothing);
+            trx.signatures.clear();
+            trx.sign( init_account_priv_key, db1.get_chain_id(), fc::ecc::fc_canonical );
+            BOOST_REQUIRE_THROW( db1.push_transaction(trx, 0/*database::skip_transaction_signatures | database::skip_authority_check*/), fc::exception );
+        }
     }
     catch (const fc::exception& e) {
         edump((e.to_detail_string()));
@@ -856,4 +883,998 @@ BOOST_FIXTURE_TEST_CASE( generate_block_size, clean_database_fixture )
     FC_LOG_AND_RETHROW()
 }
 
+BOOST_AUTO_TEST_CASE( block_log_concurrent_read )
+{
+    try {
+        fc::temp_directory data_dir( taiyi::utilities::temp_directory_path() );
+        fc::path log_file = data_dir.path() / "block_log";
+
+        auto make_block = []( uint32_t num, const block_id_type& previous ) {
+            signed_block b;
+            b.previous = previous;
+            b.timestamp = fc::time_point_sec( TAIYI_TESTING_GENESIS_TIMESTAMP + num * TAIYI_BLOCK_INTERVAL );
+            b.siming = "siming" + std::to_string( num % 7 );
+            for( uint32_t i = 0; i < num % 5; ++i )
+            {
+                signed_transaction tx;
+                tx.ref_block_num = num;
+                tx.set_expiration( b.timestamp );
+                tx.operations.push_back( transfer_operation() );
+                b.transactions.push_back( tx );
+            }
+            return b;
+        };
+
+        std::vector< block_id_type > ids( 1 );
+        {
+            block_log log;
+            log.open( log_file );
+            BOOST_REQUIRE( !log.head() );
+            for( uint32_t num = 1; num <= 100; ++num )
+            {
+                auto b = make_block( num, ids.back() );
+                log.append( b );
+                ids.push_back( b.id() );
+            }
+        }
+
+        BOOST_TEST_MESSAGE( "--- Test readers run without locks while the writer appends" );
+
+        block_log log;
+        log.open( log_file ); //前100个区块在映射区域内，之后追加的通过pread读取
+        BOOST_REQUIRE( log.head()->block_num() == 100 );
+
+        std::atomic< bool > done( false );
+        std::atomic< uint32_t > errors( 0 );
+        std::vector< std::thread > readers;
+        for( int t = 0; t < 4; ++t )
+        {
+            readers.emplace_back( [&, t]() {
+                uint32_t num = 1 + t;
+                while( !done )
+                {
+                    try
+                    {
+                        auto head = log.head();
+                        uint32_t head_num = head->block_num();
+                        num = num % head_num + 1;
+
+                        auto b = log.read_block_by_num( num );
+                        if( !b.valid() || b->block_num() != num || b->timestamp != fc::time_point_sec( TAIYI_TESTING_GENESIS_TIMESTAMP + num * TAIYI_BLOCK_INTERVAL ) )
+                            ++errors;
+
+                        auto next = log.read_block( log.get_block_pos( num ) );
+                        if( next.first.block_num() != num )
+                            ++errors;
+                    }
+                    catch( ... )
+                    {
+                        ++errors;
+                    }
+                }
+            } );
+        }
+
+        for( uint32_t num = 101; num <= 1000; ++num )
+        {
+            auto b = make_block( num, ids.back() );
+            log.append( b );
+            ids.push_back( b.id() );
+        }
+        done = true;
+        for( auto& t : readers )
+            t.join();
+        BOOST_REQUIRE_EQUAL( errors.load(), 0u );
+
+        BOOST_TEST_MESSAGE( "--- Test walking the log and reading the head" );
+
+        auto itr = log.read_block( 0 );
+        for( uint32_t num = 1; num <= 1000; ++num )
+        {
+            BOOST_REQUIRE( itr.first.id() == ids[ num ] );
+            if( num < 1000 )
+                itr = log.read_block( itr.second );
+        }
+        BOOST_REQUIRE( log.read_head().id() == ids[ 1000 ] );
+        BOOST_REQUIRE( !log.read_block_by_num( 1001 ).valid() );
+        log.close();
+
+        BOOST_TEST_MESSAGE( "--- Test index is reconstructed when missing" );
+
+        fc::remove_all( fc::path( log_file.generic_string() + ".index" ) );
+        log.open( log_file );
+        BOOST_REQUIRE( log.head()->id() == ids[ 1000 ] );
+        for( uint32_t num = 1; num <= 1000; num += 37 )
+            BOOST_REQUIRE( log.read_block_by_num( num )->id() == ids[ num ] );
+
+        BOOST_TEST_MESSAGE( "--- Test readers run while the log is closed and reopened" );
+
+        done = false;
+        readers.clear();
+        std::atomic< uint32_t > reads( 0 );
+        for( int t = 0; t < 4; ++t )
+        {
+            readers.emplace_back( [&, t]() {
+                uint32_t num = 1 + t;
+                while( !done )
+                {
+                    try
+                    {
+                        //日志关闭时读不到区块，但读到的区块必须正确
+                        num = num % 1000 + 1;
+                        auto b = log.read_block_by_num( num );
+                        if( b.valid() )
+                        {
+                            if( b->id() != ids[ num ] )
+                                ++errors;
+                            ++reads;
+                        }
+
+                        auto head = log.head();
+                        if( head.valid() && head->id() != ids[ 1000 ] )
+                            ++errors;
+                    }
+                    catch( ... )
+                    {
+                        ++errors;
+                    }
+                }
+            } );
+        }
+
+        for( int i = 0; i < 200; ++i )
+        {
+            log.close();
+            log.open( log_file );
+        }
+        while( reads < 100 )
+            std::this_thread::yield();
+        done = true;
+        for( auto& t : readers )
+            t.join();
+        BOOST_REQUIRE_EQUAL( errors.load(), 0u );
+        BOOST_REQUIRE( log.head()->id() == ids[ 1000 ] );
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( compressed_block_log_test )
+{
+    try {
+        fc::temp_directory data_dir( taiyi::utilities::temp_directory_path() );
+        fc::path log_file = data_dir.path() / "block_log";
+        fc::path tail_file = data_dir.path() / "block_log.tail";
+
+        auto make_block = []( uint32_t num, const block_id_type& previous ) {
+            signed_block b;
+            b.previous = previous;
+            b.timestamp = fc::time_point_sec( TAIYI_TESTING_GENESIS_TIMESTAMP + num * TAIYI_BLOCK_INTERVAL );
+            b.siming = "siming" + std::to_string( num % 7 );
+            return b;
+        };
+
+        BOOST_TEST_MESSAGE( "--- Test a new log is compressed in chunks" );
+
+        std::vector< block_id_type > ids( 1 );
+        block_log log;
+        log.open( log_file, 16 );
+        BOOST_REQUIRE( log.is_compressed() );
+        BOOST_REQUIRE( !log.head() );
+        for( uint32_t num = 1; num <= 100; ++num )
+        {
+            auto b = make_block( num, ids.back() );
+            BOOST_REQUIRE_EQUAL( log.append( b ), num - 1 );
+            ids.push_back( b.id() );
+        }
+        BOOST_REQUIRE( log.head()->id() == ids[ 100 ] );
+
+        for( uint32_t num = 1; num <= 100; ++num )
+            BOOST_REQUIRE( log.read_block_by_num( num )->id() == ids[ num ] ); //最后4个区块在尾部文件中
+        BOOST_REQUIRE( !log.read_block_by_num( 101 ).valid() );
+        BOOST_REQUIRE( log.get_block_pos( 101 ) == block_log::npos );
+
+        BOOST_TEST_MESSAGE( "--- Test walking the log with read ahead" );
+
+        log.set_read_ahead( true );
+        auto itr = log.read_block( 0 );
+        for( uint32_t num = 1; num <= 100; ++num )
+        {
+            BOOST_REQUIRE( itr.first.id() == ids[ num ] );
+            if( num < 100 )
+                itr = log.read_block( itr.second );
+        }
+        log.set_read_ahead( false );
+        log.close();
+
+        BOOST_TEST_MESSAGE( "--- Test the format is detected on open and the chunk size is kept" );
+
+        log.open( log_file );
+        BOOST_REQUIRE( log.is_compressed() );
+        BOOST_REQUIRE( log.read_head().id() == ids[ 100 ] );
+        for( uint32_t num = 101; num <= 130; ++num )
+        {
+            auto b = make_block( num, ids.back() );
+            log.append( b );
+            ids.push_back( b.id() );
+        }
+        for( uint32_t num = 1; num <= 130; num += 3 )
+            BOOST_REQUIRE( log.read_block_by_num( num )->id() == ids[ num ] );
+        log.close();
+
+        BOOST_TEST_MESSAGE( "--- Test a torn record at the end of the tail is dropped" );
+
+        {
+            std::ofstream tail( tail_file.generic_string(), std::ios::out | std::ios::binary | std::ios::app );
+            uint32_t len = 1000;
+            tail.write( (const char*)&len, sizeof( len ) );
+            tail.write( "abc", 3 );
+        }
+        fc::remove_all( fc::path( log_file.generic_string() + ".index" ) );
+        log.open( log_file );
+        BOOST_REQUIRE( log.head()->id() == ids[ 130 ] );
+        for( uint32_t num = 1; num <= 130; num += 7 )
+            BOOST_REQUIRE( log.read_block_by_num( num )->id() == ids[ num ] );
+        log.close();
+
+        BOOST_TEST_MESSAGE( "--- Test an existing uncompressed log is not converted on open" );
+
+        fc::path plain_file = data_dir.path() / "plain_log";
+        {
+            block_log plain;
+            plain.open( plain_file );
+            plain.append( make_block( 1, block_id_type() ) );
+        }
+        log.open( plain_file, 16 );
+        BOOST_REQUIRE( !log.is_compressed() );
+        BOOST_REQUIRE( log.head()->block_num() == 1 );
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( reindex_pipeline_test )
+{
+    try {
+        fc::temp_directory data_dir( taiyi::utilities::temp_directory_path() );
+
+        std::vector< signed_block > blocks( 1 );
+        block_log log;
+        log.open( data_dir.path() / "block_log" );
+        for( uint32_t num = 1; num <= 200; ++num )
+        {
+            signed_block b;
+            b.previous = num > 1 ? blocks.back().id() : block_id_type();
+            b.timestamp = fc::time_point_sec( TAIYI_TESTING_GENESIS_TIMESTAMP + num * TAIYI_BLOCK_INTERVAL );
+            b.siming = "siming" + std::to_string( num % 7 );
+            for( uint32_t i = 0; i < num % 4; ++i )
+            {
+                signed_transaction tx;
+                tx.ref_block_num = num;
+                tx.ref_block_prefix = i;
+                tx.set_expiration( b.timestamp );
+                tx.operations.push_back( transfer_operation() );
+                b.transactions.push_back( tx );
+            }
+            log.append( b );
+            blocks.push_back( b );
+        }
+
+        BOOST_TEST_MESSAGE( "--- Test blocks come out in order with precomputed hashes" );
+
+        for( uint32_t depth : { 1, 3, 16 } )
+        {
+            reindex_pipeline pipeline( log, 1, 150, depth, 4 );
+            uint32_t num = 1;
+            while( auto b = pipeline.next() )
+            {
+                BOOST_REQUIRE_EQUAL( b->block.block_num(), num );
+                BOOST_REQUIRE( b->block_id == blocks[ num ].id() );
+                BOOST_REQUIRE_EQUAL( b->block_size, fc::raw::pack_size( blocks[ num ] ) );
+                BOOST_REQUIRE_EQUAL( b->trx_ids.size(), blocks[ num ].transactions.size() );
+                for( size_t i = 0; i < b->trx_ids.size(); ++i )
+                    BOOST_REQUIRE( b->trx_ids[ i ] == blocks[ num ].transactions[ i ].id() );
+
+                auto stats = pipeline.get_stats();
+                BOOST_REQUIRE_LE( stats.ready, depth );
+                ++num;
+            }
+            BOOST_REQUIRE_EQUAL( num, 151u );
+            BOOST_REQUIRE_EQUAL( pipeline.get_stats().consumed, 150u );
+        }
+
+        BOOST_TEST_MESSAGE( "--- Test a read error is raised in order" );
+
+        {
+            reindex_pipeline pipeline( log, 195, 210, 8, 2 );
+            for( uint32_t num = 195; num <= 200; ++num )
+                BOOST_REQUIRE_EQUAL( pipeline.next()->block.block_num(), num );
+            TAIYI_REQUIRE_THROW( pipeline.next(), fc::exception );
+        }
+
+        BOOST_TEST_MESSAGE( "--- Test the pipeline can be dropped before it is drained" );
+
+        {
+            reindex_pipeline pipeline( log, 1, 200, 8, 3 );
+            BOOST_REQUIRE_EQUAL( pipeline.next()->block.block_num(), 1u );
+        }
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( signature_key_cache_test )
+{
+    try {
+        chain_id_type chain_id = fc::sha256::hash( "signature_key_cache_test" );
+        auto alice_key = fc::ecc::private_key::regenerate( fc::sha256::hash( "alice" ) );
+        auto bob_key = fc::ecc::private_key::regenerate( fc::sha256::hash( "bob" ) );
+
+        auto make_block = [&]( uint32_t num ) {
+            signed_block b;
+            for( uint32_t i = 0; i < 20; ++i )
+            {
+                signed_transaction tx;
+                tx.ref_block_num = num;
+                tx.ref_block_prefix = i;
+                tx.set_expiration( fc::time_point_sec( TAIYI_TESTING_GENESIS_TIMESTAMP ) );
+                tx.operations.push_back( transfer_operation() );
+                tx.sign( alice_key, chain_id, fc::ecc::bip_0062 );
+                if( i % 2 )
+                    tx.sign( bob_key, chain_id, fc::ecc::bip_0062 );
+                b.transactions.push_back( tx );
+            }
+            return b;
+        };
+
+        signature_key_cache cache;
+        cache.set_thread_num( 4 );
+        cache.set_capacity( 2 );
+
+        BOOST_TEST_MESSAGE( "--- Test recovered keys match serial recovery" );
+
+        auto b1 = make_block( 1 );
+        b1.transactions[ 3 ].signatures.push_back( b1.transactions[ 3 ].signatures.front() ); //重复签名，恢复失败
+        cache.prefetch( b1, chain_id, fc::ecc::bip_0062 );
+
+        flat_set< public_key_type > keys;
+        for( size_t i = 0; i < b1.transactions.size(); ++i )
+        {
+            const auto& tx = b1.transactions[ i ];
+            if( i == 3 )
+            {
+                BOOST_REQUIRE( !cache.get( tx.id(), tx, fc::ecc::bip_0062, keys ) );
+                continue;
+            }
+            BOOST_REQUIRE( cache.get( tx.id(), tx, fc::ecc::bip_0062, keys ) );
+            BOOST_REQUIRE( keys == tx.get_signature_keys( chain_id, fc::ecc::bip_0062 ) );
+            BOOST_REQUIRE_EQUAL( keys.size(), i % 2 ? 2u : 1u );
+        }
+
+        BOOST_TEST_MESSAGE( "--- Test different signatures or canonical type miss" );
+
+        signed_transaction stripped = b1.transactions[ 1 ];
+        stripped.signatures.pop_back();
+        BOOST_REQUIRE( !cache.get( stripped.id(), stripped, fc::ecc::bip_0062, keys ) );
+        BOOST_REQUIRE( !cache.get( b1.transactions[ 0 ].id(), b1.transactions[ 0 ], fc::ecc::fc_canonical, keys ) );
+
+        BOOST_TEST_MESSAGE( "--- Test only the latest blocks are kept" );
+
+        auto b2 = make_block( 2 );
+        auto b3 = make_block( 3 );
+        cache.prefetch( b2, chain_id, fc::ecc::bip_0062 );
+        cache.prefetch( b1, chain_id, fc::ecc::bip_0062 ); //同一个区块再次恢复，不会被更早的记录淘汰
+        cache.prefetch( b3, chain_id, fc::ecc::bip_0062 );
+        BOOST_REQUIRE( !cache.get( b2.transactions[ 0 ].id(), b2.transactions[ 0 ], fc::ecc::bip_0062, keys ) );
+        BOOST_REQUIRE( cache.get( b1.transactions[ 0 ].id(), b1.transactions[ 0 ], fc::ecc::bip_0062, keys ) );
+        BOOST_REQUIRE( cache.get( b3.transactions[ 0 ].id(), b3.transactions[ 0 ], fc::ecc::bip_0062, keys ) );
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( pending_transaction_pool_test )
+{
+    try {
+        auto make_transfer = [&]( const string& from, const string& to, uint32_t seconds ) {
+            signed_transaction tx;
+            transfer_operation t;
+            t.from = from;
+            t.to = to;
+            t.amount = asset( 1, YANG_SYMBOL );
+            tx.operations.push_back( t );
+            tx.set_expiration( fc::time_point_sec( TAIYI_TESTING_GENESIS_TIMESTAMP + seconds ) );
+            return tx;
+        };
+
+        pending_transaction_pool pool;
+        auto t1 = make_transfer( "alice", "bob", 10 );
+        auto t2 = make_transfer( "bob", "carol", 20 );
+        auto t3 = make_transfer( "dave", "erin", 30 );
+        auto t4 = make_transfer( "carol", "frank", 40 );
+        const auto& p1 = pool.add( t1, t1.id(), true );
+        const auto& p2 = pool.add( t2, t2.id(), false );
+        const auto& p3 = pool.add( t3, t3.id(), false );
+        const auto& p4 = pool.add( t4, t4.id(), false );
+
+        BOOST_TEST_MESSAGE( "--- Test arrival order" );
+
+        BOOST_REQUIRE_EQUAL( pool.size(), 4u );
+        BOOST_REQUIRE( p1.sequence < p2.sequence && p2.sequence < p3.sequence && p3.sequence < p4.sequence );
+        BOOST_REQUIRE( pool.is_applied( p1 ) && !pool.is_applied( p2 ) );
+        BOOST_REQUIRE( pool.is_verified( p1 ) && !pool.is_verified( p2 ) );
+        vector< transaction_id_type > order;
+        for( const auto& ptx : pool.by_arrival() )
+            order.push_back( ptx.id );
+        BOOST_REQUIRE( order == vector< transaction_id_type >( { t1.id(), t2.id(), t3.id(), t4.id() } ) );
+        TAIYI_REQUIRE_THROW( pool.add( t1, t1.id(), false ), fc::exception );
+
+        BOOST_TEST_MESSAGE( "--- Test applied and verified marks are reset independently" );
+
+        pool.reset_applied();
+        BOOST_REQUIRE( !pool.is_applied( p1 ) && pool.is_verified( p1 ) );
+        pool.set_applied( p2 );
+        pool.set_verified( p2 );
+        pool.reset_verified();
+        BOOST_REQUIRE( pool.is_applied( p2 ) && !pool.is_verified( p2 ) && !pool.is_verified( p1 ) );
+
+        BOOST_TEST_MESSAGE( "--- Test included and expired transactions are removed" );
+
+        uint64_t seq3 = p3.sequence;
+        BOOST_REQUIRE_EQUAL( pool.remove_included( { t3.id(), make_transfer( "x", "y", 1 ).id() } ), 1u );
+        BOOST_REQUIRE( !pool.contains( t3.id() ) );
+        BOOST_REQUIRE( pool.find( seq3 ) == nullptr );
+
+        BOOST_REQUIRE_EQUAL( pool.remove_expired( fc::time_point_sec( TAIYI_TESTING_GENESIS_TIMESTAMP + 20 ) ), 2u );
+        BOOST_REQUIRE_EQUAL( pool.size(), 1u );
+        BOOST_REQUIRE( pool.contains( t4.id() ) );
+
+        auto stats = pool.get_stats();
+        BOOST_REQUIRE_EQUAL( stats.size, 1u );
+        BOOST_REQUIRE_EQUAL( stats.bytes, fc::raw::pack_size( t4 ) );
+        BOOST_REQUIRE_EQUAL( stats.added, 4u );
+        BOOST_REQUIRE_EQUAL( stats.included, 1u );
+        BOOST_REQUIRE_EQUAL( stats.expired, 2u );
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( incremental_pending_transactions )
+{
+    try {
+        for( bool incremental : { false, true } )
+        {
+            BOOST_TEST_MESSAGE( "--- Test incremental pending transactions " << ( incremental ? "on" : "off" ) );
+
+            fc::temp_directory dir1( taiyi::utilities::temp_directory_path() ), dir2( taiyi::utilities::temp_directory_path() );
+            database db1, db2;
+            siming::block_producer bp1( db1 ), bp2( db2 );
+            db1.set_log_hardforks(false);
+            open_test_database( db1, dir1.path(), incremental );
+            db2.set_log_hardforks(false);
+            open_test_database( db2, dir2.path(), incremental );
+
+            auto skip_sigs = database::skip_transaction_signatures | database::skip_authority_check;
+            auto init_account_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("init_key")) );
+            public_key_type init_account_pub_key  = init_account_priv_key.get_public_key();
+
+            auto make_transfer = [&]( const string& from, const string& to, int64_t amount ) {
+                signed_transaction tx;
+                transfer_operation t;
+                t.from = from;
+                t.to = to;
+                t.amount = asset( amount, YANG_SYMBOL );
+                tx.operations.push_back( t );
+                tx.set_expiration( db1.head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+                return tx;
+            };
+
+            signed_transaction trx;
+            for( const string name : { "alice", "bob", "carol", "dave" } )
+            {
+                account_create_operation cop;
+                cop.new_account_name = name;
+                cop.creator = TAIYI_INIT_SIMING_NAME;
+                cop.fee = db1.get_siming_schedule_object().median_props.account_creation_fee;
+                cop.owner = authority(1, init_account_pub_key, 1);
+                cop.active = cop.owner;
+                trx.operations.push_back( cop );
+
+                transfer_operation t;
+                t.from = TAIYI_INIT_SIMING_NAME;
+                t.to = name;
+                t.amount = asset( 1000, YANG_SYMBOL );
+                trx.operations.push_back( t );
+            }
+            trx.set_expiration( db1.head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+            PUSH_TX( db1, trx, skip_sigs );
+            auto b = bp1.generate_block( db1.get_slot_time(1), db1.get_scheduled_siming( 1 ), init_account_priv_key, skip_sigs );
+            PUSH_BLOCK( db2, b, skip_sigs );
+            BOOST_REQUIRE( db1.get_pending_transaction_pool().empty() );
+            auto alice_balance = db1.get_balance( "alice", YANG_SYMBOL ).amount.value;
+            auto carol_balance = db1.get_balance( "carol", YANG_SYMBOL ).amount.value;
+            auto dave_balance = db1.get_balance( "dave", YANG_SYMBOL ).amount.value;
+
+            BOOST_TEST_MESSAGE( "--- Test every pending transaction stays applied after a new block" );
+
+            auto ta = make_transfer( "alice", "bob", 10 );
+            auto tb = make_transfer( "carol", "dave", 10 );
+            PUSH_TX( db1, ta, skip_sigs );
+            PUSH_TX( db1, tb, skip_sigs );
+
+            const auto& pool = db1.get_pending_transaction_pool();
+            auto skipped = pool.get_stats().verification_skipped;
+            auto tc = make_transfer( "alice", "bob", 5 );
+            PUSH_TX( db2, tc, skip_sigs );
+            b = bp2.generate_block( db2.get_slot_time(1), db2.get_scheduled_siming( 1 ), init_account_priv_key, skip_sigs );
+            PUSH_BLOCK( db1, b, skip_sigs );
+
+            BOOST_REQUIRE_EQUAL( pool.size(), 2u );
+            BOOST_REQUIRE( pool.is_applied( *pool.find( ta.id() ) ) );
+            BOOST_REQUIRE( pool.is_applied( *pool.find( tb.id() ) ) );
+            BOOST_REQUIRE_EQUAL( db1.get_balance( "alice", YANG_SYMBOL ).amount.value, alice_balance - 5 - 10 );
+            BOOST_REQUIRE_EQUAL( db1.get_balance( "carol", YANG_SYMBOL ).amount.value, carol_balance - 10 );
+            BOOST_REQUIRE_EQUAL( pool.get_stats().verification_skipped, skipped + ( incremental ? 2u : 0u ) );
+            TAIYI_REQUIRE_THROW( PUSH_TX( db1, tb, skip_sigs ), fc::exception );
+
+            BOOST_TEST_MESSAGE( "--- Test an authority change in a block makes pending transactions checked again" );
+
+            account_update_operation uop;
+            uop.account = "dave";
+            uop.posting = authority( 1, init_account_pub_key, 1 );
+            trx = signed_transaction();
+            trx.operations.push_back( uop );
+            trx.set_expiration( db2.head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+            PUSH_TX( db2, trx, skip_sigs );
+            skipped = pool.get_stats().verification_skipped;
+            b = bp2.generate_block( db2.get_slot_time(1), db2.get_scheduled_siming( 1 ), init_account_priv_key, skip_sigs );
+            PUSH_BLOCK( db1, b, skip_sigs );
+            BOOST_REQUIRE_EQUAL( pool.size(), 2u );
+            BOOST_REQUIRE_EQUAL( pool.get_stats().verification_skipped, skipped );
+            BOOST_REQUIRE_EQUAL( pool.get_stats().verified, 2u );
+
+            BOOST_TEST_MESSAGE( "--- Test produced block takes every pending transaction in arrival order" );
+
+            auto td = make_transfer( "dave", "carol", 1 );
+            PUSH_TX( db1, td, skip_sigs );
+            BOOST_REQUIRE_EQUAL( db1.get_balance( "carol", YANG_SYMBOL ).amount.value, carol_balance - 10 + 1 );
+            BOOST_REQUIRE_EQUAL( db1.get_balance( "dave", YANG_SYMBOL ).amount.value, dave_balance + 10 - 1 );
+
+            b = bp1.generate_block( db1.get_slot_time(1), db1.get_scheduled_siming( 1 ), init_account_priv_key, skip_sigs );
+            BOOST_REQUIRE_EQUAL( b.transactions.size(), 3u );
+            BOOST_REQUIRE( b.transactions[ 0 ].id() == ta.id() );
+            BOOST_REQUIRE( b.transactions[ 1 ].id() == tb.id() );
+            BOOST_REQUIRE( b.transactions[ 2 ].id() == td.id() );
+            BOOST_REQUIRE( pool.empty() );
+            BOOST_REQUIRE_EQUAL( pool.get_stats().included, 1u + 3u );
+
+            PUSH_BLOCK( db2, b, skip_sigs );
+            BOOST_REQUIRE_EQUAL( db2.get_balance( "carol", YANG_SYMBOL ).amount.value, carol_balance - 10 + 1 );
+            BOOST_REQUIRE_EQUAL( db2.get_balance( "alice", YANG_SYMBOL ).amount.value, alice_balance - 5 - 10 );
+        }
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( block_packer_test )
+{
+    try {
+        uint32_t next_id = 0;
+        auto make_tx = [&]( uint32_t memo_size ) {
+            signed_transaction tx;
+            transfer_operation t;
+            t.from = "alice";
+            t.to = "bob";
+            t.amount = asset( 1, YANG_SYMBOL );
+            t.memo = string( memo_size, 'x' );
+            tx.operations.push_back( t );
+            tx.ref_block_prefix = next_id++;
+            tx.set_expiration( fc::time_point_sec( TAIYI_TESTING_GENESIS_TIMESTAMP + 60 ) );
+            return tx;
+        };
+
+        pending_transaction_pool pool;
+        vector< transaction_id_type > ids;
+        auto add = [&]( uint32_t memo_size, int64_t qi_cost ) {
+            auto tx = make_tx( memo_size );
+            ids.push_back( tx.id() );
+            pool.set_qi_cost( pool.add( tx, tx.id(), false ), qi_cost );
+        };
+        //排在前面的大交易放不下，后面的小交易不应该被饿死
+        for( uint32_t i = 0; i < 10; ++i )
+            add( 2000, 100 );
+        for( uint32_t i = 0; i < 20; ++i )
+            add( 10, i );
+        auto expired = make_tx( 10 );
+        expired.set_expiration( fc::time_point_sec( TAIYI_TESTING_GENESIS_TIMESTAMP ) );
+        pool.add( expired, expired.id(), false );
+
+        fc::time_point_sec when( TAIYI_TESTING_GENESIS_TIMESTAMP + 3 );
+        uint32_t small_size = pool.find( ids[ 10 ] )->size;
+        uint32_t large_size = pool.find( ids[ 0 ] )->size;
+        uint64_t max_size = 100 + large_size + 20 * small_size + 1;
+        auto apply_all = []( const pending_transaction& ) { return true; };
+
+        BOOST_TEST_MESSAGE( "--- Test oversized transactions are skipped instead of stopping the scan" );
+
+        siming::block_packer packer;
+        auto result = packer.pack( pool, when, 100, max_size, apply_all );
+        BOOST_REQUIRE_EQUAL( result.expired, 1u );
+        BOOST_REQUIRE_EQUAL( result.packed.size(), 21u );
+        BOOST_REQUIRE( result.packed[ 0 ]->id == ids[ 0 ] );
+        BOOST_REQUIRE( result.packed[ 1 ]->id == ids[ 10 ] );
+        BOOST_REQUIRE_EQUAL( result.postponed, 9u );
+        BOOST_REQUIRE_EQUAL( result.block_size, 100 + large_size + 20 * small_size );
+
+        BOOST_TEST_MESSAGE( "--- Test size and qi priorities" );
+
+        packer.set_priority( siming::block_packing_priority::size );
+        result = packer.pack( pool, when, 100, max_size, apply_all );
+        BOOST_REQUIRE_EQUAL( result.packed.size(), 21u );
+        BOOST_REQUIRE( result.packed[ 0 ]->id == ids[ 10 ] );
+        BOOST_REQUIRE( result.packed[ 20 ]->id == ids[ 0 ] );
+
+        packer.set_priority( siming::block_packing_priority::qi_cost );
+        result = packer.pack( pool, when, 100, 100 + large_size + 2 * small_size + 1, apply_all );
+        BOOST_REQUIRE_EQUAL( result.packed.size(), 3u );
+        BOOST_REQUIRE( result.packed[ 0 ]->id == ids[ 0 ] );
+        BOOST_REQUIRE( result.packed[ 1 ]->id == ids[ 29 ] );
+        BOOST_REQUIRE( result.packed[ 2 ]->id == ids[ 28 ] );
+
+        BOOST_TEST_MESSAGE( "--- Test failed transactions are retried after the first pass" );
+
+        //ids[29]依赖ids[10]，按qi排序时排在前面会失败
+        bool dependency_applied = false;
+        result = packer.pack( pool, when, 100, max_size, [&]( const pending_transaction& ptx ) {
+            if( ptx.id == ids[ 10 ] )
+                dependency_applied = true;
+            return ptx.id != ids[ 29 ] || dependency_applied;
+        } );
+        BOOST_REQUIRE_EQUAL( result.packed.size(), 21u );
+        BOOST_REQUIRE_EQUAL( result.retried, 1u );
+        BOOST_REQUIRE_EQUAL( result.failed, 0u );
+        BOOST_REQUIRE( result.packed.back()->id == ids[ 29 ] );
+
+        BOOST_REQUIRE( siming::block_packing_priority_from_string( "size" ) == siming::block_packing_priority::size );
+        TAIYI_REQUIRE_THROW( siming::block_packing_priority_from_string( "fee" ), fc::exception );
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+BOOST_FIXTURE_TEST_CASE( invariant_checker_test, clean_database_fixture )
+{
+    try
+    {
+        auto require_equal = []( const invariant_totals& a, const invariant_totals& b ) {
+            BOOST_REQUIRE_EQUAL( a.supply.value, b.supply.value );
+            BOOST_REQUIRE_EQUAL( a.account_qi.value, b.account_qi.value );
+            BOOST_REQUIRE_EQUAL( a.vsf_adores.value, b.vsf_adores.value );
+            BOOST_REQUIRE_EQUAL( a.reward_qi.value, b.reward_qi.value );
+            BOOST_REQUIRE_EQUAL( a.reward_feigang.value, b.reward_feigang.value );
+            BOOST_REQUIRE_EQUAL( a.nfa_qi.value, b.nfa_qi.value );
+            BOOST_REQUIRE_EQUAL( a.cultivation_qi.value, b.cultivation_qi.value );
+            BOOST_REQUIRE_EQUAL( a.gold.value, b.gold.value );
+            BOOST_REQUIRE_EQUAL( a.food.value, b.food.value );
+            BOOST_REQUIRE_EQUAL( a.wood.value, b.wood.value );
+            BOOST_REQUIRE_EQUAL( a.fabric.value, b.fabric.value );
+            BOOST_REQUIRE_EQUAL( a.herb.value, b.herb.value );
+            BOOST_REQUIRE_EQUAL( a.actors, b.actors );
+            BOOST_REQUIRE_EQUAL( a.live_actors, b.live_actors );
+        };
+
+        ACTORS( (alice)(bob)(carol) )
+        generate_block();
+        FUND( "alice", 100000 );
+        vest( TAIYI_INIT_SIMING_NAME, "bob", ASSET( "100.000 YANG" ) );
+        generate_block();
+
+        auto& checker = db->get_invariant_checker();
+
+        BOOST_TEST_MESSAGE( "--- Test sharded scan matches single thread scan" );
+        checker.set_thread_num( 0 );
+        auto single = checker.scan();
+        checker.set_thread_num( 4 );
+        require_equal( single, checker.scan() );
+        db->validate_invariants();
+
+        BOOST_TEST_MESSAGE( "--- Test running totals follow modifications, undo and pop_block" );
+        checker.set_incremental( true );
+        BOOST_REQUIRE( checker.is_incremental() );
+        require_equal( checker.get_running_totals(), checker.scan() );
+
+        transfer( "alice", "carol", ASSET( "1.000 YANG" ) );
+        vest( "alice", "carol", ASSET( "1.000 YANG" ) );
+        require_equal( checker.get_running_totals(), checker.scan() );
+        generate_blocks( 3 );
+        require_equal( checker.get_running_totals(), checker.scan() );
+        db->validate_invariants();
+
+        transfer( "alice", "bob", ASSET( "2.000 YANG" ) );
+        generate_block();
+        db->pop_block();
+        require_equal( checker.get_running_totals(), checker.scan() );
+        db->validate_invariants();
+
+        BOOST_TEST_MESSAGE( "--- Test incremental check detects an inconsistent balance" );
+        {
+            auto session = db->start_undo_session();
+            db->modify( db->get_account( "alice" ), []( account_object& a ) {
+                a.balance += asset( 1, YANG_SYMBOL );
+            } );
+            require_equal( checker.get_running_totals(), checker.scan() );
+            TAIYI_REQUIRE_THROW( db->validate_invariants(), fc::exception );
+            session.undo();
+        }
+        require_equal( checker.get_running_totals(), checker.scan() );
+        db->validate_invariants();
+
+        checker.set_incremental( false );
+        checker.set_thread_num( 0 );
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+BOOST_FIXTURE_TEST_CASE( changed_objects_feed_test, clean_database_fixture )
+{
+    try
+    {
+        ACTORS( (alice)(bob) )
+        generate_block();
+        FUND( "alice", 100000 );
+        generate_block();
+
+        vector< changed_objects_notification< account_object > > notes;
+        vector< string > created, modified;
+        vector< std::pair< asset, asset > > alice_balances;
+        auto conn = db->add_changed_objects_handler< account_index >( [&]( const changed_objects_notification< account_object >& note ) {
+            notes.push_back( changed_objects_notification< account_object >() );
+            notes.back().block_num = note.block_num;
+            notes.back().change_count = note.change_count;
+            notes.back().truncated = note.truncated;
+            for( const auto* a : note.created )
+                created.push_back( a->name );
+            for( const auto& m : note.modified )
+            {
+                BOOST_REQUIRE( m.first->id == m.second->id );
+                modified.push_back( m.second->name );
+                if( m.second->name == "alice" )
+                    alice_balances.emplace_back( m.first->balance, m.second->balance );
+            }
+        }, *db_plugin );
+
+        BOOST_TEST_MESSAGE( "--- Test one notification per block with before and after values" );
+        auto alice_before = db->get_account( "alice" ).balance;
+        transfer( "alice", "bob", ASSET( "1.000 YANG" ) );
+        transfer( "alice", "bob", ASSET( "2.000 YANG" ) );
+        BOOST_REQUIRE( notes.empty() );
+        generate_block();
+        BOOST_REQUIRE_EQUAL( notes.size(), 1u );
+        BOOST_REQUIRE_EQUAL( notes[0].block_num, db->head_block_num() );
+        BOOST_REQUIRE( !notes[0].truncated );
+        BOOST_REQUIRE( std::find( modified.begin(), modified.end(), "bob" ) != modified.end() );
+        BOOST_REQUIRE_EQUAL( alice_balances.size(), 1u );
+        BOOST_REQUIRE( alice_balances[0].first == alice_before );
+        BOOST_REQUIRE( alice_balances[0].second == db->get_account( "alice" ).balance );
+
+        BOOST_TEST_MESSAGE( "--- Test created objects" );
+        ACTORS( (carol) )
+        generate_block();
+        BOOST_REQUIRE( std::find( created.begin(), created.end(), "carol" ) != created.end() );
+
+        BOOST_TEST_MESSAGE( "--- Test bounded subscription gets a truncated notification" );
+        vector< changed_objects_notification< account_object > > bounded;
+        auto bounded_conn = db->add_changed_objects_handler< account_index >( [&]( const changed_objects_notification< account_object >& note ) {
+            BOOST_REQUIRE( note.created.empty() && note.modified.empty() && note.removed.empty() );
+            bounded.push_back( changed_objects_notification< account_object >() );
+            bounded.back().change_count = note.change_count;
+            bounded.back().truncated = note.truncated;
+        }, *db_plugin, 1 );
+
+        notes.clear();
+        modified.clear();
+        transfer( "alice", "bob", ASSET( "3.000 YANG" ) );
+        generate_block();
+        BOOST_REQUIRE_EQUAL( bounded.size(), 1u );
+        BOOST_REQUIRE( bounded[0].truncated );
+        BOOST_REQUIRE( bounded[0].change_count >= 2 );
+        BOOST_REQUIRE_EQUAL( notes.size(), 1u );
+        BOOST_REQUIRE( !notes[0].truncated );
+        BOOST_REQUIRE_EQUAL( notes[0].change_count, bounded[0].change_count );
+
+        conn.disconnect();
+        bounded_conn.disconnect();
+        transfer( "alice", "bob", ASSET( "4.000 YANG" ) );
+        generate_block();
+        BOOST_REQUIRE_EQUAL( notes.size(), 1u );
+        BOOST_REQUIRE_EQUAL( bounded.size(), 1u );
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+BOOST_FIXTURE_TEST_CASE( changed_objects_feed_fork_switch, clean_database_fixture )
+{
+    try
+    {
+        ACTORS( (alice)(bob) )
+        generate_block();
+        FUND( "alice", 100000 );
+        generate_block();
+
+        struct entry
+        {
+            uint32_t                        block_num;
+            bool                            reverted;
+            fc::optional< asset >           alice_first;
+            fc::optional< asset >           alice_second;
+        };
+        vector< entry > notes;
+        auto conn = db->add_changed_objects_handler< account_index >( [&]( const changed_objects_notification< account_object >& note ) {
+            entry e{ note.block_num, note.reverted };
+            for( const auto& m : note.modified )
+            {
+                if( m.second->name == "alice" )
+                {
+                    e.alice_first = m.first->balance;
+                    e.alice_second = m.second->balance;
+                }
+            }
+            notes.push_back( e );
+        }, *db_plugin );
+
+        auto alice_before = db->get_account( "alice" ).balance;
+        uint32_t fork_num = db->head_block_num();
+
+        transfer( "alice", "bob", ASSET( "1.000 YANG" ) );
+        generate_block();
+        auto b1 = *db->fetch_block_by_number( fork_num + 1 );
+        auto alice_after = db->get_account( "alice" ).balance;
+        generate_block();
+        auto b2 = *db->fetch_block_by_number( fork_num + 2 );
+        BOOST_REQUIRE_EQUAL( notes.size(), 2u );
+        BOOST_REQUIRE( !notes[0].reverted && !notes[1].reverted );
+
+        BOOST_TEST_MESSAGE( "--- Test popped blocks are reported as reverted, newest first" );
+        notes.clear();
+        db->pop_block();
+        db->pop_block();
+        BOOST_REQUIRE_EQUAL( notes.size(), 2u );
+        BOOST_REQUIRE( notes[0].reverted && notes[0].block_num == fork_num + 2 );
+        BOOST_REQUIRE( notes[1].reverted && notes[1].block_num == fork_num + 1 );
+        BOOST_REQUIRE( notes[1].alice_first.valid() && *notes[1].alice_first == alice_before );
+        BOOST_REQUIRE( *notes[1].alice_second == alice_after );
+        BOOST_REQUIRE( db->get_account( "alice" ).balance == alice_before );
+
+        BOOST_TEST_MESSAGE( "--- Test switching to a longer fork reverts the old head and applies the fork" );
+        db->clear_pending();
+        generate_block( 0, init_account_priv_key, 1 );
+        BOOST_REQUIRE_EQUAL( db->head_block_num(), fork_num + 1 );
+        BOOST_REQUIRE( db->head_block_id() != b1.id() );
+
+        notes.clear();
+        db->push_block( b1 );
+        BOOST_REQUIRE( notes.empty() );
+        db->push_block( b2 );
+        BOOST_REQUIRE( db->head_block_id() == b2.id() );
+        BOOST_REQUIRE_EQUAL( notes.size(), 3u );
+        BOOST_REQUIRE( notes[0].reverted && notes[0].block_num == fork_num + 1 );
+        BOOST_REQUIRE( !notes[1].reverted && notes[1].block_num == fork_num + 1 );
+        BOOST_REQUIRE( notes[1].alice_second.valid() && *notes[1].alice_second == alice_after );
+        BOOST_REQUIRE( !notes[2].reverted && notes[2].block_num == fork_num + 2 );
+        BOOST_REQUIRE( db->get_account( "alice" ).balance == alice_after );
+
+        conn.disconnect();
+        validate_database();
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+BOOST_FIXTURE_TEST_CASE( changed_objects_feed_rejected_block, clean_database_fixture )
+{
+    try
+    {
+        ACTORS( (alice)(bob) )
+        generate_block();
+        FUND( "alice", 100000 );
+        generate_block();
+
+        vector< uint32_t > notified;
+        auto conn = db->add_changed_objects_handler< account_index >( [&]( const changed_objects_notification< account_object >& note ) {
+            notified.push_back( note.block_num );
+        }, *db_plugin );
+
+        BOOST_TEST_MESSAGE( "--- Test a block failing the invariant check is not notified" );
+        db->clear_pending();
+        auto break_supply = [&]( int64_t delta ) {
+            db->modify( db->get_account( "alice" ), [&]( account_object& a ) {
+                a.balance += asset( delta, YANG_SYMBOL );
+            } );
+        };
+        break_supply( 1 );
+
+        uint32_t head_num = db->head_block_num();
+        transfer( "alice", "bob", ASSET( "1.000 YANG" ) );
+        TAIYI_REQUIRE_THROW( generate_block(), fc::exception );
+        BOOST_REQUIRE_EQUAL( db->head_block_num(), head_num );
+        BOOST_REQUIRE( notified.empty() );
+
+        BOOST_TEST_MESSAGE( "--- Test the block is notified once it is accepted" );
+        db->clear_pending();
+        break_supply( -1 );
+        transfer( "alice", "bob", ASSET( "1.000 YANG" ) );
+        generate_block();
+        BOOST_REQUIRE_EQUAL( notified.size(), 1u );
+        BOOST_REQUIRE_EQUAL( notified[0], head_num + 1 );
+
+        conn.disconnect();
+        validate_database();
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+BOOST_FIXTURE_TEST_CASE( state_snapshot_test, clean_database_fixture )
+{
+    try
+    {
+        ACTORS( (alice)(bob) )
+        generate_block();
+        FUND( "alice", 100000 );
+        generate_block();
+
+        BOOST_TEST_MESSAGE( "--- Test the snapshot follows applied blocks only" );
+        auto snapshot = db->get_state_snapshot();
+        BOOST_REQUIRE( snapshot );
+        BOOST_REQUIRE_EQUAL( snapshot->dynamic_global_properties.head_block_number, db->head_block_num() );
+        BOOST_REQUIRE( snapshot->dynamic_global_properties.head_block_id == db->head_block_id() );
+        BOOST_REQUIRE_EQUAL( snapshot->reward_funds.size(), db->get_index< reward_fund_index >().indices().size() );
+
+        auto supply = db->get_dynamic_global_properties().current_supply;
+        vest( "alice", "bob", ASSET( "1.000 YANG" ) );
+        BOOST_REQUIRE( db->get_state_snapshot() == snapshot );
+
+        generate_block();
+        auto next = db->get_state_snapshot();
+        BOOST_REQUIRE( next != snapshot );
+        BOOST_REQUIRE_EQUAL( next->dynamic_global_properties.head_block_number, db->head_block_num() );
+        BOOST_REQUIRE( snapshot->dynamic_global_properties.head_block_number + 1 == next->dynamic_global_properties.head_block_number );
+
+        BOOST_TEST_MESSAGE( "--- Test pop_block publishes the previous state" );
+        db->pop_block();
+        BOOST_REQUIRE_EQUAL( db->get_state_snapshot()->dynamic_global_properties.head_block_number, db->head_block_num() );
+        BOOST_REQUIRE( db->get_state_snapshot()->dynamic_global_properties.current_supply == supply );
+        generate_block();
+
+        BOOST_TEST_MESSAGE( "--- Test a block failing the invariant check is not published" );
+        db->clear_pending();
+        auto break_supply = [&]( int64_t delta ) {
+            db->modify( db->get_account( "alice" ), [&]( account_object& a ) {
+                a.balance += asset( delta, YANG_SYMBOL );
+            } );
+        };
+        break_supply( 1 );
+        snapshot = db->get_state_snapshot();
+        TAIYI_REQUIRE_THROW( generate_block(), fc::exception );
+        BOOST_REQUIRE( db->get_state_snapshot() == snapshot );
+        BOOST_REQUIRE_EQUAL( snapshot->dynamic_global_properties.head_block_number, db->head_block_num() );
+        break_supply( -1 );
+        generate_block();
+        BOOST_REQUIRE_EQUAL( db->get_state_snapshot()->dynamic_global_properties.head_block_number, db->head_block_num() );
+
+        BOOST_TEST_MESSAGE( "--- Test readers need no lock while blocks are applied" );
+        std::atomic< bool > done( false );
+        std::atomic< uint32_t > reads( 0 );
+        std::atomic< bool > consistent( true );
+        std::thread reader( [&]() {
+            while( !done )
+            {
+                auto s = db->get_state_snapshot();
+                if( block_header::num_from_id( s->dynamic_global_properties.head_block_id ) != s->dynamic_global_properties.head_block_number )
+                    consistent = false;
+                ++reads;
+            }
+        } );
+        generate_blocks( 10 );
+        done = true;
+        reader.join();
+        BOOST_REQUIRE( consistent );
+        BOOST_REQUIRE( reads > 0 );
+    }
+    FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_SUITE_END()
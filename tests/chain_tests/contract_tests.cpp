@@ -23,6 +23,7 @@ extern "C" {
 
 #include <chain/lua_context.hpp>
 #include <chain/contract_handles.hpp>
+#include <chain/contract_worker.hpp>
 
 using namespace taiyi;
 using namespace taiyi::chain;
@@ -835,4 +836,204 @@ BOOST_AUTO_TEST_CASE( call_contract_function_apply )
 } FC_LOG_AND_RETHROW() }
 
 
+BOOST_AUTO_TEST_CASE( contract_chunk_cache )
+{ try {
+    string lua_code1 =  "function get_value() \n \
+                            return { value = 1, name = 'this is a long string constant in the first version' } \n \
+                        end";
+
+    string lua_code2 =  "function get_value() \n \
+                            return { value = 2, name = 'this is a long string constant in the second version' } \n \
+                        end";
+
+    BOOST_TEST_MESSAGE( "Testing: contract_chunk_cache" );
+
+    ACTORS( (alice) )
+    vest( TAIYI_INIT_SIMING_NAME, TAIYI_DAO_ACCOUNT, ASSET( "1000.000 YANG" ) ); //执行提案需要真气
+    generate_xinsu({"alice"});
+    vest( TAIYI_INIT_SIMING_NAME, "alice", ASSET( "1000.000 YANG" ) );
+    generate_block();
+
+    signed_transaction tx;
+
+    create_contract_operation op;
+    op.owner = "alice";
+    op.name = "contract.test";
+    op.data = lua_code1;
+
+    tx.operations.push_back( op );
+    tx.set_expiration( db->head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+    sign( tx, alice_private_key );
+    db->push_transaction( tx, 0 );
+    generate_block();
+
+    auto& cache = db->get_lua_chunk_cache();
+    const auto& caller = db->get_account( "alice" );
+    auto get_value = [&]( long long& used_drops ) -> int64_t {
+        const auto& contract = db->get<contract_object, by_name>( "contract.test" );
+        LuaContext context;
+        db->initialize_VM_baseENV( context );
+        contract_worker worker;
+        vector<lua_types> value_list;
+        long long vm_drops = 10000000;
+        lua_table result = worker.do_contract_function( caller, "get_value", value_list, contract, vm_drops, true, context, *db );
+        used_drops = 10000000 - vm_drops;
+        auto itr = result.v.find( lua_types( lua_string( "value" ) ) );
+        BOOST_REQUIRE( itr != result.v.end() );
+        return itr->second.get<lua_int>().v;
+    };
+
+    BOOST_TEST_MESSAGE( "--- Test cached chunk has the same drops accounting as undumped one" );
+
+    long long uncached_drops = 0, missed_drops = 0, cached_drops = 0;
+    {
+        auto session = db->start_undo_session(); //合约执行对状态的修改在这里撤销
+
+        cache.set_capacity( 0 );
+        BOOST_REQUIRE_EQUAL( get_value( uncached_drops ), 1 );
+
+        cache.set_capacity( 16 );
+        auto old_misses = cache.get_misses();
+        BOOST_REQUIRE_EQUAL( get_value( missed_drops ), 1 );
+        BOOST_REQUIRE( cache.get_misses() > old_misses );
+
+        auto old_hits = cache.get_hits();
+        BOOST_REQUIRE_EQUAL( get_value( cached_drops ), 1 );
+        BOOST_REQUIRE( cache.get_hits() > old_hits );
+        BOOST_REQUIRE( cache.get_image_bytes() > 0 );
+    }
+    idump( (uncached_drops)(missed_drops)(cached_drops) );
+    BOOST_REQUIRE_EQUAL( uncached_drops, missed_drops );
+    BOOST_REQUIRE_EQUAL( uncached_drops, cached_drops );
+
+    BOOST_TEST_MESSAGE( "--- Test revise contract invalidates cached chunk" );
+
+    revise_contract_operation rop;
+    rop.reviser = "alice";
+    rop.contract_name = "contract.test";
+    rop.data = lua_code2;
+
+    tx.operations.clear();
+    tx.signatures.clear();
+    tx.set_expiration( db->head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+    tx.operations.push_back( rop );
+    sign( tx, alice_private_key );
+    db->push_transaction( tx, 0 );
+
+    {
+        auto session = db->start_undo_session();
+        long long drops = 0;
+        BOOST_REQUIRE_EQUAL( get_value( drops ), 2 );
+        BOOST_REQUIRE_EQUAL( get_value( drops ), 2 );
+    }
+
+    BOOST_TEST_MESSAGE( "--- Test undo of revise restores the previous version" );
+
+    db->clear_pending(); //撤销pending中的revise
+    {
+        auto session = db->start_undo_session();
+        long long drops = 0;
+        BOOST_REQUIRE_EQUAL( get_value( drops ), 1 );
+    }
+
+    cache.set_capacity( 0 );
+
+} FC_LOG_AND_RETHROW() }
+
+
+BOOST_AUTO_TEST_CASE( contract_data_copy_on_write )
+{ try {
+    string lua_code =  "function write_data() \n \
+                            contract_helper:write_contract_data({ a = 1, b = 'hello', t = { x = 1, y = 2 } }, { a = true, b = true, t = true }) \n \
+                            contract_helper:write_account_contract_data({ score = 10 }, { score = true }) \n \
+                        end \n \
+                        function update_data() \n \
+                            local d = contract_helper:read_contract_data({ t = { y = true } }) \n \
+                            contract_helper:write_contract_data({ t = { y = d.t.y + 1 } }, { t = { y = true } }) \n \
+                            contract_helper:write_contract_data({}, { b = false }) \n \
+                        end \n \
+                        function read_data() \n \
+                            local d = contract_helper:read_contract_data({ a = true }) \n \
+                            assert(d.a == 1) \n \
+                        end";
+
+    BOOST_TEST_MESSAGE( "Testing: contract_data_copy_on_write" );
+
+    ACTORS( (alice) )
+    vest( TAIYI_INIT_SIMING_NAME, TAIYI_DAO_ACCOUNT, ASSET( "1000.000 YANG" ) ); //执行提案需要真气
+    generate_xinsu({"alice"});
+    vest( TAIYI_INIT_SIMING_NAME, "alice", ASSET( "1000.000 YANG" ) );
+    generate_block();
+
+    signed_transaction tx;
+
+    create_contract_operation op;
+    op.owner = "alice";
+    op.name = "contract.test";
+    op.data = lua_code;
+
+    tx.operations.push_back( op );
+    tx.set_expiration( db->head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+    sign( tx, alice_private_key );
+    db->push_transaction( tx, 0 );
+    generate_block();
+
+    auto call = [&]( const string& function_name ) {
+        call_contract_function_operation cop;
+        cop.caller = "alice";
+        cop.contract_name = "contract.test";
+        cop.function_name = function_name;
+
+        tx.operations.clear();
+        tx.signatures.clear();
+        tx.set_expiration( db->head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+        tx.operations.push_back( cop );
+        sign( tx, alice_private_key );
+        db->push_transaction( tx, 0 );
+        generate_block();
+    };
+
+    auto check_size = [&]() {
+        const auto& contract = db->get<contract_object, by_name>( "contract.test" );
+        BOOST_REQUIRE_EQUAL( contract.contract_data_size, fc::raw::pack_size( contract.contract_data ) );
+        const auto& acd = db->get<account_contract_data_object, by_account_contract>( boost::make_tuple( db->get_account( "alice" ).id, contract.id ) );
+        BOOST_REQUIRE_EQUAL( acd.contract_data_size, fc::raw::pack_size( acd.contract_data ) );
+    };
+
+    BOOST_TEST_MESSAGE( "--- Test write back only touched keys" );
+
+    call( "write_data" );
+    check_size();
+    {
+        const auto& data = db->get<contract_object, by_name>( "contract.test" ).contract_data;
+        BOOST_REQUIRE_EQUAL( data.size(), 3u );
+        BOOST_REQUIRE_EQUAL( data.at( lua_types( lua_string( "a" ) ) ).get<lua_int>().v, 1 );
+        BOOST_REQUIRE_EQUAL( data.at( lua_types( lua_string( "b" ) ) ).get<lua_string>().v, "hello" );
+    }
+
+    BOOST_TEST_MESSAGE( "--- Test nested update and erase" );
+
+    call( "update_data" );
+    check_size();
+    {
+        const auto& data = db->get<contract_object, by_name>( "contract.test" ).contract_data;
+        BOOST_REQUIRE_EQUAL( data.size(), 2u );
+        BOOST_REQUIRE( data.find( lua_types( lua_string( "b" ) ) ) == data.end() );
+        const auto& t = data.at( lua_types( lua_string( "t" ) ) ).get<lua_table>().v;
+        BOOST_REQUIRE_EQUAL( t.at( lua_types( lua_string( "x" ) ) ).get<lua_int>().v, 1 );
+        BOOST_REQUIRE_EQUAL( t.at( lua_types( lua_string( "y" ) ) ).get<lua_int>().v, 3 );
+    }
+
+    BOOST_TEST_MESSAGE( "--- Test read only call keeps stored data" );
+
+    auto old_data = fc::raw::pack_to_vector( db->get<contract_object, by_name>( "contract.test" ).contract_data );
+    call( "read_data" );
+    check_size();
+    BOOST_REQUIRE( fc::raw::pack_to_vector( db->get<contract_object, by_name>( "contract.test" ).contract_data ) == old_data );
+
+    validate_database();
+
+} FC_LOG_AND_RETHROW() }
+
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -15,15 +15,18 @@
 #include <chain/nfa_objects.hpp>
 
 #include <chain/lua_context.hpp>
+#include <chain/contract_worker.hpp>
 
 #include <fc/macros.hpp>
 #include <fc/crypto/digest.hpp>
 
 #include "../db_fixture/database_fixture.hpp"
 
+#include <chrono>
 #include <cmath>
 #include <iostream>
 #include <stdexcept>
+#include <thread>
 
 using namespace taiyi;
 using namespace taiyi::chain;
@@ -1517,4 +1520,338 @@ BOOST_AUTO_TEST_CASE( inter_nfa_action_drops )
 
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE( nfa_contract_data_size_tracking )
+{ try {
+
+    BOOST_TEST_MESSAGE( "Testing: nfa_contract_data_size_tracking" );
+
+    //依次为：修改顶层和嵌套的键，删除顶层键
+    string nfa_code_lua = " grow = { consequence = true }       \n \
+                            function init_data() return { hp = 10, bag = { a = 1 } } end  \n \
+                            function do_grow()                  \n \
+                                local d = nfa_helper:read_contract_data({ hp = true })  \n \
+                                nfa_helper:write_contract_data({ hp = d.hp + 1, bag = { b = 'sword' } }, { hp = true, bag = { b = true } })  \n \
+                                nfa_helper:write_contract_data({}, { hp = false })      \n \
+                            end";
+
+    signed_transaction tx;
+    ACTORS( (alice)(bob) )
+    vest( TAIYI_INIT_SIMING_NAME, TAIYI_DAO_ACCOUNT, ASSET( "1000.000 YANG" ) ); //执行提案需要真气
+    generate_xinsu({"alice","bob"});
+    vest( TAIYI_INIT_SIMING_NAME, "alice", ASSET( "1000.000 YANG" ) );
+    vest( TAIYI_INIT_SIMING_NAME, "bob", ASSET( "1000.000 YANG" ) );
+    generate_block();
+
+    create_contract_operation op;
+
+    op.owner = "bob";
+    op.name = "contract.nfa.basic";
+    op.data = s_code_nfa_basic;
+    tx.operations.push_back( op );
+
+    op.owner = "bob";
+    op.name = "contract.nfa.grow";
+    op.data = nfa_code_lua;
+    tx.operations.push_back( op );
+
+    tx.set_expiration( db->head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+    sign( tx, bob_private_key );
+    db->push_transaction( tx, 0 );
+    validate_database();
+
+    generate_block();
+
+    call_contract_function_operation cop;
+    cop.caller = "alice";
+    cop.contract_name = "contract.nfa.basic";
+    cop.function_name = "create_nfa_symbol";
+    cop.value_list = { lua_string("nfa.grow"), lua_string("test"), lua_string("contract.nfa.grow"), lua_int(100), lua_int(0), lua_bool(false) };
+
+    tx.operations.clear();
+    tx.signatures.clear();
+    tx.set_expiration( db->head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+    tx.operations.push_back( cop );
+    sign( tx, alice_private_key );
+    db->push_transaction( tx, 0 );
+    validate_database();
+
+    generate_block();
+
+    cop.function_name = "create_nfa_to_me";
+    cop.value_list = { lua_string("nfa.grow") };
+
+    tx.operations.clear();
+    tx.signatures.clear();
+    tx.set_expiration( db->head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+    tx.operations.push_back( cop );
+    sign( tx, alice_private_key );
+    db->push_transaction( tx, 0 );
+    validate_database();
+
+    generate_block();
+
+    const auto& to = db->get<transaction_object, by_trx_id>(tx.id());
+    int64_t nfa_id = to.operation_results[0].get<contract_result>().contract_affecteds[0].get<nfa_affected>().affected_item;
+    auto require_size = [&]() {
+        const auto& nfa = db->get<nfa_object, by_id>( nfa_id );
+        BOOST_REQUIRE_EQUAL( nfa.contract_data_size, fc::raw::pack_size( nfa.contract_data ) );
+        return nfa.contract_data;
+    };
+    auto created_data = fc::raw::pack_to_vector( require_size() );
+
+    BOOST_TEST_MESSAGE( "--- Test size is kept through nested writes and erases" );
+
+    action_nfa_operation anop;
+    anop.caller = "alice";
+    anop.id = nfa_id;
+    anop.action = "grow";
+
+    tx.operations.clear();
+    tx.signatures.clear();
+    tx.set_expiration( db->head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+    tx.operations.push_back( anop );
+    sign( tx, alice_private_key );
+    db->push_transaction( tx, 0 );
+
+    auto data = require_size();
+    BOOST_REQUIRE( data.find( lua_types( lua_string( "hp" ) ) ) == data.end() );
+    const auto& bag = data[ lua_types( lua_string( "bag" ) ) ].get<lua_table>().v;
+    BOOST_REQUIRE_EQUAL( bag.size(), 2u );
+
+    generate_block();
+    require_size();
+
+    BOOST_TEST_MESSAGE( "--- Test size is restored by undo" );
+
+    db->pop_block();
+    BOOST_REQUIRE( fc::raw::pack_to_vector( require_size() ) == created_data );
+
+    validate_database();
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( nested_handler_contract_data_write_back )
+{ try {
+
+    BOOST_TEST_MESSAGE( "Testing: nested_handler_contract_data_write_back" );
+
+    //outer导入inner后再通过nfa行为调用inner，inner的写入由嵌套的contract_handler完成，
+    //导入时创建的handler在outer结束时以自己的快照写回，覆盖inner的写入
+    string outer_code_lua = "run_nested = { consequence = true }     \n \
+                                                                    \n \
+                            function init_data() return {} end      \n \
+                                                                    \n \
+                            function do_run_nested(nfa_id)          \n \
+                                local inner = import_contract('contract.nested.inner')   \n \
+                                contract_helper:do_nfa_action(nfa_id, 'bump', {})       \n \
+                            end";
+
+    string inner_code_lua = "bump = { consequence = true }          \n \
+                                                                    \n \
+                            function init_data() return {} end      \n \
+                                                                    \n \
+                            function do_bump()                      \n \
+                                contract_helper:write_contract_data({ v = 2 }, { v = true })   \n \
+                            end";
+
+    signed_transaction tx;
+    ACTORS( (alice)(bob) )
+    vest( TAIYI_INIT_SIMING_NAME, TAIYI_DAO_ACCOUNT, ASSET( "1000.000 YANG" ) ); //执行提案需要真气
+    generate_xinsu({"alice","bob"});
+    vest( TAIYI_INIT_SIMING_NAME, "alice", ASSET( "1000.000 YANG" ) );
+    vest( TAIYI_INIT_SIMING_NAME, "bob", ASSET( "1000.000 YANG" ) );
+    generate_block();
+
+    create_contract_operation op;
+
+    op.owner = "bob";
+    op.name = "contract.nfa.basic";
+    op.data = s_code_nfa_basic;
+    tx.operations.push_back( op );
+
+    op.owner = "bob";
+    op.name = "contract.nested.outer";
+    op.data = outer_code_lua;
+    tx.operations.push_back( op );
+
+    op.owner = "bob";
+    op.name = "contract.nested.inner";
+    op.data = inner_code_lua;
+    tx.operations.push_back( op );
+
+    tx.set_expiration( db->head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+    sign( tx, bob_private_key );
+    db->push_transaction( tx, 0 );
+    validate_database();
+
+    generate_block();
+
+    call_contract_function_operation cop;
+
+    tx.operations.clear();
+
+    cop.caller = "alice";
+    cop.contract_name = "contract.nfa.basic";
+    cop.function_name = "create_nfa_symbol";
+    cop.value_list = { lua_string("nfa.outer"), lua_string("test"), lua_string("contract.nested.outer"), lua_int(3), lua_int(0), lua_bool(false) };
+    tx.operations.push_back( cop );
+
+    cop.value_list = { lua_string("nfa.inner"), lua_string("test"), lua_string("contract.nested.inner"), lua_int(3), lua_int(0), lua_bool(false) };
+    tx.operations.push_back( cop );
+
+    tx.signatures.clear();
+    tx.set_expiration( db->head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+    sign( tx, alice_private_key );
+    db->push_transaction( tx, 0 );
+    validate_database();
+
+    generate_block();
+
+    tx.operations.clear();
+
+    cop.function_name = "create_nfa_to_me";
+    cop.value_list = { lua_string("nfa.outer") };
+    tx.operations.push_back( cop );
+
+    cop.value_list = { lua_string("nfa.inner") };
+    tx.operations.push_back( cop );
+
+    tx.signatures.clear();
+    tx.set_expiration( db->head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+    sign( tx, alice_private_key );
+    db->push_transaction( tx, 0 );
+    validate_database();
+
+    generate_block();
+
+    const auto& to = db->get<transaction_object, by_trx_id>(tx.id());
+    BOOST_REQUIRE( to.operation_results.size() == 2 );
+    int64_t outer_id = to.operation_results[0].get<contract_result>().contract_affecteds[0].get<nfa_affected>().affected_item;
+    int64_t inner_id = to.operation_results[1].get<contract_result>().contract_affecteds[0].get<nfa_affected>().affected_item;
+
+    auto inner_v = [&]() -> fc::optional<lua_types> {
+        const auto& contract = db->get<contract_object, by_name>( "contract.nested.inner" );
+        BOOST_REQUIRE_EQUAL( contract.contract_data_size, fc::raw::pack_size( contract.contract_data ) );
+        auto itr = contract.contract_data.find( lua_types( lua_string( "v" ) ) );
+        if( itr == contract.contract_data.end() )
+            return fc::optional<lua_types>();
+        return itr->second;
+    };
+
+    BOOST_TEST_MESSAGE( "--- Test nested write is restored by the importing handler" );
+
+    action_nfa_operation anop;
+    anop.caller = "alice";
+    anop.id = outer_id;
+    anop.action = "run_nested";
+    anop.value_list = { lua_int(inner_id) };
+
+    tx.operations.clear();
+    tx.signatures.clear();
+    tx.set_expiration( db->head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+    tx.operations.push_back( anop );
+    sign( tx, alice_private_key );
+    db->push_transaction( tx, 0 );
+    validate_database();
+
+    BOOST_REQUIRE( !inner_v().valid() );
+
+    generate_block();
+
+    BOOST_TEST_MESSAGE( "--- Test the same write without the outer handler" );
+
+    anop.id = inner_id;
+    anop.action = "bump";
+    anop.value_list = {};
+
+    tx.operations.clear();
+    tx.signatures.clear();
+    tx.set_expiration( db->head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+    tx.operations.push_back( anop );
+    sign( tx, alice_private_key );
+    db->push_transaction( tx, 0 );
+    validate_database();
+
+    auto v = inner_v();
+    BOOST_REQUIRE( v.valid() && v->get<lua_int>().v == 2 );
+
+    generate_block();
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( heart_beat_vm_pool_benchmark )
+{ try {
+
+    BOOST_TEST_MESSAGE( "Testing: heart_beat_vm_pool_benchmark" );
+
+    const uint32_t bench_count = 200;
+    auto& pool = db->get_lua_context_pool();
+
+    BOOST_TEST_MESSAGE( "--- Test pooled context has the same drops accounting as a fresh one" );
+
+    {
+        auto session = db->start_undo_session(); //合约执行对状态的修改在这里撤销
+        const auto& caller = db->get_account( TAIYI_INIT_SIMING_NAME );
+        const auto& contract = db->get<contract_object, by_name>( "contract.nfa.xinsumark" );
+        //内存分配的drops与每个虚拟机随机的字符串哈希种子有关，两个虚拟机之间只比较指令的drops
+        auto run_init = [&]( LuaContext& context ) -> long long {
+            contract_worker worker;
+            vector<lua_types> value_list;
+            long long vm_drops = 10000000;
+            long long old_mem_drops = lua_getmemdrops( context.mState );
+            worker.do_contract_function( caller, TAIYI_NFA_INIT_FUNC_NAME, value_list, contract, vm_drops, true, context, *db );
+            return 10000000 - vm_drops - ( lua_getmemdrops( context.mState ) - old_mem_drops );
+        };
+
+        LuaContext fresh_context;
+        db->initialize_VM_baseENV( fresh_context );
+        long long fresh_drops = run_init( fresh_context );
+
+        pool.start( 4 );
+        db->release_VM_context( db->acquire_VM_context() ); //设置baseENV，开始预热
+        for( int wait = 0; wait < 1000 && pool.get_ready_size() == 0; ++wait )
+            std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+        auto old_hits = pool.get_hits();
+        auto pooled_context = db->acquire_VM_context();
+        BOOST_REQUIRE_EQUAL( pool.get_hits(), old_hits + 1 ); //确实取自预热的虚拟机
+        long long pooled_drops = run_init( *pooled_context );
+        db->release_VM_context( std::move( pooled_context ) );
+
+        idump( (fresh_drops)(pooled_drops) );
+        BOOST_REQUIRE_EQUAL( fresh_drops, pooled_drops );
+    }
+
+    BOOST_TEST_MESSAGE( "--- Benchmark per heart beat context setup" );
+
+    pool.start( 0 );
+    auto start = fc::time_point::now();
+    for( uint32_t i = 0; i < bench_count; ++i )
+    {
+        auto context = db->acquire_VM_context();
+        db->release_VM_context( std::move( context ) );
+    }
+    int64_t unpooled_us = ( fc::time_point::now() - start ).count();
+
+    pool.start( bench_count );
+    db->release_VM_context( db->acquire_VM_context() ); //设置baseENV，开始预热
+    for( int wait = 0; wait < 1000 && pool.get_ready_size() < bench_count; ++wait )
+        std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+
+    auto old_hits = pool.get_hits();
+    start = fc::time_point::now();
+    for( uint32_t i = 0; i < bench_count; ++i )
+    {
+        auto context = db->acquire_VM_context();
+        db->release_VM_context( std::move( context ) );
+    }
+    int64_t pooled_us = ( fc::time_point::now() - start ).count();
+    auto pooled_hits = pool.get_hits() - old_hits;
+
+    ilog( "heart beat context setup: ${u} us/nfa unpooled, ${p} us/nfa pooled (${h} hits of ${n})", ("u", unpooled_us / bench_count)("p", pooled_us / bench_count)("h", pooled_hits)("n", bench_count) );
+    BOOST_REQUIRE( pooled_hits > 0 );
+
+    pool.start( 0 );
+
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
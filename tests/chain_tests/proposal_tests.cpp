@@ -1138,6 +1138,72 @@ BOOST_AUTO_TEST_CASE( update_proposal_votes_006 )
     validate_database();
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE( update_proposal_votes_incremental )
+{ try {
+    BOOST_TEST_MESSAGE( "Testing: update proposal votes: total votes are kept current between maintenance periods" );
+
+    ACTORS( (alice)(bob)(carol) )
+    vest( TAIYI_INIT_SIMING_NAME, TAIYI_DAO_ACCOUNT, ASSET( "1000.000 YANG" ) ); //执行提案需要真气
+    vest( TAIYI_INIT_SIMING_NAME, "alice", ASSET( "1000.000 YANG" ) );
+    vest( TAIYI_INIT_SIMING_NAME, "bob", ASSET( "1000.000 YANG" ) );
+    generate_block();
+    generate_xinsu({"alice", "bob"});
+    create_contract(TAIYI_INIT_SIMING_NAME, "contract.proposal.test", s_code_proposal_test);
+    create_contract(TAIYI_INIT_SIMING_NAME, "contract.xinsu.sample", s_code_xinsu_sample);
+
+    auto check_votes = [&]( int64_t id, uint64_t expected ) {
+        const auto& proposal = db->get< proposal_object, by_id >( id );
+        BOOST_REQUIRE_EQUAL( proposal.total_votes, expected );
+        proposal_processor( *db ).validate_votes();
+    };
+
+    create_proposal_data cpd(db->head_block_time());
+    int64_t proposal_1 = create_proposal(cpd.creator, cpd.contract_name, cpd.function_name, cpd.params, cpd.subject, cpd.end_date, alice_private_key);
+    BOOST_REQUIRE(proposal_1 >= 0);
+    check_votes( proposal_1, 0 );
+
+    BOOST_TEST_MESSAGE( "--- Votes are counted immediately ---" );
+    vote_proposal("alice", {proposal_1}, true, alice_private_key);
+    check_votes( proposal_1, 1 );
+    vote_proposal("bob", {proposal_1}, true, bob_private_key);
+    check_votes( proposal_1, 2 );
+    generate_block();
+    vote_proposal("bob", {proposal_1}, true, bob_private_key);
+    check_votes( proposal_1, 2 );
+    vote_proposal("alice", {proposal_1}, false, alice_private_key);
+    check_votes( proposal_1, 1 );
+
+    BOOST_TEST_MESSAGE( "--- Popped blocks restore the tally ---" );
+    generate_block();
+    vote_proposal("alice", {proposal_1}, true, alice_private_key);
+    generate_block();
+    check_votes( proposal_1, 2 );
+    db->pop_block();
+    check_votes( proposal_1, 1 );
+    generate_block();
+
+    BOOST_TEST_MESSAGE( "--- Revoked xinsu no longer counts ---" );
+    lua_map params;
+    params[lua_key(lua_int(1))] = lua_string("bob");
+    int64_t proposal_revoke = create_proposal(TAIYI_INIT_SIMING_NAME, "contract.xinsu.sample", "revoke_xinsu", params, "revoke bob", db->head_block_time() + fc::days( 2 ), init_account_priv_key);
+    vote_proposal(TAIYI_INIT_SIMING_NAME, {proposal_revoke}, true, init_account_priv_key);
+    vote_proposal("bob", {proposal_revoke}, true, bob_private_key);
+    check_votes( proposal_revoke, 2 );
+    generate_block();
+
+    auto next_block = get_nr_blocks_until_maintenance_block();
+    generate_blocks( next_block );
+    BOOST_REQUIRE( db->is_xinsu( db->get_account( "bob" ) ) == false );
+
+    //执行过的提案在下一个块被删除
+    const auto* revoked = db->find< proposal_object, by_id >( proposal_revoke );
+    if( revoked != nullptr )
+        BOOST_REQUIRE_EQUAL( revoked->total_votes, uint64_t( 1 ) );
+    proposal_processor( *db ).validate_votes();
+
+    validate_database();
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_CASE( remove_proposal_000 )
 { try {
     BOOST_TEST_MESSAGE( "Testing: remove proposal: basic verification operation - proposal removal (only one)." );
@@ -1790,6 +1856,9 @@ BOOST_AUTO_TEST_CASE( proposals_maintenance_02 )
         auto found_votes = calc_votes( proposal_vote_idx, proposals_id );
         
         BOOST_REQUIRE( current_active_anything == found_proposals + found_votes );
+        
+        //删除中断在投票中间时，留下的提案票数和剩下的投票一致
+        validate_database();
     }
     
     BOOST_REQUIRE( current_active_anything == 0 );
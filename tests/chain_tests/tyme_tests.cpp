@@ -7,6 +7,7 @@
 
 #include <protocol/taiyi_operations.hpp>
 #include <chain/account_object.hpp>
+#include <chain/util/tiandao_calendar.hpp>
 
 #include <tyme/tyme.h>
 
@@ -417,4 +418,36 @@ BOOST_AUTO_TEST_CASE( three_pillars_test_1 ) {
     BOOST_REQUIRE("甲戌 甲戌 甲戌" == SolarDay::from_ymd(1034, 10, 2).get_sixty_cycle_day().get_three_pillars().get_name());
 }
 
+BOOST_AUTO_TEST_CASE( tiandao_calendar_test ) {
+    //逐日校验抽样年份，包括首尾两年、儒略历改格里历的1582年和各种闰年规则，全部范围由programs/util/tiandao_calendar --verify校验
+    const SolarDay first_day = SolarDay::from_ymd(tiandao_calendar::start_year, 1, 1);
+    const JulianDay start_day = first_day.get_julian_day();
+    const uint32_t day_count = tiandao_calendar::get_day_count();
+    BOOST_REQUIRE(SolarDay::from_ymd(tiandao_calendar::end_year, 12, 31).subtract(first_day) == (int)day_count - 1);
+
+    tiandao_calendar calendar;
+    const int sample_years[] = { tiandao_calendar::start_year, 3, 4, 100, 1581, 1582, 1583, 1600, 1900, 2000, 2024, 2100, 5000, 9998, tiandao_calendar::end_year };
+    for (int year : sample_years) {
+        const uint32_t begin = SolarDay::from_ymd(year, 1, 1).subtract(first_day);
+        const uint32_t end = SolarDay::from_ymd(year, 12, 31).subtract(first_day);
+        for (uint32_t n = begin; n <= end; n++) {
+            const SolarDay sday = start_day.next(n).get_solar_day();
+            const auto& d = calendar.get_day(n);
+            BOOST_REQUIRE_EQUAL((int)d.year, sday.get_year());
+            BOOST_REQUIRE_EQUAL((int)d.month, sday.get_month());
+            BOOST_REQUIRE_EQUAL((int)d.day, sday.get_day());
+            BOOST_REQUIRE_EQUAL((int)d.term, sday.get_term().get_index());
+        }
+    }
+
+    //跨年随机访问
+    BOOST_REQUIRE(calendar.get_day(0).year == 2);
+    BOOST_REQUIRE(calendar.get_day(day_count - 1).year == 9999);
+    const SolarDay d1 = start_day.next(365 * 100).get_solar_day();
+    BOOST_REQUIRE(calendar.get_day(365 * 100).day == d1.get_day());
+    BOOST_REQUIRE(calendar.get_day(365 * 100).term == d1.get_term().get_index());
+
+    TAIYI_REQUIRE_THROW(calendar.get_day(day_count), fc::exception);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
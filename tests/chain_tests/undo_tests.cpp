@@ -9,6 +9,8 @@
 #include <chain/database_exceptions.hpp>
 #include <chain/taiyi_objects.hpp>
 #include <chain/account_object.hpp>
+#include <chain/contract_objects.hpp>
+#include <chain/util/undo_encoding.hpp>
 
 #include <fc/macros.hpp>
 #include <fc/crypto/digest.hpp>
@@ -480,4 +482,119 @@ BOOST_AUTO_TEST_CASE( undo_generate_blocks )
     FC_LOG_AND_RETHROW()
 }
 
+BOOST_AUTO_TEST_CASE( undo_encoded_contract_data )
+{
+    try
+    {
+        BOOST_TEST_MESSAGE( "--- Testing: undo_encoded_contract_data" );
+
+        auto make_data = []( int64_t n ) {
+            lua_map data;
+            for( int64_t i = 0; i < n; ++i )
+                data[ lua_types( lua_string( "key" + std::to_string( i ) ) ) ] = lua_types( lua_int( i ) );
+            return data;
+        };
+        const lua_map original = make_data( 50 );
+
+        const auto& acd = db->create< account_contract_data_object >( [&]( account_contract_data_object& o ) {
+            o.owner = db->get_account( TAIYI_INIT_SIMING_NAME ).id;
+            o.contract_id = contract_id_type( 1000 );
+            o.contract_data = original;
+            o.contract_data_size = fc::raw::pack_size( o.contract_data );
+        } );
+        auto id = acd.id;
+
+        auto undo_stats = [&]() {
+            for( auto idx : db->get_abstract_index_cntr() )
+            {
+                if( idx->type_id() == account_contract_data_object::type_id )
+                    return idx->get_statistics( true );
+            }
+            BOOST_FAIL( "account_contract_data_index not found" );
+            return chainbase::abstract_index::statistic_info();
+        };
+        auto require_original = [&]() {
+            const auto& o = db->get< account_contract_data_object >( id );
+            BOOST_REQUIRE( fc::raw::pack_to_vector( o.contract_data ) == fc::raw::pack_to_vector( original ) );
+            BOOST_REQUIRE_EQUAL( o.contract_data_size, fc::raw::pack_size( original ) );
+        };
+        auto touch = [&]( int64_t n ) {
+            db->modify( db->get< account_contract_data_object >( id ), [&]( account_contract_data_object& o ) {
+                o.contract_data = make_data( n );
+                o.contract_data_size = fc::raw::pack_size( o.contract_data );
+            } );
+        };
+
+        //外层可能已经有pending状态的undo session
+        auto base_items = undo_stats()._undo_state_items;
+        auto old_threshold = util::undo_encoding_threshold();
+        util::undo_encoding_threshold() = 1;
+
+        BOOST_TEST_MESSAGE( "--- modify + undo" );
+        {
+            auto session = db->start_undo_session();
+            touch( 3 );
+            touch( 4 );
+            auto stats = undo_stats();
+            BOOST_REQUIRE_EQUAL( stats._undo_state_items, base_items + 1 );
+            BOOST_REQUIRE( stats._undo_state_packed_allocation >= fc::raw::pack_size( original ) );
+            session.undo();
+        }
+        require_original();
+        BOOST_REQUIRE_EQUAL( undo_stats()._undo_state_items, base_items );
+
+        BOOST_TEST_MESSAGE( "--- modify + squash + undo" );
+        {
+            auto outer = db->start_undo_session();
+            {
+                auto inner = db->start_undo_session();
+                touch( 5 );
+                inner.squash();
+            }
+            touch( 6 );
+            outer.undo();
+        }
+        require_original();
+
+        BOOST_TEST_MESSAGE( "--- modify + remove + undo" );
+        {
+            auto session = db->start_undo_session();
+            touch( 7 );
+            db->remove( db->get< account_contract_data_object >( id ) );
+            session.undo();
+        }
+        require_original();
+
+        BOOST_TEST_MESSAGE( "--- modify, then remove in the next session + squash + undo" );
+        {
+            auto outer = db->start_undo_session();
+            touch( 8 );
+            {
+                auto inner = db->start_undo_session();
+                touch( 9 );
+                db->remove( db->get< account_contract_data_object >( id ) );
+                inner.squash();
+            }
+            BOOST_REQUIRE( db->find< account_contract_data_object >( id ) == nullptr );
+            outer.undo();
+        }
+        require_original();
+
+        BOOST_TEST_MESSAGE( "--- below threshold the old value is copied" );
+        util::undo_encoding_threshold() = fc::raw::pack_size( original ) + 1;
+        {
+            auto session = db->start_undo_session();
+            touch( 10 );
+            auto stats = undo_stats();
+            BOOST_REQUIRE_EQUAL( stats._undo_state_items, base_items + 1 );
+            BOOST_REQUIRE_EQUAL( stats._undo_state_packed_allocation, 0u );
+            session.undo();
+        }
+        require_original();
+
+        util::undo_encoding_threshold() = old_threshold;
+    }
+    FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,113 @@
+#include <boost/test/unit_test.hpp>
+
+#include <chain/lua_context.hpp>
+#include <plugins/baiyujing_api/eval_service.hpp>
+
+#include "../db_fixture/database_fixture.hpp"
+
+#include <future>
+#include <thread>
+
+using namespace taiyi::chain;
+using namespace taiyi::plugins::baiyujing_api;
+
+namespace
+{
+    void wait_for( eval_service& service, std::function< bool( const api_eval_stats& ) > condition )
+    {
+        for( int i = 0; i < 1000 && !condition( service.get_stats() ); ++i )
+            std::this_thread::sleep_for( std::chrono::milliseconds( 5 ) );
+        BOOST_REQUIRE( condition( service.get_stats() ) );
+    }
+}
+
+BOOST_FIXTURE_TEST_SUITE( eval_service_tests, json_rpc_database_fixture )
+
+BOOST_AUTO_TEST_CASE( eval_runs_with_drops_and_time_limit )
+{
+    try
+    {
+        eval_service_options options;
+        options.threads = 2;
+        options.max_drops = 12345;
+        options.timeout = fc::milliseconds( 200 );
+
+        eval_service service( *db );
+        service.start( options );
+
+        BOOST_TEST_MESSAGE( "--- Eval gets a context with baseENV and the configured drops" );
+        long long given_drops = 0;
+        int base_env_type = LUA_TNIL;
+        service.run( [&]( LuaContext& context, long long& vm_drops ) {
+            given_drops = vm_drops;
+            base_env_type = lua_getglobal( context.mState, "baseENV" );
+            lua_pop( context.mState, 1 );
+        } );
+        BOOST_REQUIRE_EQUAL( given_drops, 12345 );
+        BOOST_REQUIRE_EQUAL( base_env_type, LUA_TFUNCTION );
+
+        BOOST_TEST_MESSAGE( "--- Endless contract code is stopped at the time limit, even when catching errors" );
+        auto start = fc::time_point::now();
+        BOOST_REQUIRE_THROW( service.run( []( LuaContext& context, long long& ) {
+            if( luaL_dostring( context.mState, "while true do pcall(function() while true do end end) end" ) )
+                FC_THROW( "${e}", ("e", lua_tostring( context.mState, -1 )) );
+        } ), fc::timeout_exception );
+        BOOST_REQUIRE( fc::time_point::now() - start < fc::seconds( 5 ) );
+
+        BOOST_TEST_MESSAGE( "--- Errors of the eval are passed to the caller" );
+        BOOST_REQUIRE_THROW( service.run( []( LuaContext&, long long& ) { FC_ASSERT( false ); } ), fc::assert_exception );
+
+        auto stats = service.get_stats();
+        BOOST_REQUIRE_EQUAL( stats.accepted, 3u );
+        BOOST_REQUIRE_EQUAL( stats.completed, 1u );
+        BOOST_REQUIRE_EQUAL( stats.timed_out, 1u );
+        BOOST_REQUIRE_EQUAL( stats.failed, 1u );
+        BOOST_REQUIRE_EQUAL( stats.running, 0u );
+        BOOST_REQUIRE_EQUAL( stats.queue_depth, 0u );
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( eval_queue_admission )
+{
+    try
+    {
+        eval_service_options options;
+        options.threads = 1;
+        options.queue_size = 1;
+        options.timeout = fc::seconds( 30 );
+
+        eval_service service( *db );
+        service.start( options );
+
+        std::promise< void > release;
+        std::shared_future< void > released( release.get_future() );
+
+        BOOST_TEST_MESSAGE( "--- Occupy the only worker and the only queue place" );
+        std::thread running( [&]() { service.run( [released]( LuaContext&, long long& ) { released.wait(); } ); } );
+        wait_for( service, []( const api_eval_stats& s ) { return s.running == 1; } );
+
+        std::thread queued( [&]() { service.run( []( LuaContext&, long long& ) {} ); } );
+        wait_for( service, []( const api_eval_stats& s ) { return s.queue_depth == 1; } );
+
+        BOOST_TEST_MESSAGE( "--- More evals are rejected right away" );
+        BOOST_REQUIRE_THROW( service.run( []( LuaContext&, long long& ) {} ), fc::exception );
+
+        release.set_value();
+        running.join();
+        queued.join();
+
+        auto stats = service.get_stats();
+        BOOST_REQUIRE_EQUAL( stats.accepted, 2u );
+        BOOST_REQUIRE_EQUAL( stats.rejected, 1u );
+        BOOST_REQUIRE_EQUAL( stats.completed, 2u );
+        BOOST_REQUIRE_EQUAL( stats.max_queue_depth, 1u );
+
+        BOOST_TEST_MESSAGE( "--- Evals are accepted again once the worker is free" );
+        service.run( []( LuaContext&, long long& ) {} );
+        BOOST_REQUIRE_EQUAL( service.get_stats().completed, 3u );
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_SUITE_END()
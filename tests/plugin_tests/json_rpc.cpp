@@ -4,6 +4,12 @@
 #include <protocol/taiyi_operations.hpp>
 #include <plugins/json_rpc/json_rpc_plugin.hpp>
 
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+
+#include <chrono>
+#include <thread>
+
 #include "../db_fixture/database_fixture.hpp"
 
 using namespace taiyi::chain;
@@ -310,4 +316,133 @@ BOOST_AUTO_TEST_CASE( semantics_validation )
     FC_LOG_AND_RETHROW()
 }
 
+BOOST_AUTO_TEST_CASE( batch_execution )
+{
+    try
+    {
+        auto& rpc = appbase::app().get_plugin< taiyi::plugins::json_rpc::json_rpc_plugin >();
+        
+        boost::asio::io_service ios;
+        std::unique_ptr< boost::asio::io_service::work > work( new boost::asio::io_service::work( ios ) );
+        boost::thread_group threads;
+        for( int i = 0; i < 4; ++i )
+            threads.create_thread( boost::bind( &boost::asio::io_service::run, &ios ) );
+        
+        rpc.set_batch_executor( [&ios]( const std::function< void() >& task ) { ios.post( task ); } );
+        
+        BOOST_TEST_MESSAGE( "--- Batch responses keep the order of the requests" );
+        const int count = 40;
+        std::string request = "[";
+        for( int i = 0; i < count; ++i )
+        {
+            if( i )
+                request += ",";
+            if( i % 3 == 0 )
+                request += "{\"jsonrpc\":\"2.0\", \"method\":\"database_api.find_accounts\", \"params\":{\"accounts\":[\"init_miner\"]}, \"id\":" + std::to_string( i ) + "}";
+            else if( i % 3 == 1 )
+                request += "{\"jsonrpc\":\"2.0\", \"method\":\"database_api.get_dynamic_global_properties\", \"id\":" + std::to_string( i ) + "}";
+            else
+                request += "{\"jsonrpc\":\"2.0\", \"method\":\"fake_api.fake_method\", \"id\":" + std::to_string( i ) + "}";
+        }
+        request += "]";
+        
+        fc::variants answers = fc::json::from_string( rpc.call( request ) ).get_array();
+        BOOST_REQUIRE_EQUAL( answers.size(), count );
+        for( int i = 0; i < count; ++i )
+        {
+            const auto& answer = answers[ i ].get_object();
+            BOOST_REQUIRE_EQUAL( answer[ "id" ].as_int64(), i );
+            BOOST_REQUIRE_EQUAL( answer.contains( "error" ), i % 3 == 2 );
+        }
+        
+        BOOST_TEST_MESSAGE( "--- Latency statistics count every executed call" );
+        request = "{\"jsonrpc\":\"2.0\", \"method\":\"jsonrpc.get_method_stats\", \"params\":{\"methods\":[\"database_api.find_accounts\"]}, \"id\":1}";
+        auto stats = fc::json::from_string( rpc.call( request ) )[ "result" ];
+        auto bounds = stats[ "bucket_bounds_us" ].as< vector< uint64_t > >();
+        auto method = stats[ "stats" ].get_array()[ 0 ];
+        BOOST_REQUIRE_EQUAL( method[ "method" ].as_string(), "database_api.find_accounts" );
+        BOOST_REQUIRE_GE( method[ "count" ].as_uint64(), uint64_t( ( count + 2 ) / 3 ) );
+        
+        auto buckets = method[ "buckets" ].as< vector< uint64_t > >();
+        BOOST_REQUIRE_EQUAL( buckets.size(), bounds.size() );
+        uint64_t total = 0;
+        for( auto b : buckets )
+            total += b;
+        BOOST_REQUIRE_EQUAL( total, method[ "count" ].as_uint64() );
+        
+        rpc.set_batch_executor( taiyi::plugins::json_rpc::batch_executor() );
+        work.reset();
+        threads.join_all();
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( batch_with_state_changes_runs_in_order )
+{
+    try
+    {
+        ACTORS( (alice)(bob) )
+        generate_block();
+        
+        auto& rpc = appbase::app().get_plugin< taiyi::plugins::json_rpc::json_rpc_plugin >();
+        
+        // Not registered as read-only. The delay lets concurrent elements overlap if the batch were split.
+        rpc.add_api_method( "test_api", "push_transaction", [this]( const fc::variant& args ) -> fc::variant {
+            std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+            db->push_transaction( args.as< signed_transaction >(), 0 );
+            return fc::variant( true );
+        }, taiyi::plugins::json_rpc::api_method_signature{ fc::variant( signed_transaction() ), fc::variant( true ) } );
+        
+        boost::asio::io_service ios;
+        std::unique_ptr< boost::asio::io_service::work > work( new boost::asio::io_service::work( ios ) );
+        boost::thread_group threads;
+        for( int i = 0; i < 4; ++i )
+            threads.create_thread( boost::bind( &boost::asio::io_service::run, &ios ) );
+        
+        rpc.set_batch_executor( [&ios]( const std::function< void() >& task ) { ios.post( task ); } );
+        
+        BOOST_TEST_MESSAGE( "--- The second broadcast spends what the first one transfers" );
+        asset amount = ASSET( "1.000 YANG" );
+        asset spend = db->get_account( "alice" ).balance + amount;
+        asset bob_balance = db->get_account( "bob" ).balance;
+        
+        transfer_operation op;
+        signed_transaction tx1;
+        op.from = TAIYI_INIT_SIMING_NAME;
+        op.to = "alice";
+        op.amount = amount;
+        tx1.operations.push_back( op );
+        tx1.set_expiration( db->head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+        sign( tx1, init_account_priv_key );
+        
+        signed_transaction tx2;
+        op.from = "alice";
+        op.to = "bob";
+        op.amount = spend;
+        tx2.operations.push_back( op );
+        tx2.set_expiration( db->head_block_time() + TAIYI_MAX_TIME_UNTIL_EXPIRATION );
+        sign( tx2, alice_private_key );
+        
+        std::string request = "["
+            "{\"jsonrpc\":\"2.0\", \"method\":\"test_api.push_transaction\", \"params\":" + fc::json::to_string( tx1 ) + ", \"id\":1},"
+            "{\"jsonrpc\":\"2.0\", \"method\":\"database_api.get_dynamic_global_properties\", \"id\":2},"
+            "{\"jsonrpc\":\"2.0\", \"method\":\"test_api.push_transaction\", \"params\":" + fc::json::to_string( tx2 ) + ", \"id\":3}"
+            "]";
+        
+        fc::variants answers = fc::json::from_string( rpc.call( request ) ).get_array();
+        BOOST_REQUIRE_EQUAL( answers.size(), 3u );
+        for( const auto& answer : answers )
+            BOOST_REQUIRE( !answer.get_object().contains( "error" ) );
+        
+        BOOST_REQUIRE( db->get_account( "bob" ).balance == bob_balance + spend );
+        
+        rpc.set_batch_executor( taiyi::plugins::json_rpc::batch_executor() );
+        work.reset();
+        threads.join_all();
+        
+        validate_database();
+    }
+    FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,87 @@
+#include <boost/test/unit_test.hpp>
+
+#include <chain/account_object.hpp>
+#include <protocol/taiyi_operations.hpp>
+#include <plugins/json_rpc/json_stream.hpp>
+#include <plugins/database_api/database_api_args.hpp>
+#include <plugins/block_api/block_api_args.hpp>
+
+#include "../db_fixture/database_fixture.hpp"
+
+#include <chrono>
+
+using namespace taiyi::chain;
+using namespace taiyi::protocol;
+
+namespace
+{
+    /** Serializes value through fc::variant and through to_json_stream, checks both agree and prints the timings */
+    template< typename T >
+    void compare_serializers( const char* name, const T& value, uint32_t rounds )
+    {
+        std::string streamed;
+        taiyi::plugins::json_rpc::to_json_stream( streamed, value );
+        BOOST_REQUIRE_EQUAL( streamed, fc::json::to_string( fc::variant( value ) ) );
+
+        size_t bytes = 0;
+        auto start = std::chrono::steady_clock::now();
+        for( uint32_t i = 0; i < rounds; ++i )
+            bytes += fc::json::to_string( fc::variant( value ) ).size();
+        auto variant_us = std::chrono::duration_cast< std::chrono::microseconds >( std::chrono::steady_clock::now() - start ).count();
+
+        start = std::chrono::steady_clock::now();
+        for( uint32_t i = 0; i < rounds; ++i )
+        {
+            std::string out;
+            taiyi::plugins::json_rpc::to_json_stream( out, value );
+            bytes -= out.size();
+        }
+        auto stream_us = std::chrono::duration_cast< std::chrono::microseconds >( std::chrono::steady_clock::now() - start ).count();
+
+        BOOST_REQUIRE_EQUAL( bytes, 0u );
+        BOOST_TEST_MESSAGE( name << ": " << streamed.size() << " bytes, variant " << variant_us << "us, stream " << stream_us << "us for " << rounds << " rounds" );
+    }
+}
+
+BOOST_FIXTURE_TEST_SUITE( json_stream, json_rpc_database_fixture )
+
+BOOST_AUTO_TEST_CASE( stream_serialization_benchmark )
+{
+    try
+    {
+        ACTORS( (alice)(bob)(charlie) )
+        generate_block();
+
+        for( int i = 0; i < 20; ++i )
+        {
+            transfer( TAIYI_INIT_SIMING_NAME, "alice", asset( 1000 + i, YANG_SYMBOL ) );
+            transfer( TAIYI_INIT_SIMING_NAME, "bob", asset( 2000 + i, YANG_SYMBOL ) );
+        }
+        generate_block();
+
+        BOOST_TEST_MESSAGE( "--- Accounts" );
+        taiyi::plugins::database_api::list_accounts_return accounts;
+        const auto& account_idx = db->get_index< account_index, by_id >();
+        while( accounts.accounts.size() < 500 )
+            for( const auto& a : account_idx )
+                accounts.accounts.emplace_back( a, *db );
+        compare_serializers( "list_accounts", accounts, 20 );
+
+        BOOST_TEST_MESSAGE( "--- Block" );
+        taiyi::plugins::block_api::get_block_return block;
+        auto b = db->fetch_block_by_number( db->head_block_num() );
+        BOOST_REQUIRE( b.valid() );
+        BOOST_REQUIRE( b->transactions.size() > 0 );
+        block.block = taiyi::plugins::block_api::api_signed_block_object( *b );
+        compare_serializers( "get_block", block, 200 );
+
+        BOOST_TEST_MESSAGE( "--- Missing block" );
+        compare_serializers( "get_block (null)", taiyi::plugins::block_api::get_block_return(), 1 );
+
+        BOOST_TEST_MESSAGE( "--- Strings that need escaping" );
+        compare_serializers( "string", std::string( "a\"b\\c\n\t\x01\x1f/\xe5\xa4\xaa" ), 1 );
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_SUITE_END()